@@ -102,9 +102,11 @@ namespace pcl
       bool quit_;
       bool running_;
 
-      boost::thread timer_thread_;
+      // the thread is started in the constructor, declare it last so it only
+      // runs once the condition and mutex are constructed
       boost::condition_variable condition_;
       boost::mutex condition_mutex_;
+      boost::thread timer_thread_;
   };
 }
 
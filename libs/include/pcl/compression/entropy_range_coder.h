@@ -190,6 +190,132 @@ namespace pcl
     std::vector<char> outputCharVector_;
 
   };
+
+  //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+  /** \brief @b StaticRansCoder compression class
+   *  \note This class provides static asymmetric numeral system (rANS) coding with the interface of StaticRangeCoder.
+   *  \note Symbol frequencies are normalized to a power of two and encoded to the output stream. Encoding uses
+   *  \note precomputed reciprocals instead of divisions, decoding a slot to symbol lookup table. The coded data is
+   *  \note prefixed with its size, so it is read from the stream in a single call.
+   *  \note
+   */
+  //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+  class StaticRansCoder
+  {
+
+  public:
+
+    /** \brief Empty constructor. */
+    StaticRansCoder ()
+    {
+
+    }
+
+    /** \brief Empty deconstructor. */
+    virtual
+    ~StaticRansCoder ()
+    {
+
+    }
+
+    /** \brief Encode integer vector to output stream
+     * \param inputIntVector_arg input vector
+     * \param outputByterStream_arg output stream containing compressed data
+     * \return amount of bytes written to output stream
+     */
+    unsigned long
+    encodeIntVectorToStream (std::vector<unsigned int>& inputIntVector_arg, std::ostream& outputByterStream_arg);
+
+    /** \brief Decode stream to output integer vector
+     * \param inputByteStream_arg input stream of compressed data
+     * \param outputIntVector_arg decompressed output vector
+     * \return amount of bytes read from input stream
+     */
+    unsigned long
+    decodeStreamToIntVector (std::istream& inputByteStream_arg, std::vector<unsigned int>& outputIntVector_arg);
+
+    /** \brief Encode char vector to output stream
+     * \param inputByteVector_arg input vector
+     * \param outputByteStream_arg output stream containing compressed data
+     * \return amount of bytes written to output stream
+     */
+    unsigned long
+    encodeCharVectorToStream (const std::vector<char>& inputByteVector_arg, std::ostream& outputByteStream_arg);
+
+    /** \brief Decode char stream to output vector
+     * \param inputByteStream_arg input stream of compressed data
+     * \param outputByteVector_arg decompressed output vector
+     * \return amount of bytes read from input stream
+     */
+    unsigned long
+    decodeStreamToCharVector (std::istream& inputByteStream_arg, std::vector<char>& outputByteVector_arg);
+
+  protected:
+    typedef boost::uint32_t DWord; // 4 bytes
+
+    /** \brief Precision of the normalized symbol frequencies */
+    static const unsigned int scaleBits_ = 14;
+
+    /** \brief Lower bound of the normalized coder state */
+    static const DWord lowerBound_ = (DWord)1 << 23;
+
+    /** \brief Symbol values of integer vectors from this value on are escaped and stored uncoded */
+    static const unsigned int escapeSymbol_ = 255;
+
+    /** \brief Per symbol encoding constants, see initEncodingTable */
+    struct EncodingSymbol
+    {
+      DWord xMax;
+      DWord rcpFreq;
+      DWord bias;
+      DWord cmplFreq;
+      DWord rcpShift;
+    };
+
+    /** \brief Encode byte symbols to output stream
+     * \param symbols_arg pointer to the symbols
+     * \param size_arg amount of symbols
+     * \param outputByteStream_arg output stream containing compressed data
+     * \return amount of bytes written to output stream
+     */
+    unsigned long
+    encodeSymbols (const uint8_t* symbols_arg, std::size_t size_arg, std::ostream& outputByteStream_arg);
+
+    /** \brief Decode byte symbols from input stream
+     * \param inputByteStream_arg input stream of compressed data
+     * \param symbols_arg pointer to the decoded symbols
+     * \param size_arg amount of symbols to decode
+     * \return amount of bytes read from input stream
+     */
+    unsigned long
+    decodeSymbols (std::istream& inputByteStream_arg, uint8_t* symbols_arg, std::size_t size_arg);
+
+    /** \brief Scale symbol frequencies to a sum of (1 << scaleBits_), keeping every used symbol
+     * \param freq_arg symbol frequencies, replaced by the normalized ones
+     * \param total_arg sum of the frequencies
+     */
+    void
+    normalizeFrequencies (DWord* freq_arg, std::size_t total_arg);
+
+  private:
+    /** normalized symbol frequencies and their cumulative sums */
+    DWord freq_[256];
+    DWord cFreq_[257];
+
+    /** encoding constants of every symbol */
+    EncodingSymbol encodingTable_[256];
+
+    /** slot to symbol lookup table used for decoding */
+    uint8_t decodingTable_[1 << scaleBits_];
+
+    /** vector containing compressed data, filled from the back while encoding */
+    std::vector<uint8_t> outputCharVector_;
+
+    /** symbols of integer vectors and their escaped values */
+    std::vector<uint8_t> symbolVector_;
+    std::vector<DWord> escapeVector_;
+
+  };
 }
 
 
@@ -687,6 +687,355 @@ namespace pcl
 
   }
 
+  //////////////////////////////////////////////////////////////////////////////////////////////
+  unsigned long
+  StaticRansCoder::encodeIntVectorToStream (std::vector<unsigned int>& inputIntVector_arg,
+                                            std::ostream& outputByteStream_arg)
+  {
+    std::size_t i;
+    std::size_t input_size = inputIntVector_arg.size ();
+    unsigned long streamByteCount;
+
+    // map values to byte symbols, large values are escaped and stored as they are
+    symbolVector_.resize (input_size);
+    escapeVector_.clear ();
+    for (i = 0; i < input_size; i++)
+    {
+      const unsigned int value = inputIntVector_arg[i];
+      if (value < escapeSymbol_)
+      {
+        symbolVector_[i] = (uint8_t)value;
+      }
+      else
+      {
+        symbolVector_[i] = (uint8_t)escapeSymbol_;
+        escapeVector_.push_back (value);
+      }
+    }
+
+    streamByteCount = encodeSymbols (input_size ? &symbolVector_[0] : NULL, input_size, outputByteStream_arg);
+
+    // write escaped values
+    DWord escapeCount = escapeVector_.size ();
+    outputByteStream_arg.write ((const char*)&escapeCount, sizeof(escapeCount));
+    if (escapeCount)
+      outputByteStream_arg.write ((const char*)&escapeVector_[0], sizeof(DWord) * escapeCount);
+
+    streamByteCount += sizeof(escapeCount) + sizeof(DWord) * escapeCount;
+
+    return streamByteCount;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+  unsigned long
+  StaticRansCoder::decodeStreamToIntVector (std::istream& inputByteStream_arg,
+                                            std::vector<unsigned int>& outputIntVector_arg)
+  {
+    std::size_t i, escapePos;
+    std::size_t output_size = outputIntVector_arg.size ();
+    unsigned long streamByteCount;
+
+    symbolVector_.resize (output_size);
+    streamByteCount = decodeSymbols (inputByteStream_arg, output_size ? &symbolVector_[0] : NULL, output_size);
+
+    // read escaped values
+    DWord escapeCount = 0;
+    inputByteStream_arg.read ((char*)&escapeCount, sizeof(escapeCount));
+    escapeVector_.resize (escapeCount);
+    if (escapeCount)
+      inputByteStream_arg.read ((char*)&escapeVector_[0], sizeof(DWord) * escapeCount);
+
+    streamByteCount += sizeof(escapeCount) + sizeof(DWord) * escapeCount;
+
+    escapePos = 0;
+    for (i = 0; i < output_size; i++)
+    {
+      const uint8_t symbol = symbolVector_[i];
+      if (symbol != escapeSymbol_)
+        outputIntVector_arg[i] = symbol;
+      else
+        outputIntVector_arg[i] = (escapePos < escapeCount) ? escapeVector_[escapePos++] : 0;
+    }
+
+    return streamByteCount;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+  unsigned long
+  StaticRansCoder::encodeCharVectorToStream (const std::vector<char>& inputByteVector_arg,
+                                             std::ostream& outputByteStream_arg)
+  {
+    const std::size_t input_size = inputByteVector_arg.size ();
+    return encodeSymbols (input_size ? (const uint8_t*)&inputByteVector_arg[0] : NULL, input_size,
+                          outputByteStream_arg);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+  unsigned long
+  StaticRansCoder::decodeStreamToCharVector (std::istream& inputByteStream_arg,
+                                             std::vector<char>& outputByteVector_arg)
+  {
+    const std::size_t output_size = outputByteVector_arg.size ();
+    return decodeSymbols (inputByteStream_arg, output_size ? (uint8_t*)&outputByteVector_arg[0] : NULL,
+                          output_size);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+  void
+  StaticRansCoder::normalizeFrequencies (DWord* freq_arg, std::size_t total_arg)
+  {
+    const DWord totalScale = (DWord)1 << scaleBits_;
+    unsigned int s;
+    DWord sum;
+
+    // scale frequencies, symbols in use keep at least one slot
+    sum = 0;
+    for (s = 0; s < 256; s++)
+    {
+      if (!freq_arg[s])
+        continue;
+
+      DWord f = (DWord)(((uint64_t)freq_arg[s] * totalScale) / total_arg);
+      if (f == 0)
+        f = 1;
+
+      freq_arg[s] = f;
+      sum += f;
+    }
+
+    // move the rounding error to the most frequent symbols
+    while (sum != totalScale)
+    {
+      unsigned int maxSymbol = 0;
+      for (s = 1; s < 256; s++)
+      {
+        if (freq_arg[s] > freq_arg[maxSymbol])
+          maxSymbol = s;
+      }
+
+      if (sum < totalScale)
+      {
+        freq_arg[maxSymbol] += totalScale - sum;
+        sum = totalScale;
+      }
+      else
+      {
+        const DWord take = std::min (sum - totalScale, freq_arg[maxSymbol] - 1);
+        freq_arg[maxSymbol] -= take;
+        sum -= take;
+      }
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+  unsigned long
+  StaticRansCoder::encodeSymbols (const uint8_t* symbols_arg, std::size_t size_arg,
+                                  std::ostream& outputByteStream_arg)
+  {
+    const DWord totalScale = (DWord)1 << scaleBits_;
+    DWord histogram[4][256];
+    uint8_t symbolSet[32];
+    std::size_t i;
+    unsigned int s;
+
+    unsigned long streamByteCount;
+
+    streamByteCount = 0;
+
+    // symbol histogram, four interleaved tables avoid stalls on runs of the same symbol
+    memset (histogram, 0, sizeof(histogram));
+    for (i = 0; i + 4 <= size_arg; i += 4)
+    {
+      histogram[0][symbols_arg[i]]++;
+      histogram[1][symbols_arg[i + 1]]++;
+      histogram[2][symbols_arg[i + 2]]++;
+      histogram[3][symbols_arg[i + 3]]++;
+    }
+    for (; i < size_arg; i++)
+      histogram[0][symbols_arg[i]]++;
+
+    for (s = 0; s < 256; s++)
+      freq_[s] = histogram[0][s] + histogram[1][s] + histogram[2][s] + histogram[3][s];
+
+    if (size_arg)
+      normalizeFrequencies (freq_, size_arg);
+
+    // write set of used symbols and their frequencies
+    memset (symbolSet, 0, sizeof(symbolSet));
+    for (s = 0; s < 256; s++)
+    {
+      if (freq_[s])
+        symbolSet[s >> 3] |= (uint8_t)(1 << (s & 7));
+    }
+    outputByteStream_arg.write ((const char*)symbolSet, sizeof(symbolSet));
+    streamByteCount += sizeof(symbolSet);
+
+    for (s = 0; s < 256; s++)
+    {
+      if (freq_[s])
+      {
+        const boost::uint16_t f = (boost::uint16_t)freq_[s];
+        outputByteStream_arg.write ((const char*)&f, sizeof(f));
+        streamByteCount += sizeof(f);
+      }
+    }
+
+    // cumulative frequencies and encoding constants, divisions by the frequency are replaced by a
+    // multiplication with its reciprocal and a shift
+    cFreq_[0] = 0;
+    for (s = 0; s < 256; s++)
+    {
+      const DWord freq = freq_[s];
+      EncodingSymbol& symbol = encodingTable_[s];
+
+      cFreq_[s + 1] = cFreq_[s] + freq;
+      if (!freq)
+        continue;
+
+      symbol.xMax = ((lowerBound_ >> scaleBits_) << 8) * freq;
+      symbol.cmplFreq = totalScale - freq;
+      if (freq < 2)
+      {
+        symbol.rcpFreq = ~(DWord)0;
+        symbol.rcpShift = 0;
+        symbol.bias = cFreq_[s] + totalScale - 1;
+      }
+      else
+      {
+        DWord shift = 0;
+        while (freq > ((DWord)1 << shift))
+          shift++;
+
+        symbol.rcpFreq = (DWord)((((uint64_t)1 << (shift + 31)) + freq - 1) / freq);
+        symbol.rcpShift = shift - 1;
+        symbol.bias = cFreq_[s];
+      }
+      symbol.rcpShift += 32;
+    }
+
+    // encode in reverse order into the end of the output buffer,
+    // a symbol emits at most two bytes, the final state takes four
+    const std::size_t bufferSize = size_arg * 2 + sizeof(DWord);
+    if (outputCharVector_.size () < bufferSize)
+      outputCharVector_.resize (bufferSize);
+
+    uint8_t* const end = &outputCharVector_[0] + bufferSize;
+    uint8_t* ptr = end;
+    DWord x = lowerBound_;
+
+    for (i = size_arg; i > 0; i--)
+    {
+      const EncodingSymbol& symbol = encodingTable_[symbols_arg[i - 1]];
+
+      // renormalize
+      while (x >= symbol.xMax)
+      {
+        *--ptr = (uint8_t)(x & 0xff);
+        x >>= 8;
+      }
+
+      // x = (x / freq) * totalScale + (x % freq) + cFreq
+      const DWord q = (DWord)(((uint64_t)x * symbol.rcpFreq) >> symbol.rcpShift);
+      x += symbol.bias + q * symbol.cmplFreq;
+    }
+
+    // flush coder state
+    ptr -= 4;
+    ptr[0] = (uint8_t)(x >> 0);
+    ptr[1] = (uint8_t)(x >> 8);
+    ptr[2] = (uint8_t)(x >> 16);
+    ptr[3] = (uint8_t)(x >> 24);
+
+    // write encoded data to stream
+    DWord codedSize = (DWord)(end - ptr);
+    outputByteStream_arg.write ((const char*)&codedSize, sizeof(codedSize));
+    outputByteStream_arg.write ((const char*)ptr, codedSize);
+
+    streamByteCount += sizeof(codedSize) + codedSize;
+
+    return streamByteCount;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////
+  unsigned long
+  StaticRansCoder::decodeSymbols (std::istream& inputByteStream_arg, uint8_t* symbols_arg, std::size_t size_arg)
+  {
+    const DWord totalScale = (DWord)1 << scaleBits_;
+    uint8_t symbolSet[32];
+    std::size_t i;
+    unsigned int s;
+
+    unsigned long streamByteCount;
+
+    streamByteCount = 0;
+
+    // read set of used symbols and their frequencies
+    inputByteStream_arg.read ((char*)symbolSet, sizeof(symbolSet));
+    streamByteCount += sizeof(symbolSet);
+
+    cFreq_[0] = 0;
+    for (s = 0; s < 256; s++)
+    {
+      freq_[s] = 0;
+      if (symbolSet[s >> 3] & (1 << (s & 7)))
+      {
+        boost::uint16_t f = 0;
+        inputByteStream_arg.read ((char*)&f, sizeof(f));
+        streamByteCount += sizeof(f);
+        freq_[s] = f;
+      }
+      cFreq_[s + 1] = cFreq_[s] + freq_[s];
+    }
+
+    // read encoded data
+    DWord codedSize = 0;
+    inputByteStream_arg.read ((char*)&codedSize, sizeof(codedSize));
+    if (!inputByteStream_arg)
+      return (streamByteCount);
+
+    if (outputCharVector_.size () < codedSize)
+      outputCharVector_.resize (codedSize);
+    if (codedSize)
+      inputByteStream_arg.read ((char*)&outputCharVector_[0], codedSize);
+
+    streamByteCount += sizeof(codedSize) + codedSize;
+
+    // corrupt frequency table or data
+    if (!size_arg || cFreq_[256] != totalScale || codedSize < sizeof(DWord))
+      return (streamByteCount);
+
+    // slot to symbol lookup table
+    for (s = 0; s < 256; s++)
+    {
+      if (freq_[s])
+        memset (&decodingTable_[cFreq_[s]], s, freq_[s]);
+    }
+
+    const uint8_t* ptr = &outputCharVector_[0];
+    const uint8_t* const end = ptr + codedSize;
+
+    // initialize coder state
+    DWord x = (DWord)ptr[0] | ((DWord)ptr[1] << 8) | ((DWord)ptr[2] << 16) | ((DWord)ptr[3] << 24);
+    ptr += 4;
+
+    for (i = 0; i < size_arg; i++)
+    {
+      const DWord slot = x & (totalScale - 1);
+      const uint8_t symbol = decodingTable_[slot];
+
+      symbols_arg[i] = symbol;
+
+      // x = freq * (x / totalScale) + (x % totalScale) - cFreq
+      x = freq_[symbol] * (x >> scaleBits_) + slot - cFreq_[symbol];
+
+      // renormalize
+      while ((x < lowerBound_) && (ptr < end))
+        x = (x << 8) | *ptr++;
+    }
+
+    return (streamByteCount);
+  }
+
 }
 
 #endif
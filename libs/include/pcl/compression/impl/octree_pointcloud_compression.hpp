@@ -45,6 +45,7 @@
 #include <vector>
 #include <string.h>
 #include <iostream>
+#include <sstream>
 #include <stdio.h>
 
 
@@ -59,6 +60,42 @@ namespace pcl
       void
       PointCloudCompression<PointT, LeafT, OctreeT>::encodePointCloud (const PointCloudConstPtr &cloud_arg,
                                                                        std::ostream& compressedTreeDataOut_arg)
+      {
+        // octree stage
+        this->encodeFrame (cloud_arg, frameData_);
+
+        // apply entropy coding to the content of all data vectors and send data to output stream
+        this->writeFrame (frameData_, compressedTreeDataOut_arg);
+
+        compressedPointDataLen_ = frameData_.compressedPointDataLen;
+        compressedColorDataLen_ = frameData_.compressedColorDataLen;
+
+        if (bShowStatistics)
+          this->printStatistics ("ENCODING");
+      }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    template<typename PointT, typename LeafT, typename OctreeT>
+      void
+      PointCloudCompression<PointT, LeafT, OctreeT>::decodePointCloud (std::istream& compressedTreeDataIn_arg,
+                                                             PointCloudPtr &cloud_arg)
+      {
+        // read header and data vectors from input stream
+        if (!this->readFrame (compressedTreeDataIn_arg, frameData_))
+          return;
+
+        // octree stage
+        this->decodeFrame (frameData_, cloud_arg);
+
+        if (bShowStatistics)
+          this->printStatistics ("DECODING");
+      }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    template<typename PointT, typename LeafT, typename OctreeT>
+      void
+      PointCloudCompression<PointT, LeafT, OctreeT>::encodeFrame (const PointCloudConstPtr &cloud_arg,
+                                                                  FrameData &frame_arg)
       {
         unsigned char recentTreeDepth;
         recentTreeDepth = this->getTreeDepth ();
@@ -116,6 +153,9 @@ namespace pcl
         pointCoder_.initializeEncoding ();
         pointCoder_.setPointCount (cloud_arg->points.size ());
 
+        serializedLeafIdx_.clear ();
+        serializedLeafKey_.clear ();
+
         // serialize octree
         if (iFrame_) {
           // i-frame encoding - encode tree structure without referencing previous buffer
@@ -125,372 +165,443 @@ namespace pcl
           this->serializeTree (binaryTreeDataVector_, true);
         }
 
-        // write frame header information to stream
-        this->writeFrameHeader (compressedTreeDataOut_arg);
-
-        // apply entropy coding to the content of all data vectors and send data to output stream
-        this->entropyEncoding (compressedTreeDataOut_arg);
-
-        if (bShowStatistics)
+        // point detail and color coding of the serialized leaves, the two coders don't share any state
+        const std::size_t leafCount = serializedLeafIdx_.size ();
+#pragma omp parallel sections
         {
-          float bytesPerXYZ;
-          float bytesPerColor;
-
-          bytesPerXYZ = (float)compressedPointDataLen_ / (float)pointCount_;
-          bytesPerColor = (float)compressedColorDataLen_ / (float)pointCount_;
-
-
-          std::cerr << "*** POINTCLOUD ENCODING ***" << std::endl;
-          std::cerr << "Frame ID: " << frameID_ << std::endl;
-          if (iFrame_)
+#pragma omp section
           {
-            std::cerr << "Encoding Frame: Intra frame" << std::endl;
+            if (!doVoxelGridEnDecoding_)
+            {
+              for (std::size_t i = 0; i < leafCount; i++)
+              {
+                const OctreeKey& key = serializedLeafKey_[i];
+                double lowerVoxelCorner[3];
+
+                // calculate lower voxel corner based on octree key
+                lowerVoxelCorner[0] = ((double)key.x) * this->resolution_ + this->minX_;
+                lowerVoxelCorner[1] = ((double)key.y) * this->resolution_ + this->minY_;
+                lowerVoxelCorner[2] = ((double)key.z) * this->resolution_ + this->minZ_;
+
+                // differentially encode points to lower voxel corner
+                pointCoder_.encodePoints (*serializedLeafIdx_[i], lowerVoxelCorner, this->input_);
+              }
+            }
           }
-          else
+#pragma omp section
           {
-            std::cerr << "Encoding Frame: Prediction frame" << std::endl;
+            if (cloudWithColor_)
+            {
+              for (std::size_t i = 0; i < leafCount; i++)
+              {
+                if (!doVoxelGridEnDecoding_)
+                  // encode color of points
+                  colorCoder_.encodePoints (*serializedLeafIdx_[i], pointColorOffset_, this->input_);
+                else
+                  // encode average color of all points within voxel
+                  colorCoder_.encodeAverageOfPoints (*serializedLeafIdx_[i], pointColorOffset_, this->input_);
+              }
+            }
           }
-          std::cerr << "Number of encoded points: " << pointCount_ << std::endl;
-          std::cerr << "XYZ compression percentage: " << bytesPerXYZ / (3.0f * sizeof(float)) * 100.0f
-              << "%" << std::endl;
-          std::cerr << "XYZ bytes per point: " << bytesPerXYZ << " bytes" << std::endl;
-          std::cerr << "Color compression percentage: " << bytesPerColor / (sizeof(int)) * 100.0f << "%" << std::endl;
-          std::cerr << "Color bytes per point: " << bytesPerColor << " bytes" << std::endl;
-          std::cerr << "Size of uncompressed point cloud: " <<
-              pointCount_* (sizeof(int) + 3.0f  * sizeof(float))  / (1024) << " kBytes" << std::endl;
-          std::cerr << "Size of compressed point cloud: " <<
-              (compressedPointDataLen_ + compressedColorDataLen_) / (1024) << " kBytes" << std::endl;
-          std::cerr << "Total bytes per point: " << bytesPerXYZ + bytesPerColor << " bytes" << std::endl;
-          std::cerr << "Total compression percentage: " << (bytesPerXYZ + bytesPerColor) / (sizeof(int) + 3.0f
-              * sizeof(float)) * 100.0f << "%" << std::endl;
-          std::cerr << "Compression ratio: " << (float)(sizeof(int) + 3.0f  * sizeof(float))
-              / (float)(bytesPerXYZ + bytesPerColor)  << std::endl << std::endl;
         }
 
+        // encode amount of points
+        if (iFrame_)
+        {
+          if (doVoxelGridEnDecoding_)
+            pointCount_ = this->leafCount_;
+          else
+            pointCount_ = this->objectCount_;
+        }
+
+        // frame header
+        FrameHeader& header = frame_arg.header;
+        header.frameID = frameID_;
+        header.iFrame = iFrame_;
+        header.entropyCoding = entropyCoding_;
+        header.doVoxelGridEnDecoding = doVoxelGridEnDecoding_;
+        header.withColor = cloudWithColor_;
+        header.pointCount = pointCount_;
+        header.octreeResolution = this->getResolution ();
+        header.colorBitDepth = colorCoder_.getBitDepth ();
+        header.pointResolution = pointCoder_.getPrecision ();
+        this->getBoundingBox (header.minX, header.minY, header.minZ, header.maxX, header.maxY, header.maxZ);
+
+        // hand over the data vectors, the coders continue with the buffers of the previous frame
+        frame_arg.binaryTree.swap (binaryTreeDataVector_);
+        frame_arg.averageColor.swap (colorCoder_.getAverageDataVector ());
+        frame_arg.pointCount.swap (pointCountDataVector_);
+        frame_arg.pointDiff.swap (pointCoder_.getDifferentialDataVector ());
+        frame_arg.colorDiff.swap (colorCoder_.getDifferentialDataVector ());
+
+        frame_arg.compressedPointDataLen = 0;
+        frame_arg.compressedColorDataLen = 0;
       }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
     template<typename PointT, typename LeafT, typename OctreeT>
       void
-      PointCloudCompression<PointT, LeafT, OctreeT>::decodePointCloud (std::istream& compressedTreeDataIn_arg,
-                                                             PointCloudPtr &cloud_arg)
+      PointCloudCompression<PointT, LeafT, OctreeT>::writeFrame (FrameData &frame_arg,
+                                                                 std::ostream& compressedTreeDataOut_arg)
       {
+        const FrameHeader& header = frame_arg.header;
 
-        // initialize octree
-        this->switchBuffers ();
-        this->setOutputCloud (cloud_arg);
+        // encode header identifier, which also tells the entropy coder
+        const char* headerIdentifier = (header.entropyCoding == RANS_CODING) ? ransFrameHeaderIdentifier_
+                                                                             : frameHeaderIdentifier_;
+        compressedTreeDataOut_arg.write (headerIdentifier, strlen(headerIdentifier));
 
-        // color field analysis
-        cloudWithColor_ = false;
-        std::vector<sensor_msgs::PointField> fields;
-        int rgba_index = -1;
-        rgba_index = pcl::getFieldIndex (*output_, "rgb", fields);
-        if (rgba_index == -1)
-        {
-          rgba_index = pcl::getFieldIndex (*output_, "rgba", fields);
-        }
-        if (rgba_index >= 0)
-        {
-          pointColorOffset_ = fields[rgba_index].offset;
-          cloudWithColor_ = true;
-        }
+        // encode point cloud header id
+        compressedTreeDataOut_arg.write ((const char*)&header.frameID, sizeof(header.frameID));
 
+        // encode frame type (I/P-frame)
+        compressedTreeDataOut_arg.write ((const char*)&header.iFrame, sizeof(header.iFrame));
+        if (header.iFrame)
+        {
+          // encode coding configuration
+          compressedTreeDataOut_arg.write ((const char*)&header.doVoxelGridEnDecoding, sizeof(header.doVoxelGridEnDecoding));
+          compressedTreeDataOut_arg.write ((const char*)&header.withColor, sizeof(header.withColor));
+          compressedTreeDataOut_arg.write ((const char*)&header.pointCount, sizeof(header.pointCount));
+          compressedTreeDataOut_arg.write ((const char*)&header.octreeResolution, sizeof(header.octreeResolution));
+          compressedTreeDataOut_arg.write ((const char*)&header.colorBitDepth, sizeof(header.colorBitDepth));
+          compressedTreeDataOut_arg.write ((const char*)&header.pointResolution, sizeof(header.pointResolution));
 
-        // read header from input stream
-        this->readFrameHeader (compressedTreeDataIn_arg);
+          // encode octree bounding box
+          compressedTreeDataOut_arg.write ((const char*)&header.minX, sizeof(header.minX));
+          compressedTreeDataOut_arg.write ((const char*)&header.minY, sizeof(header.minY));
+          compressedTreeDataOut_arg.write ((const char*)&header.minZ, sizeof(header.minZ));
+          compressedTreeDataOut_arg.write ((const char*)&header.maxX, sizeof(header.maxX));
+          compressedTreeDataOut_arg.write ((const char*)&header.maxY, sizeof(header.maxY));
+          compressedTreeDataOut_arg.write ((const char*)&header.maxZ, sizeof(header.maxZ));
+        }
 
-        // decode data vectors from stream
-        this->entropyDecoding (compressedTreeDataIn_arg);
+        const bool withColor = header.withColor;
+        const bool withDetail = !header.doVoxelGridEnDecoding;
 
-        // initialize color and point encoding
-        colorCoder_.initializeDecoding ();
-        pointCoder_.initializeDecoding ();
+        // entropy code the data vectors in parallel, each with its own coder
+        std::ostringstream codedData[5];
+        unsigned long codedLen[5] = { 0, 0, 0, 0, 0 };
 
-        // initialize output cloud
-        output_->points.clear ();
-        output_->points.reserve (pointCount_);
-
-        if (iFrame_)
-          // i-frame decoding - decode tree structure without referencing previous buffer
-          this->deserializeTree (binaryTreeDataVector_, false);
+        if (header.entropyCoding == RANS_CODING)
+          this->encodeDataVectors (ransCoder_, frame_arg, codedData, codedLen);
         else
-          // p-frame decoding - decode XOR encoded tree structure
-          this->deserializeTree (binaryTreeDataVector_, true);
+          this->encodeDataVectors (entropyCoder_, frame_arg, codedData, codedLen);
 
-        // assign point cloud properties
-        output_->height = 1;
-        output_->width = cloud_arg->points.size ();
-        output_->is_dense = false;
+        // output in stream order: size of the data vector followed by its coded content
+        const unsigned long vectorSize[5] = { frame_arg.binaryTree.size (), frame_arg.averageColor.size (),
+                                              frame_arg.pointCount.size (), frame_arg.pointDiff.size (),
+                                              frame_arg.colorDiff.size () };
+        const bool vectorUsed[5] = { true, withColor, withDetail, withDetail, withDetail && withColor };
 
-        if (bShowStatistics)
+        for (int i = 0; i < 5; i++)
         {
-          float bytesPerXYZ;
-          float bytesPerColor;
-
-          bytesPerXYZ = (float)compressedPointDataLen_ / (float)pointCount_;
-          bytesPerColor = (float)compressedColorDataLen_ / (float)pointCount_;
+          if (!vectorUsed[i])
+            continue;
 
-          std::cerr << "*** POINTCLOUD DECODING ***" << std::endl;
-          std::cerr << "Frame ID: " << frameID_ << std::endl;
-          if (iFrame_)
-            std::cerr << "Encoding Frame: Intra frame" << std::endl;
-          else
-            std::cerr << "Encoding Frame: Prediction frame" << std::endl;
-          std::cerr << "Number of encoded points: " << pointCount_ << std::endl;
-          std::cerr << "XYZ compression percentage: " << bytesPerXYZ / (3.0f * sizeof(float)) * 100.0f
-                    << "%" << std::endl;
-          std::cerr << "XYZ bytes per point: " << bytesPerXYZ << " bytes" << std::endl;
-          std::cerr << "Color compression percentage: " << bytesPerColor / (sizeof(int)) * 100.0f 
-                    << "%" << std::endl;
-          std::cerr << "Color bytes per point: " << bytesPerColor << " bytes" << std::endl;
-          std::cerr << "Size of uncompressed point cloud: " 
-                    << pointCount_* (sizeof(int) + 3.0f  * sizeof(float))  / (1024) << " kBytes" << std::endl;
-          std::cerr << "Size of compressed point cloud: " 
-                    << (compressedPointDataLen_ + compressedColorDataLen_) / (1024) << " kBytes" << std::endl;
-          std::cerr << "Total bytes per point: " << bytesPerXYZ + bytesPerColor << " bytes" << std::endl;
-          std::cerr << "Total compression percentage: " 
-                    << (bytesPerXYZ + bytesPerColor) / (sizeof(int) + 3.0f * sizeof(float)) * 100.0f 
-                    << "%" << std::endl;
-          std::cerr << "Compression ratio: " 
-                    << (float)(sizeof(int) + 3.0f  * sizeof(float)) / (float)(bytesPerXYZ + bytesPerColor) 
-                    << std::endl << std::endl;
+          const std::string coded = codedData[i].str ();
+          compressedTreeDataOut_arg.write ((const char*)&vectorSize[i], sizeof(vectorSize[i]));
+          compressedTreeDataOut_arg.write (coded.data (), coded.size ());
         }
+
+        frame_arg.compressedPointDataLen = codedLen[0] + codedLen[2] + codedLen[3];
+        frame_arg.compressedColorDataLen = codedLen[1] + codedLen[4];
+
+        // flush output stream
+        compressedTreeDataOut_arg.flush ();
       }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
     template<typename PointT, typename LeafT, typename OctreeT>
-      void
-      PointCloudCompression<PointT, LeafT, OctreeT>::entropyEncoding (std::ostream& compressedTreeDataOut_arg)
+      bool
+      PointCloudCompression<PointT, LeafT, OctreeT>::readFrame (std::istream& compressedTreeDataIn_arg,
+                                                                FrameData &frame_arg)
       {
-        unsigned long binaryTreeDataVector_size;
-        unsigned long pointAvgColorDataVector_size;
+        // sync to frame header, the identifier tells the entropy coder of the frame
+        const std::size_t headerIdLen = strlen(frameHeaderIdentifier_);
+        std::vector<char> headerId (headerIdLen);
+        std::size_t headerIdPos = 0;
+        entropy_Coders_e entropyCoding;
+        for (;;)
+        {
+          char readChar;
+          if (!compressedTreeDataIn_arg.read ((char*)&readChar, sizeof(readChar)))
+            return (false);
 
-        compressedPointDataLen_ = 0;
-        compressedColorDataLen_ = 0;
+          // keep the last headerIdLen characters
+          if (headerIdPos < headerIdLen)
+          {
+            headerId[headerIdPos++] = readChar;
+          }
+          else
+          {
+            memmove (&headerId[0], &headerId[1], headerIdLen - 1);
+            headerId[headerIdLen - 1] = readChar;
+          }
 
-        // encode binary octree structure
-        binaryTreeDataVector_size = binaryTreeDataVector_.size ();
-        compressedTreeDataOut_arg.write ((const char*)&binaryTreeDataVector_size, sizeof(binaryTreeDataVector_size));
-        compressedPointDataLen_ += entropyCoder_.encodeCharVectorToStream (binaryTreeDataVector_,
-                                                                           compressedTreeDataOut_arg);
+          if (headerIdPos < headerIdLen)
+            continue;
 
-        if (cloudWithColor_)
-        {
-          // encode averaged voxel color information
-          std::vector<char>& pointAvgColorDataVector = colorCoder_.getAverageDataVector ();
-          pointAvgColorDataVector_size = pointAvgColorDataVector.size ();
-          compressedTreeDataOut_arg.write ((const char*)&pointAvgColorDataVector_size,
-                                           sizeof(pointAvgColorDataVector_size));
-          compressedColorDataLen_ += entropyCoder_.encodeCharVectorToStream (pointAvgColorDataVector,
-                                                                             compressedTreeDataOut_arg);
+          if (!memcmp (&headerId[0], frameHeaderIdentifier_, headerIdLen))
+          {
+            entropyCoding = RANGE_CODING;
+            break;
+          }
+          if (!memcmp (&headerId[0], ransFrameHeaderIdentifier_, headerIdLen))
+          {
+            entropyCoding = RANS_CODING;
+            break;
+          }
         }
 
+        FrameHeader& header = frame_arg.header;
+        unsigned int frameID;
+        bool iFrame;
 
-        if (!doVoxelGridEnDecoding_)
+        // read header
+        compressedTreeDataIn_arg.read ((char*)&frameID, sizeof(frameID));
+        compressedTreeDataIn_arg.read ((char*)&iFrame, sizeof(iFrame));
+        if (iFrame)
         {
-          unsigned long pointCountDataVector_size;
-          unsigned long pointDiffDataVector_size;
-          unsigned long pointDiffColorDataVector_size;
-
-          // encode amount of points per voxel
-          pointCountDataVector_size = pointCountDataVector_.size ();
-          compressedTreeDataOut_arg.write ((const char*)&pointCountDataVector_size, sizeof(pointCountDataVector_size));
-          compressedPointDataLen_ += entropyCoder_.encodeIntVectorToStream (pointCountDataVector_,
-                                                                            compressedTreeDataOut_arg);
-
-          // encode differential point information
-          std::vector<char>& pointDiffDataVector = pointCoder_.getDifferentialDataVector ();
-          pointDiffDataVector_size = pointDiffDataVector.size ();
-          compressedTreeDataOut_arg.write ((const char*)&pointDiffDataVector_size, sizeof(pointDiffDataVector_size));
-          compressedPointDataLen_ += entropyCoder_.encodeCharVectorToStream (pointDiffDataVector,
-                                                                             compressedTreeDataOut_arg);
-          if (cloudWithColor_)
-          {
-            // encode differential color information
-            std::vector<char>& pointDiffColorDataVector = colorCoder_.getDifferentialDataVector ();
-            pointDiffColorDataVector_size = pointDiffColorDataVector.size ();
-            compressedTreeDataOut_arg.write ((const char*)&pointDiffColorDataVector_size,
-                                             sizeof(pointDiffColorDataVector_size));
-            compressedColorDataLen_ += entropyCoder_.encodeCharVectorToStream (pointDiffColorDataVector,
-                                                                               compressedTreeDataOut_arg);
-          }
+          // read coder configuration
+          compressedTreeDataIn_arg.read ((char*)&header.doVoxelGridEnDecoding, sizeof(header.doVoxelGridEnDecoding));
+          compressedTreeDataIn_arg.read ((char*)&header.withColor, sizeof(header.withColor));
+          compressedTreeDataIn_arg.read ((char*)&header.pointCount, sizeof(header.pointCount));
+          compressedTreeDataIn_arg.read ((char*)&header.octreeResolution, sizeof(header.octreeResolution));
+          compressedTreeDataIn_arg.read ((char*)&header.colorBitDepth, sizeof(header.colorBitDepth));
+          compressedTreeDataIn_arg.read ((char*)&header.pointResolution, sizeof(header.pointResolution));
 
+          // read octree bounding box
+          compressedTreeDataIn_arg.read ((char*)&header.minX, sizeof(header.minX));
+          compressedTreeDataIn_arg.read ((char*)&header.minY, sizeof(header.minY));
+          compressedTreeDataIn_arg.read ((char*)&header.minZ, sizeof(header.minZ));
+          compressedTreeDataIn_arg.read ((char*)&header.maxX, sizeof(header.maxX));
+          compressedTreeDataIn_arg.read ((char*)&header.maxY, sizeof(header.maxY));
+          compressedTreeDataIn_arg.read ((char*)&header.maxZ, sizeof(header.maxZ));
+
+          streamHeader_ = header;
         }
+        else
+        {
+          // P-frames continue with the configuration of the last I-frame
+          header = streamHeader_;
+        }
+        header.frameID = frameID;
+        header.iFrame = iFrame;
+        header.entropyCoding = entropyCoding;
 
-        // flush output stream
-        compressedTreeDataOut_arg.flush ();
+        if (!compressedTreeDataIn_arg)
+          return (false);
+
+        // decode data vectors
+        if (entropyCoding == RANS_CODING)
+          return (this->decodeDataVectors (ransCoder_, compressedTreeDataIn_arg, frame_arg));
+        else
+          return (this->decodeDataVectors (entropyCoder_, compressedTreeDataIn_arg, frame_arg));
       }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
     template<typename PointT, typename LeafT, typename OctreeT>
-      void
-      PointCloudCompression<PointT, LeafT, OctreeT>::entropyDecoding (std::istream& compressedTreeDataIn_arg)
+      template<typename CoderT> void
+      PointCloudCompression<PointT, LeafT, OctreeT>::encodeDataVectors (CoderT* coders_arg, FrameData &frame_arg,
+                                                                        std::ostringstream* codedData_arg,
+                                                                        unsigned long* codedLen_arg)
       {
-        unsigned long binaryTreeDataVector_size;
-        unsigned long pointAvgColorDataVector_size;
+        const bool withColor = frame_arg.header.withColor;
+        const bool withDetail = !frame_arg.header.doVoxelGridEnDecoding;
 
-        compressedPointDataLen_ = 0;
-        compressedColorDataLen_ = 0;
+#pragma omp parallel sections
+        {
+#pragma omp section
+          codedLen_arg[0] = coders_arg[0].encodeCharVectorToStream (frame_arg.binaryTree, codedData_arg[0]);
+#pragma omp section
+          if (withColor)
+            codedLen_arg[1] = coders_arg[1].encodeCharVectorToStream (frame_arg.averageColor, codedData_arg[1]);
+#pragma omp section
+          if (withDetail)
+            codedLen_arg[2] = coders_arg[2].encodeIntVectorToStream (frame_arg.pointCount, codedData_arg[2]);
+#pragma omp section
+          if (withDetail)
+            codedLen_arg[3] = coders_arg[3].encodeCharVectorToStream (frame_arg.pointDiff, codedData_arg[3]);
+#pragma omp section
+          if (withDetail && withColor)
+            codedLen_arg[4] = coders_arg[4].encodeCharVectorToStream (frame_arg.colorDiff, codedData_arg[4]);
+        }
+      }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    template<typename PointT, typename LeafT, typename OctreeT>
+      template<typename CoderT> bool
+      PointCloudCompression<PointT, LeafT, OctreeT>::decodeDataVectors (CoderT* coders_arg,
+                                                                        std::istream& compressedTreeDataIn_arg,
+                                                                        FrameData &frame_arg)
+      {
+        const FrameHeader& header = frame_arg.header;
+
+        const bool withColor = header.withColor;
+        const bool withDetail = !header.doVoxelGridEnDecoding;
+        unsigned long vectorSize;
+
+        frame_arg.compressedPointDataLen = 0;
+        frame_arg.compressedColorDataLen = 0;
 
         // decode binary octree structure
-        compressedTreeDataIn_arg.read ((char*)&binaryTreeDataVector_size, sizeof(binaryTreeDataVector_size));
-        binaryTreeDataVector_.resize (binaryTreeDataVector_size);
-        compressedPointDataLen_ += entropyCoder_.decodeStreamToCharVector (compressedTreeDataIn_arg,
-                                                                           binaryTreeDataVector_);
+        if (!compressedTreeDataIn_arg.read ((char*)&vectorSize, sizeof(vectorSize)))
+          return (false);
+        frame_arg.binaryTree.resize (vectorSize);
+        frame_arg.compressedPointDataLen += coders_arg[0].decodeStreamToCharVector (compressedTreeDataIn_arg,
+                                                                                    frame_arg.binaryTree);
 
-        if (dataWithColor_)
+        if (withColor)
         {
           // decode averaged voxel color information
-          std::vector<char>& pointAvgColorDataVector = colorCoder_.getAverageDataVector ();
-          compressedTreeDataIn_arg.read ((char*)&pointAvgColorDataVector_size, sizeof(pointAvgColorDataVector_size));
-          pointAvgColorDataVector.resize (pointAvgColorDataVector_size);
-          compressedColorDataLen_ += entropyCoder_.decodeStreamToCharVector (compressedTreeDataIn_arg,
-                                                                             pointAvgColorDataVector);
+          if (!compressedTreeDataIn_arg.read ((char*)&vectorSize, sizeof(vectorSize)))
+            return (false);
+          frame_arg.averageColor.resize (vectorSize);
+          frame_arg.compressedColorDataLen += coders_arg[1].decodeStreamToCharVector (compressedTreeDataIn_arg,
+                                                                                      frame_arg.averageColor);
         }
 
-        if (!doVoxelGridEnDecoding_)
+        if (withDetail)
         {
-          unsigned long pointCountDataVector_size;
-          unsigned long pointDiffDataVector_size;
-          unsigned long pointDiffColorDataVector_size;
-
           // decode amount of points per voxel
-          compressedTreeDataIn_arg.read ((char*)&pointCountDataVector_size, sizeof(pointCountDataVector_size));
-          pointCountDataVector_.resize (pointCountDataVector_size);
-          compressedPointDataLen_ += entropyCoder_.decodeStreamToIntVector (compressedTreeDataIn_arg, pointCountDataVector_);
-          pointCountDataVectorIterator_ = pointCountDataVector_.begin ();
+          if (!compressedTreeDataIn_arg.read ((char*)&vectorSize, sizeof(vectorSize)))
+            return (false);
+          frame_arg.pointCount.resize (vectorSize);
+          frame_arg.compressedPointDataLen += coders_arg[2].decodeStreamToIntVector (compressedTreeDataIn_arg,
+                                                                                     frame_arg.pointCount);
 
           // decode differential point information
-          std::vector<char>& pointDiffDataVector = pointCoder_.getDifferentialDataVector ();
-          compressedTreeDataIn_arg.read ((char*)&pointDiffDataVector_size, sizeof(pointDiffDataVector_size));
-          pointDiffDataVector.resize (pointDiffDataVector_size);
-          compressedPointDataLen_ += entropyCoder_.decodeStreamToCharVector (compressedTreeDataIn_arg,
-                                                                             pointDiffDataVector);
+          if (!compressedTreeDataIn_arg.read ((char*)&vectorSize, sizeof(vectorSize)))
+            return (false);
+          frame_arg.pointDiff.resize (vectorSize);
+          frame_arg.compressedPointDataLen += coders_arg[3].decodeStreamToCharVector (compressedTreeDataIn_arg,
+                                                                                      frame_arg.pointDiff);
 
-          if (dataWithColor_)
+          if (withColor)
           {
             // decode differential color information
-            std::vector<char>& pointDiffColorDataVector = colorCoder_.getDifferentialDataVector ();
-            compressedTreeDataIn_arg.read ((char*)&pointDiffColorDataVector_size, sizeof(pointDiffColorDataVector_size));
-            pointDiffColorDataVector.resize (pointDiffColorDataVector_size);
-            compressedColorDataLen_ += entropyCoder_.decodeStreamToCharVector (compressedTreeDataIn_arg,
-                                                                               pointDiffColorDataVector);
+            if (!compressedTreeDataIn_arg.read ((char*)&vectorSize, sizeof(vectorSize)))
+              return (false);
+            frame_arg.colorDiff.resize (vectorSize);
+            frame_arg.compressedColorDataLen += coders_arg[4].decodeStreamToCharVector (compressedTreeDataIn_arg,
+                                                                                        frame_arg.colorDiff);
           }
-
         }
 
+        return (!compressedTreeDataIn_arg.fail ());
       }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
     template<typename PointT, typename LeafT, typename OctreeT>
       void
-      PointCloudCompression<PointT, LeafT, OctreeT>::writeFrameHeader (std::ostream& compressedTreeDataOut_arg)
+      PointCloudCompression<PointT, LeafT, OctreeT>::decodeFrame (FrameData &frame_arg, PointCloudPtr &cloud_arg)
       {
+        // initialize octree
+        this->switchBuffers ();
+        this->setOutputCloud (cloud_arg);
 
-        // encode header identifier
-        compressedTreeDataOut_arg.write ((const char*)frameHeaderIdentifier_, strlen(frameHeaderIdentifier_));
+        // color field analysis
+        cloudWithColor_ = false;
+        std::vector<sensor_msgs::PointField> fields;
+        int rgba_index = -1;
+        rgba_index = pcl::getFieldIndex (*output_, "rgb", fields);
+        if (rgba_index == -1)
+        {
+          rgba_index = pcl::getFieldIndex (*output_, "rgba", fields);
+        }
+        if (rgba_index >= 0)
+        {
+          pointColorOffset_ = fields[rgba_index].offset;
+          cloudWithColor_ = true;
+        }
 
-        // encode point cloud header id
-        compressedTreeDataOut_arg.write ((const char*)&frameID_, sizeof(frameID_));
+        // apply frame header
+        const FrameHeader& header = frame_arg.header;
+        frameID_ = header.frameID;
+        iFrame_ = header.iFrame;
+        doVoxelGridEnDecoding_ = header.doVoxelGridEnDecoding;
+        dataWithColor_ = header.withColor;
+        pointCount_ = header.pointCount;
 
-        // encode frame type (I/P-frame)
-        compressedTreeDataOut_arg.write ((const char*)&iFrame_, sizeof(iFrame_));
         if (iFrame_)
         {
-          double minX, minY, minZ, maxX, maxY, maxZ;
-          double octreeResolution;
-          unsigned char colorBitDepth;
-          double pointResolution;
-
-          // get current configuration
-          octreeResolution = this->getResolution();
-          colorBitDepth  = colorCoder_.getBitDepth();
-          pointResolution= pointCoder_.getPrecision();
-          this->getBoundingBox (minX, minY, minZ, maxX, maxY, maxZ);
-
-          // encode amount of points
-          if (doVoxelGridEnDecoding_) {
-            pointCount_ = this->leafCount_;
-          } else
-          {
-            pointCount_ = this->objectCount_;
-          }
+          // reset octree and assign new bounding box & resolution
+          this->deleteTree ();
+          this->setResolution (header.octreeResolution);
+          this->defineBoundingBox (header.minX, header.minY, header.minZ, header.maxX, header.maxY, header.maxZ);
 
-          // encode coding configuration
-          compressedTreeDataOut_arg.write ((const char*)&doVoxelGridEnDecoding_, sizeof(doVoxelGridEnDecoding_));
-          compressedTreeDataOut_arg.write ((const char*)&cloudWithColor_, sizeof(cloudWithColor_));
-          compressedTreeDataOut_arg.write ((const char*)&pointCount_, sizeof(pointCount_));
-          compressedTreeDataOut_arg.write ((const char*)&octreeResolution, sizeof(octreeResolution));
-          compressedTreeDataOut_arg.write ((const char*)&colorBitDepth, sizeof(colorBitDepth));
-          compressedTreeDataOut_arg.write ((const char*)&pointResolution, sizeof(pointResolution));
+          // configure color & point coding
+          colorCoder_.setBitDepth (header.colorBitDepth);
+          pointCoder_.setPrecision (header.pointResolution);
+        }
 
-          // encode octree bounding box
-          compressedTreeDataOut_arg.write ((const char*)&minX, sizeof(minX));
-          compressedTreeDataOut_arg.write ((const char*)&minY, sizeof(minY));
-          compressedTreeDataOut_arg.write ((const char*)&minZ, sizeof(minZ));
-          compressedTreeDataOut_arg.write ((const char*)&maxX, sizeof(maxX));
-          compressedTreeDataOut_arg.write ((const char*)&maxY, sizeof(maxY));
-          compressedTreeDataOut_arg.write ((const char*)&maxZ, sizeof(maxZ));
+        // take over the data vectors
+        binaryTreeDataVector_.swap (frame_arg.binaryTree);
+        colorCoder_.getAverageDataVector ().swap (frame_arg.averageColor);
+        pointCountDataVector_.swap (frame_arg.pointCount);
+        pointCoder_.getDifferentialDataVector ().swap (frame_arg.pointDiff);
+        colorCoder_.getDifferentialDataVector ().swap (frame_arg.colorDiff);
+        pointCountDataVectorIterator_ = pointCountDataVector_.begin ();
 
-        }
+        compressedPointDataLen_ = frame_arg.compressedPointDataLen;
+        compressedColorDataLen_ = frame_arg.compressedColorDataLen;
+
+        // initialize color and point encoding
+        colorCoder_.initializeDecoding ();
+        pointCoder_.initializeDecoding ();
+
+        // initialize output cloud
+        output_->points.clear ();
+        output_->points.reserve (pointCount_);
+
+        if (iFrame_)
+          // i-frame decoding - decode tree structure without referencing previous buffer
+          this->deserializeTree (binaryTreeDataVector_, false);
+        else
+          // p-frame decoding - decode XOR encoded tree structure
+          this->deserializeTree (binaryTreeDataVector_, true);
+
+        // assign point cloud properties
+        output_->height = 1;
+        output_->width = cloud_arg->points.size ();
+        output_->is_dense = false;
       }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
     template<typename PointT, typename LeafT, typename OctreeT>
       void
-      PointCloudCompression<PointT, LeafT, OctreeT>::readFrameHeader ( std::istream& compressedTreeDataIn_arg)
+      PointCloudCompression<PointT, LeafT, OctreeT>::printStatistics (const char* title_arg)
       {
+        float bytesPerXYZ;
+        float bytesPerColor;
 
-      // sync to frame header
-        unsigned int headerIdPos = 0;
-        while (headerIdPos < strlen(frameHeaderIdentifier_))
-        {
-          char readChar;
-          compressedTreeDataIn_arg.read ((char*)&readChar, sizeof(readChar));
-          if (readChar != frameHeaderIdentifier_[headerIdPos++])
-          {
-            headerIdPos = (frameHeaderIdentifier_[0]==readChar)?1:0;
-          }
-        }
-
-        // read header
-        compressedTreeDataIn_arg.read ((char*)&frameID_, sizeof(frameID_));
+        bytesPerXYZ = (float)compressedPointDataLen_ / (float)pointCount_;
+        bytesPerColor = (float)compressedColorDataLen_ / (float)pointCount_;
 
-        compressedTreeDataIn_arg.read ((char*)&iFrame_, sizeof(iFrame_));
+        std::cerr << "*** POINTCLOUD " << title_arg << " ***" << std::endl;
+        std::cerr << "Frame ID: " << frameID_ << std::endl;
         if (iFrame_)
-        {
-          double minX, minY, minZ, maxX, maxY, maxZ;
-          double octreeResolution;
-          unsigned char colorBitDepth;
-          double pointResolution;
-
-          // read coder configuration
-          compressedTreeDataIn_arg.read ((char*)&doVoxelGridEnDecoding_, sizeof(doVoxelGridEnDecoding_));
-          compressedTreeDataIn_arg.read ((char*)&dataWithColor_, sizeof(dataWithColor_));
-          compressedTreeDataIn_arg.read ((char*)&pointCount_, sizeof(pointCount_));
-          compressedTreeDataIn_arg.read ((char*)&octreeResolution, sizeof(octreeResolution));
-          compressedTreeDataIn_arg.read ((char*)&colorBitDepth, sizeof(colorBitDepth));
-          compressedTreeDataIn_arg.read ((char*)&pointResolution, sizeof(pointResolution));
-
-          // read octree bounding box
-          compressedTreeDataIn_arg.read ((char*)&minX, sizeof(minX));
-          compressedTreeDataIn_arg.read ((char*)&minY, sizeof(minY));
-          compressedTreeDataIn_arg.read ((char*)&minZ, sizeof(minZ));
-          compressedTreeDataIn_arg.read ((char*)&maxX, sizeof(maxX));
-          compressedTreeDataIn_arg.read ((char*)&maxY, sizeof(maxY));
-          compressedTreeDataIn_arg.read ((char*)&maxZ, sizeof(maxZ));
-
-          // reset octree and assign new bounding box & resolution
-          this->deleteTree ();
-          this->setResolution (octreeResolution);
-          this->defineBoundingBox (minX, minY, minZ, maxX, maxY, maxZ);
-
-          // configure color & point coding
-          colorCoder_.setBitDepth(colorBitDepth);
-          pointCoder_.setPrecision(pointResolution);
-
-        }
-
+          std::cerr << "Encoding Frame: Intra frame" << std::endl;
+        else
+          std::cerr << "Encoding Frame: Prediction frame" << std::endl;
+        std::cerr << "Number of encoded points: " << pointCount_ << std::endl;
+        std::cerr << "XYZ compression percentage: " << bytesPerXYZ / (3.0f * sizeof(float)) * 100.0f
+                  << "%" << std::endl;
+        std::cerr << "XYZ bytes per point: " << bytesPerXYZ << " bytes" << std::endl;
+        std::cerr << "Color compression percentage: " << bytesPerColor / (sizeof(int)) * 100.0f
+                  << "%" << std::endl;
+        std::cerr << "Color bytes per point: " << bytesPerColor << " bytes" << std::endl;
+        std::cerr << "Size of uncompressed point cloud: "
+                  << pointCount_* (sizeof(int) + 3.0f  * sizeof(float))  / (1024) << " kBytes" << std::endl;
+        std::cerr << "Size of compressed point cloud: "
+                  << (compressedPointDataLen_ + compressedColorDataLen_) / (1024) << " kBytes" << std::endl;
+        std::cerr << "Total bytes per point: " << bytesPerXYZ + bytesPerColor << " bytes" << std::endl;
+        std::cerr << "Total compression percentage: "
+                  << (bytesPerXYZ + bytesPerColor) / (sizeof(int) + 3.0f * sizeof(float)) * 100.0f
+                  << "%" << std::endl;
+        std::cerr << "Compression ratio: "
+                  << (float)(sizeof(int) + 3.0f  * sizeof(float)) / (float)(bytesPerXYZ + bytesPerColor)
+                  << std::endl << std::endl;
       }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -499,40 +610,18 @@ namespace pcl
       PointCloudCompression<PointT, LeafT, OctreeT>::serializeLeafCallback (OctreeLeaf& leaf_arg, const OctreeKey& key_arg)
       {
 
-      // reference to point indices vector stored within octree leaf
-      const std::vector<int>& leafIdx = leaf_arg.getIdxVector ();
+        // reference to point indices vector stored within octree leaf
+        const std::vector<int>& leafIdx = leaf_arg.getIdxVector ();
 
         if (!doVoxelGridEnDecoding_)
         {
-          double lowerVoxelCorner[3];
-
           // encode amount of points within voxel
           pointCountDataVector_.push_back ((int)leafIdx.size ());
-
-          // calculate lower voxel corner based on octree key
-          lowerVoxelCorner[0] = ((double)key_arg.x) * this->resolution_ + this->minX_;
-          lowerVoxelCorner[1] = ((double)key_arg.y) * this->resolution_ + this->minY_;
-          lowerVoxelCorner[2] = ((double)key_arg.z) * this->resolution_ + this->minZ_;
-
-          // differentially encode points to lower voxel corner
-          pointCoder_.encodePoints (leafIdx, lowerVoxelCorner, this->input_);
-
-          if (cloudWithColor_)
-          {
-            // encode color of points
-            colorCoder_.encodePoints (leafIdx, pointColorOffset_, this->input_);
-          }
-
-        }
-        else
-        {
-          if (cloudWithColor_)
-          {
-            // encode average color of all points within voxel
-            colorCoder_.encodeAverageOfPoints (leafIdx, pointColorOffset_, this->input_);
-          }
         }
 
+        // point detail and color coding is done by encodeFrame once the whole tree is serialized
+        serializedLeafIdx_.push_back (&leafIdx);
+        serializedLeafKey_.push_back (key_arg);
       }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -48,6 +48,7 @@
 
 #include <iterator>
 #include <iostream>
+#include <sstream>
 #include <vector>
 #include <string.h>
 #include <iostream>
@@ -60,6 +61,13 @@ namespace pcl
   {
     using namespace std;
 
+    /** \brief Entropy coders available to PointCloudCompression */
+    enum entropy_Coders_e
+    {
+      RANGE_CODING, // StaticRangeCoder, compatible with older decoders
+      RANS_CODING   // StaticRansCoder, faster encoding and decoding
+    };
+
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /** \brief @b Octree pointcloud compression class
      *  \note This class enables compression and decompression of point cloud data based on octree data structures.
@@ -86,6 +94,40 @@ namespace pcl
         typedef PointCloudCompression<PointT, LeafT, Octree2BufBase<int, LeafT> > RealTimeStreamCompression;
         typedef PointCloudCompression<PointT, LeafT, OctreeLowMemBase<int, LeafT> > SinglePointCloudCompressionLowMemory;
 
+        /** \brief Frame header information, as written in front of every encoded frame */
+        struct FrameHeader
+        {
+          unsigned int frameID;
+          bool iFrame;
+          entropy_Coders_e entropyCoding;
+
+          // coding configuration, only transmitted with I-frames
+          bool doVoxelGridEnDecoding;
+          bool withColor;
+          unsigned long pointCount;
+          double octreeResolution;
+          unsigned char colorBitDepth;
+          double pointResolution;
+          double minX, minY, minZ, maxX, maxY, maxZ;
+        };
+
+        /** \brief Data vectors of a single frame. Output of the octree stage (encodeFrame) and input of the
+         *  entropy coding stage (writeFrame), and the other way round when decoding.
+         */
+        struct FrameData
+        {
+          FrameHeader header;
+
+          std::vector<char> binaryTree;
+          std::vector<char> averageColor;
+          std::vector<unsigned int> pointCount;
+          std::vector<char> pointDiff;
+          std::vector<char> colorDiff;
+
+          unsigned long compressedPointDataLen;
+          unsigned long compressedColorDataLen;
+        };
+
         /** \brief Constructor
          *  \param compressionProfile_arg:  define compression profile
          *  \param octreeResolution_arg:  octree resolution at lowest octree level
@@ -110,7 +152,8 @@ namespace pcl
               doVoxelGridEnDecoding_ (doVoxelGridDownDownSampling_arg), iFrameRate_ (iFrameRate_arg),
               iFrameCounter_ (0), frameID_ (0), pointCount_ (0), iFrame_ (true),
               doColorEncoding_ (doColorEncoding_arg), cloudWithColor_ (false), dataWithColor_ (false),
-              pointColorOffset_ (0), bShowStatistics (showStatistics_arg)
+              pointColorOffset_ (0), bShowStatistics (showStatistics_arg),
+              compressedPointDataLen_ (0), compressedColorDataLen_ (0), entropyCoding_ (RANGE_CODING)
 
         {
           output_ = PointCloudPtr ();
@@ -142,6 +185,11 @@ namespace pcl
             doVoxelGridEnDecoding_ = true;
           }
 
+          // the decoder starts with the configuration of this instance until the first I-frame arrives
+          memset (&streamHeader_, 0, sizeof(streamHeader_));
+          streamHeader_.doVoxelGridEnDecoding = doVoxelGridEnDecoding_;
+          streamHeader_.withColor = false;
+
         }
 
         /** \brief Empty deconstructor. */
@@ -171,6 +219,22 @@ namespace pcl
           return (output_);
         }
 
+        /** \brief Select the entropy coder used for encoding. The decoder detects it from the frame header.
+         *  \param entropyCoding_arg: RANGE_CODING (default) or RANS_CODING
+         * */
+        inline void
+        setEntropyCoding (entropy_Coders_e entropyCoding_arg)
+        {
+          entropyCoding_ = entropyCoding_arg;
+        }
+
+        /** \brief Get the entropy coder used for encoding. */
+        inline entropy_Coders_e
+        getEntropyCoding () const
+        {
+          return (entropyCoding_);
+        }
+
         /** \brief Encode point cloud to output stream
          *  \param cloud_arg:  point cloud to be compressed
          *  \param compressedTreeDataOut_arg:  binary output stream containing compressed data
@@ -185,31 +249,68 @@ namespace pcl
         void
         decodePointCloud (std::istream& compressedTreeDataIn_arg, PointCloudPtr &cloud_arg);
 
-      protected:
+        /** \brief Octree stage of encodePointCloud: build and serialize the octree and run point detail and color
+         *  coding. The resulting data vectors are swapped into frame_arg, so passing the same FrameData objects
+         *  again recycles their memory.
+         *  \param cloud_arg: point cloud to be compressed
+         *  \param frame_arg: receives the frame header and data vectors
+         * */
+        void
+        encodeFrame (const PointCloudConstPtr &cloud_arg, FrameData &frame_arg);
 
-        /** \brief Write frame information to output stream
+        /** \brief Entropy coding stage of encodePointCloud: write the frame header and the range coded data vectors
+         *  of frame_arg. The data vectors are coded in parallel. Only touches the entropy coders, so it may run
+         *  concurrently with encodeFrame for the next frame.
+         *  \param frame_arg: frame produced by encodeFrame
          *  \param compressedTreeDataOut_arg: binary output stream
          * */
         void
-        writeFrameHeader (std::ostream& compressedTreeDataOut_arg);
+        writeFrame (FrameData &frame_arg, std::ostream& compressedTreeDataOut_arg);
 
-        /** \brief Read frame information to output stream
+        /** \brief Entropy decoding stage of decodePointCloud: read the next frame header and data vectors.
+         *  Only touches the entropy coders and the stream configuration, so it may run concurrently with
+         *  decodeFrame for the previous frame.
          *  \param compressedTreeDataIn_arg: binary input stream
+         *  \param frame_arg: receives the frame header and data vectors
+         *  \return false if the stream ended before a complete frame was read
+         * */
+        bool
+        readFrame (std::istream& compressedTreeDataIn_arg, FrameData &frame_arg);
+
+        /** \brief Octree stage of decodePointCloud: rebuild the octree and decode the points of a frame read by
+         *  readFrame. The data vectors of frame_arg are swapped out.
+         *  \param frame_arg: frame produced by readFrame
+         *  \param cloud_arg: reference to decoded point cloud
          * */
         void
-        readFrameHeader (std::istream& compressedTreeDataIn_arg);
+        decodeFrame (FrameData &frame_arg, PointCloudPtr &cloud_arg);
 
-        /** \brief Apply entropy encoding to encoded information and output to binary stream
-         *  \param compressedTreeDataOut_arg: binary output stream
+      protected:
+
+        /** \brief Print compression statistics of the current frame
+         *  \param title_arg: "ENCODING" or "DECODING"
          * */
         void
-        entropyEncoding (std::ostream& compressedTreeDataOut_arg);
+        printStatistics (const char* title_arg);
+
+        /** \brief Entropy code the data vectors of a frame in parallel, one coder per vector
+         *  \param coders_arg: five coder instances
+         *  \param frame_arg: frame to be coded
+         *  \param codedData_arg: receives the coded data of each vector
+         *  \param codedLen_arg: receives the coded size of each vector
+         * */
+        template<typename CoderT> void
+        encodeDataVectors (CoderT* coders_arg, FrameData &frame_arg, std::ostringstream* codedData_arg,
+                           unsigned long* codedLen_arg);
 
-        /** \brief Entropy decoding of input binary stream and output to information vectors
+        /** \brief Entropy decode the data vectors of a frame
+         *  \param coders_arg: five coder instances
          *  \param compressedTreeDataIn_arg: binary input stream
+         *  \param frame_arg: frame with header, receives the data vectors
+         *  \return false if the stream ended
          * */
-        void
-        entropyDecoding (std::istream& compressedTreeDataIn_arg);
+        template<typename CoderT> bool
+        decodeDataVectors (CoderT* coders_arg, std::istream& compressedTreeDataIn_arg, FrameData &frame_arg);
 
         /** \brief Encode leaf node information during serialization
          *  \param leaf_arg: reference to new leaf node
@@ -246,8 +347,21 @@ namespace pcl
         /** \brief Point coding instance */
         PointCoding<PointT> pointCoder_;
 
-        /** \brief Static range coder instance */
-        StaticRangeCoder entropyCoder_;
+        /** \brief Static range coder instances, one per data vector so they can run in parallel */
+        StaticRangeCoder entropyCoder_[5];
+
+        /** \brief rANS coder instances, used instead of entropyCoder_ with RANS_CODING */
+        StaticRansCoder ransCoder_[5];
+
+        /** \brief Leaves visited during serialization, point detail and color coding runs after the tree is serialized */
+        std::vector<const std::vector<int>*> serializedLeafIdx_;
+        std::vector<OctreeKey> serializedLeafKey_;
+
+        /** \brief Frame buffers reused by encodePointCloud and decodePointCloud */
+        FrameData frameData_;
+
+        /** \brief Configuration of the last I-frame read by readFrame */
+        FrameHeader streamHeader_;
 
         bool doVoxelGridEnDecoding_;
         unsigned int iFrameRate_;
@@ -266,14 +380,23 @@ namespace pcl
         unsigned long compressedPointDataLen_;
         unsigned long compressedColorDataLen_;
 
+        /** \brief Entropy coder used for encoding */
+        entropy_Coders_e entropyCoding_;
+
         // frame header identifier
         static const char* frameHeaderIdentifier_;
 
+        // frame header identifier of frames coded with StaticRansCoder, same length as frameHeaderIdentifier_
+        static const char* ransFrameHeaderIdentifier_;
+
       };
 
     // define frame header initialization
     template<typename PointT, typename LeafT, typename OctreeT>
       const char* PointCloudCompression<PointT, LeafT, OctreeT>::frameHeaderIdentifier_ = "<PCL-COMPRESSED>";
+
+    template<typename PointT, typename LeafT, typename OctreeT>
+      const char* PointCloudCompression<PointT, LeafT, OctreeT>::ransFrameHeaderIdentifier_ = "<PCL-COMPR-RANS>";
   }
 
 }
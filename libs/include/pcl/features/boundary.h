@@ -48,8 +48,10 @@ namespace pcl
   /** \brief @b BoundaryEstimation estimates whether a set of points is lying on surface boundaries using an angle
     * criterion. The code makes use of the estimated surface normals at each point in the input dataset.
     *
-    * @note The code is stateful as we do not expect this class to be multicore parallelized. Please look at
-    * \a NormalEstimationOpenMP and \a NormalEstimationTBB for examples on how to extend this to parallel implementations.
+    * The angles of the neighbors around a point are binned into sectors no wider than the angle threshold instead
+    * of being sorted (see AngleGaps). On organized clouds searched with the default OrganizedDataIndex, the image
+    * neighborhood of every point is walked directly, without building neighbor lists. The points are processed in
+    * parallel (see setNumberOfThreads ()).
     * \author Radu Bogdan Rusu
     * \ingroup features
     */
@@ -72,7 +74,7 @@ namespace pcl
 
     public:
       /** \brief Empty constructor. */
-      BoundaryEstimation () : angle_threshold_ (M_PI/2.0) 
+      BoundaryEstimation () : angle_threshold_ (M_PI/2.0), threads_ (1)
       {
         feature_name_ = "BoundaryEstimation";
       };
@@ -123,6 +125,22 @@ namespace pcl
         return (angle_threshold_);
       }
 
+      /** \brief Set the number of threads to use.
+        * \param[in] nr_threads the number of hardware threads to use (0 sets the value back to 1)
+        */
+      inline void
+      setNumberOfThreads (unsigned int nr_threads)
+      {
+        threads_ = (nr_threads == 0) ? 1 : nr_threads;
+      }
+
+      /** \brief Get the number of threads to use. */
+      inline unsigned int
+      getNumberOfThreads ()
+      {
+        return (threads_);
+      }
+
       /** \brief Get a u-v-n coordinate system that lies on a plane defined by its normal
         * \param[in] p_coeff the plane coefficients (containing the plane normal)
         * \param[out] u the resultant u direction
@@ -138,7 +156,55 @@ namespace pcl
       }
 
     protected:
- 
+      /** \brief Finds out whether the largest gap between consecutive angles around a point is larger than a
+        * threshold, without sorting the angles. The circle is split into sectors no wider than the threshold and
+        * only the smallest and largest angle of every sector are kept: a gap inside a sector is never larger than
+        * the threshold, and the gaps between consecutive non empty sectors are exact.
+        */
+      class AngleGaps
+      {
+        public:
+          /** \brief Constructor.
+            * \param[in] angle_threshold the threshold angle
+            */
+          AngleGaps (float angle_threshold);
+
+          /** \brief Check whether the threshold is wide enough for the available sectors. Smaller thresholds need
+            * the angles to be sorted.
+            */
+          inline bool
+          isValid () const { return (nr_sectors_ > 0); }
+
+          /** \brief Add an angle in [-pi, pi]. */
+          inline void
+          add (float angle)
+          {
+            int sector = static_cast<int> ((angle + static_cast<float> (M_PI)) * scale_);
+            if (sector >= nr_sectors_)
+              sector = nr_sectors_ - 1;
+            else if (sector < 0)
+              sector = 0;
+            if (angle < min_[sector])
+              min_[sector] = angle;
+            if (angle > max_[sector])
+              max_[sector] = angle;
+          }
+
+          /** \brief Check whether the largest gap between the angles added so far, including the one that wraps
+            * around from the last angle to the first, is larger than the threshold.
+            */
+          bool
+          exceedsThreshold () const;
+
+        private:
+          /** \brief The largest number of sectors, i.e. the smallest supported threshold is 2 pi / 63. */
+          static const int max_nr_sectors_ = 64;
+
+          int nr_sectors_;
+          float scale_, angle_threshold_;
+          float min_[max_nr_sectors_], max_[max_nr_sectors_];
+      };
+
       /** \brief Estimate whether a set of points is lying on surface boundaries using an angle criterion for all points
         * given in <setInputCloud (), setIndices ()> using the surface in setSearchSurface () and the spatial locator in
         * setSearchMethod ()
@@ -147,8 +213,22 @@ namespace pcl
       void 
       computeFeature (PointCloudOut &output);
 
+      /** \brief Estimate whether a point of an organized input is a boundary point, walking its image neighborhood
+        * the way OrganizedDataIndex::radiusSearch () does: rings of pixels around the point, until a ring has no point
+        * within the search radius.
+        * \param[in] index the index of the query point in the input cloud
+        * \param[in] u the u direction
+        * \param[in] v the v direction
+        * \param[in] gaps an empty AngleGaps for the angle threshold
+        */
+      bool
+      isImageBoundaryPoint (int index, const Eigen::Vector4f &u, const Eigen::Vector4f &v, AngleGaps &gaps) const;
+
       /** \brief The decision boundary (angle threshold) that marks points as boundary or regular. (default \f$\pi / 2.0\f$) */
       float angle_threshold_;
+
+      /** \brief The number of threads to use. */
+      unsigned int threads_;
   };
 }
 
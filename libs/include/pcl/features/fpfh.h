@@ -40,8 +40,6 @@
 
 #include <pcl/features/feature.h>
 
-#include <set>
-
 namespace pcl
 {
   /** \brief @b FPFHEstimation estimates the <b>Fast Point Feature Histogram (FPFH)</b> descriptor for a given point 
@@ -62,8 +60,8 @@ namespace pcl
     * </li>
     * </ul>
     *
-    * @note The code is stateful as we do not expect this class to be multicore parallelized. Please look at
-    * \ref FPFHEstimationOMP for examples on parallel implementations of the FPFH (Fast Point Feature Histogram).
+    * The SPFH signature of every point needed is computed once, in a first parallel pass, and stored in one
+    * contiguous buffer. The FPFH signatures are weighted sums of these rows, computed in a second parallel pass.
     * \author Radu Bogdan Rusu
     * \ingroup features
     */
@@ -78,12 +76,14 @@ namespace pcl
       using Feature<PointInT, PointOutT>::search_parameter_;
       using Feature<PointInT, PointOutT>::input_;
       using Feature<PointInT, PointOutT>::surface_;
+      using Feature<PointInT, PointOutT>::fake_indices_;
       using FeatureFromNormals<PointInT, PointNT, PointOutT>::normals_;
 
       typedef typename Feature<PointInT, PointOutT>::PointCloudOut PointCloudOut;
 
       /** \brief Empty constructor. */
-      FPFHEstimation () : nr_bins_f1_ (11), nr_bins_f2_ (11), nr_bins_f3_ (11), d_pi_ ((float)(1.0 / (2.0 * M_PI)))
+      FPFHEstimation () : nr_bins_f1_ (11), nr_bins_f2_ (11), nr_bins_f3_ (11), threads_ (1),
+                          d_pi_ ((float)(1.0 / (2.0 * M_PI)))
       {
         feature_name_ = "FPFHEstimation";
       };
@@ -161,6 +161,43 @@ namespace pcl
         nr_bins_f3 = nr_bins_f3_;
       }
 
+      /** \brief Set the number of threads to use.
+        * \param nr_threads the number of threads to use (0 sets it back to 1)
+        */
+      inline void
+      setNumberOfThreads (unsigned int nr_threads)
+      {
+        if (nr_threads == 0)
+          nr_threads = 1;
+        threads_ = nr_threads;
+      }
+
+      /** \brief Get the number of threads to use. */
+      inline unsigned int
+      getNumberOfThreads ()
+      {
+        return (threads_);
+      }
+
+      /** \brief Share a neighbor list with other stages (e.g. NormalEstimation). It is used when the features
+        * are estimated for the whole input cloud, which is also the search surface, with a k-nearest search. If
+        * it holds at least k neighbors of the input cloud for every point, no search is done. Otherwise the
+        * neighbors are searched as usual and stored in it, for the next stages to use.
+        * \param neighbors the neighbor list, NULL to disable
+        */
+      inline void
+      setNeighborCache (const KNeighborList::Ptr &neighbors)
+      {
+        neighbor_cache_ = neighbors;
+      }
+
+      /** \brief Get the shared neighbor list. */
+      inline KNeighborList::Ptr
+      getNeighborCache ()
+      {
+        return (neighbor_cache_);
+      }
+
     protected:
 
       /** \brief Estimate the Fast Point Feature Histograms (FPFH) descriptors at a set of points given by
@@ -171,9 +208,32 @@ namespace pcl
       void 
       computeFeature (PointCloudOut &output);
 
+      /** \brief Estimate the SPFH signature of a point into one row of \a spfh_, the f1, f2 and f3 histograms
+        * one after the other.
+        * \param cloud the dataset containing the XYZ Cartesian coordinates of the two points
+        * \param normals the dataset containing the surface normals at each point in \a cloud
+        * \param p_idx the index of the query point (source)
+        * \param indices the neighbor point indices in the dataset
+        * \param nr_indices the number of neighbors
+        * \param hist the resultant SPFH signature, zeroed by the caller
+        */
+      void
+      computePointSPFHSignature (const pcl::PointCloud<PointInT> &cloud,
+                                 const pcl::PointCloud<PointNT> &normals, int p_idx,
+                                 const int *indices, int nr_indices, float *hist);
+
       /** \brief The number of subdivisions for each angular feature interval. */
       int nr_bins_f1_, nr_bins_f2_, nr_bins_f3_;
 
+      /** \brief The number of threads to use. */
+      unsigned int threads_;
+
+      /** \brief The neighbor list shared with other stages, if any. */
+      KNeighborList::Ptr neighbor_cache_;
+
+      /** \brief The SPFH signatures of all the points needed, one row of f1, f2 and f3 bins per point. */
+      std::vector<float> spfh_;
+
       /** \brief Placeholder for the f1 histogram. */
       Eigen::MatrixXf hist_f1_;
 
@@ -184,9 +244,6 @@ namespace pcl
       Eigen::MatrixXf hist_f3_;
 
     private:
-      /** \brief Placeholder for a point's FPFH signature. */
-      Eigen::VectorXf fpfh_histogram_;
-
       /** \brief Float constant = 1.0 / (2.0 * M_PI) */
       float d_pi_; 
   };
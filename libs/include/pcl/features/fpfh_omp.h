@@ -60,6 +60,7 @@ namespace pcl
     *      St. Louis, MO, USA, October 11-15 2009.
     * </li>
     * </ul>
+    * \note FPFHEstimation is parallel itself, this class only sets its number of threads at construction.
     * \author Radu Bogdan Rusu
     * \ingroup features
     */
@@ -68,61 +69,24 @@ namespace pcl
   {
     public:
       using Feature<PointInT, PointOutT>::feature_name_;
-      using Feature<PointInT, PointOutT>::getClassName;
-      using Feature<PointInT, PointOutT>::indices_;
-      using Feature<PointInT, PointOutT>::k_;
-      using Feature<PointInT, PointOutT>::search_parameter_;
-      using Feature<PointInT, PointOutT>::input_;
-      using Feature<PointInT, PointOutT>::surface_;
-      using FeatureFromNormals<PointInT, PointNT, PointOutT>::normals_;
-      using FPFHEstimation<PointInT, PointNT, PointOutT>::hist_f1_;
-      using FPFHEstimation<PointInT, PointNT, PointOutT>::hist_f2_;
-      using FPFHEstimation<PointInT, PointNT, PointOutT>::hist_f3_;
-      using FPFHEstimation<PointInT, PointNT, PointOutT>::weightPointSPFHSignature;
+      using FPFHEstimation<PointInT, PointNT, PointOutT>::setNumberOfThreads;
 
       typedef typename Feature<PointInT, PointOutT>::PointCloudOut PointCloudOut;
 
       /** \brief Empty constructor. */
-      FPFHEstimationOMP () : nr_bins_f1_ (11), nr_bins_f2_ (11), nr_bins_f3_ (11), threads_ (1) 
+      FPFHEstimationOMP ()
       {
         feature_name_ = "FPFHEstimationOMP";
       };
 
       /** \brief Initialize the scheduler and set the number of threads to use.
-        * \param nr_threads the number of hardware threads to use (-1 sets the value back to automatic)
+        * \param nr_threads the number of hardware threads to use (0 sets the value back to 1)
         */
-      FPFHEstimationOMP (unsigned int nr_threads) : nr_bins_f1_ (11), nr_bins_f2_ (11), nr_bins_f3_ (11)
+      FPFHEstimationOMP (unsigned int nr_threads)
       {
         setNumberOfThreads (nr_threads);
+        feature_name_ = "FPFHEstimationOMP";
       }
-
-      /** \brief Initialize the scheduler and set the number of threads to use.
-        * \param nr_threads the number of hardware threads to use (-1 sets the value back to automatic)
-        */
-      inline void 
-      setNumberOfThreads (unsigned int nr_threads) 
-      { 
-        if (nr_threads == 0)
-          nr_threads = 1;
-        threads_ = nr_threads; 
-      }
-
-    private:
-
-      /** \brief Estimate the Fast Point Feature Histograms (FPFH) descriptors at a set of points given by
-        * <setInputCloud (), setIndices ()> using the surface in setSearchSurface () and the spatial locator in
-        * setSearchMethod ()
-        * \param output the resultant point cloud model dataset that contains the FPFH feature estimates
-        */
-      void 
-      computeFeature (PointCloudOut &output);
-
-    public:
-      /** \brief The number of subdivisions for each angular feature interval. */
-      int nr_bins_f1_, nr_bins_f2_, nr_bins_f3_;
-    private:
-      /** \brief The number of threads the scheduler should use. */
-      unsigned int threads_;
   };
 }
 
@@ -54,6 +54,49 @@ template <typename PointInT, typename PointNT, typename PointOutT> bool
   return (isBoundaryPoint (cloud, cloud.points[q_idx], indices, u, v, angle_threshold));
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT>
+  pcl::BoundaryEstimation<PointInT, PointNT, PointOutT>::AngleGaps::AngleGaps (float angle_threshold)
+  : nr_sectors_ (0), scale_ (0), angle_threshold_ (angle_threshold)
+{
+  // One more sector than needed keeps them narrower than the threshold despite rounding
+  if (!(angle_threshold > 2.0f * static_cast<float> (M_PI) / (max_nr_sectors_ - 1)))
+    return;
+  nr_sectors_ = static_cast<int> (ceilf (2.0f * static_cast<float> (M_PI) / angle_threshold)) + 1;
+  if (nr_sectors_ > max_nr_sectors_)
+    nr_sectors_ = max_nr_sectors_;
+  scale_ = nr_sectors_ / (2.0f * static_cast<float> (M_PI));
+  for (int i = 0; i < nr_sectors_; ++i)
+  {
+    min_[i] = std::numeric_limits<float>::max ();
+    max_[i] = -std::numeric_limits<float>::max ();
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT> bool
+  pcl::BoundaryEstimation<PointInT, PointNT, PointOutT>::AngleGaps::exceedsThreshold () const
+{
+  int first = -1, last = -1;
+  for (int i = 0; i < nr_sectors_; ++i)
+  {
+    if (min_[i] > max_[i])
+      continue;
+    if (first == -1)
+      first = i;
+    // The gap between the largest angle of the previous sector and the smallest one of this sector
+    else if (min_[i] - max_[last] > angle_threshold_)
+      return (true);
+    last = i;
+  }
+  if (first == -1)
+    return (false);
+
+  // Get the angle difference between the last and the first
+  float dif = 2 * M_PI - max_[last] + min_[first];
+  return (dif > angle_threshold_);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT, typename PointNT, typename PointOutT> bool
   pcl::BoundaryEstimation<PointInT, PointNT, PointOutT>::isBoundaryPoint (
@@ -69,8 +112,9 @@ template <typename PointInT, typename PointNT, typename PointOutT> bool
     return (false);
 
   // Compute the angles between each neighboring point and the query point itself
-  std::vector<float> angles (indices.size ());
-  float max_dif = FLT_MIN, dif;
+  AngleGaps gaps (angle_threshold);
+  // Only thresholds too small for the sectors need the angles to be sorted
+  std::vector<float> angles;
   int cp = 0;
 
   for (size_t i = 0; i < indices.size (); ++i)
@@ -82,15 +126,23 @@ template <typename PointInT, typename PointNT, typename PointOutT> bool
 
     Eigen::Vector4f delta = cloud.points[indices[i]].getVector4fMap () - q_point.getVector4fMap ();
 
-    angles[cp++] = atan2f (v.dot (delta), u.dot (delta)); // the angles are fine between -PI and PI too
+    float angle = atan2f (v.dot (delta), u.dot (delta)); // the angles are fine between -PI and PI too
+    if (gaps.isValid ())
+      gaps.add (angle);
+    else
+      angles.push_back (angle);
+    ++cp;
   }
   if (cp == 0)
     return (false);
 
-  angles.resize (cp);
+  if (gaps.isValid ())
+    return (gaps.exceedsThreshold ());
+
   std::sort (angles.begin (), angles.end ());
 
   // Compute the maximal angle difference between two consecutive angles
+  float max_dif = FLT_MIN, dif;
   for (size_t i = 0; i < angles.size () - 1; ++i)
   {
     dif = angles[i + 1] - angles[i];
@@ -110,36 +162,93 @@ template <typename PointInT, typename PointNT, typename PointOutT> bool
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
-template <typename PointInT, typename PointNT, typename PointOutT> void
-  pcl::BoundaryEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut &output)
+template <typename PointInT, typename PointNT, typename PointOutT> bool
+  pcl::BoundaryEstimation<PointInT, PointNT, PointOutT>::isImageBoundaryPoint (
+      int index, const Eigen::Vector4f &u, const Eigen::Vector4f &v, AngleGaps &gaps) const
 {
-  // Allocate enough space to hold the results
-  // \note This resize is irrelevant for a radiusSearch ().
-  std::vector<int> nn_indices (k_);
-  std::vector<float> nn_dists (k_);
+  const int width = input_->width, height = input_->height;
+  const int y = index / width, x = index - y * width;
+  const PointInT &point = input_->points[index];
+  const float max_dist_squared = search_parameter_ * search_parameter_;
 
-  Eigen::Vector4f u = Eigen::Vector4f::Zero (), v = Eigen::Vector4f::Zero ();
+  // The point itself is its first neighbor
+  gaps.add (0.0f);
+  int nr_neighbors = 1;
 
-  // Iterating over the entire index vector
-  for (size_t idx = 0; idx < indices_->size (); ++idx)
+  bool still_in_range = true;
+  for (int radius = 1; still_in_range; ++radius)
   {
-    if (!pcl_isfinite (input_->points[(*indices_)[idx]].x) || 
-        !pcl_isfinite (input_->points[(*indices_)[idx]].y) || 
-        !pcl_isfinite (input_->points[(*indices_)[idx]].z))
+    int x2 = x - radius - 1, y2 = y - radius;  // Top left - 1
+    still_in_range = false;
+    for (int i = 0; i < 8 * radius; ++i)
     {
-      output.points[idx].boundary_point = 0;
-      continue;
+      if (i <= 2 * radius) ++x2; else if (i <= 4 * radius) ++y2; else if (i <= 6 * radius) --x2; else --y2;
+      if (x2 < 0 || x2 >= width || y2 < 0 || y2 >= height)
+        continue;
+      const PointInT &neighbor = input_->points[y2 * width + x2];
+      if (!pcl_isfinite (neighbor.x))
+        continue;
+      if (squaredEuclideanDistance (point, neighbor) > max_dist_squared)
+        continue;
+      still_in_range = true;
+
+      Eigen::Vector4f delta = neighbor.getVector4fMap () - point.getVector4fMap ();
+      gaps.add (atan2f (v.dot (delta), u.dot (delta)));
+      ++nr_neighbors;
     }
+  }
+
+  if (nr_neighbors < 3)
+    return (false);
+  return (gaps.exceedsThreshold ());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT> void
+  pcl::BoundaryEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut &output)
+{
+  // Walk the image neighborhoods ourselves when they would be searched with the default organized locator
+  bool image_neighborhood = k_ == 0 && surface_ == input_ && input_->isOrganized () &&
+                            dynamic_cast<const pcl::OrganizedDataIndex<PointInT>*> (tree_.get ()) != NULL &&
+                            AngleGaps (angle_threshold_).isValid ();
+
+#pragma omp parallel num_threads (threads_)
+  {
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
 
-    this->searchForNeighbors ((*indices_)[idx], search_parameter_, nn_indices, nn_dists);
+    Eigen::Vector4f u = Eigen::Vector4f::Zero (), v = Eigen::Vector4f::Zero ();
 
-    // Obtain a coordinate system on the least-squares plane
-    //v = normals_->points[(*indices_)[idx]].getNormalVector4fMap ().unitOrthogonal ();
-    //u = normals_->points[(*indices_)[idx]].getNormalVector4fMap ().cross3 (v);
-    getCoordinateSystemOnPlane (normals_->points[(*indices_)[idx]], u, v);
+    // Iterating over the entire index vector
+#pragma omp for schedule (dynamic, 256)
+    for (int idx = 0; idx < (int) indices_->size (); ++idx)
+    {
+      int index = (*indices_)[idx];
+      if (!pcl_isfinite (input_->points[index].x) || 
+          !pcl_isfinite (input_->points[index].y) || 
+          !pcl_isfinite (input_->points[index].z))
+      {
+        output.points[idx].boundary_point = 0;
+        continue;
+      }
+
+      // Obtain a coordinate system on the least-squares plane
+      getCoordinateSystemOnPlane (normals_->points[index], u, v);
+
+      if (image_neighborhood)
+      {
+        AngleGaps gaps (angle_threshold_);
+        output.points[idx].boundary_point = isImageBoundaryPoint (index, u, v, gaps);
+        continue;
+      }
 
-    // Estimate whether the point is lying on a boundary surface or not
-    output.points[idx].boundary_point = isBoundaryPoint (*surface_, input_->points[(*indices_)[idx]], nn_indices, u, v, angle_threshold_);
+      // Only the first k entries are valid, the search doesn't shrink vectors it can reuse
+      int k = this->searchForNeighbors (index, search_parameter_, nn_indices, nn_dists);
+      nn_indices.resize (std::max (k, 0));
+
+      // Estimate whether the point is lying on a boundary surface or not
+      output.points[idx].boundary_point = isBoundaryPoint (*surface_, input_->points[index], nn_indices, u, v, angle_threshold_);
+    }
   }
 }
 
@@ -242,10 +242,10 @@ pcl::CVFHEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut
 
   std::vector <Eigen::Vector3f> dominant_normals;
 
+  // The signatures are computed directly over the whole surface, vfh.compute () would rebuild a kd-tree that VFH
+  // doesn't search for every one of them
   VFHEstimator vfh;
-  vfh.setInputCloud (surface_);
-  vfh.setInputNormals (normals_);
-  vfh.setSearchMethod(this->tree_);
+  vfh.setViewPoint (vpx_, vpy_, vpz_);
   vfh.setUseGivenNormal (true);
   vfh.setUseGivenCentroid (true);
   vfh.setNormalizeBins (false);
@@ -253,6 +253,10 @@ pcl::CVFHEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut
   vfh.setFillSizeComponent(true);
   output.height = 1;
 
+  std::vector<int> surface_indices (surface_->points.size ());
+  for (size_t i = 0; i < surface_indices.size (); ++i)
+    surface_indices[i] = i;
+
   // ---[ Step 1b : check if any dominant cluster was found
   if (clusters.size () > 0)
   {  // ---[ Step 1b.1 : If yes, compute CVFH using the cluster information
@@ -282,8 +286,6 @@ pcl::CVFHEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut
         avg_normal /= clusters[i].indices.size ();
         avg_centroid /= clusters[i].indices.size ();
 
-        Eigen::Vector4f centroid_test;
-        pcl::compute3DCentroid(*normals_filtered_cloud,centroid_test);
         avg_normal.normalize ();
 
         Eigen::Vector3f avg_norm (avg_normal[0], avg_normal[1], avg_normal[2]);
@@ -301,12 +303,10 @@ pcl::CVFHEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut
 
     for (size_t i = 0; i < dominant_normals.size (); ++i)
     {
-      //configure VFH computation for CVFH
-      vfh.setNormalToUse (dominant_normals[i]);
-      vfh.setCentroidToUse (centroids_dominant_orientations_[i]);
-      pcl::PointCloud < pcl::VFHSignature308 > vfh_signature;
-      vfh.compute (vfh_signature);
-      output.points[i] = vfh_signature.points[0];
+      Eigen::Vector4f normal (dominant_normals[i][0], dominant_normals[i][1], dominant_normals[i][2], 0);
+      Eigen::Vector4f centroid (centroids_dominant_orientations_[i][0], centroids_dominant_orientations_[i][1],
+                                centroids_dominant_orientations_[i][2], 0);
+      vfh.computeSignature (*surface_, *normals_, surface_indices, centroid, normal, output.points[i]);
     }
   }
   else
@@ -320,13 +320,13 @@ pcl::CVFHEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut
     vfh.setCentroidToUse (cloud_centroid);
     vfh.setUseGivenNormal (false);
 
-    pcl::PointCloud < pcl::VFHSignature308 > vfh_signature;
-    vfh.compute (vfh_signature);
+    Eigen::Vector4f centroid, normal;
+    vfh.computeMoments (*surface_, *normals_, surface_indices, centroid, normal);
 
     output.points.resize(1);
     output.width = 1;
 
-    output.points[0] = vfh_signature.points[0];
+    vfh.computeSignature (*surface_, *normals_, surface_indices, centroid, normal, output.points[0]);
   }
 }
 
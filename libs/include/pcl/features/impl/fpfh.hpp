@@ -165,85 +165,227 @@ pcl::FPFHEstimation<PointInT, PointNT, PointOutT>::weightPointSPFHSignature (
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT, typename PointNT, typename PointOutT> void
-pcl::FPFHEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut &output)
+pcl::FPFHEstimation<PointInT, PointNT, PointOutT>::computePointSPFHSignature (
+      const pcl::PointCloud<PointInT> &cloud, const pcl::PointCloud<PointNT> &normals,
+      int p_idx, const int *indices, int nr_indices, float *hist)
 {
-  // Allocate enough space to hold the NN search results
-  // \note This resize is irrelevant for a radiusSearch ().
-  std::vector<int> nn_indices (k_);
-  std::vector<float> nn_dists (k_);
-
-  std::set<int> spfh_indices;
-  std::vector<int> spfh_hist_lookup (surface_->points.size ());
-
-  // Build a list of (unique) indices for which we will need to compute SPFH signatures
-  // (We need an SPFH signature for every point that is a neighbor of any point in input_[indices_])
-  if (surface_ != input_ ||
-      indices_->size () != surface_->points.size ())
-  { 
-    for (size_t idx = 0; idx < indices_->size (); ++idx)
-    {
-      int p_idx = (*indices_)[idx];
-      this->searchForNeighbors (p_idx, search_parameter_, nn_indices, nn_dists);
-      
-      spfh_indices.insert (nn_indices.begin (), nn_indices.end ());
-    }
-  }
-  else
-  {
-    // Special case: When a feature must be computed at every point, there is no need for a neighborhood search
-    for (size_t idx = 0; idx < indices_->size (); ++idx)
-      spfh_indices.insert (idx);
-  }
+  Eigen::Vector4f pfh_tuple;
+  float *hist_f2 = hist + nr_bins_f1_;
+  float *hist_f3 = hist_f2 + nr_bins_f2_;
 
-  // Initialize the arrays that will store the SPFH signatures
-  size_t data_size = spfh_indices.size ();
-  hist_f1_.setZero (data_size, nr_bins_f1_);
-  hist_f2_.setZero (data_size, nr_bins_f2_);
-  hist_f3_.setZero (data_size, nr_bins_f3_);
+  // Factorization constant
+  float hist_incr = 100.0 / (float)(nr_indices - 1);
 
-  // Compute SPFH signatures for every point that needs them
-  std::set<int>::iterator spfh_indices_itr = spfh_indices.begin ();
-  for (size_t i = 0; i < spfh_indices.size (); ++i)
+  // Iterate over all the points in the neighborhood
+  for (int idx = 0; idx < nr_indices; ++idx)
   {
-    // Get the next point index
-    int p_idx = *spfh_indices_itr;
-    ++spfh_indices_itr;
-
-    // Find the neighborhood around p_idx
-    this->searchForNeighbors (p_idx, search_parameter_, nn_indices, nn_dists);
+    // Avoid unnecessary returns
+    if (p_idx == indices[idx])
+      continue;
 
-    // Estimate the SPFH signature around p_idx
-    computePointSPFHSignature (*surface_, *normals_, p_idx, i, nn_indices, hist_f1_, hist_f2_, hist_f3_);
+    // Compute the pair P to NNi
+    if (!computePairFeatures (cloud, normals, p_idx, indices[idx], pfh_tuple[0], pfh_tuple[1], pfh_tuple[2], pfh_tuple[3]))
+      continue;
 
-    // Populate a lookup table for converting a point index to its corresponding row in the spfh_hist_* matrices
-    spfh_hist_lookup[p_idx] = i;
+    // Normalize the f1, f2, f3 features and push them in the histogram
+    int h_index = floor (nr_bins_f1_ * ((pfh_tuple[0] + M_PI) * d_pi_));
+    if (h_index < 0)            h_index = 0;
+    if (h_index >= nr_bins_f1_) h_index = nr_bins_f1_ - 1;
+    hist[h_index] += hist_incr;
+
+    h_index = floor (nr_bins_f2_ * ((pfh_tuple[1] + 1.0) * 0.5));
+    if (h_index < 0)            h_index = 0;
+    if (h_index >= nr_bins_f2_) h_index = nr_bins_f2_ - 1;
+    hist_f2[h_index] += hist_incr;
+
+    h_index = floor (nr_bins_f3_ * ((pfh_tuple[2] + 1.0) * 0.5));
+    if (h_index < 0)            h_index = 0;
+    if (h_index >= nr_bins_f3_) h_index = nr_bins_f3_ - 1;
+    hist_f3[h_index] += hist_incr;
   }
+}
 
-  // Intialize the array that will store the FPFH signature
-  int nr_bins = nr_bins_f1_ + nr_bins_f2_ + nr_bins_f3_;
-  fpfh_histogram_.setZero (nr_bins);
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT> void
+pcl::FPFHEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut &output)
+{
+  const int nr_bins = nr_bins_f1_ + nr_bins_f2_ + nr_bins_f3_;
+  const int nr_points = (int)indices_->size ();
+  const int nr_surface = (int)surface_->points.size ();
+
+  // The neighbors of an earlier stage can be used if every surface point is a query point, in order
+  const bool whole_cloud = surface_ == input_ && fake_indices_ && k_ > 0;
+  const bool use_cache = whole_cloud && neighbor_cache_ && neighbor_cache_->holds (input_, nr_surface, k_);
+  const bool fill_cache = whole_cloud && neighbor_cache_ && !use_cache;
+  if (fill_cache)
+  {
+    neighbor_cache_->k = k_;
+    neighbor_cache_->cloud = input_;
+    neighbor_cache_->indices.resize ((size_t)nr_surface * k_);
+    neighbor_cache_->sqr_distances.resize ((size_t)nr_surface * k_);
+  }
+  const int cache_k = neighbor_cache_ ? neighbor_cache_->k : 0;
 
-  // Iterate over the entire index vector
-  for (size_t idx = 0; idx < indices_->size (); ++idx)
+  // Search the neighbors of every query point once, unless they are in the cache already
+  std::vector<std::vector<int> > query_indices;
+  std::vector<std::vector<float> > query_dists;
+  if (!use_cache)
   {
-    // Find the indices of point idx's neighbors... 
-    this->searchForNeighbors ((*indices_)[idx], search_parameter_, nn_indices, nn_dists);
+    query_indices.resize (nr_points);
+    query_dists.resize (nr_points);
+#pragma omp parallel for num_threads (threads_) schedule (static)
+    for (int idx = 0; idx < nr_points; ++idx)
+    {
+      std::vector<int> &nn_indices = query_indices[idx];
+      std::vector<float> &nn_dists = query_dists[idx];
+      nn_indices.resize (k_);             // \note These resizes are irrelevant for a radiusSearch ().
+      nn_dists.resize (k_);
+      if (this->searchForNeighbors ((*indices_)[idx], search_parameter_, nn_indices, nn_dists) == 0)
+        nn_indices.clear ();
+
+      if (fill_cache)
+      {
+        int *cache_indices = &neighbor_cache_->indices[(size_t)idx * k_];
+        float *cache_dists = &neighbor_cache_->sqr_distances[(size_t)idx * k_];
+        if ((int)nn_indices.size () < k_)
+        {
+          std::fill_n (cache_indices, k_, -1);
+          std::fill_n (cache_dists, k_, 0.0f);
+        }
+        else
+        {
+          std::copy (nn_indices.begin (), nn_indices.begin () + k_, cache_indices);
+          std::copy (nn_dists.begin (), nn_dists.begin () + k_, cache_dists);
+        }
+      }
+    }
+  }
 
-    // ... and remap the nn_indices values so that they represent row indices in the spfh_hist_* matrices 
-    // instead of indices into surface_->points
-    for (size_t i = 0; i < nn_indices.size (); ++i)
-      nn_indices[i] = spfh_hist_lookup[nn_indices[i]];
+  // Give every surface point that is a neighbor of a query point a row in the SPFH buffer, in
+  // increasing point order, and keep track of the points that are queries themselves
+  std::vector<const int*> query_nn_indices (nr_points);
+  std::vector<const float*> query_nn_dists (nr_points);
+  std::vector<int> query_nr_nn (nr_points);
+  std::vector<int> spfh_row (nr_surface, -1);
+  std::vector<int> query_of;
+  if (surface_ == input_)
+    query_of.assign (nr_surface, -1);
+  for (int idx = 0; idx < nr_points; ++idx)
+  {
+    if (use_cache)
+    {
+      query_nn_indices[idx] = &neighbor_cache_->indices[(size_t)idx * cache_k];
+      query_nn_dists[idx] = &neighbor_cache_->sqr_distances[(size_t)idx * cache_k];
+      query_nr_nn[idx] = query_nn_indices[idx][0] == -1 ? 0 : k_;
+    }
+    else if (!query_indices[idx].empty ())
+    {
+      query_nn_indices[idx] = &query_indices[idx][0];
+      query_nn_dists[idx] = &query_dists[idx][0];
+      query_nr_nn[idx] = (int)query_indices[idx].size ();
+    }
 
-    // Compute the FPFH signature (i.e. compute a weighted combination of local SPFH signatures) ...
-    weightPointSPFHSignature (hist_f1_, hist_f2_, hist_f3_, nn_indices, nn_dists, fpfh_histogram_);
+    for (int i = 0; i < query_nr_nn[idx]; ++i)
+      spfh_row[query_nn_indices[idx][i]] = 0;
+    if (surface_ == input_)
+      query_of[(*indices_)[idx]] = idx;
+  }
+  std::vector<int> spfh_points;
+  for (int p_idx = 0; p_idx < nr_surface; ++p_idx)
+  {
+    if (spfh_row[p_idx] == -1)
+      continue;
+    spfh_row[p_idx] = (int)spfh_points.size ();
+    spfh_points.push_back (p_idx);
+  }
 
-    // ...and copy it into the output cloud
-    for (int d = 0; d < fpfh_histogram_.size (); ++d)
-      output.points[idx].histogram[d] = fpfh_histogram_[d];
+  // First pass: the SPFH signature of every point needed
+  const int nr_rows = (int)spfh_points.size ();
+  spfh_.assign ((size_t)nr_rows * nr_bins, 0.0f);
+#pragma omp parallel num_threads (threads_)
+  {
+    std::vector<int> p_indices (k_);
+    std::vector<float> p_dists (k_);
 
-    fpfh_histogram_.setZero ();
+#pragma omp for schedule (static)
+    for (int row = 0; row < nr_rows; ++row)
+    {
+      const int p_idx = spfh_points[row];
+      const int *nn_indices;
+      int nr_nn;
+
+      // Reuse the neighbors of the query points, search the others in the surface
+      if (surface_ == input_ && query_of[p_idx] != -1)
+      {
+        nn_indices = query_nn_indices[query_of[p_idx]];
+        nr_nn = query_nr_nn[query_of[p_idx]];
+      }
+      else
+      {
+        if (surface_ == input_)
+          nr_nn = this->search_method_ (p_idx, search_parameter_, p_indices, p_dists);
+        else
+          nr_nn = this->search_method_surface_ (*surface_, p_idx, search_parameter_, p_indices, p_dists);
+        nn_indices = nr_nn == 0 ? NULL : &p_indices[0];
+      }
+
+      // Points without neighbors keep an empty signature
+      if (nr_nn > 0)
+        computePointSPFHSignature (*surface_, *normals_, p_idx, nn_indices, nr_nn, &spfh_[(size_t)row * nr_bins]);
+    }
   }
 
+  // Second pass: weight the SPFH signatures of the neighbors of every query point
+#pragma omp parallel num_threads (threads_)
+  {
+    std::vector<float> fpfh_histogram (nr_bins);
+
+#pragma omp for schedule (static)
+    for (int idx = 0; idx < nr_points; ++idx)
+    {
+      const int *nn_indices = query_nn_indices[idx];
+      const float *nn_dists = query_nn_dists[idx];
+      const int nr_nn = query_nr_nn[idx];
+
+      // Points without neighbors (e.g. invalid ones) get a NaN signature
+      if (nr_nn == 0)
+      {
+        for (int d = 0; d < nr_bins; ++d)
+          output.points[idx].histogram[d] = std::numeric_limits<float>::quiet_NaN ();
+        output.is_dense = false;
+        continue;
+      }
+
+      // Sum the rows of the neighbors, minus the query point itself, weighted by their inverse distance
+      float *hist = &fpfh_histogram[0];
+      std::fill_n (hist, nr_bins, 0.0f);
+      for (int i = 0; i < nr_nn; ++i)
+      {
+        if (nn_dists[i] == 0)
+          continue;
+        const float weight = 1.0f / nn_dists[i];
+        const float *row = &spfh_[(size_t)spfh_row[nn_indices[i]] * nr_bins];
+        for (int d = 0; d < nr_bins; ++d)
+          hist[d] += row[d] * weight;
+      }
+
+      // Normalize every feature histogram so that its values sum up to 100
+      int begin = 0;
+      const int nr_bins_f[3] = {nr_bins_f1_, nr_bins_f2_, nr_bins_f3_};
+      for (int f = 0; f < 3; ++f)
+      {
+        const int end = begin + nr_bins_f[f];
+        double sum = 0.0;
+        for (int d = begin; d < end; ++d)
+          sum += hist[d];
+        if (sum != 0)
+          sum = 100.0 / sum;
+        for (int d = begin; d < end; ++d)
+          output.points[idx].histogram[d] = hist[d] * sum;
+        begin = end;
+      }
+    }
+  }
 }
 
 #define PCL_INSTANTIATE_FPFHEstimation(T,NT,OutT) template class PCL_EXPORTS pcl::FPFHEstimation<T,NT,OutT>;
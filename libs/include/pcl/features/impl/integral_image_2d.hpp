@@ -36,49 +36,34 @@
 /* \author Stefan Holzer */
 
 #include <cstddef>
+#include <algorithm>
 
+template <class DataType, class IIDataType>
+pcl::IntegralImage2D<DataType, IIDataType>::IntegralImage2D () : width_(0), height_(0),
+  dimensions_(0),
+  element_stride_(0),
+  row_stride_(0),
+  are_second_order_ii_available_(false),
+  threads_(1),
+  nr_values_(0)
+{
+}
+
+
+// ---------------------------------------------------------------------------- 
 template <class DataType, class IIDataType>
 pcl::IntegralImage2D<DataType, IIDataType>::IntegralImage2D (
     DataType * data, const int width, const int height,
     const int dimensions, const bool compute_second_order_integral_images,
-    const int element_stride,const int row_stride) : width_(width), height_(height),
-  dimensions_(dimensions),
-  element_stride_(element_stride),
-  row_stride_(row_stride),
-  are_second_order_ii_available_(compute_second_order_integral_images)
+    const int element_stride,const int row_stride) : width_(0), height_(0),
+  dimensions_(0),
+  element_stride_(0),
+  row_stride_(0),
+  are_second_order_ii_available_(false),
+  threads_(1),
+  nr_values_(0)
 {
-  // allocate memory
-  for (int dimension_index = 0; dimension_index < dimensions; ++dimension_index)
-  {
-    IIDataType * data_array = new IIDataType[width*height]; // reinterpret_cast<IIDataType*>(new unsigned char(width*height*sizeof(IIDataType)));
-
-    first_order_integral_images_.push_back(data_array);
-  }
-
-  if (compute_second_order_integral_images)
-  {
-    for (int dimension_index1 = 0; dimension_index1 < dimensions; ++dimension_index1)
-    {
-      second_order_integral_images_.push_back(::std::vector< IIDataType* >());
-      for (int dimension_index2 = 0; dimension_index2 < dimensions; ++dimension_index2)
-      {
-        IIDataType * data_array = new IIDataType[width*height];
-
-        second_order_integral_images_[dimension_index1].push_back(data_array);
-      }
-    }
-  }
-
-
-  // compute integral images
-  if (dimensions_ == 1)
-  {
-    this->computeIntegralImagesOneDimensional (data);
-  }
-  else
-  {
-    this->computeIntegralImages (data);
-  }
+  setInput (data, width, height, dimensions, compute_second_order_integral_images, element_stride, row_stride);
 }
 
 
@@ -86,17 +71,41 @@ pcl::IntegralImage2D<DataType, IIDataType>::IntegralImage2D (
 template <class DataType, class IIDataType>
 pcl::IntegralImage2D<DataType, IIDataType>::~IntegralImage2D()
 {
-  for (unsigned int index = 0; index < first_order_integral_images_.size(); ++index)
-  {
-    delete[] (first_order_integral_images_[index]);
-  }
-  for (unsigned int index1 = 0; index1 < second_order_integral_images_.size(); ++index1)
+}
+
+
+// ---------------------------------------------------------------------------- 
+template <class DataType, class IIDataType> void
+pcl::IntegralImage2D<DataType, IIDataType>::setInput (
+    DataType * data, const int width, const int height,
+    const int dimensions, const bool compute_second_order_integral_images,
+    const int element_stride,const int row_stride)
+{
+  width_ = width;
+  height_ = height;
+  dimensions_ = dimensions;
+  element_stride_ = element_stride;
+  row_stride_ = row_stride;
+  are_second_order_ii_available_ = compute_second_order_integral_images;
+
+  // only the upper triangle of the products is stored, they are symmetric
+  nr_values_ = dimensions;
+  second_order_offsets_.assign (compute_second_order_integral_images ? dimensions : 0, std::vector<int> (dimensions, 0));
+  for (int dimension_index1 = 0; dimension_index1 < dimensions && compute_second_order_integral_images; ++dimension_index1)
   {
-    for (unsigned int index2 = 0; index2 < second_order_integral_images_[index1].size(); ++index2)
+    for (int dimension_index2 = dimension_index1; dimension_index2 < dimensions; ++dimension_index2, ++nr_values_)
     {
-      delete[] (second_order_integral_images_[index1][index2]);
+      second_order_offsets_[dimension_index1][dimension_index2] = nr_values_;
+      second_order_offsets_[dimension_index2][dimension_index1] = nr_values_;
     }
   }
+
+  // resizing keeps the capacity, so a stream of images of the same size never reallocates
+  integral_images_.resize (static_cast<size_t> (width) * height * nr_values_);
+  if (integral_images_.empty ())
+    return;
+
+  this->computeIntegralImages (data);
 }
 
 
@@ -105,18 +114,9 @@ template <class DataType, class IIDataType> IIDataType
 pcl::IntegralImage2D<DataType, IIDataType>::getSum (
   const int start_x, const int start_y,
   const int width, const int height,
-  const int dimension_index )
+  const int dimension_index ) const
 {
-  const int l_ulX = start_x;
-  const int l_ulY = start_y;
-  const int l_lrX = start_x + width;
-  const int l_lrY = start_y + height;
-  
-  return 
-     (first_order_integral_images_[dimension_index][l_ulY*width_ + l_ulX]
-    + first_order_integral_images_[dimension_index][l_lrY*width_ + l_lrX]
-    - first_order_integral_images_[dimension_index][l_lrY*width_ + l_ulX]
-    - first_order_integral_images_[dimension_index][l_ulY*width_ + l_lrX]);
+  return (getSumAtOffset (start_x, start_y, width, height, dimension_index));
 }
 
 
@@ -125,17 +125,9 @@ template <class DataType, class IIDataType> IIDataType
 pcl::IntegralImage2D<DataType, IIDataType>::getSum (
   const int start_x, const int start_y,
   const int width, const int height,
-  const int dimension_index1, const int dimension_index2)
+  const int dimension_index1, const int dimension_index2) const
 {
-  const int l_ulX = start_x;
-  const int l_ulY = start_y;
-  const int l_lrX = start_x + width;
-  const int l_lrY = start_y + height;
-  
-  return second_order_integral_images_[dimension_index1][dimension_index2][l_ulY*width_ + l_ulX]
-    + second_order_integral_images_[dimension_index1][dimension_index2][l_lrY*width_ + l_lrX]
-    - second_order_integral_images_[dimension_index1][dimension_index2][l_lrY*width_ + l_ulX]
-    - second_order_integral_images_[dimension_index1][dimension_index2][l_ulY*width_ + l_lrX];
+  return (getSumAtOffset (start_x, start_y, width, height, second_order_offsets_[dimension_index1][dimension_index2]));
 }
 
 
@@ -143,209 +135,35 @@ pcl::IntegralImage2D<DataType, IIDataType>::getSum (
 template <class DataType, class IIDataType> void
 pcl::IntegralImage2D<DataType, IIDataType>::computeIntegralImages (DataType *data)
 {
-  // first element
+  if (threads_ <= 1)
   {
-    const int row_index = 0;
-    const int col_index = 0;
-    for (int dimension_index = 0; dimension_index < dimensions_; ++dimension_index)
+    // single sweep, every row is still in cache when the previous one is added to it
+    for (int row_index = 0; row_index < height_; ++row_index)
     {
-      const IIDataType data_value = static_cast<IIDataType>(data[row_index*row_stride_ + col_index*element_stride_ + dimension_index]);
-
-      if (!pcl_isfinite (data_value))
-      {
-        first_order_integral_images_[dimension_index][row_index*width_ + col_index] = 0.0f;
-
-        if (are_second_order_ii_available_)
-        {
-          for (int dimension_index2 = 0; dimension_index2 < dimensions_; ++dimension_index2)
-          {
-            second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + col_index] = 0.0f;
-          }
-        }
-      }
-      else
-      {
-        first_order_integral_images_[dimension_index][row_index*width_ + col_index] = data_value;
-
-        if (are_second_order_ii_available_)
-        {
-          for (int dimension_index2 = 0; dimension_index2 < dimensions_; ++dimension_index2)
-          {
-            const IIDataType data_value2 = static_cast<IIDataType>(data[row_index*row_stride_ + col_index*element_stride_ + dimension_index2]);
-
-            if (!pcl_isfinite (data_value2))
-            {
-              second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + col_index] = 0.0f;
-            }
-            else
-            {
-              second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + col_index] = data_value*data_value2;
-            }
-          }
-        }
-      }
+      computeRowPrefixSums (data, row_index);
+      if (row_index > 0)
+        accumulateRow (row_index, 0, width_);
     }
+    return;
   }
 
-  // first row
-  {
-    const int row_index = 0; 
-    for (int col_index = 1; col_index < width_; ++col_index)
-    {
-      for (int dimension_index = 0; dimension_index < dimensions_; ++dimension_index)
-      {
-        const IIDataType data_value = static_cast<IIDataType>(data[row_index*row_stride_ + col_index*element_stride_ + dimension_index]);
-
-        if (!pcl_isfinite (data_value))
-        {
-          first_order_integral_images_[dimension_index][row_index*width_ + col_index] = 
-            first_order_integral_images_[dimension_index][row_index*width_ + (col_index-1)];
-
-          if (are_second_order_ii_available_)
-          {
-            for (int dimension_index2 = 0; dimension_index2 < dimensions_; ++dimension_index2)
-            {
-              second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + col_index] = 
-                second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + (col_index-1)];
-            }
-          }
-        }
-        else
-        {
-          first_order_integral_images_[dimension_index][row_index*width_ + col_index] = data_value
-            + first_order_integral_images_[dimension_index][row_index*width_ + (col_index-1)];
-
-          if (are_second_order_ii_available_)
-          {
-            for (int dimension_index2 = 0; dimension_index2 < dimensions_; ++dimension_index2)
-            {
-              const IIDataType data_value2 = static_cast<IIDataType>(data[row_index*row_stride_ + col_index*element_stride_ + dimension_index2]);
+  // blocks of columns that are accumulated independently in the second pass
+  const int block_size = 64;
+  const int nr_blocks = (width_ + block_size - 1) / block_size;
 
-              if (!pcl_isfinite (data_value2))
-              {
-                second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + col_index] = 
-                  second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + (col_index-1)];
-              }
-              else
-              {
-                second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + col_index] = data_value*data_value2
-                  + second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + (col_index-1)];
-              }
-            }
-          }
-        }
-      }
-    }
-  }
-
-  // first column
+#pragma omp parallel num_threads (threads_)
   {
-    const int col_index = 0;
-    for (int row_index = 1; row_index < height_; ++row_index)
-    {
-      for (int dimension_index = 0; dimension_index < dimensions_; ++dimension_index)
-      {
-        const IIDataType data_value = static_cast<IIDataType>(data[row_index*row_stride_ + col_index*element_stride_ + dimension_index]);
-
-        if (!pcl_isfinite (data_value))
-        {
-          first_order_integral_images_[dimension_index][row_index*width_ + col_index] = 
-            first_order_integral_images_[dimension_index][(row_index-1)*width_ + col_index];
+#pragma omp for schedule (static)
+    for (int row_index = 0; row_index < height_; ++row_index)
+      computeRowPrefixSums (data, row_index);
 
-          if (are_second_order_ii_available_)
-          {
-            for (int dimension_index2 = 0; dimension_index2 < dimensions_; ++dimension_index2)
-            {
-              second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + col_index] = 
-                second_order_integral_images_[dimension_index][dimension_index2][(row_index-1)*width_ + col_index];
-            }
-          }
-        }
-        else
-        {
-          first_order_integral_images_[dimension_index][row_index*width_ + col_index] = data_value
-            + first_order_integral_images_[dimension_index][(row_index-1)*width_ + col_index];
-
-          if (are_second_order_ii_available_)
-          {
-            for (int dimension_index2 = 0; dimension_index2 < dimensions_; ++dimension_index2)
-            {
-              const IIDataType data_value2 = static_cast<IIDataType>(data[row_index*row_stride_ + col_index*element_stride_ + dimension_index2]);
-
-              if (!pcl_isfinite (data_value))
-              {
-                second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + col_index] = second_order_integral_images_[dimension_index][dimension_index2][(row_index-1)*width_ + col_index];
-              }
-              else
-              {
-                second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + col_index] = data_value*data_value2
-                  + second_order_integral_images_[dimension_index][dimension_index2][(row_index-1)*width_ + col_index];
-              }
-            }
-          }
-        }
-      }
-    }
-  }
-
-  // the rest
-  for (int row_index = 1; row_index < height_; ++row_index)
-  {
-    for (int col_index = 1; col_index < width_; ++col_index)
+#pragma omp for schedule (static)
+    for (int block_index = 0; block_index < nr_blocks; ++block_index)
     {
-      for (int dimension_index = 0; dimension_index < dimensions_; ++dimension_index)
-      {
-        const IIDataType data_value = static_cast<IIDataType>(data[row_index*row_stride_ + col_index*element_stride_ + dimension_index]);
-
-        if (!pcl_isfinite (data_value))
-        {
-          first_order_integral_images_[dimension_index][row_index*width_ + col_index] = 
-            first_order_integral_images_[dimension_index][row_index*width_ + (col_index-1)]
-            + first_order_integral_images_[dimension_index][(row_index-1)*width_ + col_index]
-            - first_order_integral_images_[dimension_index][(row_index-1)*width_ + (col_index-1)];
-
-          if (are_second_order_ii_available_)
-          {
-            for (int dimension_index2 = 0; dimension_index2 < dimensions_; ++dimension_index2)
-            {
-              second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + col_index] = 
-                second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + (col_index-1)]
-                + second_order_integral_images_[dimension_index][dimension_index2][(row_index-1)*width_ + col_index]
-                - second_order_integral_images_[dimension_index][dimension_index2][(row_index-1)*width_ + (col_index-1)];
-            }
-          }
-        }
-        else
-        {
-          first_order_integral_images_[dimension_index][row_index*width_ + col_index] = data_value
-            + first_order_integral_images_[dimension_index][row_index*width_ + (col_index-1)]
-            + first_order_integral_images_[dimension_index][(row_index-1)*width_ + col_index]
-            - first_order_integral_images_[dimension_index][(row_index-1)*width_ + (col_index-1)];
-
-          if (are_second_order_ii_available_)
-          {
-            for (int dimension_index2 = 0; dimension_index2 < dimensions_; ++dimension_index2)
-            {
-              const IIDataType data_value2 = static_cast<IIDataType>(data[row_index*row_stride_ + col_index*element_stride_ + dimension_index2]);
-
-              if (!pcl_isfinite (data_value2))
-              {
-                second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + col_index] = 
-                  second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + (col_index-1)]
-                  + second_order_integral_images_[dimension_index][dimension_index2][(row_index-1)*width_ + col_index]
-                  - second_order_integral_images_[dimension_index][dimension_index2][(row_index-1)*width_ + (col_index-1)];
-              }
-              else
-              {
-                second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + col_index] = data_value*data_value2
-                  + second_order_integral_images_[dimension_index][dimension_index2][row_index*width_ + (col_index-1)]
-                  + second_order_integral_images_[dimension_index][dimension_index2][(row_index-1)*width_ + col_index]
-                  - second_order_integral_images_[dimension_index][dimension_index2][(row_index-1)*width_ + (col_index-1)];
-              }
-            }
-          }
-        }
-      }
+      const int col_begin = block_index * block_size;
+      const int col_end = std::min (col_begin + block_size, width_);
+      for (int row_index = 1; row_index < height_; ++row_index)
+        accumulateRow (row_index, col_begin, col_end);
     }
   }
 }
@@ -353,133 +171,52 @@ pcl::IntegralImage2D<DataType, IIDataType>::computeIntegralImages (DataType *dat
 
 // ---------------------------------------------------------------------------- 
 template <class DataType, class IIDataType> void
-pcl::IntegralImage2D<DataType, IIDataType>::computeIntegralImagesOneDimensional (DataType *data)
+pcl::IntegralImage2D<DataType, IIDataType>::computeRowPrefixSums (const DataType *data, const int row_index)
 {
-  IIDataType * first_order_integral_image = first_order_integral_images_[0];
-  IIDataType * second_order_integral_image = NULL;
-  if (are_second_order_ii_available_)
-  {
-    second_order_integral_image = second_order_integral_images_[0][0];
-  }
-
-  // first element
-  {
-    const int row_index = 0;
-    const int col_index = 0;
+  const DataType *row = data + row_index*row_stride_;
+  IIDataType *integral_image = &integral_images_[static_cast<size_t> (row_index) * width_ * nr_values_];
 
-    const IIDataType data_value = static_cast<IIDataType>(data[row_index*row_stride_ + col_index*element_stride_]);
+  // non finite values contribute nothing to the sums
+  for (int value_index = 0; value_index < nr_values_; ++value_index)
+    integral_image[value_index] = 0;
 
-    if (!pcl_isfinite (data_value))
-    {
-      first_order_integral_image[row_index*width_ + col_index] = 0.0;
+  for (int col_index = 0; col_index < width_; ++col_index)
+  {
+    const DataType *element = row + col_index*element_stride_;
+    IIDataType *sums = integral_image + col_index*nr_values_;
+    const IIDataType *previous_sums = col_index > 0 ? sums - nr_values_ : sums;
 
-      if (are_second_order_ii_available_)
-      {
-        second_order_integral_image[row_index*width_ + col_index] = 0.0;
-      }
-    }
-    else
+    for (int dimension_index = 0; dimension_index < dimensions_; ++dimension_index)
     {
-      first_order_integral_image[row_index*width_ + col_index] = data_value;
+      const IIDataType data_value = static_cast<IIDataType>(element[dimension_index]);
+      sums[dimension_index] = previous_sums[dimension_index] + (pcl_isfinite (data_value) ? data_value : 0);
     }
-  }
-
-  // first row
-  {
-    const int row_index = 0; 
-    for (int col_index = 1; col_index < width_; ++col_index)
-    {
-      const IIDataType data_value = static_cast<IIDataType>(data[row_index*row_stride_ + col_index*element_stride_]);
-
-      if (!pcl_isfinite (data_value))
-      {
-        first_order_integral_image[row_index*width_ + col_index] = first_order_integral_image[row_index*width_ + (col_index-1)];
-
-        if (are_second_order_ii_available_)
-        {
-          second_order_integral_image[row_index*width_ + col_index] = second_order_integral_image[row_index*width_ + (col_index-1)];
-        }
-      }
-      else
-      {
-        first_order_integral_image[row_index*width_ + col_index] = data_value
-          + first_order_integral_image[row_index*width_ + (col_index-1)];
 
-        if (are_second_order_ii_available_)
-        {
-          second_order_integral_image[row_index*width_ + col_index] = data_value*data_value
-            + second_order_integral_image[row_index*width_ + (col_index-1)];
-        }
-      }
-    }
-  }
+    if (!are_second_order_ii_available_)
+      continue;
 
-  // first column
-  {
-    const int col_index = 0;
-    for (int row_index = 1; row_index < height_; ++row_index)
+    int value_index = dimensions_;
+    for (int dimension_index1 = 0; dimension_index1 < dimensions_; ++dimension_index1)
     {
-      const IIDataType data_value = static_cast<IIDataType>(data[row_index*row_stride_ + col_index*element_stride_]);
-
-      if (!pcl_isfinite (data_value))
+      const IIDataType data_value1 = static_cast<IIDataType>(element[dimension_index1]);
+      for (int dimension_index2 = dimension_index1; dimension_index2 < dimensions_; ++dimension_index2, ++value_index)
       {
-        first_order_integral_image[row_index*width_ + col_index] = first_order_integral_image[(row_index-1)*width_ + col_index];
-
-        if (are_second_order_ii_available_)
-        {
-          second_order_integral_image[row_index*width_ + col_index] = second_order_integral_image[(row_index-1)*width_ + col_index];
-        }
-      }
-      else
-      {
-        first_order_integral_image[row_index*width_ + col_index] = data_value
-          + first_order_integral_image[(row_index-1)*width_ + col_index];
-
-        if (are_second_order_ii_available_)
-        {
-          second_order_integral_image[row_index*width_ + col_index] = data_value*data_value
-            + second_order_integral_image[(row_index-1)*width_ + col_index];
-        }
+        const IIDataType data_value2 = static_cast<IIDataType>(element[dimension_index2]);
+        const bool finite = pcl_isfinite (data_value1) && pcl_isfinite (data_value2);
+        sums[value_index] = previous_sums[value_index] + (finite ? data_value1*data_value2 : 0);
       }
     }
   }
+}
 
-  // the rest
-  for (int row_index = 1; row_index < height_; ++row_index)
-  {
-    for (int col_index = 1; col_index < width_; ++col_index)
-    {
-      const IIDataType data_value = static_cast<IIDataType>(data[row_index*row_stride_ + col_index*element_stride_]);
-
-      if (!pcl_isfinite (data_value))
-      {
-        first_order_integral_image[row_index*width_ + col_index] = first_order_integral_image[(row_index-1)*width_ + (col_index-1)]
-          + first_order_integral_image[(row_index-1)*width_ + col_index]
-          + first_order_integral_image[row_index*width_ + (col_index-1)];
-
-        if (are_second_order_ii_available_)
-        {
-          second_order_integral_image[row_index*width_ + col_index] = second_order_integral_image[row_index*width_ + (col_index-1)]
-            + second_order_integral_image[(row_index-1)*width_ + col_index]
-            - second_order_integral_image[(row_index-1)*width_ + (col_index-1)];
-        }
-      }
-      else
-      {
-        first_order_integral_image[row_index*width_ + col_index] = data_value
-          - first_order_integral_image[(row_index-1)*width_ + (col_index-1)]
-          + first_order_integral_image[(row_index-1)*width_ + col_index]
-          + first_order_integral_image[row_index*width_ + (col_index-1)];
 
-        if (are_second_order_ii_available_)
-        {
-          second_order_integral_image[row_index*width_ + col_index] = data_value*data_value
-            + second_order_integral_image[row_index*width_ + (col_index-1)]
-            + second_order_integral_image[(row_index-1)*width_ + col_index]
-            - second_order_integral_image[(row_index-1)*width_ + (col_index-1)];
-        }
-      }
-    }
-  }
+// ---------------------------------------------------------------------------- 
+template <class DataType, class IIDataType> void
+pcl::IntegralImage2D<DataType, IIDataType>::accumulateRow (const int row_index, const int col_begin, const int col_end)
+{
+  // the sums of an element are contiguous, so the columns are a contiguous range of values
+  IIDataType *current_row = &integral_images_[static_cast<size_t> (row_index) * width_ * nr_values_];
+  const IIDataType *previous_row = current_row - width_ * nr_values_;
+  for (int value_index = col_begin * nr_values_; value_index < col_end * nr_values_; ++value_index)
+    current_row[value_index] += previous_row[value_index];
 }
-
@@ -37,38 +37,23 @@
 #define PCL_FEATURES_INTEGRALIMAGE_BASED_IMPL_NORMAL_ESTIMATOR_H_
 
 #include "pcl/features/integral_image_normal.h"
+#include <algorithm>
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT, typename PointOutT>
 pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::~IntegralImageNormalEstimation ()
 {
-  if (integral_image_x_ != NULL) delete integral_image_x_;
-  if (integral_image_y_ != NULL) delete integral_image_y_;
-  if (integral_image_xyz_ != NULL) delete integral_image_xyz_;
-  if (integral_image_ != NULL) delete integral_image_;
-  if (diff_x_ != NULL) delete diff_x_;
-  if (diff_y_ != NULL) delete diff_y_;
-  if (depth_data_ != NULL) delete depth_data_;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT, typename PointOutT> void
 pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::initData ()
 {
-  // compute derivatives
-  if (integral_image_x_ != NULL) delete integral_image_x_;
-  if (integral_image_y_ != NULL) delete integral_image_y_;
-  if (integral_image_xyz_ != NULL) delete integral_image_xyz_;
-  if (integral_image_ != NULL) delete integral_image_;
-  if (diff_x_ != NULL) delete diff_x_;
-  if (diff_y_ != NULL) delete diff_y_;
-  if (depth_data_ != NULL) delete depth_data_;
-
-  if (normal_estimation_method_ == COVARIANCE_MATRIX)
+  if (normal_estimation_method_ == COVARIANCE_MATRIX && !init_covariance_matrix_)
     initCovarianceMatrixMethod ();
-  else if (normal_estimation_method_ == AVERAGE_3D_GRADIENT)
+  else if (normal_estimation_method_ == AVERAGE_3D_GRADIENT && !init_average_3d_gradient_)
     initAverage3DGradientMethod ();
-  else if (normal_estimation_method_ == AVERAGE_DEPTH_CHANGE)
+  else if (normal_estimation_method_ == AVERAGE_DEPTH_CHANGE && !init_depth_change_)
     initAverageDepthChangeMethod ();
 }
 
@@ -92,10 +77,10 @@ pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::initCovarianceMatrixMet
   
   float *data_ = reinterpret_cast<float*>((PointInT*)(&(input_->points[0])));
   // compute integral images
-  integral_image_xyz_ = new pcl::IntegralImage2D<float, double>(data_, input_->width, input_->height, 3, true, element_stride, row_stride);
+  integral_image_xyz_.setNumberOfThreads (threads_);
+  integral_image_xyz_.setInput (data_, input_->width, input_->height, 3, true, element_stride, row_stride);
       
   init_covariance_matrix_ = true;
-  init_average_3d_gradient_ = init_depth_change_ = false;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -103,29 +88,41 @@ template <typename PointInT, typename PointOutT> void
 pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::initAverage3DGradientMethod ()
 {
   float *data_ = reinterpret_cast<float*>((PointInT*)(&(input_->points[0])));
-  size_t nr_points = 4 * input_->points.size ();
-  diff_x_ = new float[nr_points];
-  diff_y_ = new float[nr_points];
+  const int width = input_->width;
+  const int height = input_->height;
+  diff_x_.resize (4 * input_->points.size ());
+  diff_y_.resize (4 * input_->points.size ());
   
   // number of DataType entries per element (equal or bigger than dimensions)
   int element_stride = sizeof (input_->points[0]) / sizeof (float);
   // number of DataType entries per row (equal or bigger than element_stride number of elements per row)
   int row_stride     = element_stride * input_->width;
 
-  memset (diff_x_, 0, sizeof(float) * nr_points);
-  memset (diff_y_, 0, sizeof(float) * nr_points);
+  // the inner pixels are all overwritten below, only the border has to be cleared
+  std::fill (diff_x_.begin (), diff_x_.begin () + 4 * width, 0.0f);
+  std::fill (diff_y_.begin (), diff_y_.begin () + 4 * width, 0.0f);
+  std::fill (diff_x_.end () - 4 * width, diff_x_.end (), 0.0f);
+  std::fill (diff_y_.end () - 4 * width, diff_y_.end (), 0.0f);
 
-  for (size_t ri = 1; ri < input_->height - 1; ++ri)
+#pragma omp parallel for schedule (static) num_threads (threads_)
+  for (int ri = 1; ri < height - 1; ++ri)
   {
     float *data_pointer_y_up    = data_ + (ri-1)*row_stride + element_stride;
     float *data_pointer_y_down  = data_ + (ri+1)*row_stride + element_stride;
     float *data_pointer_x_left  = data_ + ri*row_stride;
     float *data_pointer_x_right = data_ + ri*row_stride + 2*element_stride;
 
-    float * diff_x_pointer = diff_x_ + ri * 4 * input_->width + 4;
-    float * diff_y_pointer = diff_y_ + ri * 4 * input_->width + 4;
+    float * diff_x_pointer = &diff_x_[ri * 4 * width];
+    float * diff_y_pointer = &diff_y_[ri * 4 * width];
+
+    std::fill (diff_x_pointer, diff_x_pointer + 4, 0.0f);
+    std::fill (diff_y_pointer, diff_y_pointer + 4, 0.0f);
+    std::fill (diff_x_pointer + 4 * (width - 1), diff_x_pointer + 4 * width, 0.0f);
+    std::fill (diff_y_pointer + 4 * (width - 1), diff_y_pointer + 4 * width, 0.0f);
+    diff_x_pointer += 4;
+    diff_y_pointer += 4;
 
-    for (size_t ci = 1; ci < input_->width - 1; ++ci)
+    for (int ci = 1; ci < width - 1; ++ci)
     {
       diff_x_pointer[0] = data_pointer_x_right[0] - data_pointer_x_left[0];
       diff_x_pointer[1] = data_pointer_x_right[1] - data_pointer_x_left[1];
@@ -146,10 +143,11 @@ pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::initAverage3DGradientMe
   }
 
   // Compute integral images
-  integral_image_x_ = new pcl::IntegralImage2D<float, double>(diff_x_, input_->width, input_->height, 3, false, 4, 4 * input_->width);
-  integral_image_y_ = new pcl::IntegralImage2D<float, double>(diff_y_, input_->width, input_->height, 3, false, 4, 4 * input_->width);
+  integral_image_x_.setNumberOfThreads (threads_);
+  integral_image_y_.setNumberOfThreads (threads_);
+  integral_image_x_.setInput (&diff_x_[0], width, height, 3, false, 4, 4 * width);
+  integral_image_y_.setInput (&diff_y_[0], width, height, 3, false, 4, 4 * width);
       
-  init_covariance_matrix_ = init_depth_change_ = false;
   init_average_3d_gradient_ = true;
 }
 
@@ -164,38 +162,43 @@ pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::initAverageDepthChangeM
 
   float *data_ = reinterpret_cast<float*>((PointInT*)(&(input_->points[0])));
   // compute integral image
-  integral_image_ = new pcl::IntegralImage2D<float, double>(
-    &(data_[2]), input_->width, input_->height, 1, false, element_stride, row_stride);
+  integral_image_.setNumberOfThreads (threads_);
+  integral_image_.setInput (&(data_[2]), input_->width, input_->height, 1, false, element_stride, row_stride);
 
   init_depth_change_ = true;
-  init_covariance_matrix_ = init_average_3d_gradient_ = false;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT, typename PointOutT> void
 pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::computePointNormal (
     const int pos_x, const int pos_y, PointOutT &normal)
+{
+  initData ();
+  computePointNormalInRect (pos_x, pos_y, rect_width_, rect_height_, normal);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointOutT> void
+pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::computePointNormalInRect (
+    const int pos_x, const int pos_y, const int rect_width, const int rect_height, PointOutT &normal) const
 {
   float bad_point = std::numeric_limits<float>::quiet_NaN ();
 
   if (normal_estimation_method_ == COVARIANCE_MATRIX)
   {
-    if (!init_covariance_matrix_)
-      initCovarianceMatrixMethod ();
-
-    const float mean_x = integral_image_xyz_->getSum(pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 0);
-    const float mean_y = integral_image_xyz_->getSum(pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 1);
-    const float mean_z = integral_image_xyz_->getSum(pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 2);
+    const float mean_x = integral_image_xyz_.getSum(pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 0);
+    const float mean_y = integral_image_xyz_.getSum(pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 1);
+    const float mean_z = integral_image_xyz_.getSum(pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 2);
 
-    const float mean_xx = integral_image_xyz_->getSum(pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 0, 0);
-    const float mean_xy = integral_image_xyz_->getSum(pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 0, 1);
-    const float mean_xz = integral_image_xyz_->getSum(pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 0, 2);
+    const float mean_xx = integral_image_xyz_.getSum(pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 0, 0);
+    const float mean_xy = integral_image_xyz_.getSum(pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 0, 1);
+    const float mean_xz = integral_image_xyz_.getSum(pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 0, 2);
     const float mean_yx = mean_xy;
-    const float mean_yy = integral_image_xyz_->getSum(pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 1, 1);
-    const float mean_yz = integral_image_xyz_->getSum(pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 1, 2);
+    const float mean_yy = integral_image_xyz_.getSum(pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 1, 1);
+    const float mean_yz = integral_image_xyz_.getSum(pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 1, 2);
     const float mean_zx = mean_xz;
     const float mean_zy = mean_yz;
-    const float mean_zz = integral_image_xyz_->getSum(pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 2, 2);
+    const float mean_zz = integral_image_xyz_.getSum(pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 2, 2);
 
 
     EIGEN_ALIGN16 Eigen::Matrix3f covariance_matrix;
@@ -205,8 +208,8 @@ pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::computePointNormal (
 
     Eigen::Vector3f center (mean_x, mean_y, mean_z);
 
-    covariance_matrix -= (1.0f/(rect_width_*rect_height_)) * (center * center.transpose());
-    covariance_matrix *= 1.0f/(rect_width_*rect_height_-1);
+    covariance_matrix -= (1.0f/(rect_width*rect_height)) * (center * center.transpose());
+    covariance_matrix *= 1.0f/(rect_width*rect_height-1);
     
     EIGEN_ALIGN16 Eigen::Vector3f eigen_values;
     EIGEN_ALIGN16 Eigen::Matrix3f eigen_vectors;
@@ -229,15 +232,13 @@ pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::computePointNormal (
   }
   else if (normal_estimation_method_ == AVERAGE_3D_GRADIENT)
   {
-    if (!init_average_3d_gradient_)
-      initAverage3DGradientMethod ();
-    const float mean_x_x = integral_image_x_->getSum (pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 0);
-    const float mean_x_y = integral_image_x_->getSum (pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 1);
-    const float mean_x_z = integral_image_x_->getSum (pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 2);
+    const float mean_x_x = integral_image_x_.getSum (pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 0);
+    const float mean_x_y = integral_image_x_.getSum (pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 1);
+    const float mean_x_z = integral_image_x_.getSum (pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 2);
 
-    const float mean_y_x = integral_image_y_->getSum (pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 0);
-    const float mean_y_y = integral_image_y_->getSum (pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 1);
-    const float mean_y_z = integral_image_y_->getSum (pos_x-rect_width_/2, pos_y-rect_height_/2, rect_width_, rect_height_, 2);
+    const float mean_y_x = integral_image_y_.getSum (pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 0);
+    const float mean_y_y = integral_image_y_.getSum (pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 1);
+    const float mean_y_z = integral_image_y_.getSum (pos_x-rect_width/2, pos_y-rect_height/2, rect_width, rect_height, 2);
 
     const float normal_x = mean_x_y * mean_y_z - mean_x_z * mean_y_y;
     const float normal_y = mean_x_z * mean_y_x - mean_x_x * mean_y_z;
@@ -262,26 +263,23 @@ pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::computePointNormal (
   }
   else if (normal_estimation_method_ == AVERAGE_DEPTH_CHANGE)
   {
-    if (!init_depth_change_)
-      initAverageDepthChangeMethod ();
-
-    PointInT pointL = input_->points[pos_y * input_->width + pos_x-rect_width_/2];
-    PointInT pointR = input_->points[pos_y * input_->width + pos_x+rect_width_/2];
-    PointInT pointU = input_->points[(pos_y-rect_height_/2) * input_->width+pos_x];
-    PointInT pointD = input_->points[(pos_y+rect_height_/2) * input_->width+pos_x];
+    PointInT pointL = input_->points[pos_y * input_->width + pos_x-rect_width/2];
+    PointInT pointR = input_->points[pos_y * input_->width + pos_x+rect_width/2];
+    PointInT pointU = input_->points[(pos_y-rect_height/2) * input_->width+pos_x];
+    PointInT pointD = input_->points[(pos_y+rect_height/2) * input_->width+pos_x];
 
-    const float mean_L_z = integral_image_->getSum(pos_x-1-rect_width_/2, pos_y-rect_height_/2, rect_width_-1, rect_height_-1, 0)/((rect_width_-1)*(rect_height_-1));
-    const float mean_R_z = integral_image_->getSum(pos_x+1-rect_width_/2, pos_y-rect_height_/2, rect_width_-1, rect_height_-1, 0)/((rect_width_-1)*(rect_height_-1));
-    const float mean_U_z = integral_image_->getSum(pos_x-rect_width_/2, pos_y-1-rect_height_/2, rect_width_-1, rect_height_-1, 0)/((rect_width_-1)*(rect_height_-1));
-    const float mean_D_z = integral_image_->getSum(pos_x-rect_width_/2, pos_y+1-rect_height_/2, rect_width_-1, rect_height_-1, 0)/((rect_width_-1)*(rect_height_-1));
+    const float mean_L_z = integral_image_.getSum(pos_x-1-rect_width/2, pos_y-rect_height/2, rect_width-1, rect_height-1, 0)/((rect_width-1)*(rect_height-1));
+    const float mean_R_z = integral_image_.getSum(pos_x+1-rect_width/2, pos_y-rect_height/2, rect_width-1, rect_height-1, 0)/((rect_width-1)*(rect_height-1));
+    const float mean_U_z = integral_image_.getSum(pos_x-rect_width/2, pos_y-1-rect_height/2, rect_width-1, rect_height-1, 0)/((rect_width-1)*(rect_height-1));
+    const float mean_D_z = integral_image_.getSum(pos_x-rect_width/2, pos_y+1-rect_height/2, rect_width-1, rect_height-1, 0)/((rect_width-1)*(rect_height-1));
 
     const float mean_x_z = (mean_R_z - mean_L_z)/2.0f;
     const float mean_y_z = (mean_D_z - mean_U_z)/2.0f;
 
-    const float mean_x_x = (pointR.x - pointL.x)/(rect_width_);
-    const float mean_x_y = (pointR.y - pointL.y)/(rect_height_);
-    const float mean_y_x = (pointD.x - pointU.x)/(rect_width_);
-    const float mean_y_y = (pointD.y - pointU.y)/(rect_height_);
+    const float mean_x_x = (pointR.x - pointL.x)/(rect_width);
+    const float mean_x_y = (pointR.y - pointL.y)/(rect_height);
+    const float mean_y_x = (pointD.x - pointU.x)/(rect_width);
+    const float mean_y_y = (pointD.y - pointU.y)/(rect_height);
 
     const float normal_x = mean_x_y * mean_y_z - mean_x_z * mean_y_y;
     const float normal_y = mean_x_z * mean_y_x - mean_x_x * mean_y_z;
@@ -312,188 +310,150 @@ pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::computePointNormal (
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT, typename PointOutT> void
-pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::computeFeature (PointCloudOut &output)
+pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::computeDepthChangeMap (const int ri)
 {
-  float bad_point = std::numeric_limits<float>::quiet_NaN ();
-
-  // compute depth-change map
-  unsigned char * depthChangeMap = new unsigned char[input_->points.size ()];
-  memset (depthChangeMap, 255, input_->points.size ());
-
-  for (unsigned int ri = 0; ri < input_->height-1; ++ri)
+  // the pairs of pixels are tested as they always were: the horizontal pairs of the last row and the 
+  // vertical pairs of the last column are skipped
+  const int width = input_->width;
+  const int height = input_->height;
+  const PointInT *row = &input_->points[ri * width];
+  unsigned char *map = &depth_change_map_[ri * width];
+
+  for (int ci = 0; ci < width; ++ci)
   {
-    for (unsigned int ci = 0; ci < input_->width-1; ++ci)
+    const float depth = row[ci].z;
+    bool depth_change = false;
+    if (ri < height - 1)
     {
-      const float depth  = (*input_)(ci,     ri    ).z;
-      const float depthR = (*input_)(ci + 1, ri    ).z;
-      const float depthD = (*input_)(ci,     ri + 1).z;
-
-      const float depthDependendDepthChange = (max_depth_change_factor_ * (fabs(depth)+1.0f))/(500.0f*0.001f);
-
-      if (abs (depth - depthR) > depthDependendDepthChange
-        || !pcl_isfinite (depth) || !pcl_isfinite (depthR))
-      { 
-        depthChangeMap[ri*input_->width + ci] = 0;
-        depthChangeMap[ri*input_->width + ci+1] = 0;
-      }
-      if (abs (depth - depthD) > depthDependendDepthChange
-        || !pcl_isfinite (depth) || !pcl_isfinite (depthD))
-      {
-        depthChangeMap[ri*input_->width + ci] = 0;
-        depthChangeMap[(ri+1)*input_->width + ci] = 0;
-      }
+      const float depthD = row[ci + width].z;
+      depth_change = (ci < width - 1 && (isDepthChange (depth, row[ci + 1].z) || isDepthChange (depth, depthD)))
+                  || (ci > 0 && isDepthChange (row[ci - 1].z, depth));
     }
+    if (ri > 0 && ci < width - 1)
+      depth_change = depth_change || isDepthChange (row[ci - width].z, depth);
+
+    map[ci] = depth_change ? 0 : 255;
   }
+}
 
-    
-  // compute distance map
-  float *distanceMap = new float[input_->points.size ()];
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointOutT> void
+pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::computeDistanceMap ()
+{
+  const int width = input_->width;
+  const int height = input_->height;
+  distance_map_.resize (input_->points.size ());
   for (size_t index = 0; index < input_->points.size (); ++index)
   {
-    if (depthChangeMap[index] == 0)
-      distanceMap[index] = 0.0f;
+    if (depth_change_map_[index] == 0)
+      distance_map_[index] = 0.0f;
     else
-      distanceMap[index] = 640.0f;
+      distance_map_[index] = 640.0f;
   }
 
+  float *distanceMap = &distance_map_[0];
+
+  // Both passes take the minimum over the neighbors of the previous row first, which has no dependencies
+  // between the pixels, and only then walk along the row. The minimum is exact, so this gives the same 
+  // map as visiting the four neighbors of every pixel at once.
+
   // first pass
-  for (size_t ri = 1; ri < input_->height; ++ri)
+  for (int ri = 1; ri < height; ++ri)
   {
-    for (size_t ci = 1; ci < input_->width; ++ci)
+    float *row = distanceMap + ri*width;
+    const float *up_row = row - width;
+    for (int ci = 1; ci < width; ++ci)
     {
-      const float upLeft = distanceMap[(ri-1)*input_->width + ci-1] + 1.4f;
-      const float up = distanceMap[(ri-1)*input_->width + ci] + 1.0f;
-      const float upRight = distanceMap[(ri-1)*input_->width + ci+1] + 1.4f;
-      const float left = distanceMap[ri*input_->width + ci-1] + 1.0f;
-      const float center = distanceMap[ri*input_->width + ci];
-
-      const float minValue = std::min (std::min (upLeft, up), std::min (left, upRight));
-
-      if (minValue < center)
-        distanceMap[ri * input_->width + ci] = minValue;
+      const float upLeft = up_row[ci-1] + 1.4f;
+      const float up = up_row[ci] + 1.0f;
+      const float upRight = up_row[ci+1] + 1.4f;
+      row[ci] = std::min (row[ci], std::min (std::min (upLeft, up), upRight));
     }
+    for (int ci = 1; ci < width; ++ci)
+      row[ci] = std::min (row[ci], row[ci-1] + 1.0f);
   }
 
   // second pass
-  for (int ri = input_->height-2; ri >= 0; --ri)
+  for (int ri = height-2; ri >= 0; --ri)
   {
-    for (int ci = input_->width-2; ci >= 0; --ci)
+    float *row = distanceMap + ri*width;
+    const float *lower_row = row + width;
+    for (int ci = width-2; ci >= 0; --ci)
     {
-      const float lowerLeft = distanceMap[(ri+1)*input_->width + ci-1] + 1.4f;
-      const float lower = distanceMap[(ri+1)*input_->width + ci] + 1.0f;
-      const float lowerRight = distanceMap[(ri+1)*input_->width + ci+1] + 1.4f;
-      const float right = distanceMap[ri*input_->width + ci+1] + 1.0f;
-      const float center = distanceMap[ri*input_->width + ci];
-
-      const float minValue = std::min (std::min (lowerLeft, lower), std::min (right, lowerRight));
-
-      if (minValue < center)
-        distanceMap[ri*input_->width + ci] = minValue;
+      const float lowerLeft = lower_row[ci-1] + 1.4f;
+      const float lower = lower_row[ci] + 1.0f;
+      const float lowerRight = lower_row[ci+1] + 1.4f;
+      row[ci] = std::min (row[ci], std::min (std::min (lowerLeft, lower), lowerRight));
     }
+    for (int ci = width-2; ci >= 0; --ci)
+      row[ci] = std::min (row[ci], row[ci+1] + 1.0f);
   }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointOutT> void
+pcl::IntegralImageNormalEstimation<PointInT, PointOutT>::computeFeature (PointCloudOut &output)
+{
+  float bad_point = std::numeric_limits<float>::quiet_NaN ();
+  const int width = input_->width;
+  const int height = input_->height;
+
+  // (re)compute the integral images of the current cloud, if needed
+  initData ();
+
+  // compute depth-change map
+  depth_change_map_.resize (input_->points.size ());
+#pragma omp parallel for schedule (static) num_threads (threads_)
+  for (int ri = 0; ri < height; ++ri)
+    computeDepthChangeMap (ri);
+
+  // compute distance map
+  computeDistanceMap ();
 
   // Estimate normals
   output.width  = input_->width;
   output.height = input_->height;
   output.points.resize (input_->width * input_->height);
 
-  // Set all normals that we do not touch to NaN
-  for (size_t ri = 0; ri < normal_smoothing_size_; ++ri)
-  {
-    for (size_t ci = 0; ci < input_->width; ++ci)
-    {
-      output (ci, ri).getNormalVector4fMap ().setConstant (bad_point);
-      output (ci, ri).curvature = bad_point;
-    }
-  }
-  for (size_t ri = normal_smoothing_size_; ri < input_->height; ++ri)
-  {
-    for (size_t ci = 0; ci < normal_smoothing_size_; ++ci)
-    {
-      output (ci, ri).getNormalVector4fMap ().setConstant (bad_point);
-      output (ci, ri).curvature = bad_point;
-    }
-  }
+  // normals closer than normal_smoothing_size_ to the border and the ones skipped by the sampling are NaN
+  const int border = static_cast<int> (normal_smoothing_size_);
+  const int step = sampling_step_;
+  const float smoothing_constant = normal_smoothing_size_ * static_cast<float>(1.0f) / (500.0f * 0.001f);
 
-  for (size_t ri = input_->height - normal_smoothing_size_; ri < input_->height; ++ri)
+#pragma omp parallel for schedule (dynamic, 8) num_threads (threads_)
+  for (int ri = 0; ri < height; ++ri)
   {
-    for (size_t ci = normal_smoothing_size_; ci < input_->width; ++ci)
+    const bool estimate_row = ri >= border && ri < height - normal_smoothing_size_ && ri % step == 0;
+    for (int ci = 0; ci < width; ++ci)
     {
-      output (ci, ri).getNormalVector4fMap ().setConstant (bad_point);
-      output (ci, ri).curvature = bad_point;
-    }
-  }
+      PointOutT &normal = output.points[ri * width + ci];
+      const float depth = input_->points[ri * width + ci].z;
+      if (!estimate_row || ci < border || !(ci < width - normal_smoothing_size_) || ci % step != 0 
+          || !pcl_isfinite (depth))
+      {
+        normal.getNormalVector4fMap ().setConstant (bad_point);
+        normal.curvature = bad_point;
+        continue;
+      }
 
-  for (size_t ri = normal_smoothing_size_; ri < input_->height - normal_smoothing_size_; ++ri)
-  {
-    for (size_t ci = input_->width - normal_smoothing_size_; ci < input_->width; ++ci)
-    {
-      output (ci, ri).getNormalVector4fMap ().setConstant (bad_point);
-      output (ci, ri).curvature = bad_point;
-    }
-  }
+      float smoothing;
+      if (use_depth_dependent_smoothing_)
+        smoothing = (std::min)(distance_map_[ri*width + ci], normal_smoothing_size_ + static_cast<float>(depth)/10.0f);
+      else
+        smoothing = (std::min)(distance_map_[ri*width + ci], smoothing_constant);
 
-  if (use_depth_dependent_smoothing_)
-  {
-    for (int ri = normal_smoothing_size_; ri < input_->height-normal_smoothing_size_; ++ri)
-    {
-      for (int ci = normal_smoothing_size_; ci < input_->width-normal_smoothing_size_; ++ci)
+      if (smoothing > 2.0f)
       {
-        const float depth = (*input_)(ci, ri).z;
-        if (!pcl_isfinite (depth))
-        {
-          output (ci, ri).getNormalVector4fMap ().setConstant (bad_point);
-          output (ci, ri).curvature = bad_point;
-          continue;
-        }
-
-        float smoothing = (std::min)(distanceMap[ri*input_->width + ci], normal_smoothing_size_ + static_cast<float>(depth)/10.0f);
-
-        if (smoothing > 2.0f)
-        {
-          setRectSize (smoothing, smoothing);
-          computePointNormal (ci, ri, output (ci, ri));
-        }
-        else
-        {
-          output (ci, ri).getNormalVector4fMap ().setConstant (bad_point);
-          output (ci, ri).curvature = bad_point;
-        }
+        const int rect_size = static_cast<int> (smoothing);
+        computePointNormalInRect (ci, ri, rect_size, rect_size, normal);
       }
-    }
-  }
-  else
-  {
-    float smoothing_constant = normal_smoothing_size_ * static_cast<float>(1.0f) / (500.0f * 0.001f);
-    for (int ri = normal_smoothing_size_; ri < input_->height-normal_smoothing_size_; ++ri)
-    {
-      for (int ci = normal_smoothing_size_; ci < input_->width-normal_smoothing_size_; ++ci)
+      else
       {
-        if (!pcl_isfinite ((*input_) (ci, ri).z))
-        {
-          output (ci, ri).getNormalVector4fMap ().setConstant (bad_point);
-          output (ci, ri).curvature = bad_point;
-          continue;
-        }
-
-        float smoothing = (std::min)(distanceMap[ri*input_->width + ci], smoothing_constant);
-
-        if (smoothing > 2.0f)
-        {
-          setRectSize (smoothing, smoothing);
-          computePointNormal (ci, ri, output (ci, ri));
-        }
-        else
-        {
-          output (ci, ri).getNormalVector4fMap ().setConstant (bad_point);
-          output (ci, ri).curvature = bad_point;
-        }
+        normal.getNormalVector4fMap ().setConstant (bad_point);
+        normal.curvature = bad_point;
       }
     }
   }
-
-  delete[] depthChangeMap;
-  delete[] distanceMap;
 }
 
 #define PCL_INSTANTIATE_IntegralImageNormalEstimation(T,NT) template class PCL_EXPORTS pcl::IntegralImageNormalEstimation<T,NT>;
@@ -44,7 +44,9 @@
 template <typename PointSource, typename PointFeature>
 pcl::MultiscaleFeaturePersistence<PointSource, PointFeature>::MultiscaleFeaturePersistence ()
   : distance_metric_ (L1),
-    feature_estimator_ ()
+    feature_estimator_ (),
+    copy_feature_estimator_ (NULL),
+    threads_ (1)
 {
   feature_representation_.reset (new DefaultPointRepresentation<PointFeature>);
   // No input is needed, hack around the initCompute () check from PCLBase
@@ -84,10 +86,37 @@ pcl::MultiscaleFeaturePersistence<PointSource, PointFeature>::computeFeaturesAtA
 {
   features_at_scale.resize (scale_values_.size ());
   features_at_scale_vectorized.resize (scale_values_.size ());
-  for (size_t scale_i = 0; scale_i < scale_values_.size (); ++scale_i)
+
+  // Search the neighborhoods once at the largest scale, the smaller ones are prefixes of them
+  typename KdTree<PointSource>::Ptr user_tree = feature_estimator_->getSearchMethod (), tree = user_tree;
+  typename PointCloud<PointSource>::ConstPtr surface = feature_estimator_->getSearchSurface ();
+  if (!surface)
+    surface = feature_estimator_->getInputCloud ();
+  if (!tree)
   {
+    if (surface->isOrganized ())
+      tree.reset (new pcl::OrganizedDataIndex<PointSource> ());
+    else
+      tree.reset (new pcl::KdTreeFLANN<PointSource> (false));
+  }
+  tree->setInputCloud (surface);
+
+  NeighborhoodCache<PointSource> neighborhoods (tree);
+  neighborhoods.setNumberOfThreads (threads_);
+  neighborhoods.computeNeighborhoods (feature_estimator_->getInputCloud (), feature_estimator_->getIndices (),
+                                      *std::max_element (scale_values_.begin (), scale_values_.end ()));
+
+  // Without a way to copy the estimator all the scales go through it, one after the other
+  int nr_threads = copy_feature_estimator_ ? threads_ : 1;
+#pragma omp parallel for schedule (dynamic, 1) num_threads (nr_threads)
+  for (int scale_i = 0; scale_i < (int) scale_values_.size (); ++scale_i)
+  {
+    FeatureEstimatorPtr feature_estimator = copy_feature_estimator_ ? copy_feature_estimator_ (feature_estimator_) : feature_estimator_;
+    // Every estimator gets its own copy of the cache, as compute () sets the input of its search method
+    feature_estimator->setSearchMethod (typename KdTree<PointSource>::Ptr (new NeighborhoodCache<PointSource> (neighborhoods)));
+
     FeatureCloudPtr feature_cloud (new FeatureCloud ());
-    computeFeatureAtScale (scale_values_[scale_i], feature_cloud);
+    computeFeatureAtScale (scale_values_[scale_i], feature_estimator, feature_cloud);
     features_at_scale[scale_i] = feature_cloud;
 
     // Vectorize each feature and insert it into the vectorized feature storage
@@ -100,16 +129,20 @@ pcl::MultiscaleFeaturePersistence<PointSource, PointFeature>::computeFeaturesAtA
     }
     features_at_scale_vectorized[scale_i] = feature_cloud_vectorized;
   }
+
+  // Give the estimator its search method back
+  feature_estimator_->setSearchMethod (user_tree);
 }
 
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointSource, typename PointFeature> void
 pcl::MultiscaleFeaturePersistence<PointSource, PointFeature>::computeFeatureAtScale (float &scale,
+                                                                                     const FeatureEstimatorPtr &feature_estimator,
                                                                                      FeatureCloudPtr &features)
 {
-   feature_estimator_->setRadiusSearch (scale);
-   feature_estimator_->compute (*features);
+   feature_estimator->setRadiusSearch (scale);
+   feature_estimator->compute (*features);
 }
 
 
@@ -39,20 +39,87 @@
 #define PCL_FEATURES_IMPL_NORMAL_3D_H_
 
 #include "pcl/features/normal_3d.h"
+#include "pcl/common/common.h"
+#include <boost/unordered_map.hpp>
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointOutT> bool
+pcl::NormalEstimation<PointInT, PointOutT>::initCompute ()
+{
+  if (approximation_leaf_size_ <= 0)
+    return (Feature<PointInT, PointOutT>::initCompute ());
+
+  // The voxel moments replace the neighbor search, there is nothing else to set up
+  if (!PCLBase<PointInT>::initCompute ())
+  {
+    PCL_ERROR ("[pcl::%s::initCompute] Init failed.\n", getClassName ().c_str ());
+    return (false);
+  }
+
+  if (input_->points.empty ())
+  {
+    PCL_ERROR ("[pcl::%s::compute] input_ is empty!\n", getClassName ().c_str ());
+    return (false);
+  }
+  return (true);
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT, typename PointOutT> void
 pcl::NormalEstimation<PointInT, PointOutT>::computeFeature (PointCloudOut &output)
 {
+  if (approximation_leaf_size_ > 0)
+  {
+    computeApproximateFeature (output, 1);
+    return;
+  }
+
   // Allocate enough space to hold the results
   // \note This resize is irrelevant for a radiusSearch ().
   std::vector<int> nn_indices (k_);
   std::vector<float> nn_dists (k_);
 
+  // Reuse the neighbors of an earlier stage if there are enough of them
+  const bool cacheable = neighbor_cache_ && surface_ == input_ && k_ > 0;
+  const bool use_cache = cacheable && neighbor_cache_->holds (input_, indices_->size (), k_);
+  if (cacheable && !use_cache)
+  {
+    neighbor_cache_->k = k_;
+    neighbor_cache_->cloud = input_;
+    neighbor_cache_->indices.resize (indices_->size () * k_);
+    neighbor_cache_->sqr_distances.resize (indices_->size () * k_);
+  }
+  const int cache_k = neighbor_cache_ ? neighbor_cache_->k : 0;
+
   // Iterating over the entire index vector
   for (size_t idx = 0; idx < indices_->size (); ++idx)
   {
-    if (!this->searchForNeighbors ((*indices_)[idx], search_parameter_, nn_indices, nn_dists))
+    bool valid;
+    if (use_cache)
+    {
+      const int *cached = &neighbor_cache_->indices[idx * cache_k];
+      valid = cached[0] != -1;
+      nn_indices.assign (cached, cached + k_);
+    }
+    else
+    {
+      valid = this->searchForNeighbors ((*indices_)[idx], search_parameter_, nn_indices, nn_dists) != 0;
+      if (cacheable)
+      {
+        if (valid)
+        {
+          std::copy (nn_indices.begin (), nn_indices.begin () + k_, &neighbor_cache_->indices[idx * cache_k]);
+          std::copy (nn_dists.begin (), nn_dists.begin () + k_, &neighbor_cache_->sqr_distances[idx * cache_k]);
+        }
+        else
+        {
+          std::fill_n (&neighbor_cache_->indices[idx * cache_k], cache_k, -1);
+          std::fill_n (&neighbor_cache_->sqr_distances[idx * cache_k], cache_k, 0.0f);
+        }
+      }
+    }
+
+    if (!valid)
     {
       output.points[idx].normal[0] = output.points[idx].normal[1] = output.points[idx].normal[2] = output.points[idx].curvature = std::numeric_limits<float>::quiet_NaN ();
       continue;
@@ -67,6 +134,154 @@ pcl::NormalEstimation<PointInT, PointOutT>::computeFeature (PointCloudOut &outpu
   }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointOutT> void
+pcl::NormalEstimation<PointInT, PointOutT>::computeApproximateFeature (PointCloudOut &output, unsigned int nr_threads)
+{
+  const float bad_point = std::numeric_limits<float>::quiet_NaN ();
+  const PointCloudIn &surface = surface_ ? *surface_ : *input_;
+  const float inverse_leaf_size = 1.0f / approximation_leaf_size_;
+
+  // The voxels are counted from the minimum corner of the surface. The points are binned with the same double
+  // precision arithmetic, so none of them falls beyond the last voxel.
+  Eigen::Vector4f min_p, max_p;
+  getMinMax3D (surface, min_p, max_p);
+  const double nr_divisions[3] = {floor ((static_cast<double> (max_p[0]) - min_p[0]) * inverse_leaf_size) + 1,
+                                  floor ((static_cast<double> (max_p[1]) - min_p[1]) * inverse_leaf_size) + 1,
+                                  floor ((static_cast<double> (max_p[2]) - min_p[2]) * inverse_leaf_size) + 1};
+  // The queries are keyed with one more voxel on each side, as their neighborhoods may stick out of the surface
+  const double max_division = std::numeric_limits<int>::max () - 2;
+  if (!(nr_divisions[0] >= 1 && nr_divisions[1] >= 1 && nr_divisions[2] >= 1) ||
+      nr_divisions[0] > max_division || nr_divisions[1] > max_division || nr_divisions[2] > max_division ||
+      (nr_divisions[0] + 2) * (nr_divisions[1] + 2) * (nr_divisions[2] + 2) > static_cast<double> (std::numeric_limits<size_t>::max ()))
+  {
+    PCL_ERROR ("[pcl::%s::computeApproximateFeature] The leaf size %f is too small for the extent of the surface (or the surface has no finite points)!\n", getClassName ().c_str (), approximation_leaf_size_);
+    for (size_t idx = 0; idx < output.points.size (); ++idx)
+      output.points[idx].normal[0] = output.points[idx].normal[1] = output.points[idx].normal[2] = output.points[idx].curvature = bad_point;
+    return;
+  }
+  const size_t div_b[3] = {static_cast<size_t> (nr_divisions[0]), static_cast<size_t> (nr_divisions[1]), static_cast<size_t> (nr_divisions[2])};
+
+  // Accumulate the moments of every voxel of the surface: the number of points, the sums of x, y and z, and the
+  // sums of xx, xy, xz, yy, yz and zz. The coordinates are relative to the minimum corner.
+  const int nr_moments = 10;
+  boost::unordered_map<size_t, int> leaves;
+  std::vector<double> moments;
+  for (size_t cp = 0; cp < surface.points.size (); ++cp)
+  {
+    const PointInT &point = surface.points[cp];
+    if (!pcl_isfinite (point.x) || !pcl_isfinite (point.y) || !pcl_isfinite (point.z))
+      continue;
+
+    const double x = static_cast<double> (point.x) - min_p[0];
+    const double y = static_cast<double> (point.y) - min_p[1];
+    const double z = static_cast<double> (point.z) - min_p[2];
+    const size_t i = static_cast<size_t> (x * inverse_leaf_size);
+    const size_t j = static_cast<size_t> (y * inverse_leaf_size);
+    const size_t k = static_cast<size_t> (z * inverse_leaf_size);
+
+    std::pair<boost::unordered_map<size_t, int>::iterator, bool> leaf = 
+      leaves.insert (std::make_pair (i + j * div_b[0] + k * div_b[0] * div_b[1], static_cast<int> (moments.size () / nr_moments)));
+    if (leaf.second)
+      moments.resize (moments.size () + nr_moments, 0.0);
+
+    double *m = &moments[leaf.first->second * nr_moments];
+    m[0] += 1.0;
+    m[1] += x;     m[2] += y;     m[3] += z;
+    m[4] += x * x; m[5] += x * y; m[6] += x * z;
+    m[7] += y * y; m[8] += y * z; m[9] += z * z;
+  }
+
+  // Find the voxels of the query points, each of them is solved once
+  boost::unordered_map<size_t, int> query_leaves;
+  std::vector<Eigen::Vector3i> query_voxels;
+  std::vector<int> point_leaves (indices_->size (), -1);
+  for (size_t idx = 0; idx < indices_->size (); ++idx)
+  {
+    const PointInT &point = input_->points[(*indices_)[idx]];
+    if (!pcl_isfinite (point.x) || !pcl_isfinite (point.y) || !pcl_isfinite (point.z))
+      continue;
+
+    const double x = (static_cast<double> (point.x) - min_p[0]) * inverse_leaf_size;
+    const double y = (static_cast<double> (point.y) - min_p[1]) * inverse_leaf_size;
+    const double z = (static_cast<double> (point.z) - min_p[2]) * inverse_leaf_size;
+    // Too far from the surface to have any of it in the neighborhood
+    if (x < -1 || y < -1 || z < -1 || x >= nr_divisions[0] + 1 || y >= nr_divisions[1] + 1 || z >= nr_divisions[2] + 1)
+      continue;
+    // Shifted by one voxel, so the voxels around the surface are still positive
+    const size_t i = static_cast<size_t> (floor (x) + 1);
+    const size_t j = static_cast<size_t> (floor (y) + 1);
+    const size_t k = static_cast<size_t> (floor (z) + 1);
+
+    std::pair<boost::unordered_map<size_t, int>::iterator, bool> leaf = 
+      query_leaves.insert (std::make_pair (i + j * (div_b[0] + 2) + k * (div_b[0] + 2) * (div_b[1] + 2), static_cast<int> (query_voxels.size ())));
+    if (leaf.second)
+      query_voxels.push_back (Eigen::Vector3i (static_cast<int> (i) - 1, static_cast<int> (j) - 1, static_cast<int> (k) - 1));
+    point_leaves[idx] = leaf.first->second;
+  }
+
+  // Sum the moments of the 3x3x3 voxels around every query voxel and solve the covariance in closed form
+  std::vector<float> leaf_normals (query_voxels.size () * 4);
+#pragma omp parallel for schedule (dynamic, 256) num_threads (nr_threads)
+  for (int ql = 0; ql < static_cast<int> (query_voxels.size ()); ++ql)
+  {
+    double m[nr_moments] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    const Eigen::Vector3i &ijk = query_voxels[ql];
+    for (int k = std::max (ijk[2] - 1, 0); k <= ijk[2] + 1 && k < static_cast<int> (div_b[2]); ++k)
+      for (int j = std::max (ijk[1] - 1, 0); j <= ijk[1] + 1 && j < static_cast<int> (div_b[1]); ++j)
+        for (int i = std::max (ijk[0] - 1, 0); i <= ijk[0] + 1 && i < static_cast<int> (div_b[0]); ++i)
+        {
+          boost::unordered_map<size_t, int>::const_iterator leaf = leaves.find (i + j * div_b[0] + k * div_b[0] * div_b[1]);
+          if (leaf == leaves.end ())
+            continue;
+          const double *leaf_moments = &moments[leaf->second * nr_moments];
+          for (int mi = 0; mi < nr_moments; ++mi)
+            m[mi] += leaf_moments[mi];
+        }
+
+    float *normal = &leaf_normals[ql * 4];
+    // A plane needs at least 3 points
+    if (m[0] < 3)
+    {
+      normal[0] = normal[1] = normal[2] = normal[3] = bad_point;
+      continue;
+    }
+
+    const double inverse_n = 1.0 / m[0];
+    const double cx = m[1] * inverse_n, cy = m[2] * inverse_n, cz = m[3] * inverse_n;
+    EIGEN_ALIGN16 Eigen::Matrix3f covariance_matrix;
+    covariance_matrix (0, 0) = static_cast<float> (m[4] * inverse_n - cx * cx);
+    covariance_matrix (0, 1) = static_cast<float> (m[5] * inverse_n - cx * cy);
+    covariance_matrix (0, 2) = static_cast<float> (m[6] * inverse_n - cx * cz);
+    covariance_matrix (1, 1) = static_cast<float> (m[7] * inverse_n - cy * cy);
+    covariance_matrix (1, 2) = static_cast<float> (m[8] * inverse_n - cy * cz);
+    covariance_matrix (2, 2) = static_cast<float> (m[9] * inverse_n - cz * cz);
+    covariance_matrix (1, 0) = covariance_matrix (0, 1);
+    covariance_matrix (2, 0) = covariance_matrix (0, 2);
+    covariance_matrix (2, 1) = covariance_matrix (1, 2);
+
+    solvePlaneParameters (covariance_matrix, normal[0], normal[1], normal[2], normal[3]);
+  }
+
+#pragma omp parallel for schedule (static) num_threads (nr_threads)
+  for (int idx = 0; idx < static_cast<int> (indices_->size ()); ++idx)
+  {
+    PointOutT &point = output.points[idx];
+    if (point_leaves[idx] == -1)
+    {
+      point.normal[0] = point.normal[1] = point.normal[2] = point.curvature = bad_point;
+      continue;
+    }
+
+    const float *normal = &leaf_normals[point_leaves[idx] * 4];
+    point.normal[0] = normal[0];
+    point.normal[1] = normal[1];
+    point.normal[2] = normal[2];
+    point.curvature = normal[3];
+    flipNormalTowardsViewpoint (input_->points[(*indices_)[idx]], vpx_, vpy_, vpz_, point.normal[0], point.normal[1], point.normal[2]);
+  }
+}
+
 #define PCL_INSTANTIATE_NormalEstimation(T,NT) template class PCL_EXPORTS pcl::NormalEstimation<T,NT>;
 
 #endif    // PCL_FEATURES_IMPL_NORMAL_3D_H_ 
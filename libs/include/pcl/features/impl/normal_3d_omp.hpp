@@ -44,6 +44,12 @@
 template <typename PointInT, typename PointOutT> void
 pcl::NormalEstimationOMP<PointInT, PointOutT>::computeFeature (PointCloudOut &output)
 {
+  if (this->getApproximationLeafSize () > 0)
+  {
+    this->computeApproximateFeature (output, threads_);
+    return;
+  }
+
   float vpx, vpy, vpz;
   getViewPoint (vpx, vpy, vpz);
   // Iterating over the entire index vector
@@ -52,56 +52,107 @@ pcl::PFHEstimation<PointInT, PointNT, PointOutT>::computePairFeatures (
   return (true);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT> void
+pcl::PFHEstimation<PointInT, PointNT, PointOutT>::computePairBins (
+      const pcl::PointCloud<PointInT> &cloud, const pcl::PointCloud<PointNT> &normals,
+      int p_idx, int q_idx, int nr_split, int &bin_pq, int &bin_qp)
+{
+  bin_pq = bin_qp = -1;
+
+  const PointInT &p = cloud.points[p_idx];
+  const PointInT &q = cloud.points[q_idx];
+  const float dx = q.x - p.x, dy = q.y - p.y, dz = q.z - p.z;
+  const float f4 = sqrtf (dx * dx + dy * dy + dz * dz);
+  if (f4 == 0.0f)
+  {
+    PCL_ERROR ("Euclidean distance between points is 0!\n");
+    return;
+  }
+
+  const float n1x = normals.points[p_idx].normal_x, n1y = normals.points[p_idx].normal_y, n1z = normals.points[p_idx].normal_z;
+  const float n2x = normals.points[q_idx].normal_x, n2y = normals.points[q_idx].normal_y, n2z = normals.points[q_idx].normal_z;
+
+  // Both Darboux frames are u = n, v = d x n / |d x n|, w = u x v, with d pointing from the source
+  // to the target point, so all the features follow from a few products of d, n1 and n2
+  const float c1x = dy * n1z - dz * n1y, c1y = dz * n1x - dx * n1z, c1z = dx * n1y - dy * n1x;
+  const float c2x = dy * n2z - dz * n2y, c2y = dz * n2x - dx * n2z, c2z = dx * n2y - dy * n2x;
+  const float c1_norm = sqrtf (c1x * c1x + c1y * c1y + c1z * c1z);
+  const float c2_norm = sqrtf (c2x * c2x + c2y * c2y + c2z * c2z);
+
+  const float triple = c1x * n2x + c1y * n2y + c1z * n2z;   // (d x n1) . n2
+  const float dn1  = dx * n1x + dy * n1y + dz * n1z;
+  const float dn2  = dx * n2x + dy * n2y + dz * n2z;
+  const float n1n2 = n1x * n2x + n1y * n2y + n1z * n2z;
+  const float n1n1 = n1x * n1x + n1y * n1y + n1z * n1z;
+  const float n2n2 = n2x * n2x + n2y * n2y + n2z * n2z;
+
+  // Source p, target q: f2 = v . n2, f1 = atan2 (w . n2, u . n2), f3 = u . d / |d|
+  if (c1_norm == 0.0f)
+    PCL_ERROR ("Norm of Delta x U is 0!\n");
+  else
+    bin_pq = computeHistogramBin (atan2f ((n1n1 * dn2 - dn1 * n1n2) / c1_norm, n1n2), triple / c1_norm, dn1 / f4, nr_split);
+
+  // Source q, target p: d and the normals swap, the triple product stays the same
+  if (c2_norm == 0.0f)
+    PCL_ERROR ("Norm of Delta x U is 0!\n");
+  else
+    bin_qp = computeHistogramBin (atan2f ((dn2 * n1n2 - n2n2 * dn1) / c2_norm, n1n2), triple / c2_norm, -dn2 / f4, nr_split);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT, typename PointNT, typename PointOutT> void
 pcl::PFHEstimation<PointInT, PointNT, PointOutT>::computePointPFHSignature (
       const pcl::PointCloud<PointInT> &cloud, const pcl::PointCloud<PointNT> &normals,
       const std::vector<int> &indices, int nr_split, Eigen::VectorXf &pfh_histogram)
 {
-  int h_index, h_p;
+  computePointPFHSignature (cloud, normals, indices, nr_split, pfh_histogram, NULL);
+}
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT> void
+pcl::PFHEstimation<PointInT, PointNT, PointOutT>::computePointPFHSignature (
+      const pcl::PointCloud<PointInT> &cloud, const pcl::PointCloud<PointNT> &normals,
+      const std::vector<int> &indices, int nr_split, Eigen::VectorXf &pfh_histogram,
+      std::vector<PairBins> *cache)
+{
   // Clear the resultant point histogram
   pfh_histogram.setZero ();
 
   // Factorization constant
   float hist_incr = 100.0 / (indices.size () * indices.size () - 1);
 
-  // Iterate over all the points in the neighborhood
-  for (size_t i_idx = 0; i_idx < indices.size (); ++i_idx)
+  const size_t mask = cache ? cache->size () - 1 : 0;
+  const int nr_indices = (int)indices.size ();
+
+  // Iterate over all the unordered pairs in the neighborhood, each one gives two ordered pairs
+  for (int i_idx = 0; i_idx < nr_indices; ++i_idx)
   {
-    for (size_t j_idx = 0; j_idx < indices.size (); ++j_idx)
+    for (int j_idx = i_idx + 1; j_idx < nr_indices; ++j_idx)
     {
-      // Avoid unnecessary returns
-      if (i_idx == j_idx)
-        continue;
-
-      // Compute the pair NNi to NNj
-      if (!computePairFeatures (cloud, normals, indices[i_idx], indices[j_idx],
-                                pfh_tuple_[0], pfh_tuple_[1], pfh_tuple_[2], pfh_tuple_[3]))
-        continue;
-
-      // Normalize the f1, f2, f3 features and push them in the histogram
-      f_index_[0] = floor (nr_split * ((pfh_tuple_[0] + M_PI) * d_pi_));
-      if (f_index_[0] < 0)         f_index_[0] = 0;
-      if (f_index_[0] >= nr_split) f_index_[0] = nr_split - 1;
-
-      f_index_[1] = floor (nr_split * ((pfh_tuple_[1] + 1.0) * 0.5));
-      if (f_index_[1] < 0)         f_index_[1] = 0;
-      if (f_index_[1] >= nr_split) f_index_[1] = nr_split - 1;
-
-      f_index_[2] = floor (nr_split * ((pfh_tuple_[2] + 1.0) * 0.5));
-      if (f_index_[2] < 0)         f_index_[2] = 0;
-      if (f_index_[2] >= nr_split) f_index_[2] = nr_split - 1;
-
-      // Copy into the histogram
-      h_index = 0;
-      h_p     = 1;
-      for (int d = 0; d < 3; ++d)
+      int bin_ij, bin_ji;
+      if (cache)
       {
-        h_index += h_p * f_index_[d];
-        h_p     *= nr_split;
+        const int p_idx = std::min (indices[i_idx], indices[j_idx]);
+        const int q_idx = std::max (indices[i_idx], indices[j_idx]);
+        PairBins &slot = (*cache)[((size_t)p_idx * 73856093u ^ (size_t)q_idx * 19349663u) & mask];
+        if (slot.p_idx != p_idx || slot.q_idx != q_idx)
+        {
+          slot.p_idx = p_idx;
+          slot.q_idx = q_idx;
+          computePairBins (cloud, normals, p_idx, q_idx, nr_split, slot.bin_pq, slot.bin_qp);
+        }
+        bin_ij = (p_idx == indices[i_idx]) ? slot.bin_pq : slot.bin_qp;
+        bin_ji = (p_idx == indices[i_idx]) ? slot.bin_qp : slot.bin_pq;
       }
-      pfh_histogram[h_index] += hist_incr;
+      else
+        computePairBins (cloud, normals, indices[i_idx], indices[j_idx], nr_split, bin_ij, bin_ji);
+
+      // Pairs without features are skipped
+      if (bin_ij >= 0)
+        pfh_histogram[bin_ij] += hist_incr;
+      if (bin_ji >= 0)
+        pfh_histogram[bin_ji] += hist_incr;
     }
   }
 }
@@ -110,24 +161,58 @@ pcl::PFHEstimation<PointInT, PointNT, PointOutT>::computePointPFHSignature (
 template <typename PointInT, typename PointNT, typename PointOutT> void
 pcl::PFHEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut &output)
 {
-  pfh_histogram_.setZero (nr_subdiv_ * nr_subdiv_ * nr_subdiv_);
+  const int nr_bins = nr_subdiv_ * nr_subdiv_ * nr_subdiv_;
 
-  // Allocate enough space to hold the results
-  // \note This resize is irrelevant for a radiusSearch ().
-  std::vector<int> nn_indices (k_);
-  std::vector<float> nn_dists (k_);
-
-  // Iterating over the entire index vector
-  for (size_t idx = 0; idx < indices_->size (); ++idx)
+  // Split the cache between the threads, a power of two slots each, and clear it: the
+  // surface may have changed since the last call
+  size_t cache_size = 0;
+  if (use_cache_)
+  {
+    const size_t thread_size = max_cache_size_ / threads_;
+    for (cache_size = 1; cache_size * 2 <= thread_size; cache_size *= 2) ;
+  }
+  PairBins empty_slot;
+  empty_slot.p_idx = empty_slot.q_idx = -1;
+  empty_slot.bin_pq = empty_slot.bin_qp = -1;
+  caches_.resize (threads_);
+  for (size_t i = 0; i < caches_.size (); ++i)
+    caches_[i].assign (cache_size, empty_slot);
+
+  // Iterating over the entire index vector. Every thread owns a contiguous range, whose
+  // neighborhoods overlap the most
+#pragma omp parallel num_threads (threads_)
   {
-    this->searchForNeighbors ((*indices_)[idx], search_parameter_, nn_indices, nn_dists);
+    // Allocate enough space to hold the results
+    // \note This resize is irrelevant for a radiusSearch ().
+    std::vector<int> nn_indices (k_);
+    std::vector<float> nn_dists (k_);
+    Eigen::VectorXf pfh_histogram (nr_bins);
+
+#ifdef _OPENMP
+    std::vector<PairBins> *cache = use_cache_ ? &caches_[omp_get_thread_num ()] : NULL;
+#else
+    std::vector<PairBins> *cache = use_cache_ ? &caches_[0] : NULL;
+#endif
+
+#pragma omp for schedule (static)
+    for (int idx = 0; idx < (int)indices_->size (); ++idx)
+    {
+      // Points without neighbors (e.g. invalid ones) get a NaN signature
+      if (this->searchForNeighbors ((*indices_)[idx], search_parameter_, nn_indices, nn_dists) == 0)
+      {
+        for (int d = 0; d < nr_bins; ++d)
+          output.points[idx].histogram[d] = std::numeric_limits<float>::quiet_NaN ();
+        output.is_dense = false;
+        continue;
+      }
 
-    // Estimate the PFH signature at each patch
-    computePointPFHSignature (*surface_, *normals_, nn_indices, nr_subdiv_, pfh_histogram_);
+      // Estimate the PFH signature at each patch
+      computePointPFHSignature (*surface_, *normals_, nn_indices, nr_subdiv_, pfh_histogram, cache);
 
-    // Copy into the resultant cloud
-    for (int d = 0; d < pfh_histogram_.size (); ++d)
-      output.points[idx].histogram[d] = pfh_histogram_[d];
+      // Copy into the resultant cloud
+      for (int d = 0; d < pfh_histogram.size (); ++d)
+        output.points[idx].histogram[d] = pfh_histogram[d];
+    }
   }
 }
 
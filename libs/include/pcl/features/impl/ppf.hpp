@@ -66,6 +66,9 @@ pcl::PPFEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut
   for (size_t index_i = 0; index_i < indices_->size (); ++index_i)
   {
     size_t i = (*indices_)[index_i];
+    // The reference frame of the model point, in which alpha_m of all its pairs is measured
+    Eigen::Affine3f transform_mg = pcl::computePPFReferenceTransform (input_->points[i].getVector3fMap (),
+                                                                      normals_->points[i].getNormalVector3fMap ());
     for (size_t j = 0 ; j < input_->points.size (); ++j)
     {
       PointOutT p;
@@ -78,13 +81,7 @@ pcl::PPFEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut
                                    p.f1, p.f2, p.f3, p.f4))
         {
           // Calculate alpha_m angle
-          Eigen::Vector3f model_reference_point = input_->points[i].getVector3fMap (),
-                          model_reference_normal = normals_->points[i].getNormalVector3fMap (),
-                          model_point = input_->points[j].getVector3fMap ();
-          Eigen::AngleAxisf rotation_mg (acos (model_reference_normal.dot (Eigen::Vector3f::UnitX ())),
-                                         model_reference_normal.cross (Eigen::Vector3f::UnitX ()).normalized ());
-          Eigen::Affine3f transform_mg = Eigen::Translation3f ( rotation_mg * ((-1) * model_reference_point)) * rotation_mg;
-          p.alpha_m = acos (Eigen::Vector3f::UnitY ().dot ((transform_mg * model_point).normalized ()));
+          p.alpha_m = pcl::computePPFAlpha (transform_mg, input_->points[j].getVector3fMap ());
         }
         else
         {
@@ -170,8 +170,6 @@ pcl::SHOTEstimationBase<PointInT, PointNT, PointOutT>::getSHOTLocalRF (
     rf.resize (3);
 
   Eigen::Vector4f central_point = cloud.points[index].getVector4fMap ();
-  // Allocate enough space
-  Eigen::Vector4d *vij = new Eigen::Vector4d[indices.size ()];
 
   Eigen::Matrix3d cov_m = Eigen::Matrix3d::Zero ();
 
@@ -187,12 +185,12 @@ pcl::SHOTEstimationBase<PointInT, PointNT, PointOutT>::getSHOTLocalRF (
 
     Eigen::Vector4f pt = cloud.points[indices[i_idx]].getVector4fMap (); 
     // Difference between current point and origin
-    vij[valid_nn_points] = (pt - central_point).cast<double> ();
+    Eigen::Vector4d vij = (pt - central_point).cast<double> ();
 
     distance = search_radius_ - sqrt (dists[i_idx]);
 
     // Multiply vij * vij'
-    cov_m += distance * (vij[valid_nn_points].head<3> () * vij[valid_nn_points].head<3> ().transpose ());
+    cov_m += distance * (vij.head<3> () * vij.head<3> ().transpose ());
 
     sum += distance;
     valid_nn_points++;
@@ -209,8 +207,6 @@ pcl::SHOTEstimationBase<PointInT, PointNT, PointOutT>::getSHOTLocalRF (
     rf[1][1] = 1;
     rf[2][2] = 1;
 
-    delete [] vij;
-
     return (std::numeric_limits<float>::max ());
   }
 
@@ -267,13 +263,20 @@ pcl::SHOTEstimationBase<PointInT, PointNT, PointOutT>::getSHOTLocalRF (
     }
   }
 
-  for (int ne = 0; ne < valid_nn_points; ne++)
+  // Go over the neighbors again instead of keeping their differences to the origin around
+  for (size_t i_idx = 0; i_idx < indices.size (); ++i_idx)
   {
-    double dp = vij[ne].dot (v1);
+    if (indices[i_idx] == index)
+      continue;
+
+    Eigen::Vector4f pt = cloud.points[indices[i_idx]].getVector4fMap ();
+    Eigen::Vector4d vij = (pt - central_point).cast<double> ();
+
+    double dp = vij.dot (v1);
     if (dp >= 0)
       plusTangentDirection1++;
 
-    dp = vij[ne].dot (v3);
+    dp = vij.dot (v3);
     if (dp >= 0)
       plusNormal++;
   }
@@ -289,8 +292,6 @@ pcl::SHOTEstimationBase<PointInT, PointNT, PointOutT>::getSHOTLocalRF (
   rf[1] = rf[2].cross3 (rf[0]);
   rf[0][3] = 0; rf[1][3] = 0; rf[2][3] = 0;
 
-  delete [] vij;
-
   return (0.0f);
 }
 
@@ -689,14 +690,12 @@ template <typename PointNT, typename PointOutT> void
 pcl::SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::computePointSHOT (
   const pcl::PointCloud<pcl::PointXYZRGBA> &cloud, const pcl::PointCloud<PointNT> &normals,
   const int index, const std::vector<int> &indices, const std::vector<float> &dists, Eigen::VectorXf &shot,
-  std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > &rf)
+  std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > &rf,
+  std::vector<double> &binDistanceShape, std::vector<double> &binDistanceColor)
 {
   if (rf.size () != 3)
     rf.resize (3);
 
-  std::vector<double> binDistanceShape;
-  std::vector<double> binDistanceColor;
-
   int nNeighbors = indices.size ();
 
   //Skip the current feature if the number of its neighbors is not sufficient for its description
@@ -798,13 +797,12 @@ template <typename PointInT, typename PointNT, typename PointOutT> void
 pcl::SHOTEstimation<PointInT, PointNT, PointOutT>::computePointSHOT (
   const pcl::PointCloud<PointInT> &cloud, const pcl::PointCloud<PointNT> &normals,
   const int index, const std::vector<int> &indices, const std::vector<float> &dists, Eigen::VectorXf &shot,
-  std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > &rf)
+  std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > &rf,
+  std::vector<double> &binDistanceShape, std::vector<double> &)
 {
   if (rf.size () != 3)
     rf.resize (3);
 
-  std::vector<double> binDistanceShape;
-
   int nNeighbors = indices.size ();
 
   if (nNeighbors < 5)
@@ -849,103 +847,79 @@ pcl::SHOTEstimation<PointInT, PointNT, PointOutT>::computePointSHOT (
 template <typename PointNT, typename PointOutT> void
 pcl::SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::computeFeature (PointCloudOut &output)
 {
-  if (rf_.size () != 3)
-    rf_.resize (3);
-
   // Compute the current length of the descriptor
   descLength_ = (b_describe_shape_) ? nr_grid_sector_*(nr_shape_bins_+1) : 0;
   descLength_ +=   (b_describe_color_) ? nr_grid_sector_*(nr_color_bins_+1) : 0;
 
-  // Useful values
-  sqradius_ = search_radius_*search_radius_;
-  sqradius4_ = sqradius_ / 4;
-  radius3_4_ = (search_radius_*3) / 4;
-  radius1_4_ = search_radius_ / 4;
-  radius1_2_ = search_radius_ / 2;
-
-  shot_.setZero (descLength_);
-  rf_[0].setZero ();
-  rf_[1].setZero ();
-  rf_[2].setZero ();
-
-  if (output.points[0].descriptor.size () != (size_t)descLength_)
-    for (size_t idx = 0; idx < indices_->size (); ++idx)
-      output.points[idx].descriptor.resize (descLength_);
-//  if (output.points[0].size != (size_t)descLength_)
-//  {
-//    PCL_ERROR ("[pcl::%s::computeFeature] The desired descriptor size (%lu) does not match the output point type feature (%lu)! Aborting...\n", getClassName ().c_str (), (unsigned long) descLength_, (unsigned long) output.points[0].size);
-//    return;
-//  }
-
-  // Allocate enough space to hold the results
-  // \note This resize is irrelevant for a radiusSearch ().
-  std::vector<int> nn_indices (k_);
-  std::vector<float> nn_dists (k_);
-
-  // Iterating over the entire index vector
-  for (size_t idx = 0; idx < indices_->size (); ++idx)
+  // Fill the color conversion tables before the threads use them
+  if (b_describe_color_)
   {
-    this->searchForNeighbors ((*indices_)[idx], search_parameter_, nn_indices, nn_dists);
-
-    // Compute the SHOT descriptor for the current 3D feature
-    computePointSHOT (*surface_, *normals_, idx, nn_indices, nn_dists, shot_, rf_);
-
-    // Copy into the resultant cloud
-    for (int d = 0; d < shot_.size (); ++d)
-      output.points[idx].descriptor[d] = shot_[d];
-    for (int d = 0; d < 9; ++d)
-      output.points[idx].rf[d] = rf_[d/3][d%3];
+    float L, a, b;
+    RGB2CIELAB (0, 0, 0, L, a, b);
   }
-}
 
+  computeDescriptors (output);
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT, typename PointNT, typename PointOutT> void
 pcl::SHOTEstimationBase<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut &output)
 {
-  if (rf_.size () != 3)
-    rf_.resize (3);
-
   descLength_ = nr_grid_sector_ * (nr_shape_bins_+1);
 
+  computeDescriptors (output);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT> void
+pcl::SHOTEstimationBase<PointInT, PointNT, PointOutT>::computeDescriptors (PointCloudOut &output)
+{
   sqradius_ = search_radius_ * search_radius_;
   sqradius4_ = sqradius_ / 4;
   radius3_4_ = (search_radius_*3) / 4;
   radius1_4_ = search_radius_ / 4;
   radius1_2_ = search_radius_ / 2;
 
-  shot_.setZero (descLength_);
-  rf_[0].setZero ();
-  rf_[1].setZero ();
-  rf_[2].setZero ();
-
   if (output.points[0].descriptor.size () != (size_t)descLength_)
     for (size_t idx = 0; idx < indices_->size (); ++idx)
       output.points[idx].descriptor.resize (descLength_);
-//  if (output.points[0].size != (size_t)descLength_)
-//  {
-//    PCL_ERROR ("[pcl::%s::computeFeature] The desired descriptor size (%lu) does not match the output point type feature (%lu)! Aborting...\n", getClassName ().c_str (), (unsigned long) descLength_, (unsigned long) output.points[0].size);
-//    return;
-//  }
-
-  // Allocate enough space to hold the results
-  // \note This resize is irrelevant for a radiusSearch ().
-  std::vector<int> nn_indices (k_);
-  std::vector<float> nn_dists (k_);
-
-  // Iterating over the entire index vector
-  for (size_t idx = 0; idx < indices_->size (); ++idx)
+
+  // Iterating over the entire index vector. The neighborhoods differ in size, so the threads take
+  // small chunks of points as they go
+#pragma omp parallel num_threads (threads_)
   {
-    this->searchForNeighbors ((*indices_)[idx], search_parameter_, nn_indices, nn_dists);
+    // Allocate enough space to hold the results, once per thread
+    // \note This resize is irrelevant for a radiusSearch ().
+    std::vector<int> nn_indices (k_);
+    std::vector<float> nn_dists (k_);
+    Eigen::VectorXf shot (descLength_);
+    std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > rf (3);
+    std::vector<double> bin_distance_shape, bin_distance_color;
+
+#pragma omp for schedule (dynamic, 16)
+    for (int idx = 0; idx < (int)indices_->size (); ++idx)
+    {
+      // Points with too few neighbors (e.g. invalid ones) get a NaN descriptor
+      if (this->searchForNeighbors ((*indices_)[idx], search_parameter_, nn_indices, nn_dists) < 5)
+      {
+        for (int d = 0; d < descLength_; ++d)
+          output.points[idx].descriptor[d] = std::numeric_limits<float>::quiet_NaN ();
+        for (int d = 0; d < 9; ++d)
+          output.points[idx].rf[d] = std::numeric_limits<float>::quiet_NaN ();
+        output.is_dense = false;
+        continue;
+      }
 
-    // Estimate the SHOT at each patch
-    computePointSHOT (*surface_, *normals_, idx, nn_indices, nn_dists, shot_, rf_);
+      // Estimate the SHOT at each patch
+      computePointSHOT (*surface_, *normals_, (*indices_)[idx], nn_indices, nn_dists, shot, rf,
+                        bin_distance_shape, bin_distance_color);
 
-    // Copy into the resultant cloud
-    for (int d = 0; d < shot_.size (); ++d)
-      output.points[idx].descriptor[d] = shot_[d];
-    for (int d = 0; d < 9; ++d)
-      output.points[idx].rf[d] = rf_[d/3][d%3];
+      // Copy into the resultant cloud
+      for (int d = 0; d < shot.size (); ++d)
+        output.points[idx].descriptor[d] = shot[d];
+      for (int d = 0; d < 9; ++d)
+        output.points[idx].rf[d] = rf[d/3][d%3];
+    }
   }
 }
 
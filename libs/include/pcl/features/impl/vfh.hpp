@@ -49,13 +49,32 @@ pcl::VFHEstimation<PointInT, PointNT, PointOutT>::computePointSPFHSignature (con
                                                                              const pcl::PointCloud<PointInT> &cloud,
                                                                              const pcl::PointCloud<PointNT> &normals,
                                                                              const std::vector<int> &indices)
+{
+  std::vector<float> hist (nr_bins_f1_ + nr_bins_f2_ + nr_bins_f3_ + nr_bins_f4_);
+  computePointSPFHSignature (centroid_p, centroid_n, cloud, normals, indices, &hist[0]);
+
+  hist_f1_ = Eigen::Map<Eigen::VectorXf> (&hist[0], nr_bins_f1_);
+  hist_f2_ = Eigen::Map<Eigen::VectorXf> (&hist[nr_bins_f1_], nr_bins_f2_);
+  hist_f3_ = Eigen::Map<Eigen::VectorXf> (&hist[nr_bins_f1_ + nr_bins_f2_], nr_bins_f3_);
+  hist_f4_ = Eigen::Map<Eigen::VectorXf> (&hist[nr_bins_f1_ + nr_bins_f2_ + nr_bins_f3_], nr_bins_f4_);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template<typename PointInT, typename PointNT, typename PointOutT> void
+pcl::VFHEstimation<PointInT, PointNT, PointOutT>::computePointSPFHSignature (const Eigen::Vector4f &centroid_p,
+                                                                             const Eigen::Vector4f &centroid_n,
+                                                                             const pcl::PointCloud<PointInT> &cloud,
+                                                                             const pcl::PointCloud<PointNT> &normals,
+                                                                             const std::vector<int> &indices,
+                                                                             float *hist) const
 {
   Eigen::Vector4f pfh_tuple;
   // Reset the whole thing
-  hist_f1_.setZero (nr_bins_f1_);
-  hist_f2_.setZero (nr_bins_f2_);
-  hist_f3_.setZero (nr_bins_f3_);
-  hist_f4_.setZero (nr_bins_f4_);
+  float *hist_f1 = hist;
+  float *hist_f2 = hist_f1 + nr_bins_f1_;
+  float *hist_f3 = hist_f2 + nr_bins_f2_;
+  float *hist_f4 = hist_f3 + nr_bins_f3_;
+  std::fill (hist, hist_f4 + nr_bins_f4_, 0.0f);
 
   // Get the bounding box of the current cluster
   //Eigen::Vector4f min_pt, max_pt;
@@ -102,21 +121,21 @@ pcl::VFHEstimation<PointInT, PointNT, PointOutT>::computePointSPFHSignature (con
       h_index = 0;
     if (h_index >= nr_bins_f1_)
       h_index = nr_bins_f1_ - 1;
-    hist_f1_ (h_index) += hist_incr;
+    hist_f1[h_index] += hist_incr;
 
     h_index = floor (nr_bins_f2_ * ((pfh_tuple[1] + 1.0) * 0.5));
     if (h_index < 0)
       h_index = 0;
     if (h_index >= nr_bins_f2_)
       h_index = nr_bins_f2_ - 1;
-    hist_f2_ (h_index) += hist_incr;
+    hist_f2[h_index] += hist_incr;
 
     h_index = floor (nr_bins_f3_ * ((pfh_tuple[2] + 1.0) * 0.5));
     if (h_index < 0)
       h_index = 0;
     if (h_index >= nr_bins_f3_)
       h_index = nr_bins_f3_ - 1;
-    hist_f3_ (h_index) += hist_incr;
+    hist_f3[h_index] += hist_incr;
 
     if (normalize_distances_) 
       h_index = floor (nr_bins_f4_ * (pfh_tuple[3] / distance_normalization_factor));
@@ -128,114 +147,151 @@ pcl::VFHEstimation<PointInT, PointNT, PointOutT>::computePointSPFHSignature (con
     if (h_index >= nr_bins_f4_)
       h_index = nr_bins_f4_ - 1;
 
-    hist_f4_ (h_index) += hist_incr_size_component;
+    hist_f4[h_index] += hist_incr_size_component;
   }
 }
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT, typename PointNT, typename PointOutT> void
-pcl::VFHEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut &output)
+pcl::VFHEstimation<PointInT, PointNT, PointOutT>::computeMoments (const pcl::PointCloud<PointInT> &cloud,
+                                                                  const pcl::PointCloud<PointNT> &normals,
+                                                                  const std::vector<int> &indices,
+                                                                  Eigen::Vector4f &xyz_centroid,
+                                                                  Eigen::Vector4f &normal_centroid) const
 {
-  // ---[ Step 1a : compute the centroid in XYZ space
-  Eigen::Vector4f xyz_centroid;
-
-  if (use_given_centroid_) 
-    xyz_centroid = centroid_to_use_;
-  else
-    compute3DCentroid (*surface_, *indices_, xyz_centroid);          // Estimate the XYZ centroid
-
-  // ---[ Step 1b : compute the centroid in normal space
-  Eigen::Vector4f normal_centroid = Eigen::Vector4f::Zero ();
-  int cp = 0;
+  xyz_centroid.setZero ();
+  normal_centroid.setZero ();
+  int cp_xyz = 0, cp_normal = 0;
 
+  // ---[ Step 1a/1b : accumulate the centroids in XYZ and in normal space together
   // If the data is dense, we don't need to check for NaN
-
-  if (use_given_normal_)
-    normal_centroid = normal_to_use_;
-  else
+  for (size_t i = 0; i < indices.size (); ++i)
   {
-    if (normals_->is_dense)
+    const PointInT &p = cloud.points[indices[i]];
+    if (cloud.is_dense || (pcl_isfinite (p.x) && pcl_isfinite (p.y) && pcl_isfinite (p.z)))
     {
-      for (size_t i = 0; i < indices_->size (); ++i)
-      {
-        normal_centroid += normals_->points[(*indices_)[i]].getNormalVector4fMap ();
-        cp++;
-      }
+      xyz_centroid += p.getVector4fMap ();
+      cp_xyz++;
     }
-    // NaN or Inf values could exist => check for them
-    else
+
+    const PointNT &n = normals.points[indices[i]];
+    if (normals.is_dense || (pcl_isfinite (n.normal[0]) && pcl_isfinite (n.normal[1]) && pcl_isfinite (n.normal[2])))
     {
-      for (size_t i = 0; i < indices_->size (); ++i)
-      {
-        if (!pcl_isfinite (normals_->points[(*indices_)[i]].normal[0])
-            ||
-            !pcl_isfinite (normals_->points[(*indices_)[i]].normal[1])
-            ||
-            !pcl_isfinite (normals_->points[(*indices_)[i]].normal[2]))
-          continue;
-        normal_centroid += normals_->points[(*indices_)[i]].getNormalVector4fMap ();
-        cp++;
-      }
+      normal_centroid += n.getNormalVector4fMap ();
+      cp_normal++;
     }
-    normal_centroid /= cp;
   }
+  xyz_centroid[3] = 0;
+  if (cp_xyz > 0)
+    xyz_centroid /= (float)cp_xyz;
+  if (cp_normal > 0)
+    normal_centroid /= cp_normal;
+
+  if (use_given_centroid_) 
+    xyz_centroid = centroid_to_use_;
+  if (use_given_normal_)
+    normal_centroid = normal_to_use_;
+}
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT> void
+pcl::VFHEstimation<PointInT, PointNT, PointOutT>::computeSignature (const pcl::PointCloud<PointInT> &cloud,
+                                                                    const pcl::PointCloud<PointNT> &normals,
+                                                                    const std::vector<int> &indices,
+                                                                    const Eigen::Vector4f &xyz_centroid,
+                                                                    const Eigen::Vector4f &normal_centroid,
+                                                                    PointOutT &signature) const
+{
   // Compute the direction of view from the viewpoint to the centroid
   Eigen::Vector4f viewpoint (vpx_, vpy_, vpz_, 0);
   Eigen::Vector4f d_vp_p = viewpoint - xyz_centroid;
   d_vp_p.normalize ();
 
-  // Estimate the SPFH at nn_indices[0] using the entire cloud
-  computePointSPFHSignature (xyz_centroid, normal_centroid, *surface_, *normals_, *indices_);
-
-  // We only output _1_ signature
-  output.points.resize (1);
-  output.width = 1;
-  output.height = 1;
-
-  // Estimate the FPFH at nn_indices[0] using the entire cloud and copy the resultant signature
-  for (int d = 0; d < hist_f1_.size (); ++d)
-    output.points[0].histogram[d + 0] = hist_f1_[d];
-
-  size_t data_size = hist_f1_.size ();
-  for (int d = 0; d < hist_f2_.size (); ++d)
-    output.points[0].histogram[d + data_size] = hist_f2_[d];
-
-  data_size += hist_f2_.size ();
-  for (int d = 0; d < hist_f3_.size (); ++d)
-    output.points[0].histogram[d + data_size] = hist_f3_[d];
-
-  data_size += hist_f3_.size ();
-  for (int d = 0; d < hist_f4_.size (); ++d)
-    output.points[0].histogram[d + data_size] = hist_f4_[d];
+  // Estimate the SPFH of the centroid using the entire set, straight into the signature
+  computePointSPFHSignature (xyz_centroid, normal_centroid, cloud, normals, indices, signature.histogram);
 
   // ---[ Step 2 : obtain the viewpoint component
-  hist_vp_.setZero (nr_bins_vp_);
+  float *hist_vp = signature.histogram + nr_bins_f1_ + nr_bins_f2_ + nr_bins_f3_ + nr_bins_f4_;
+  std::fill (hist_vp, hist_vp + nr_bins_vp_, 0.0f);
 
   double hist_incr;
   if (normalize_bins_)
-    hist_incr = 100.0 / (double)(indices_->size ());
+    hist_incr = 100.0 / (double)(indices.size ());
   else
     hist_incr = 1.0;
 
-  for (size_t i = 0; i < indices_->size (); ++i)
+  for (size_t i = 0; i < indices.size (); ++i)
   {
-    Eigen::Vector4f normal (normals_->points[(*indices_)[i]].normal[0],
-                            normals_->points[(*indices_)[i]].normal[1],
-                            normals_->points[(*indices_)[i]].normal[2], 0);
+    Eigen::Vector4f normal (normals.points[indices[i]].normal[0],
+                            normals.points[indices[i]].normal[1],
+                            normals.points[indices[i]].normal[2], 0);
     // Normalize
     double alpha = (normal.dot (d_vp_p) + 1.0) * 0.5;
-    int fi = floor (alpha * hist_vp_.size ());
+    int fi = floor (alpha * nr_bins_vp_);
     if (fi < 0)
       fi = 0;
-    if (fi > ((int)hist_vp_.size () - 1))
-      fi = hist_vp_.size () - 1;
+    if (fi > (nr_bins_vp_ - 1))
+      fi = nr_bins_vp_ - 1;
     // Bin into the histogram
-    hist_vp_ [fi] += hist_incr;
+    hist_vp [fi] += hist_incr;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT> void
+pcl::VFHEstimation<PointInT, PointNT, PointOutT>::computeFeature (PointCloudOut &output)
+{
+  Eigen::Vector4f xyz_centroid, normal_centroid;
+  computeMoments (*surface_, *normals_, *indices_, xyz_centroid, normal_centroid);
+
+  // We only output _1_ signature
+  output.points.resize (1);
+  output.width = 1;
+  output.height = 1;
+
+  computeSignature (*surface_, *normals_, *indices_, xyz_centroid, normal_centroid, output.points[0]);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT> void
+pcl::VFHEstimation<PointInT, PointNT, PointOutT>::computeClusters (const std::vector<pcl::PointIndices> &clusters,
+                                                                   PointCloudOut &output)
+{
+  output.points.clear ();
+  output.width = output.height = 0;
+  if (!input_)
+  {
+    PCL_ERROR ("[pcl::%s::computeClusters] No input dataset was given!\n", getClassName ().c_str ());
+    return;
+  }
+  if (!normals_ || normals_->points.size () != input_->points.size ())
+  {
+    PCL_ERROR ("[pcl::%s::computeClusters] The number of points in the input dataset differs from the number of points in the dataset containing the normals!\n", getClassName ().c_str ());
+    return;
+  }
+
+  output.header = input_->header;
+  output.points.resize (clusters.size ());
+  output.width = clusters.size ();
+  output.height = 1;
+  output.is_dense = true;
+
+#pragma omp parallel for schedule (dynamic, 1) num_threads (threads_)
+  for (int i = 0; i < (int)clusters.size (); ++i)
+  {
+    const std::vector<int> &indices = clusters[i].indices;
+    if (indices.empty ())
+    {
+      for (int d = 0; d < nr_bins_f1_ + nr_bins_f2_ + nr_bins_f3_ + nr_bins_f4_ + nr_bins_vp_; ++d)
+        output.points[i].histogram[d] = std::numeric_limits<float>::quiet_NaN ();
+      output.is_dense = false;
+      continue;
+    }
+
+    Eigen::Vector4f xyz_centroid, normal_centroid;
+    computeMoments (*input_, *normals_, indices, xyz_centroid, normal_centroid);
+    computeSignature (*input_, *normals_, indices, xyz_centroid, normal_centroid, output.points[i]);
   }
-  data_size += hist_f4_.size ();
-  // Copy the resultant signature
-  for (int d = 0; d < hist_vp_.size (); ++d)
-    output.points[0].histogram[d + data_size] = hist_vp_[d];
 }
 
 #define PCL_INSTANTIATE_VFHEstimation(T,NT,OutT) template class PCL_EXPORTS pcl::VFHEstimation<T,NT,OutT>;
@@ -44,6 +44,10 @@ namespace pcl
 {
 
   /** \brief Generic implementation for creating 2D integral images (including second order integral images).
+    *
+    * The sums of all dimensions (and of their products) of an element are stored next to each other, so the
+    * lookups of getSum () for the different dimensions of the same area touch the same cache lines.
+    *
     * \author Stefan Holzer
     * \ingroup features
     */
@@ -52,6 +56,11 @@ namespace pcl
   {
     public: // functions
     
+      /**
+       * Constructor. No integral images are available until setInput () is called.
+       */
+      IntegralImage2D ();
+
       /**
        * Constructor. Internally creates the integral images.
        *
@@ -73,12 +82,35 @@ namespace pcl
       //! Destructor
       virtual ~IntegralImage2D ();
 
+      /**
+       * (Re)computes the integral images for new data. The memory of the previous integral images is
+       * reused, so calling this for every frame of a stream with a fixed resolution doesn't allocate.
+       * The parameters are the same as for the constructor.
+       */
+      void
+      setInput (DataType * data,
+                const int width,
+                const int height,
+                const int dimensions,
+                const bool compute_second_order_integral_images, 
+                const int element_stride, const int row_stride);
+
+      /** \brief Set the number of threads used to compute the integral images.
+        * \param nr_threads the number of threads, 0 is the same as 1
+        */
+      inline void
+      setNumberOfThreads (unsigned int nr_threads) { threads_ = nr_threads == 0 ? 1 : nr_threads; }
+
+      /** \brief Get the number of threads used to compute the integral images. */
+      inline unsigned int
+      getNumberOfThreads () const { return (threads_); }
+
       /**
        * Computes the sum of the "dimension_index"-th dimension of the elements within the specified area.
        */
       IIDataType getSum (const int start_x, const int start_y, 
                          const int width,   const int height, 
-                         const int dimension_index);
+                         const int dimension_index) const;
 
       /**
        * Computes the sum of the "dimension_index1"-th dimension of the elements times the 
@@ -86,17 +118,45 @@ namespace pcl
        */
       IIDataType getSum (const int start_x, const int start_y,
                          const int width,   const int height, 
-                         const int dimension_index_1, const int dimension_index_2);
+                         const int dimension_index_1, const int dimension_index_2) const;
 
     protected: // functions
     
-      /** Computes integral images for multiple dimensions. */
+      /** Computes the integral images of all dimensions (and their products).
+        *
+        * Every row is first replaced by its prefix sums, then the rows are accumulated from top to bottom.
+        * With more than one thread the first pass runs in parallel over the rows and the second one over
+        * blocks of columns, otherwise both are done in a single sweep.
+        */
       void 
       computeIntegralImages (DataType * data);
-      
-      /** Computes integral image for one dimension. */
-      void 
-      computeIntegralImagesOneDimensional (DataType * data);
+
+      /** Writes the prefix sums of one row of the input into the same row of the integral images. */
+      void
+      computeRowPrefixSums (const DataType * data, const int row_index);
+
+      /** Adds the columns [col_begin, col_end) of the previous row of the integral images to the given row. */
+      void
+      accumulateRow (const int row_index, const int col_begin, const int col_end);
+
+      /** Computes the sum stored at the given offset within the elements of the integral images. */
+      inline IIDataType
+      getSumAtOffset (const int start_x, const int start_y, 
+                      const int width,   const int height, 
+                      const int offset) const
+      {
+        const IIDataType *integral_image = &integral_images_[offset];
+        const int l_ulX = start_x;
+        const int l_ulY = start_y;
+        const int l_lrX = start_x + width;
+        const int l_lrY = start_y + height;
+
+        return 
+           (integral_image[(l_ulY*width_ + l_ulX) * nr_values_]
+          + integral_image[(l_lrY*width_ + l_lrX) * nr_values_]
+          - integral_image[(l_lrY*width_ + l_ulX) * nr_values_]
+          - integral_image[(l_ulY*width_ + l_lrX) * nr_values_]);
+      }
 
     protected: // data
     
@@ -112,11 +172,16 @@ namespace pcl
       int row_stride_;
       /** indicates whether second order integral images are available **/
       bool are_second_order_ii_available_;
+      /** number of threads used to compute the integral images */
+      unsigned int threads_;
+
+      /** number of sums stored per element: the dimensions followed by the upper triangle of their products */
+      int nr_values_;
+      /** offset of the sum of the product of two dimensions within an element, [i][j] equals [j][i] */
+      std::vector <std::vector <int> > second_order_offsets_;
 
-      /** first order integral images */
-      std::vector <IIDataType *> first_order_integral_images_;
-      /** second order integral images */
-      std::vector <std::vector <IIDataType*> > second_order_integral_images_;
+      /** the interleaved integral images, kept between calls to setInput () */
+      std::vector <IIDataType> integral_images_;
   };
 
 }
@@ -47,6 +47,12 @@ namespace pcl
 {
   /**
     * \brief Surface normal estimation on dense data using integral images.
+    *
+    * The integral images and the other per pixel buffers are kept between calls, so estimating the normals 
+    * of a stream of clouds with a fixed resolution doesn't allocate after the first frame. The integral images
+    * and the normals can be computed with several threads (see setNumberOfThreads), and normals can be 
+    * estimated for a regular subset of the pixels only (see setSamplingStep).
+    *
     * \author Stefan Holzer
     */
   template <typename PointInT, typename PointOutT>
@@ -72,12 +78,11 @@ namespace pcl
       /** \brief Constructor */
       IntegralImageNormalEstimation () : 
         normal_estimation_method_(AVERAGE_3D_GRADIENT),
-        integral_image_x_(NULL), integral_image_y_(NULL), 
-        integral_image_xyz_(NULL), integral_image_(NULL),
-        diff_x_(NULL), diff_y_(NULL), depth_data_(NULL),
+        rect_width_(0), rect_height_(0),
         use_depth_dependent_smoothing_(false),
         max_depth_change_factor_(20.0f*0.001f),
         normal_smoothing_size_(10.0f),
+        sampling_step_(1), threads_(1),
         init_covariance_matrix_(false), init_average_3d_gradient_(false), init_depth_change_(false)
       {
         feature_name_ = "IntegralImagesNormalEstimation";
@@ -151,6 +156,39 @@ namespace pcl
         use_depth_dependent_smoothing_ = use_depth_dependent_smoothing;
       }
 
+      /** \brief Estimate normals only at every step-th pixel of every step-th row. The output keeps the size 
+        * and organization of the input, the normals of the skipped pixels are set to NaN. 
+        * \param step the distance in pixels between two estimated normals, 0 is the same as 1 (every pixel)
+        */
+      void
+      setSamplingStep (unsigned int step)
+      {
+        sampling_step_ = step == 0 ? 1 : step;
+      }
+
+      /** \brief Get the distance in pixels between two estimated normals. */
+      unsigned int
+      getSamplingStep () const
+      {
+        return (sampling_step_);
+      }
+
+      /** \brief Set the number of threads used to compute the integral images and the normals.
+        * \param nr_threads the number of threads, 0 is the same as 1
+        */
+      void
+      setNumberOfThreads (unsigned int nr_threads)
+      {
+        threads_ = nr_threads == 0 ? 1 : nr_threads;
+      }
+
+      /** \brief Get the number of threads used to compute the integral images and the normals. */
+      unsigned int
+      getNumberOfThreads () const
+      {
+        return (threads_);
+      }
+
        /** \brief Provide a pointer to the input dataset (overwrites the PCLBase::setInputCloud method)
         * \param cloud the const boost shared pointer to a PointCloud message
         */
@@ -159,10 +197,8 @@ namespace pcl
       { 
         input_ = cloud; 
 
+        // the data structures are (re)computed on demand, reusing the memory of the previous cloud
         init_covariance_matrix_ = init_average_3d_gradient_ = init_depth_change_ = false;
-
-        // Initialize the correct data structure based on the normal estimation method chosen 
-        initData ();
       }
 
     protected:
@@ -177,6 +213,42 @@ namespace pcl
         */
       void 
       initData ();
+
+      /** \brief Computes the normal at the specified position with the given region size. Unlike 
+        * computePointNormal this neither modifies the estimator nor initializes the data structures, so it
+        * can be called from several threads once initData () was called.
+        * \param pos_x x position (pixel)
+        * \param pos_y y position (pixel)
+        * \param rect_width the width of the search rectangle
+        * \param rect_height the height of the search rectangle
+        * \param normal the output estimated normal 
+        */
+      void
+      computePointNormalInRect (const int pos_x, const int pos_y, const int rect_width, const int rect_height, 
+                                PointOutT &normal) const;
+
+      /** \brief Returns true if the depth jump between two neighboring pixels is a discontinuity. 
+        * \param depth the depth of the first pixel, which determines the threshold
+        * \param other_depth the depth of the second pixel
+        */
+      inline bool
+      isDepthChange (const float depth, const float other_depth) const
+      {
+        const float depthDependendDepthChange = (max_depth_change_factor_ * (fabs (depth)+1.0f))/(500.0f*0.001f);
+        return (fabs (depth - other_depth) > depthDependendDepthChange || !pcl_isfinite (depth) || !pcl_isfinite (other_depth));
+      }
+
+      /** \brief Computes one row of depth_change_map_: a pixel is 0 if the depth changes too much towards 
+        * one of its neighbors, 255 otherwise. 
+        * \param ri the row to compute
+        */
+      void
+      computeDepthChangeMap (const int ri);
+
+      /** \brief Computes distance_map_, the (approximate) distance of each pixel to the closest depth 
+        * discontinuity in depth_change_map_. */
+      void
+      computeDistanceMap ();
       
     private:
       /** \brief The normal estimation method to use. Currently, 3 implementations are provided:
@@ -196,21 +268,23 @@ namespace pcl
       float distance_threshold_;
 
       /** integral image in x-direction */
-      IntegralImage2D<float, double> *integral_image_x_;
+      IntegralImage2D<float, double> integral_image_x_;
       /** integral image in y-direction */
-      IntegralImage2D<float, double> *integral_image_y_;
+      IntegralImage2D<float, double> integral_image_y_;
       /** integral image xyz */
-      IntegralImage2D<float, double> *integral_image_xyz_;
+      IntegralImage2D<float, double> integral_image_xyz_;
       /** integral image */
-      IntegralImage2D<float, double> *integral_image_;
+      IntegralImage2D<float, double> integral_image_;
 
       /** derivatives in x-direction */
-      float *diff_x_;
+      std::vector<float> diff_x_;
       /** derivatives in y-direction */
-      float *diff_y_;
+      std::vector<float> diff_y_;
 
-      /** depth data */
-      float *depth_data_;
+      /** 0 at depth discontinuities, 255 elsewhere */
+      std::vector<unsigned char> depth_change_map_;
+      /** distance of each pixel to the closest depth discontinuity */
+      std::vector<float> distance_map_;
 
       /** \brief Smooth data based on depth (true/false). */
       bool use_depth_dependent_smoothing_;
@@ -221,6 +295,12 @@ namespace pcl
       /** \brief */
       float normal_smoothing_size_;
 
+      /** \brief Distance in pixels between two estimated normals. */
+      unsigned int sampling_step_;
+
+      /** \brief The number of threads used to compute the integral images and the normals. */
+      unsigned int threads_;
+
       /** \brief True when a dataset has been received and the covariance_matrix data has been initialized. */
       bool init_covariance_matrix_;
       
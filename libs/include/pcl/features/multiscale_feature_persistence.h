@@ -42,6 +42,7 @@
 #include <pcl/features/feature.h>
 #include <pcl/point_representation.h>
 #include <pcl/common/norms.h>
+#include <pcl/kdtree/neighborhood_cache.h>
 #include <list>
 
 namespace pcl
@@ -56,6 +57,10 @@ namespace pcl
    *    Proceedings of the 10th International Conference on Intelligent Autonomous Systems (IAS-10)
    *    2008, Baden-Baden, Germany
    *
+   * The neighborhoods of all the scales come from one radius search at the largest scale (see NeighborhoodCache),
+   * and when the feature estimator is given with its own type the scales are computed in parallel, each by a
+   * copy of the estimator (see setFeatureEstimator () and setNumberOfThreads ()).
+   *
    * \author Alexandru-Eugen Ichim
    */
   template <typename PointSource, typename PointFeature>
@@ -99,9 +104,28 @@ namespace pcl
        * \param feature_estimator pointer to the feature estimator instance that will be used
        * \note the feature estimator instance should already have the input data given beforehand
        * and everything set, ready to be given the compute () command
+       * \note the estimator can't be copied through a pointer to the base class, so the scales are computed one
+       * after the other; give a pointer to the estimator's own type to compute them in parallel
        */
       inline void
-      setFeatureEstimator (FeatureEstimatorPtr feature_estimator) { feature_estimator_ = feature_estimator; };
+      setFeatureEstimator (FeatureEstimatorPtr feature_estimator)
+      {
+        feature_estimator_ = feature_estimator;
+        copy_feature_estimator_ = NULL;
+      }
+
+      /** \brief Setter method for the feature estimator, which is copied once per scale so that the scales can
+       * be computed in parallel
+       * \param feature_estimator pointer to the feature estimator instance that will be used
+       * \note the feature estimator instance should already have the input data given beforehand
+       * and everything set, ready to be given the compute () command
+       */
+      template <typename FeatureEstimatorT> inline void
+      setFeatureEstimator (const boost::shared_ptr<FeatureEstimatorT> &feature_estimator)
+      {
+        feature_estimator_ = feature_estimator;
+        copy_feature_estimator_ = &copyFeatureEstimator<FeatureEstimatorT>;
+      }
 
       /** \brief Getter method for the feature estimator */
       inline FeatureEstimatorPtr
@@ -137,6 +161,16 @@ namespace pcl
       inline NormType
       getDistanceMetric () { return distance_metric_; }
 
+      /** \brief Set the number of threads the scales are computed in.
+       * \param nr_threads the number of hardware threads to use (0 sets the value back to 1)
+       */
+      inline void
+      setNumberOfThreads (unsigned int nr_threads) { threads_ = (nr_threads == 0) ? 1 : nr_threads; }
+
+      /** \brief Get the number of threads the scales are computed in. */
+      inline unsigned int
+      getNumberOfThreads () { return threads_; }
+
 
     protected:
       /** \brief Checks if all the necessary input was given and the computations can successfully start */
@@ -144,11 +178,23 @@ namespace pcl
       initCompute ();
 
     private:
-      /** \brief Method to compute the features for the point cloud at the given scale */
+      /** \brief Method to compute the features for the point cloud at the given scale
+       * \param scale the search radius
+       * \param feature_estimator the estimator to compute the features with
+       * \param features the resultant features
+       */
       virtual void
       computeFeatureAtScale (float &scale,
+                             const FeatureEstimatorPtr &feature_estimator,
                              FeatureCloudPtr &features);
 
+      /** \brief Copy a feature estimator through a pointer to its base class */
+      template <typename FeatureEstimatorT> static FeatureEstimatorPtr
+      copyFeatureEstimator (const FeatureEstimatorPtr &feature_estimator)
+      {
+        return FeatureEstimatorPtr (new FeatureEstimatorT (static_cast<const FeatureEstimatorT&> (*feature_estimator)));
+      }
+
 
       /** \brief Function that calculates the scalar difference between two features
        * \return the difference as a floating point type
@@ -182,6 +228,12 @@ namespace pcl
       /** \brief the feature estimator that will be used to determine the feature set at each scale level */
       FeatureEstimatorPtr feature_estimator_;
 
+      /** \brief copies the feature estimator for every scale, NULL if its type is not known */
+      FeatureEstimatorPtr (*copy_feature_estimator_) (const FeatureEstimatorPtr &);
+
+      /** \brief the number of threads the scales are computed in */
+      unsigned int threads_;
+
       std::vector<FeatureCloudPtr> features_at_scale;
       std::vector<std::vector<std::vector<float> > > features_at_scale_vectorized;
       std::vector<float> mean_feature;
@@ -179,6 +179,10 @@ namespace pcl
     *
     * @note The code is stateful as we do not expect this class to be multicore parallelized. Please look at
     * \ref NormalEstimationOMP for a parallel implementation.
+    *
+    * For coarse normals of large clouds see setApproximationLeafSize (): instead of searching the neighbors of
+    * every point, the first and second order moments of the points are accumulated once per voxel, and the
+    * covariance of a point is taken from the 3x3x3 voxels around its own.
     * \author Radu Bogdan Rusu
     * \ingroup features
     */
@@ -195,10 +199,11 @@ namespace pcl
       using Feature<PointInT, PointOutT>::search_radius_;
       using Feature<PointInT, PointOutT>::search_parameter_;
 
+      typedef typename Feature<PointInT, PointOutT>::PointCloudIn  PointCloudIn;
       typedef typename Feature<PointInT, PointOutT>::PointCloudOut PointCloudOut;
 
       /** \brief Empty constructor. */
-      NormalEstimation () : vpx_ (0), vpy_ (0), vpz_ (0) 
+      NormalEstimation () : neighbor_cache_ (), approximation_leaf_size_ (0), vpx_ (0), vpy_ (0), vpz_ (0) 
       {
         feature_name_ = "NormalEstimation";
       };
@@ -284,7 +289,53 @@ namespace pcl
         vpz = vpz_;
       }
 
+      /** \brief Share a neighbor list with other stages (e.g. FPFHEstimation). It is used when the input cloud
+        * is the search surface and the neighbors are searched by k. If it holds at least k neighbors of the input
+        * cloud for every input index, no search is done. Otherwise the neighbors are searched as usual and
+        * stored in it, for the next stages to use. NormalEstimationOMP doesn't use it.
+        * \param neighbors the neighbor list, NULL to disable
+        */
+      inline void
+      setNeighborCache (const KNeighborList::Ptr &neighbors)
+      {
+        neighbor_cache_ = neighbors;
+      }
+
+      /** \brief Get the shared neighbor list. */
+      inline KNeighborList::Ptr
+      getNeighborCache ()
+      {
+        return (neighbor_cache_);
+      }
+
+      /** \brief Estimate approximate normals from voxel moments instead of searching the neighbors of every point.
+        * The surface is divided into cubic voxels of the given size, which keep the number of points, their sum
+        * and the sum of their outer products. The normal and curvature of a point come from the covariance of
+        * all the points in the 3x3x3 voxels around the voxel it falls in, so points of the same voxel share them
+        * (up to the orientation towards the viewpoint), and neither a search method nor K / a radius are used.
+        * Points with less than 3 surface points in their 27 voxels get NaN normals.
+        * \param leaf_size the voxel size, the neighborhoods are cubes of 3 times this size. 0 (the default)
+        * disables the approximation.
+        */
+      inline void
+      setApproximationLeafSize (float leaf_size)
+      {
+        approximation_leaf_size_ = leaf_size;
+      }
+
+      /** \brief Get the voxel size used to approximate the normals, 0 if they are computed exactly. */
+      inline float
+      getApproximationLeafSize () const
+      {
+        return (approximation_leaf_size_);
+      }
+
     protected:
+      /** \brief Same as Feature::initCompute (), except that neither a search method nor a surface are set up
+        * for the voxel based approximation. */
+      virtual bool
+      initCompute ();
+
       /** \brief Estimate normals for all points given in <setInputCloud (), setIndices ()> using the surface in
         * setSearchSurface () and the spatial locator in setSearchMethod ()
         * \note In situations where not enough neighbors are found, the normal and curvature values are set to -1.
@@ -292,6 +343,20 @@ namespace pcl
         */
       void computeFeature (PointCloudOut &output);
 
+      /** \brief Estimate normals for all points from the moments of the voxels of the surface, see 
+        * setApproximationLeafSize ().
+        * \param output the resultant point cloud model dataset that contains surface normals and curvatures
+        * \param nr_threads the number of threads solving the voxel neighborhoods
+        */
+      void 
+      computeApproximateFeature (PointCloudOut &output, unsigned int nr_threads);
+
+      /** \brief The neighbor list shared with other stages, if any. */
+      KNeighborList::Ptr neighbor_cache_;
+
+      /** \brief The voxel size of the approximate normals, 0 for exact normals. */
+      float approximation_leaf_size_;
+
     private:
       /** \brief Values describing the viewpoint ("pinhole" camera model assumed). For per point viewpoints, inherit
         * from NormalEstimation and provide your own computeFeature (). By default, the viewpoint is set to 0,0,0. */
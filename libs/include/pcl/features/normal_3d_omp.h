@@ -43,7 +43,8 @@
 namespace pcl
 {
   /** \brief @b NormalEstimationOMP estimates local surface properties at each 3D point, such as surface normals and
-    * curvatures, in parallel, using the OpenMP standard.
+    * curvatures, in parallel, using the OpenMP standard. The voxel based approximation 
+    * (see NormalEstimation::setApproximationLeafSize) is parallelized as well.
     * \author Radu Bogdan Rusu
     * \ingroup features
     */
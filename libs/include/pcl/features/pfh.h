@@ -79,8 +79,11 @@ namespace pcl
     * </li>
     * </ul>
     *
-    * @note The code is stateful as we do not expect this class to be multicore parallelized. Please look at
-    * \ref FPFHEstimationOMP for examples on parallel implementations of the FPFH (Fast Point Feature Histogram).
+    * Every pair of neighbors is evaluated once for both of its orderings. Neighboring query points share
+    * most of their neighbors, so with \a setUseInternalCache the histogram bins of the pairs are kept in a
+    * bounded cache and looked up instead of computed again. With \a setNumberOfThreads the query points are
+    * split into contiguous ranges, each thread with a cache of its own.
+    *
     * \author Radu Bogdan Rusu
     * \ingroup features
     */
@@ -100,11 +103,65 @@ namespace pcl
       typedef typename Feature<PointInT, PointOutT>::PointCloudIn  PointCloudIn;
 
       /** \brief Empty constructor. */
-      PFHEstimation () : nr_subdiv_ (5), d_pi_ (1.0 / (2.0 * M_PI))
+      PFHEstimation () : nr_subdiv_ (5), d_pi_ (1.0 / (2.0 * M_PI)), use_cache_ (false),
+                         max_cache_size_ (1 << 20), threads_ (1)
       {
         feature_name_ = "PFHEstimation";
       };
 
+      /** \brief Set whether the histogram bins of the point pairs are cached, so the pairs shared by
+        * overlapping neighborhoods are only evaluated once. The cache is cleared at every compute ().
+        * \param use_cache true to use the cache (default: false)
+        */
+      inline void
+      setUseInternalCache (bool use_cache)
+      {
+        use_cache_ = use_cache;
+      }
+
+      /** \brief Get whether the histogram bins of the point pairs are cached. */
+      inline bool
+      getUseInternalCache ()
+      {
+        return (use_cache_);
+      }
+
+      /** \brief Set the maximum number of point pairs the cache holds, all threads together. A pair
+        * takes 16 bytes. The cache is direct mapped, a new pair replaces the one in its slot.
+        * \param cache_size the maximum number of cached pairs (default: 2^20, i.e. 16MB)
+        */
+      inline void
+      setMaximumCacheSize (unsigned int cache_size)
+      {
+        max_cache_size_ = cache_size;
+      }
+
+      /** \brief Get the maximum number of point pairs the cache holds. */
+      inline unsigned int
+      getMaximumCacheSize ()
+      {
+        return (max_cache_size_);
+      }
+
+      /** \brief Set the number of threads to use. Every thread computes the signatures of a
+        * contiguous range of the input indices.
+        * \param nr_threads the number of hardware threads to use (0 is treated as 1)
+        */
+      inline void
+      setNumberOfThreads (unsigned int nr_threads)
+      {
+        if (nr_threads == 0)
+          nr_threads = 1;
+        threads_ = nr_threads;
+      }
+
+      /** \brief Get the number of threads to use. */
+      inline unsigned int
+      getNumberOfThreads ()
+      {
+        return (threads_);
+      }
+
       /** \brief Compute the 4-tuple representation containing the three angles and one distance between two points
         * represented by Cartesian coordinates and normals.
         * \note For explanations about the features, please see the literature mentioned above (the order of the
@@ -135,6 +192,14 @@ namespace pcl
                                 const std::vector<int> &indices, int nr_split, Eigen::VectorXf &pfh_histogram);
 
     protected:
+      /** \brief One slot of the pair cache: the histogram bins of the pairs (p_idx, q_idx) and
+        * (q_idx, p_idx), with p_idx < q_idx. A bin of -1 marks a pair without features.
+        */
+      struct PairBins
+      {
+        int p_idx, q_idx;
+        int bin_pq, bin_qp;
+      };
 
       /** \brief Estimate the Point Feature Histograms (PFH) descriptors at a set of points given by
         * <setInputCloud (), setIndices ()> using the surface in setSearchSurface () and the spatial locator in
@@ -144,21 +209,79 @@ namespace pcl
       void 
       computeFeature (PointCloudOut &output);
 
+      /** \brief Estimate the PFH signature of a neighborhood, looking the pairs up in a cache.
+        * \param cloud the dataset containing the XYZ Cartesian coordinates of the two points
+        * \param normals the dataset containing the surface normals at each point in \a cloud
+        * \param indices the k-neighborhood point indices in the dataset
+        * \param nr_split the number of subdivisions for each angular feature interval
+        * \param pfh_histogram the resultant (combinatorial) PFH histogram representing the feature at the query point
+        * \param cache the pair cache (its size a power of two), or NULL
+        */
+      void
+      computePointPFHSignature (const pcl::PointCloud<PointInT> &cloud, const pcl::PointCloud<PointNT> &normals,
+                                const std::vector<int> &indices, int nr_split, Eigen::VectorXf &pfh_histogram,
+                                std::vector<PairBins> *cache);
+
+      /** \brief Compute the histogram bins of both orderings of a pair of points. The two share the
+        * distance and the dot and cross products of the normals and the difference vector, so this
+        * is about as expensive as one call to computePairFeatures.
+        * \param cloud the dataset containing the XYZ Cartesian coordinates of the two points
+        * \param normals the dataset containing the surface normals at each point in \a cloud
+        * \param p_idx the index of the first point
+        * \param q_idx the index of the second point
+        * \param nr_split the number of subdivisions for each angular feature interval
+        * \param bin_pq the resultant bin of the pair (p_idx, q_idx), -1 if it has no features
+        * \param bin_qp the resultant bin of the pair (q_idx, p_idx), -1 if it has no features
+        */
+      void
+      computePairBins (const pcl::PointCloud<PointInT> &cloud, const pcl::PointCloud<PointNT> &normals,
+                       int p_idx, int q_idx, int nr_split, int &bin_pq, int &bin_qp);
+
+      /** \brief Get the histogram bin of the three angular features of a pair.
+        * \param f1 the first angular feature
+        * \param f2 the second angular feature
+        * \param f3 the third angular feature
+        * \param nr_split the number of subdivisions for each angular feature interval
+        */
+      inline int
+      computeHistogramBin (float f1, float f2, float f3, int nr_split)
+      {
+        int f_index[3];
+
+        // Normalize the f1, f2, f3 features
+        f_index[0] = floor (nr_split * ((f1 + M_PI) * d_pi_));
+        if (f_index[0] < 0)         f_index[0] = 0;
+        if (f_index[0] >= nr_split) f_index[0] = nr_split - 1;
+
+        f_index[1] = floor (nr_split * ((f2 + 1.0) * 0.5));
+        if (f_index[1] < 0)         f_index[1] = 0;
+        if (f_index[1] >= nr_split) f_index[1] = nr_split - 1;
+
+        f_index[2] = floor (nr_split * ((f3 + 1.0) * 0.5));
+        if (f_index[2] < 0)         f_index[2] = 0;
+        if (f_index[2] >= nr_split) f_index[2] = nr_split - 1;
+
+        return (f_index[0] + nr_split * (f_index[1] + nr_split * f_index[2]));
+      }
+
     private:
       /** \brief The number of subdivisions for each angular feature interval. */
       int nr_subdiv_;
 
-      /** \brief Placeholder for a point's PFH signature. */
-      Eigen::VectorXf pfh_histogram_;
+      /** \brief Float constant = 1.0 / (2.0 * M_PI) */
+      float d_pi_; 
 
-      /** \brief Placeholder for a PFH 4-tuple. */
-      Eigen::Vector4f pfh_tuple_;
+      /** \brief True if the histogram bins of the point pairs are cached. */
+      bool use_cache_;
 
-      /** \brief Placeholder for a histogram index. */
-      int f_index_[3];
+      /** \brief The maximum number of cached point pairs, all threads together. */
+      unsigned int max_cache_size_;
 
-      /** \brief Float constant = 1.0 / (2.0 * M_PI) */
-      float d_pi_; 
+      /** \brief The number of threads to use. */
+      unsigned int threads_;
+
+      /** \brief The pair cache of every thread. */
+      std::vector<std::vector<PairBins> > caches_;
   };
 }
 
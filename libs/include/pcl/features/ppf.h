@@ -40,6 +40,8 @@
 
 #include <pcl/features/feature.h>
 #include <boost/unordered_map.hpp>
+#include <boost/shared_ptr.hpp>
+#include <Eigen/Geometry>
 
 namespace pcl
 {
@@ -48,6 +50,27 @@ namespace pcl
                          const Eigen::Vector4f &p2, const Eigen::Vector4f &n2,
                          float &f1, float &f2, float &f3, float &f4);
 
+  /** \brief Compute the transformation that moves a point to the origin and rotates its normal onto the X axis. The
+    * alpha angle of the point pair features is measured in this frame.
+    * \param point the reference point
+    * \param normal the normal of the reference point
+    */
+  PCL_EXPORTS Eigen::Affine3f
+  computePPFReferenceTransform (const Eigen::Vector3f &point, const Eigen::Vector3f &normal);
+
+  /** \brief Compute the alpha angle of a point pair: the rotation around the X axis of the reference frame that
+    * brings the second point into the half plane (y > 0, z = 0). Two pairs with the same features are aligned by
+    * moving them into their reference frames and rotating the model one by alpha_m - alpha_s.
+    * \param reference_transform the transformation given by computePPFReferenceTransform for the first point
+    * \param point the second point
+    */
+  inline float
+  computePPFAlpha (const Eigen::Affine3f &reference_transform, const Eigen::Vector3f &point)
+  {
+    Eigen::Vector3f p = reference_transform * point;
+    return (atan2f (-p[2], p[1]));
+  }
+
 
   /** \brief Class that calculates the "surflet" features for each pair in the given
     * pointcloud. Please refer to the following publication for more details:
@@ -58,7 +81,7 @@ namespace pcl
     *
     * PointOutT is meant to be pcl::PPFSignature - contains the 4 values of the Surflet
     * feature and in addition, alpha_m for the respective pair - optimization proposed by
-    * the authors (see above)
+    * the authors (see above). alpha_m is given by computePPFAlpha.
     *
     * \author Alexandru-Eugen Ichim
     */
@@ -89,6 +112,143 @@ namespace pcl
       void
       computeFeature (PointCloudOut &output);
   };
+
+  /** \brief @b PPFHashMapSearch is the model library of the point pair feature recognition of Drost et al. (see
+    * PPFEstimation): every pair of model points is stored under its quantized features together with its first
+    * point and its alpha_m angle, so that a scene pair finds all the similar model pairs with one lookup.
+    *
+    * The library is one flat block of memory: a header, an open addressing hash table and the pairs sorted by key.
+    * It is built offline from the output of PPFEstimation, written to disk with saveModel () and loaded with
+    * loadModel (), which maps the file into memory instead of reading it by default. Files are in the byte order of
+    * the machine that wrote them. Copies of a PPFHashMapSearch share the same memory, and lookups don't modify it,
+    * so one library can be searched from several threads.
+    *
+    * PPFRegistration (pcl/registration/ppf_registration.h) uses it to vote for the 6-DoF poses of the model in a
+    * scene.
+    * \ingroup features
+    */
+  class PCL_EXPORTS PPFHashMapSearch
+  {
+    public:
+      typedef boost::shared_ptr<PPFHashMapSearch> Ptr;
+      typedef boost::shared_ptr<const PPFHashMapSearch> ConstPtr;
+
+      /** \brief A model pair: the index of its first point (the reference point) and its alpha_m angle. */
+      struct Entry
+      {
+        pcl::uint32_t model_reference;
+        float alpha;
+      };
+
+      /** \brief Constructor.
+        * \param angle_discretization_step the quantization step of the three angles of the features, in radians
+        * \param distance_discretization_step the quantization step of the distance between the points of a pair
+        */
+      PPFHashMapSearch (float angle_discretization_step = 12.0f / 180.0f * (float)M_PI,
+                        float distance_discretization_step = 0.01f);
+
+      /** \brief Build the library from the point pair features of a model.
+        * \param feature_cloud the output of PPFEstimation for all the points of the model: n * n features, the one
+        * of the pair (i, j) at i * n + j
+        */
+      void
+      setInputFeatureCloud (const PointCloud<PPFSignature>::ConstPtr &feature_cloud);
+
+      /** \brief Find the model pairs whose quantized features are the ones of the given pair.
+        * \param f1 the angle of the second normal around the first one (as given by computePairFeatures)
+        * \param f2 the cosine of the angle between the second normal and the Darboux frame
+        * \param f3 the cosine of the angle between the first normal and the pair direction
+        * \param f4 the distance between the points
+        * \param entries set to the first of the matching model pairs
+        * \return the number of matching model pairs
+        */
+      int
+      nearestNeighborSearch (float f1, float f2, float f3, float f4, const Entry *&entries) const;
+
+      /** \brief Write the library to a file.
+        * \param file_name the name of the file
+        * \return 0 on success, -1 on error
+        */
+      int
+      saveModel (const std::string &file_name) const;
+
+      /** \brief Load a library written by saveModel, replacing the current one.
+        * \param file_name the name of the file
+        * \param memory_map map the file into memory (the default) instead of reading it
+        * \return 0 on success, -1 on error
+        */
+      int
+      loadModel (const std::string &file_name, bool memory_map = true);
+
+      /** \brief Get the quantization step of the angles. */
+      inline float
+      getAngleDiscretizationStep () const { return (header_ ? header_->angle_discretization_step : angle_discretization_step_); }
+
+      /** \brief Get the quantization step of the distances. */
+      inline float
+      getDistanceDiscretizationStep () const { return (header_ ? header_->distance_discretization_step : distance_discretization_step_); }
+
+      /** \brief Get the number of points of the model. */
+      inline unsigned int
+      getNumberOfModelPoints () const { return (header_ ? header_->nr_model_points : 0); }
+
+      /** \brief Get the largest distance between two points of the model. */
+      inline float
+      getModelDiameter () const { return (header_ ? header_->max_distance : 0.0f); }
+
+      /** \brief Get the number of model pairs in the library. */
+      inline size_t
+      size () const { return (header_ ? (size_t)header_->nr_entries : 0); }
+
+    private:
+      /** \brief The layout of the start of the library. */
+      struct Header
+      {
+        char magic[8];
+        pcl::uint32_t version;
+        pcl::uint32_t nr_model_points;
+        float angle_discretization_step;
+        float distance_discretization_step;
+        float max_distance;
+        pcl::uint32_t nr_slots;
+        pcl::uint64_t nr_entries;
+      };
+
+      /** \brief A slot of the hash table: the key and the range of its pairs. Empty slots have no pairs. */
+      struct Slot
+      {
+        pcl::uint64_t key;
+        pcl::uint32_t begin;
+        pcl::uint32_t count;
+      };
+
+      /** \brief Quantize the features of a pair into a key.
+        * \return false if the pair is farther apart than the quantization allows
+        */
+      bool
+      computeKey (float f1, float f2, float f3, float f4, pcl::uint64_t &key) const;
+
+      /** \brief Check the header of a library and set up the pointers into it.
+        * \param data the library
+        * \param size the size of the library in bytes
+        */
+      bool
+      setData (const boost::shared_ptr<char> &data, size_t size);
+
+      /** \brief The quantization steps of a library that is not built yet. */
+      float angle_discretization_step_, distance_discretization_step_;
+
+      /** \brief The library, allocated or mapped. */
+      boost::shared_ptr<char> data_;
+
+      /** \brief The size of the library in bytes. */
+      size_t data_size_;
+
+      /** \brief Pointers into data_. */
+      const Header *header_;
+      const Slot *slots_;
+      const Entry *entries_;
+  };
 }
 
 #endif // PCL_PPF_H_
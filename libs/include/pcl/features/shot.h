@@ -60,6 +60,9 @@ namespace pcl
     * </li>
     * </ul>
     *
+    * The descriptors are computed in parallel (see setNumberOfThreads ()). Every thread reuses its own
+    * histogram, reference frame and bin buffers, so no memory is allocated per point.
+    *
     * \author Samuele Salti, Federico Tombari
     * \ingroup features
     */
@@ -86,7 +89,8 @@ namespace pcl
         rf_ (3),                    // Initialize the placeholder for the point's RF
         nr_grid_sector_ (32),
         maxAngularSectors_ (28),
-        descLength_ (0)
+        descLength_ (0),
+        threads_ (1)
       {
         feature_name_ = "SHOTEstimation";
       };
@@ -110,6 +114,24 @@ namespace pcl
                         Eigen::VectorXf &shot,
                         std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > &rf) = 0;
 
+      /** \brief Set the number of threads to use.
+        * \param nr_threads the number of threads to use (0 sets it back to 1)
+        */
+      inline void
+      setNumberOfThreads (unsigned int nr_threads)
+      {
+        if (nr_threads == 0)
+          nr_threads = 1;
+        threads_ = nr_threads;
+      }
+
+      /** \brief Get the number of threads to use. */
+      inline unsigned int
+      getNumberOfThreads ()
+      {
+        return (threads_);
+      }
+
       /** \brief
         */
       float 
@@ -130,6 +152,27 @@ namespace pcl
       void 
       computeFeature (PointCloudOut &output);
 
+      /** \brief Estimate the SHOT descriptors of all the points, in parallel, once \a descLength_ is set.
+        * Points with less than 5 neighbors get a NaN descriptor.
+        * \param output the resultant point cloud model dataset that contains the SHOT feature estimates
+        */
+      void
+      computeDescriptors (PointCloudOut &output);
+
+      /** \brief Estimate the SHOT descriptor for a given point, using the given buffers for the bin distances
+        * of the neighbors, which are grown as needed and can be reused from point to point.
+        */
+      virtual void
+      computePointSHOT (const pcl::PointCloud<PointInT> &cloud,
+                        const pcl::PointCloud<PointNT> &normals,
+                        const int index,
+                        const std::vector<int> &indices,
+                        const std::vector<float> &dists,
+                        Eigen::VectorXf &shot,
+                        std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > &rf,
+                        std::vector<double> &bin_distance_shape,
+                        std::vector<double> &bin_distance_color) = 0;
+
       void 
       interpolateSingleChannel (const pcl::PointCloud<PointInT> &cloud, 
                                 const std::vector<int> &indices,
@@ -173,6 +216,9 @@ namespace pcl
 
       /** \brief One SHOT length. */
       int descLength_;
+
+      /** \brief The number of threads to use. */
+      unsigned int threads_;
   };
 
   /** \brief @b SHOTEstimation estimates the Signature of Histograms of OrienTations (SHOT) descriptor for 
@@ -220,6 +266,7 @@ namespace pcl
       using SHOTEstimationBase<PointInT, PointNT, PointOutT>::maxAngularSectors_;
       using SHOTEstimationBase<PointInT, PointNT, PointOutT>::interpolateSingleChannel;
       using SHOTEstimationBase<PointInT, PointNT, PointOutT>::shot_;
+      using SHOTEstimationBase<PointInT, PointNT, PointOutT>::getSHOTLocalRF;
 
       typedef typename Feature<PointInT, PointOutT>::PointCloudOut PointCloudOut;
       typedef typename Feature<PointInT, PointOutT>::PointCloudIn PointCloudIn;
@@ -245,7 +292,23 @@ namespace pcl
                         const std::vector<int> &indices, 
                         const std::vector<float> &dists, 
                         Eigen::VectorXf &shot,
-                        std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > &rf);
+                        std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > &rf)
+      {
+        std::vector<double> bin_distance_shape, bin_distance_color;
+        computePointSHOT (cloud, normals, index, indices, dists, shot, rf, bin_distance_shape, bin_distance_color);
+      }
+
+    protected:
+      void
+      computePointSHOT (const pcl::PointCloud<PointInT> &cloud,
+                        const pcl::PointCloud<PointNT> &normals,
+                        const int index,
+                        const std::vector<int> &indices,
+                        const std::vector<float> &dists,
+                        Eigen::VectorXf &shot,
+                        std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > &rf,
+                        std::vector<double> &bin_distance_shape,
+                        std::vector<double> &bin_distance_color);
   };
 
   /** \brief @b SHOTEstimation estimates the Signature of Histograms of OrienTations (SHOT) descriptor for a given point cloud dataset
@@ -293,6 +356,8 @@ namespace pcl
       using SHOTEstimationBase<pcl::PointXYZRGBA, PointNT, PointOutT>::maxAngularSectors_;
       using SHOTEstimationBase<pcl::PointXYZRGBA, PointNT, PointOutT>::interpolateSingleChannel;
       using SHOTEstimationBase<pcl::PointXYZRGBA, PointNT, PointOutT>::shot_;
+      using SHOTEstimationBase<pcl::PointXYZRGBA, PointNT, PointOutT>::getSHOTLocalRF;
+      using SHOTEstimationBase<pcl::PointXYZRGBA, PointNT, PointOutT>::computeDescriptors;
 
       typedef typename Feature<pcl::PointXYZRGBA, PointOutT>::PointCloudOut PointCloudOut;
       typedef typename Feature<pcl::PointXYZRGBA, PointOutT>::PointCloudIn PointCloudIn;
@@ -325,9 +390,24 @@ namespace pcl
                         const std::vector<int> &indices, 
                         const std::vector<float> &dists, 
                         Eigen::VectorXf &shot,
-                        std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > &rf);
+                        std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > &rf)
+      {
+        std::vector<double> bin_distance_shape, bin_distance_color;
+        computePointSHOT (cloud, normals, index, indices, dists, shot, rf, bin_distance_shape, bin_distance_color);
+      }
 
     protected:
+      void
+      computePointSHOT (const pcl::PointCloud<pcl::PointXYZRGBA> &cloud,
+                        const pcl::PointCloud<PointNT> &normals,
+                        const int index,
+                        const std::vector<int> &indices,
+                        const std::vector<float> &dists,
+                        Eigen::VectorXf &shot,
+                        std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > &rf,
+                        std::vector<double> &bin_distance_shape,
+                        std::vector<double> &bin_distance_color);
+
 
       /** \brief Estimate the Signatures of Histograms of OrienTations (SHOT) descriptors at a set of points given by
         * <setInputCloud (), setIndices ()> using the surface in setSearchSurface () and the spatial locator in
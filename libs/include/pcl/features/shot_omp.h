@@ -61,6 +61,7 @@ namespace pcl
     * </li>
     * </ul>
     *
+    * \note SHOTEstimation is parallel itself, this class only sets its number of threads at construction.
     * \author Samuele Salti
     * \ingroup features
     */
@@ -69,56 +70,18 @@ namespace pcl
   class SHOTEstimationOMP : public SHOTEstimation<PointInT, PointNT, PointOutT>
   {
     public:
-      using Feature<PointInT, PointOutT>::feature_name_;
-      using Feature<PointInT, PointOutT>::getClassName;
-      using Feature<PointInT, PointOutT>::indices_;
-      using Feature<PointInT, PointOutT>::k_;
-      using Feature<PointInT, PointOutT>::search_parameter_;
-      using Feature<PointInT, PointOutT>::search_radius_;
-      using Feature<PointInT, PointOutT>::surface_;
-      using FeatureFromNormals<PointInT, PointNT, PointOutT>::normals_;
-      using SHOTEstimation<PointInT, PointNT, PointOutT>::descLength_;
-      using SHOTEstimation<PointInT, PointNT, PointOutT>::nr_grid_sector_;
-      using SHOTEstimation<PointInT, PointNT, PointOutT>::nr_shape_bins_;
-      using SHOTEstimation<PointInT, PointNT, PointOutT>::sqradius_;
-      using SHOTEstimation<PointInT, PointNT, PointOutT>::sqradius4_;
-      using SHOTEstimation<PointInT, PointNT, PointOutT>::radius3_4_;
-      using SHOTEstimation<PointInT, PointNT, PointOutT>::radius1_4_;
-      using SHOTEstimation<PointInT, PointNT, PointOutT>::radius1_2_;
-      using SHOTEstimation<PointInT, PointNT, PointOutT>::rf_;
+      using SHOTEstimation<PointInT, PointNT, PointOutT>::setNumberOfThreads;
 
       typedef typename Feature<PointInT, PointOutT>::PointCloudOut PointCloudOut;
       typedef typename Feature<PointInT, PointOutT>::PointCloudIn PointCloudIn;
 
-      /** \brief Empty constructor. */
-      SHOTEstimationOMP (unsigned int nr_threads = - 1) : SHOTEstimation<PointInT, PointNT, PointOutT> ()
-      {
-        setNumberOfThreads (nr_threads);
-      }
-
-      /** \brief Initialize the scheduler and set the number of threads to use.
-        * \param nr_threads the number of hardware threads to use (-1 sets the value back to automatic)
+      /** \brief Empty constructor.
+        * \param nr_threads the number of threads to use (0 sets it to 1)
         */
-      inline void
-      setNumberOfThreads (unsigned int nr_threads)
+      SHOTEstimationOMP (unsigned int nr_threads = 1) : SHOTEstimation<PointInT, PointNT, PointOutT> ()
       {
-        if (nr_threads == 0)
-          nr_threads = 1;
-        threads_ = nr_threads;
+        setNumberOfThreads (nr_threads);
       }
-
-    protected:
-
-      /** \brief Estimate the Signatures of Histograms of OrienTations (SHOT) descriptors at a set of points given by
-        * <setInputCloud (), setIndices ()> using the surface in setSearchSurface () and the spatial locator in
-        * setSearchMethod ()
-        * \param output the resultant point cloud model dataset that contains the SHOT feature estimates
-        */
-      void 
-      computeFeature (PointCloudOut &output);
-
-      /** \brief The number of threads the scheduler should use. */
-      int threads_;
   };
 
 
@@ -126,62 +89,23 @@ namespace pcl
   class SHOTEstimationOMP<pcl::PointXYZRGBA, PointNT, PointOutT> : public SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>
   {
     public:
-      using Feature<pcl::PointXYZRGBA, PointOutT>::feature_name_;
-      using Feature<pcl::PointXYZRGBA, PointOutT>::getClassName;
-      using Feature<pcl::PointXYZRGBA, PointOutT>::indices_;
-      using Feature<pcl::PointXYZRGBA, PointOutT>::k_;
-      using Feature<pcl::PointXYZRGBA, PointOutT>::search_parameter_;
-      using Feature<pcl::PointXYZRGBA, PointOutT>::search_radius_;
-      using Feature<pcl::PointXYZRGBA, PointOutT>::surface_;
-      using FeatureFromNormals<pcl::PointXYZRGBA, PointNT, PointOutT>::normals_;
-      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::descLength_;
-      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::nr_grid_sector_;
-      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::nr_shape_bins_;
-      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::sqradius_;
-      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::sqradius4_;
-      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::radius3_4_;
-      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::radius1_4_;
-      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::radius1_2_;
-      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::rf_;
-      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::b_describe_shape_;
-      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::b_describe_color_;
-      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::nr_color_bins_;
+      using SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT>::setNumberOfThreads;
 
       typedef typename Feature<pcl::PointXYZRGBA, PointOutT>::PointCloudOut PointCloudOut;
       typedef typename Feature<pcl::PointXYZRGBA, PointOutT>::PointCloudIn PointCloudIn;
 
-      /** \brief Empty constructor. */
+      /** \brief Empty constructor.
+        * \param describeShape compute the shape descriptor
+        * \param describeColor compute the color descriptor
+        * \param nr_threads the number of threads to use (0 sets it to 1)
+        */
       SHOTEstimationOMP (bool describeShape = true, 
                          bool describeColor = false, 
-                         unsigned int nr_threads = - 1) 
+                         unsigned int nr_threads = 1) 
         : SHOTEstimation<pcl::PointXYZRGBA, PointNT, PointOutT> (describeShape, describeColor)
       {
         setNumberOfThreads (nr_threads);
       }
-
-      /** \brief Initialize the scheduler and set the number of threads to use.
-        * \param nr_threads the number of hardware threads to use (-1 sets the value back to automatic)
-        */
-      inline void
-      setNumberOfThreads (unsigned int nr_threads)
-      {
-        if (nr_threads == 0)
-          nr_threads = 1;
-        threads_ = nr_threads;
-      }
-
-    private:
-
-      /** \brief Estimate the Signatures of Histograms of OrienTations (SHOT) descriptors at a set of points given by
-        * <setInputCloud (), setIndices ()> using the surface in setSearchSurface () and the spatial locator in
-        * setSearchMethod ()
-        * \param output the resultant point cloud model dataset that contains the SHOT feature estimates
-        */
-      void 
-      computeFeature (PointCloudOut &output);
-
-      /** \brief The number of threads the scheduler should use. */
-      int threads_;
   };
 }
 
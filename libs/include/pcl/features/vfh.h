@@ -55,8 +55,8 @@ namespace pcl
    * </li>
    * </ul>
    *
-   * @note The code is stateful as we do not expect this class to be multicore parallelized. Please look at
-   * \ref FPFHEstimationOMP for examples on parallel implementations of the FPFH (Fast Point Feature Histogram).
+   * computeClusters () estimates the signatures of many clusters of the same cloud at once (e.g. all the Euclidean
+   * clusters of a frame), in parallel, without going through compute () and its kd-tree for every cluster.
    * \author Radu Bogdan Rusu
    * \ingroup features
    */
@@ -67,6 +67,7 @@ namespace pcl
     using Feature<PointInT, PointOutT>::feature_name_;
     using Feature<PointInT, PointOutT>::getClassName;
     using Feature<PointInT, PointOutT>::indices_;
+    using Feature<PointInT, PointOutT>::input_;
     using Feature<PointInT, PointOutT>::k_;
     using Feature<PointInT, PointOutT>::search_radius_;
     using Feature<PointInT, PointOutT>::surface_;
@@ -77,7 +78,7 @@ namespace pcl
     /** \brief Empty constructor. */
     VFHEstimation () :
       nr_bins_f1_ (45), nr_bins_f2_ (45), nr_bins_f3_ (45), nr_bins_f4_ (45), nr_bins_vp_ (128), vpx_ (0), vpy_ (0),
-          vpz_ (0), d_pi_ (1.0 / (2.0 * M_PI))
+          vpz_ (0), d_pi_ (1.0 / (2.0 * M_PI)), threads_ (1)
     {
       hist_f1_.setZero (nr_bins_f1_);
       hist_f2_.setZero (nr_bins_f2_);
@@ -109,6 +110,58 @@ namespace pcl
                                const pcl::PointCloud<PointInT> &cloud, const pcl::PointCloud<PointNT> &normals,
                                const std::vector<int> &indices);
 
+    /** \brief Compute the centroid and the average normal of a set of points in a single pass, or take the ones
+     * given with setCentroidToUse () and setNormalToUse () if enabled.
+     * \param cloud the dataset containing the XYZ Cartesian coordinates of the points
+     * \param normals the dataset containing the surface normals at each point in \a cloud
+     * \param indices the point indices of the set in the dataset
+     * \param xyz_centroid the resultant centroid
+     * \param normal_centroid the resultant average normal
+     */
+    void
+    computeMoments (const pcl::PointCloud<PointInT> &cloud, const pcl::PointCloud<PointNT> &normals,
+                    const std::vector<int> &indices, Eigen::Vector4f &xyz_centroid,
+                    Eigen::Vector4f &normal_centroid) const;
+
+    /** \brief Compute the VFH signature of a set of points with a given centroid and average normal. The estimator
+     * is not modified, so several signatures can be computed at the same time.
+     * \param cloud the dataset containing the XYZ Cartesian coordinates of the points
+     * \param normals the dataset containing the surface normals at each point in \a cloud
+     * \param indices the point indices of the set in the dataset
+     * \param xyz_centroid the centroid of the set
+     * \param normal_centroid the average normal of the set
+     * \param signature the resultant VFH signature
+     */
+    void
+    computeSignature (const pcl::PointCloud<PointInT> &cloud, const pcl::PointCloud<PointNT> &normals,
+                      const std::vector<int> &indices, const Eigen::Vector4f &xyz_centroid,
+                      const Eigen::Vector4f &normal_centroid, PointOutT &signature) const;
+
+    /** \brief Estimate one VFH signature for every cluster of the input cloud, in parallel. The clusters index the
+     * cloud given by setInputCloud () and the normals given by setInputNormals (). An empty cluster gets a NaN
+     * signature.
+     * \param clusters the point indices of the clusters
+     * \param output the resultant signatures, one per cluster, in the same order
+     */
+    void
+    computeClusters (const std::vector<pcl::PointIndices> &clusters, PointCloudOut &output);
+
+    /** \brief Set the number of threads used by computeClusters ().
+     * \param nr_threads the number of hardware threads to use (0 sets the value back to 1)
+     */
+    inline void
+    setNumberOfThreads (unsigned int nr_threads)
+    {
+      threads_ = (nr_threads == 0) ? 1 : nr_threads;
+    }
+
+    /** \brief Get the number of threads used by computeClusters (). */
+    inline unsigned int
+    getNumberOfThreads () const
+    {
+      return (threads_);
+    }
+
     /** \brief Set the viewpoint.
      * \param vpx the X coordinate of the viewpoint
      * \param vpy the Y coordinate of the viewpoint
@@ -207,6 +260,20 @@ namespace pcl
      * from VFHEstimation and provide your own computeFeature (). By default, the viewpoint is set to 0,0,0. */
     float vpx_, vpy_, vpz_;
 
+    /** \brief Compute the angular (f1, f2, f3) and distance (f4) histograms of a set of points, stored one after
+     * the other in \a hist.
+     * \param centroid_p the centroid point
+     * \param centroid_n the centroid normal
+     * \param cloud the dataset containing the XYZ Cartesian coordinates of the points
+     * \param normals the dataset containing the surface normals at each point in \a cloud
+     * \param indices the point indices of the set in the dataset
+     * \param hist the resultant histograms, of nr_bins_f1_ + nr_bins_f2_ + nr_bins_f3_ + nr_bins_f4_ floats
+     */
+    void
+    computePointSPFHSignature (const Eigen::Vector4f &centroid_p, const Eigen::Vector4f &centroid_n,
+                               const pcl::PointCloud<PointInT> &cloud, const pcl::PointCloud<PointNT> &normals,
+                               const std::vector<int> &indices, float *hist) const;
+
     /** \brief Estimate the Viewpoint Feature Histograms (VFH) descriptors at a set of points given by
      * <setInputCloud (), setIndices ()> using the surface in setSearchSurface () and the spatial locator in
      * setSearchMethod ()
@@ -248,6 +315,9 @@ namespace pcl
   private:
     /** \brief Float constant = 1.0 / (2.0 * M_PI) */
     float d_pi_;
+
+    /** \brief The number of threads used by computeClusters (). */
+    unsigned int threads_;
   };
 }
 
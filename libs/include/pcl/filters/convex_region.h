@@ -0,0 +1,217 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_FILTERS_CONVEX_REGION_H_
+#define PCL_FILTERS_CONVEX_REGION_H_
+
+#include <vector>
+#include <limits>
+#include <Eigen/Geometry>
+#include "pcl/filters/field_predicate.h"
+
+namespace pcl
+{
+  ////////////////////////////////////////////////////////////////////////////////////////////
+  /** \brief @b ConvexRegion is a point predicate (see FieldRange) that passes the points
+    * inside an intersection of slabs, i.e. whose signed distance to each of a set of planes
+    * lies in a [min, max] range. Planes, oriented boxes and prisms over convex polygons
+    * (e.g. the convex hull of a table top) are all such regions:
+    *
+    *  pcl::ConvexRegion<pcl::PointXYZ> region;
+    *  region.setPrism (*hull, 0.01f, 0.5f);
+    *  pcl::PredicateFilter<pcl::PointXYZ, pcl::ConvexRegion<pcl::PointXYZ> > crop (region);
+    *
+    * The block version loads x, y and z of the points into separate arrays once, then
+    * evaluates every plane in a branch free loop over them, which the compiler vectorizes.
+    * Bounds are included. Non-finite points never pass, unless the region has no slab at
+    * all, in which case every point passes.
+    *
+    * \ingroup filters
+    */
+  template <typename PointT>
+  class ConvexRegion
+  {
+    public:
+      typedef PointT PointType;
+
+      /** \brief Empty constructor, the region is the whole space. */
+      ConvexRegion () : slabs_ () { }
+
+      /** \brief Remove all the slabs. */
+      inline void
+      clear () { slabs_.clear (); }
+
+      /** \brief Add a slab, the points whose signed distance to a plane lies in [min, max].
+        * \param plane the plane coefficients (a, b, c, d), the normal doesn't have to be normalized
+        * \param min the minimum signed distance, in the direction of the normal
+        * \param max the maximum signed distance, in the direction of the normal
+        */
+      void
+      addSlab (const Eigen::Vector4f &plane, float min, float max);
+
+      /** \brief Add the half-space on the side of the plane normal, the plane included.
+        * \param plane the plane coefficients (a, b, c, d)
+        */
+      inline void
+      addHalfSpace (const Eigen::Vector4f &plane)
+      {
+        addSlab (plane, 0.0f, std::numeric_limits<float>::infinity ());
+      }
+
+      /** \brief Set the region to an oriented box.
+        * \param pose the rigid transformation from the box frame to the cloud frame
+        * \param min_pt the minimum corner of the box, in the box frame
+        * \param max_pt the maximum corner of the box, in the box frame
+        */
+      void
+      setOrientedBox (const Eigen::Affine3f &pose, const Eigen::Vector3f &min_pt, const Eigen::Vector3f &max_pt);
+
+      /** \brief Set the region to a prism over a convex polygon, the same region as
+        * ExtractPolygonalPrismData segments.
+        * \param hull the vertices of the convex polygon, in order
+        * \param plane the coefficients of the plane the polygon lies in (see computeHullPlane)
+        * \param height_min the minimum height above the plane, in the direction of its normal
+        * \param height_max the maximum height above the plane, in the direction of its normal
+        * \return false and leave the region empty if the polygon has less than 3 vertices
+        * or isn't convex
+        */
+      bool
+      setPrism (const pcl::PointCloud<PointT> &hull, const Eigen::Vector4f &plane, float height_min, float height_max);
+
+      /** \brief Set the region to a prism over a convex polygon, the plane is fitted to the
+        * polygon with its normal pointing to the viewpoint.
+        * \param hull the vertices of the convex polygon, in order
+        * \param height_min the minimum height above the plane
+        * \param height_max the maximum height above the plane
+        * \param viewpoint the viewpoint the heights are measured towards
+        * \return false and leave the region empty if the polygon has less than 3 vertices
+        * or isn't convex
+        */
+      bool
+      setPrism (const pcl::PointCloud<PointT> &hull, float height_min, float height_max,
+                const Eigen::Vector3f &viewpoint = Eigen::Vector3f::Zero ());
+
+      /** \brief Fit a plane to the vertices of a polygon, with the normal pointing to the
+        * viewpoint, the way ExtractPolygonalPrismData does.
+        * \param hull the vertices of the polygon
+        * \param viewpoint the viewpoint
+        * \param plane the resultant plane coefficients, with a unit normal
+        */
+      static void
+      computeHullPlane (const pcl::PointCloud<PointT> &hull, const Eigen::Vector3f &viewpoint, Eigen::Vector4f &plane);
+
+      /** \brief Get the number of slabs the region is made of. */
+      inline size_t
+      getNumberOfSlabs () const { return (slabs_.size ()); }
+
+      inline bool
+      operator() (const PointT &p) const
+      {
+        for (size_t s = 0; s < slabs_.size (); ++s)
+        {
+          const Slab &slab = slabs_[s];
+          float d = slab.a * p.x + slab.b * p.y + slab.c * p.z + slab.d;
+          if (!(d >= slab.min && d <= slab.max))
+            return (false);
+        }
+        return (true);
+      }
+
+      inline void
+      operator() (const PointT *points, int n, uint8_t *mask) const
+      {
+        float x[PREDICATE_BLOCK_SIZE], y[PREDICATE_BLOCK_SIZE], z[PREDICATE_BLOCK_SIZE];
+        for (int i = 0; i < n; ++i)
+        {
+          x[i] = points[i].x;
+          y[i] = points[i].y;
+          z[i] = points[i].z;
+        }
+        evaluate (x, y, z, n, mask);
+      }
+
+      /** \brief Evaluate a block of at most PREDICATE_BLOCK_SIZE points given by their indices.
+        * \param cloud the point cloud
+        * \param indices the indices of the points in the cloud
+        * \param n the number of indices
+        * \param mask the resultant mask, 1 for the points inside the region
+        */
+      inline void
+      operator() (const pcl::PointCloud<PointT> &cloud, const int *indices, int n, uint8_t *mask) const
+      {
+        float x[PREDICATE_BLOCK_SIZE], y[PREDICATE_BLOCK_SIZE], z[PREDICATE_BLOCK_SIZE];
+        for (int i = 0; i < n; ++i)
+        {
+          const PointT &p = cloud.points[indices[i]];
+          x[i] = p.x;
+          y[i] = p.y;
+          z[i] = p.z;
+        }
+        evaluate (x, y, z, n, mask);
+      }
+
+    protected:
+      struct Slab
+      {
+        float a, b, c, d;
+        float min, max;
+      };
+
+      inline void
+      evaluate (const float *x, const float *y, const float *z, int n, uint8_t *mask) const
+      {
+        for (int i = 0; i < n; ++i)
+          mask[i] = 1;
+        for (size_t s = 0; s < slabs_.size (); ++s)
+        {
+          const Slab slab = slabs_[s];
+          for (int i = 0; i < n; ++i)
+          {
+            float d = slab.a * x[i] + slab.b * y[i] + slab.c * z[i] + slab.d;
+            mask[i] &= (uint8_t)((d >= slab.min) & (d <= slab.max));
+          }
+        }
+      }
+
+      /** \brief The slabs the region is the intersection of, with unit normals. */
+      std::vector<Slab> slabs_;
+  };
+}
+
+#include "pcl/filters/impl/convex_region.hpp"
+
+#endif  //#ifndef PCL_FILTERS_CONVEX_REGION_H_
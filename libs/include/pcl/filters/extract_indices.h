@@ -94,6 +94,12 @@ namespace pcl
       void
       applyFilter (PointCloud &output);
 
+      /** \brief Return the input indices, or all the other point indices if negative.
+        * \param indices the resultant point indices
+        */
+      void
+      applyFilterIndices (std::vector<int> &indices);
+
       /** \brief If true, all the points _except_ the input indices will be returned. False by default. */
       bool negative_;
   };
@@ -0,0 +1,345 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_FILTERS_FIELD_PREDICATE_H_
+#define PCL_FILTERS_FIELD_PREDICATE_H_
+
+#include "pcl/filters/filter.h"
+#include "pcl/filters/conditional_removal.h"
+
+namespace pcl
+{
+  /** \brief The number of points predicates are evaluated on at once. */
+  enum { PREDICATE_BLOCK_SIZE = 256 };
+
+  ////////////////////////////////////////////////////////////////////////////////////////////
+  /** \brief Point predicates with the fields resolved at compile time.
+    *
+    * A predicate is evaluated either on a single point, or on a block of at most
+    * PREDICATE_BLOCK_SIZE points, writing 1 (pass) or 0 (fail) per point into a mask.
+    * The block version has no branches, the compiler vectorizes the mask loops
+    * and the points don't cause branch mispredictions however they are ordered.
+    *
+    * Fields are selected through the tags generated by the point type registration,
+    * e.g. FieldRange<PointXYZ, pcl::fields::z>, which compiles down to a plain load of
+    * the member. Predicates compose into trees with PredicateAnd, PredicateOr and
+    * PredicateNot (see \ref predicateAnd, \ref predicateOr and \ref predicateNot).
+    *
+    * \ingroup filters
+    */
+
+  /** \brief Passes if a (scalar) field of the point lies in [min, max]. NaN values never pass. */
+  template <typename PointT, typename Tag>
+  struct FieldRange
+  {
+    typedef PointT PointType;
+    typedef typename pcl::traits::datatype<PointT, Tag>::type FieldType;
+
+    FieldRange (FieldType min, FieldType max) : min_ (min), max_ (max) { }
+
+    static inline FieldType
+    value (const PointT &p)
+    {
+      return (*reinterpret_cast<const FieldType*>(reinterpret_cast<const uint8_t*>(&p) + pcl::traits::offset<PointT, Tag>::value));
+    }
+
+    inline bool
+    operator() (const PointT &p) const
+    {
+      FieldType v = value (p);
+      return (v >= min_ && v <= max_);
+    }
+
+    inline void
+    operator() (const PointT *points, int n, uint8_t *mask) const
+    {
+      for (int i = 0; i < n; ++i)
+      {
+        FieldType v = value (points[i]);
+        mask[i] = (uint8_t)((v >= min_) & (v <= max_));
+      }
+    }
+
+    FieldType min_, max_;
+  };
+
+  /** \brief Passes if x, y and z of the point are finite. */
+  template <typename PointT>
+  struct FiniteXYZ
+  {
+    typedef PointT PointType;
+
+    inline bool
+    operator() (const PointT &p) const
+    {
+      return (pcl_isfinite (p.x) && pcl_isfinite (p.y) && pcl_isfinite (p.z));
+    }
+
+    inline void
+    operator() (const PointT *points, int n, uint8_t *mask) const
+    {
+      // v - v is 0 for finite values and NaN for infinities and NaNs
+      for (int i = 0; i < n; ++i)
+        mask[i] = (uint8_t)(((points[i].x - points[i].x) == 0) & ((points[i].y - points[i].y) == 0) & ((points[i].z - points[i].z) == 0));
+    }
+  };
+
+  /** \brief Passes if both predicates pass. */
+  template <typename PredicateA, typename PredicateB>
+  struct PredicateAnd
+  {
+    typedef typename PredicateA::PointType PointType;
+
+    PredicateAnd (const PredicateA &a, const PredicateB &b) : a_ (a), b_ (b) { }
+
+    inline bool
+    operator() (const PointType &p) const { return (a_ (p) && b_ (p)); }
+
+    inline void
+    operator() (const PointType *points, int n, uint8_t *mask) const
+    {
+      uint8_t mask_b[PREDICATE_BLOCK_SIZE];
+      a_ (points, n, mask);
+      b_ (points, n, mask_b);
+      for (int i = 0; i < n; ++i)
+        mask[i] &= mask_b[i];
+    }
+
+    PredicateA a_;
+    PredicateB b_;
+  };
+
+  /** \brief Passes if any of the predicates passes. */
+  template <typename PredicateA, typename PredicateB>
+  struct PredicateOr
+  {
+    typedef typename PredicateA::PointType PointType;
+
+    PredicateOr (const PredicateA &a, const PredicateB &b) : a_ (a), b_ (b) { }
+
+    inline bool
+    operator() (const PointType &p) const { return (a_ (p) || b_ (p)); }
+
+    inline void
+    operator() (const PointType *points, int n, uint8_t *mask) const
+    {
+      uint8_t mask_b[PREDICATE_BLOCK_SIZE];
+      a_ (points, n, mask);
+      b_ (points, n, mask_b);
+      for (int i = 0; i < n; ++i)
+        mask[i] |= mask_b[i];
+    }
+
+    PredicateA a_;
+    PredicateB b_;
+  };
+
+  /** \brief Passes if the predicate fails. */
+  template <typename Predicate>
+  struct PredicateNot
+  {
+    typedef typename Predicate::PointType PointType;
+
+    PredicateNot (const Predicate &a) : a_ (a) { }
+
+    inline bool
+    operator() (const PointType &p) const { return (!a_ (p)); }
+
+    inline void
+    operator() (const PointType *points, int n, uint8_t *mask) const
+    {
+      a_ (points, n, mask);
+      for (int i = 0; i < n; ++i)
+        mask[i] ^= 1;
+    }
+
+    Predicate a_;
+  };
+
+  template <typename PredicateA, typename PredicateB> inline PredicateAnd<PredicateA, PredicateB>
+  predicateAnd (const PredicateA &a, const PredicateB &b) { return (PredicateAnd<PredicateA, PredicateB> (a, b)); }
+
+  template <typename PredicateA, typename PredicateB> inline PredicateOr<PredicateA, PredicateB>
+  predicateOr (const PredicateA &a, const PredicateB &b) { return (PredicateOr<PredicateA, PredicateB> (a, b)); }
+
+  template <typename Predicate> inline PredicateNot<Predicate>
+  predicateNot (const Predicate &a) { return (PredicateNot<Predicate> (a)); }
+
+  /** \brief Axis aligned box test on x, y and z, bounds included. Non-finite points never pass. */
+  template <typename PointT> inline
+  PredicateAnd<PredicateAnd<FieldRange<PointT, pcl::fields::x>, FieldRange<PointT, pcl::fields::y> >, FieldRange<PointT, pcl::fields::z> >
+  predicateBox (const Eigen::Vector4f &min_pt, const Eigen::Vector4f &max_pt)
+  {
+    return (predicateAnd (predicateAnd (FieldRange<PointT, pcl::fields::x> (min_pt[0], max_pt[0]),
+                                        FieldRange<PointT, pcl::fields::y> (min_pt[1], max_pt[1])),
+                          FieldRange<PointT, pcl::fields::z> (min_pt[2], max_pt[2])));
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////
+  /** \brief Wraps a compile-time predicate into a comparison, so it can be used in the
+    * ConditionAnd/ConditionOr trees of ConditionalRemoval.
+    * \ingroup filters
+    */
+  template <typename PointT, typename Predicate>
+  class PredicateComparison : public ComparisonBase<PointT>
+  {
+    using ComparisonBase<PointT>::capable_;
+
+    public:
+      typedef boost::shared_ptr<PredicateComparison<PointT, Predicate> > Ptr;
+      typedef boost::shared_ptr<const PredicateComparison<PointT, Predicate> > ConstPtr;
+
+      /** \brief Constructor.
+        * \param predicate the predicate the points are evaluated with
+        */
+      PredicateComparison (const Predicate &predicate) : predicate_ (predicate)
+      {
+        capable_ = true;
+      }
+
+      virtual bool
+      evaluate (const PointT &point) const
+      {
+        return (predicate_ (point));
+      }
+
+    protected:
+      Predicate predicate_;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////////////////
+  /** \brief @b PredicateFilter keeps the points that satisfy a compile-time predicate, e.g.
+    *
+    *  typedef pcl::FieldRange<pcl::PointXYZ, pcl::fields::z> Range;
+    *  pcl::PredicateFilter<pcl::PointXYZ, Range> pass (Range (0.5f, 2.0f));
+    *  pass.setInputCloud (cloud);
+    *  pass.filter (*cloud);
+    *
+    * Without indices, the cloud is evaluated in blocks of PREDICATE_BLOCK_SIZE points. With indices,
+    * only the indexed points are evaluated and kept. Unlike PassThrough, non-finite points are only
+    * removed if the predicate says so (see FiniteXYZ).
+    * Filtering in place (output == input) is supported.
+    *
+    * \ingroup filters
+    */
+  template <typename PointT, typename Predicate>
+  class PredicateFilter : public Filter<PointT>
+  {
+    using Filter<PointT>::input_;
+    using Filter<PointT>::indices_;
+    using Filter<PointT>::fake_indices_;
+    using Filter<PointT>::filter_name_;
+    using Filter<PointT>::getClassName;
+
+    using Filter<PointT>::removed_indices_;
+    using Filter<PointT>::extract_removed_indices_;
+
+    typedef typename Filter<PointT>::PointCloud PointCloud;
+    typedef typename PointCloud::Ptr PointCloudPtr;
+    typedef typename PointCloud::ConstPtr PointCloudConstPtr;
+
+    public:
+      /** \brief Constructor.
+        * \param predicate the predicate the points must satisfy to be kept
+        * \param extract_removed_indices extract filtered indices from indices vector
+        */
+      PredicateFilter (const Predicate &predicate, bool extract_removed_indices = false) :
+        Filter<PointT>::Filter (extract_removed_indices), predicate_ (predicate), keep_organized_ (false),
+        user_filter_value_ (std::numeric_limits<float>::quiet_NaN ())
+      {
+        filter_name_ = "PredicateFilter";
+      }
+
+      /** \brief Set the predicate the points must satisfy to be kept. */
+      inline void
+      setPredicate (const Predicate &predicate) { predicate_ = predicate; }
+
+      /** \brief Get the predicate the points must satisfy to be kept. */
+      inline const Predicate&
+      getPredicate () const { return (predicate_); }
+
+      /** \brief Set whether the filtered points should be kept and set to the
+        * value given through \a setUserFilterValue (default: NaN), or removed
+        * from the PointCloud, thus potentially breaking its organized
+        * structure. By default, points are removed.
+        *
+        * \param val set to true whether the filtered points should be kept and
+        * set to a given user value (default: NaN)
+        */
+      inline void
+      setKeepOrganized (bool val) { keep_organized_ = val; }
+
+      inline bool
+      getKeepOrganized () { return (keep_organized_); }
+
+      /** \brief Provide a value that the filtered points should be set to
+        * instead of removing them.  Used in conjunction with \a
+        * setKeepOrganized ().
+        * \param val the user given value that the filtered point dimensions should be set to
+        */
+      inline void
+      setUserFilterValue (float val) { user_filter_value_ = val; }
+
+    protected:
+      /** \brief Filter a Point Cloud.
+        * \param output the resultant point cloud message
+        */
+      void
+      applyFilter (PointCloud &output);
+
+      /** \brief Select the points of indices_ that satisfy the predicate.
+        * \param indices the resultant point indices
+        */
+      void
+      applyFilterIndices (std::vector<int> &indices);
+
+      /** \brief The predicate the points must satisfy to be kept. */
+      Predicate predicate_;
+
+      /** \brief Keep the structure of the data organized, by setting the
+        * filtered points to the a user given value (NaN by default).
+        */
+      bool keep_organized_;
+
+      /** \brief User given value to be set to any filtered point. */
+      float user_filter_value_;
+  };
+}
+
+#include "pcl/filters/impl/field_predicate.hpp"
+
+#endif  //#ifndef PCL_FILTERS_FIELD_PREDICATE_H_
@@ -178,6 +178,26 @@ namespace pcl
         deinitCompute ();
       }
 
+      /** \brief Calls the filtering method and returns the indices of the input points that
+        * pass, instead of copying them. The indices can be handed to the next filter through
+        * setIndices, so a chain of filters only copies points once, at the end. Filters that
+        * create new points (e.g. VoxelGrid) don't support this and return no indices.
+        * \param indices the indices of the points that pass, into the input point cloud
+        */
+      inline void
+      filter (std::vector<int> &indices)
+      {
+        if (!initCompute ())
+        {
+          indices.clear ();
+          return;
+        }
+
+        applyFilterIndices (indices);
+
+        deinitCompute ();
+      }
+
     protected:
 
       /** \brief Indices of the points that are removed */
@@ -208,6 +228,18 @@ namespace pcl
       virtual void
       applyFilter (PointCloud &output) = 0;
 
+      /** \brief Filter method returning point indices, for the filters that only select points.
+        *
+        * The implementation needs to fill indices with the indices into input_ of the points
+        * that pass, and removed_indices_ like applyFilter does.
+        */
+      virtual void
+      applyFilterIndices (std::vector<int> &indices)
+      {
+        PCL_ERROR ("[pcl::%s::filter] Filter doesn't select points, it can't return indices!\n", getClassName ().c_str ());
+        indices.clear ();
+      }
+
       /** \brief Get a string representation of the name of this class. */
       inline const std::string&
       getClassName () const
@@ -0,0 +1,199 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_FILTERS_IMPL_CONVEX_REGION_H_
+#define PCL_FILTERS_IMPL_CONVEX_REGION_H_
+
+#include "pcl/filters/convex_region.h"
+#include "pcl/common/centroid.h"
+#include "pcl/common/eigen.h"
+
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::ConvexRegion<PointT>::addSlab (const Eigen::Vector4f &plane, float min, float max)
+{
+  // Scale the plane to a unit normal, so the limits are distances
+  float norm = plane.head<3> ().norm ();
+  if (norm == 0)
+  {
+    PCL_WARN ("[pcl::ConvexRegion::addSlab] The plane normal is zero, ignoring the slab!\n");
+    return;
+  }
+
+  Slab slab;
+  slab.a = plane[0] / norm;
+  slab.b = plane[1] / norm;
+  slab.c = plane[2] / norm;
+  slab.d = plane[3] / norm;
+  slab.min = min;
+  slab.max = max;
+  slabs_.push_back (slab);
+}
+
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::ConvexRegion<PointT>::setOrientedBox (const Eigen::Affine3f &pose, const Eigen::Vector3f &min_pt, const Eigen::Vector3f &max_pt)
+{
+  clear ();
+
+  // One slab per box axis, the axes are the columns of the rotation
+  const Eigen::Vector3f origin = pose.translation ();
+  for (int k = 0; k < 3; ++k)
+  {
+    Eigen::Vector3f axis = pose.linear ().col (k);
+    addSlab (Eigen::Vector4f (axis[0], axis[1], axis[2], -axis.dot (origin)), min_pt[k], max_pt[k]);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT> bool
+pcl::ConvexRegion<PointT>::setPrism (const pcl::PointCloud<PointT> &hull, const Eigen::Vector4f &plane, float height_min, float height_max)
+{
+  clear ();
+
+  const int nr_points = (int)hull.points.size ();
+  const float norm = plane.head<3> ().norm ();
+  if (nr_points < 3 || norm == 0)
+    return (false);
+
+  // Project the polygon onto the plane
+  const Eigen::Vector3f normal = plane.head<3> () / norm;
+  const float offset = plane[3] / norm;
+  std::vector<Eigen::Vector3f> vertices (nr_points);
+  for (int i = 0; i < nr_points; ++i)
+  {
+    Eigen::Vector3f p (hull.points[i].x, hull.points[i].y, hull.points[i].z);
+    vertices[i] = p - normal * (normal.dot (p) + offset);
+  }
+
+  // Orientation of the polygon around the normal, from its signed area
+  float area = 0;
+  float extent = 0;
+  for (int i = 0; i < nr_points; ++i)
+  {
+    const Eigen::Vector3f &p = vertices[i];
+    const Eigen::Vector3f &q = vertices[(i + 1) % nr_points];
+    area += normal.dot (p.cross (q));
+    extent = std::max (extent, (q - p).norm ());
+  }
+  if (area == 0 || !pcl_isfinite (area))
+    return (false);
+  const float orientation = (area > 0) ? 1.0f : -1.0f;
+
+  addSlab (Eigen::Vector4f (normal[0], normal[1], normal[2], offset), height_min, height_max);
+
+  // Every edge bounds a half-space, perpendicular to the plane, with the polygon on its
+  // inner side. The polygon is convex if no vertex is (noticeably) outside of any of them.
+  const float tolerance = 1e-4f * extent;
+  for (int i = 0; i < nr_points; ++i)
+  {
+    const Eigen::Vector3f &p = vertices[i];
+    const Eigen::Vector3f edge = vertices[(i + 1) % nr_points] - p;
+    const float length = edge.norm ();
+    if (length == 0)
+      continue;
+
+    const Eigen::Vector3f inward = normal.cross (edge) * (orientation / length);
+    const float d = -inward.dot (p);
+    for (int k = 0; k < nr_points; ++k)
+    {
+      if (inward.dot (vertices[k]) + d < -tolerance)
+      {
+        clear ();
+        return (false);
+      }
+    }
+    addHalfSpace (Eigen::Vector4f (inward[0], inward[1], inward[2], d));
+  }
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT> bool
+pcl::ConvexRegion<PointT>::setPrism (const pcl::PointCloud<PointT> &hull, float height_min, float height_max,
+                                     const Eigen::Vector3f &viewpoint)
+{
+  if (hull.points.size () < 3)
+  {
+    clear ();
+    return (false);
+  }
+
+  Eigen::Vector4f plane;
+  computeHullPlane (hull, viewpoint, plane);
+  return (setPrism (hull, plane, height_min, height_max));
+}
+
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::ConvexRegion<PointT>::computeHullPlane (const pcl::PointCloud<PointT> &hull, const Eigen::Vector3f &viewpoint, Eigen::Vector4f &plane)
+{
+  EIGEN_ALIGN16 Eigen::Matrix3f covariance_matrix;
+  Eigen::Vector4f xyz_centroid;
+
+  // Estimate the XYZ centroid
+  compute3DCentroid (hull, xyz_centroid);
+
+  // Compute the 3x3 covariance matrix
+  computeCovarianceMatrix (hull, xyz_centroid, covariance_matrix);
+
+  // The normal is the eigenvector of the smallest eigenvalue
+  EIGEN_ALIGN16 Eigen::Vector3f eigen_values;
+  EIGEN_ALIGN16 Eigen::Matrix3f eigen_vectors;
+  eigen33 (covariance_matrix, eigen_vectors, eigen_values);
+
+  plane[0] = eigen_vectors (0, 0);
+  plane[1] = eigen_vectors (1, 0);
+  plane[2] = eigen_vectors (2, 0);
+  plane[3] = 0;
+
+  // Hessian form (D = nc . p_plane (centroid here) + p)
+  plane[3] = -1 * plane.dot (xyz_centroid);
+
+  // Flip the plane normal towards the viewpoint
+  Eigen::Vector4f vp (viewpoint[0], viewpoint[1], viewpoint[2], 0);
+  vp -= hull.points[0].getVector4fMap ();
+  vp[3] = 0;
+  if (vp.dot (plane) < 0)
+  {
+    plane *= -1;
+    plane[3] = 0;
+    plane[3] = -1 * (plane.dot (hull.points[0].getVector4fMap ()));
+  }
+}
+
+#endif    // PCL_FILTERS_IMPL_CONVEX_REGION_H_
@@ -93,6 +93,29 @@ pcl::ExtractIndices<PointT>::applyFilter (PointCloud &output)
     copyPointCloud (*input_, *indices_, output);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::ExtractIndices<PointT>::applyFilterIndices (std::vector<int> &indices)
+{
+  if (!negative_)
+  {
+    indices = *indices_;
+    return;
+  }
+
+  // All the points except the input indices, in increasing order
+  std::vector<char> selected (input_->points.size (), false);
+  for (size_t i = 0; i < indices_->size (); ++i)
+    if ((*indices_)[i] >= 0 && (size_t)(*indices_)[i] < selected.size ())
+      selected[(*indices_)[i]] = true;
+
+  indices.clear ();
+  indices.reserve (input_->points.size () - std::min (indices_->size (), input_->points.size ()));
+  for (size_t i = 0; i < selected.size (); ++i)
+    if (!selected[i])
+      indices.push_back ((int)i);
+}
+
 #define PCL_INSTANTIATE_ExtractIndices(T) template class PCL_EXPORTS pcl::ExtractIndices<T>;
 
 #endif    // PCL_FILTERS_IMPL_EXTRACT_INDICES_H_
@@ -0,0 +1,202 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_FILTERS_IMPL_FIELD_PREDICATE_H_
+#define PCL_FILTERS_IMPL_FIELD_PREDICATE_H_
+
+#include "pcl/filters/field_predicate.h"
+
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename Predicate> void
+pcl::PredicateFilter<PointT, Predicate>::applyFilter (PointCloud &output)
+{
+  // Has the input dataset been set already?
+  if (!input_)
+  {
+    PCL_WARN ("[pcl::%s::applyFilter] No input dataset given!\n", getClassName ().c_str ());
+    output.width = output.height = 0;
+    output.points.clear ();
+    return;
+  }
+
+  const bool in_place = (&output == input_.get ());
+
+  // User indices may point at points that were overwritten already, filter in place through a copy
+  if (in_place && !fake_indices_ && !keep_organized_)
+  {
+    PointCloud output_temp;
+    applyFilter (output_temp);
+    output.points.swap (output_temp.points);
+    output.width    = output_temp.width;
+    output.height   = output_temp.height;
+    output.is_dense = output_temp.is_dense;
+    return;
+  }
+
+  const int nr_indices = (int)indices_->size ();
+
+  if (keep_organized_)
+  {
+    output.width  = input_->width;
+    output.height = input_->height;
+    // Check what the user value is: if !finite, set is_dense to false, true otherwise
+    output.is_dense = pcl_isfinite (user_filter_value_) ? input_->is_dense : false;
+    if (!in_place)
+      output.points = input_->points;
+  }
+  else
+  {
+    output.height = 1;                    // filtering breaks the organized structure
+    output.is_dense = input_->is_dense;   // the predicate decides about invalid points
+    if (!in_place)
+      output.points.resize (nr_indices);
+  }
+  if (extract_removed_indices_)
+    removed_indices_->resize (nr_indices);
+
+  int nr_p = 0;
+  int nr_removed_p = 0;
+
+  // Without user indices the points are contiguous and can be evaluated a block at a time
+  if (fake_indices_)
+  {
+    // Evaluate the predicate on a block of points at a time, then copy the survivors. The output
+    // index never passes the input index, so in place filtering only overwrites visited points.
+    uint8_t mask[PREDICATE_BLOCK_SIZE];
+    for (int block = 0; block < nr_indices; block += PREDICATE_BLOCK_SIZE)
+    {
+      const int n = std::min<int> (PREDICATE_BLOCK_SIZE, nr_indices - block);
+      predicate_ (&input_->points[block], n, mask);
+
+      for (int i = 0; i < n; ++i)
+      {
+        const int cp = block + i;
+        if (mask[i])
+        {
+          if (!keep_organized_)
+          {
+            if (nr_p != cp)
+              output.points[nr_p] = input_->points[cp];
+            nr_p++;
+          }
+        }
+        else
+        {
+          if (keep_organized_)
+            output.points[cp].x = output.points[cp].y = output.points[cp].z = user_filter_value_;
+          if (extract_removed_indices_)
+            (*removed_indices_)[nr_removed_p++] = cp;
+        }
+      }
+    }
+  }
+  else
+  {
+    // Organized outputs keep the points that aren't in the indices as they are
+    for (int i = 0; i < nr_indices; ++i)
+    {
+      const int cp = (*indices_)[i];
+      if (predicate_ (input_->points[cp]))
+      {
+        if (!keep_organized_)
+          output.points[nr_p++] = input_->points[cp];
+      }
+      else
+      {
+        if (keep_organized_)
+          output.points[cp].x = output.points[cp].y = output.points[cp].z = user_filter_value_;
+        if (extract_removed_indices_)
+          (*removed_indices_)[nr_removed_p++] = cp;
+      }
+    }
+  }
+
+  if (!keep_organized_)
+  {
+    output.width = nr_p;
+    output.points.resize (nr_p);
+  }
+  removed_indices_->resize (nr_removed_p);
+}
+
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename Predicate> void
+pcl::PredicateFilter<PointT, Predicate>::applyFilterIndices (std::vector<int> &indices)
+{
+  const int nr_indices = (int)indices_->size ();
+  indices.resize (nr_indices);
+  if (extract_removed_indices_)
+    removed_indices_->resize (nr_indices);
+
+  int nr_p = 0;
+  int nr_removed_p = 0;
+
+  // Without user indices the points are contiguous and can be evaluated a block at a time
+  if (fake_indices_)
+  {
+    uint8_t mask[PREDICATE_BLOCK_SIZE];
+    for (int block = 0; block < nr_indices; block += PREDICATE_BLOCK_SIZE)
+    {
+      const int n = std::min<int> (PREDICATE_BLOCK_SIZE, nr_indices - block);
+      predicate_ (&input_->points[block], n, mask);
+
+      for (int i = 0; i < n; ++i)
+      {
+        if (mask[i])
+          indices[nr_p++] = block + i;
+        else if (extract_removed_indices_)
+          (*removed_indices_)[nr_removed_p++] = block + i;
+      }
+    }
+  }
+  else
+  {
+    for (int i = 0; i < nr_indices; ++i)
+    {
+      const int cp = (*indices_)[i];
+      if (predicate_ (input_->points[cp]))
+        indices[nr_p++] = cp;
+      else if (extract_removed_indices_)
+        (*removed_indices_)[nr_removed_p++] = cp;
+    }
+  }
+
+  indices.resize (nr_p);
+  removed_indices_->resize (nr_removed_p);
+}
+
+#endif    // PCL_FILTERS_IMPL_FIELD_PREDICATE_H_
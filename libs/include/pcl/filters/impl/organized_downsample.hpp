@@ -0,0 +1,179 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_FILTERS_IMPL_ORGANIZED_DOWNSAMPLE_H_
+#define PCL_FILTERS_IMPL_ORGANIZED_DOWNSAMPLE_H_
+
+#include "pcl/filters/organized_downsample.h"
+#include "pcl/common/io.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> bool
+pcl::OrganizedDownsample<PointT>::computeCentroid (int row, int col, int rgba_offset, PointT &centroid) const
+{
+  static const int nr_fields = boost::mpl::size<FieldList>::value;
+  float sum[nr_fields + 3];
+  std::fill (sum, sum + nr_fields + 3, 0.0f);
+  Eigen::Array4f xyz_sum = Eigen::Array4f::Zero ();
+  int nr_points = 0;
+
+  for (int r = row; r < row + step_; ++r)
+  {
+    const PointT *pt = &input_->points[r * input_->width + col];
+    for (int c = 0; c < step_; ++c, ++pt)
+    {
+      if (!pcl_isfinite (pt->x) || !pcl_isfinite (pt->y) || !pcl_isfinite (pt->z))
+        continue;
+      nr_points++;
+
+      if (!downsample_all_data_)
+      {
+        xyz_sum += pt->getArray4fMap ();
+        continue;
+      }
+
+      pcl::for_each_type <FieldList> (NdAddPointArrayFunctor <PointT> (*pt, sum));
+      // ---[ RGB special case
+      if (rgba_offset >= 0)
+      {
+        pcl::RGB rgb;
+        memcpy (&rgb, ((const char *)pt) + rgba_offset, sizeof (RGB));
+        sum[nr_fields + 0] += rgb.r;
+        sum[nr_fields + 1] += rgb.g;
+        sum[nr_fields + 2] += rgb.b;
+      }
+    }
+  }
+  if (nr_points == 0)
+    return (false);
+
+  const float inv_nr_points = 1.0f / nr_points;
+  if (!downsample_all_data_)
+  {
+    xyz_sum *= inv_nr_points;
+    centroid.x = xyz_sum[0];
+    centroid.y = xyz_sum[1];
+    centroid.z = xyz_sum[2];
+    return (true);
+  }
+
+  for (int f = 0; f < nr_fields + 3; ++f)
+    sum[f] *= inv_nr_points;
+
+  pcl::for_each_type <FieldList> (pcl::NdCopyArrayPointFunctor <PointT> (sum, centroid));
+  // ---[ RGB special case
+  if (rgba_offset >= 0)
+  {
+    // pack r/g/b into rgb
+    float r = sum[nr_fields + 0], g = sum[nr_fields + 1], b = sum[nr_fields + 2];
+    int rgb = ((int)r) << 16 | ((int)g) << 8 | ((int)b);
+    memcpy (((char *)&centroid) + rgba_offset, &rgb, sizeof (float));
+  }
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::OrganizedDownsample<PointT>::applyFilter (PointCloud &output)
+{
+  // Has the input dataset been set already?
+  if (!input_)
+  {
+    PCL_WARN ("[pcl::%s::applyFilter] No input dataset given!\n", getClassName ().c_str ());
+    output.width = output.height = 0;
+    output.points.clear ();
+    return;
+  }
+
+  if (!input_->isOrganized ())
+  {
+    PCL_ERROR ("[pcl::%s::applyFilter] Input dataset is not organized!\n", getClassName ().c_str ());
+    output.width = output.height = 0;
+    output.points.clear ();
+    return;
+  }
+
+  // The blocks read input points that are already overwritten when filtering in place
+  if (&output == input_.get ())
+  {
+    PointCloud temp;
+    applyFilter (temp);
+    output.points.swap (temp.points);
+    output.width = temp.width;
+    output.height = temp.height;
+    output.is_dense = temp.is_dense;
+    return;
+  }
+
+  const int width = input_->width / step_;
+  const int height = input_->height / step_;
+
+  output.points.resize (width * height);
+  output.width = width;
+  output.height = height;
+  output.is_dense = true;
+
+  // ---[ RGB special case
+  int rgba_offset = -1;
+  if (average_ && downsample_all_data_)
+  {
+    std::vector<sensor_msgs::PointField> fields;
+    rgba_offset = pcl::getFieldIndex (*input_, "rgb", fields);
+    if (rgba_offset == -1)
+      rgba_offset = pcl::getFieldIndex (*input_, "rgba", fields);
+    if (rgba_offset >= 0)
+      rgba_offset = fields[rgba_offset].offset;
+  }
+
+  for (int row = 0; row < height; ++row)
+  {
+    for (int col = 0; col < width; ++col)
+    {
+      PointT &pt = output.points[row * width + col];
+      // The center point, kept as is if the block has no valid point
+      pt = input_->points[(row * step_ + step_ / 2) * input_->width + col * step_ + step_ / 2];
+
+      if (average_)
+        computeCentroid (row * step_, col * step_, rgba_offset, pt);
+
+      if (!pcl_isfinite (pt.x) || !pcl_isfinite (pt.y) || !pcl_isfinite (pt.z))
+        output.is_dense = false;
+    }
+  }
+}
+
+#endif    // PCL_FILTERS_IMPL_ORGANIZED_DOWNSAMPLE_H_
@@ -230,6 +230,59 @@ pcl::PassThrough<PointT>::applyFilter (PointCloud &output)
   removed_indices_->resize(nr_removed_p);
 }
 
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::PassThrough<PointT>::applyFilterIndices (std::vector<int> &indices)
+{
+  // Get the distance field offset, if any
+  int distance_offset = -1;
+  if (!filter_field_name_.empty ())
+  {
+    std::vector<sensor_msgs::PointField> fields;
+    int distance_idx = pcl::getFieldIndex (*input_, filter_field_name_, fields);
+    if (distance_idx == -1)
+    {
+      PCL_WARN ("[pcl::%s::applyFilter] Invalid filter field name. Index is %d.\n", getClassName ().c_str (), distance_idx);
+      indices.clear ();
+      return;
+    }
+    distance_offset = fields[distance_idx].offset;
+  }
+
+  indices.resize (indices_->size ());
+  removed_indices_->resize (indices_->size ());
+
+  int nr_p = 0;
+  int nr_removed_p = 0;
+
+  for (size_t i = 0; i < indices_->size (); ++i)
+  {
+    const int cp = (*indices_)[i];
+    const PointT &pt = input_->points[cp];
+
+    // Invalid points never pass
+    bool pass = pcl_isfinite (pt.x) && pcl_isfinite (pt.y) && pcl_isfinite (pt.z);
+    if (pass && distance_offset >= 0)
+    {
+      float distance_value = 0;
+      memcpy (&distance_value, (const uint8_t*)&pt + distance_offset, sizeof (float));
+
+      if (filter_limit_negative_)
+        pass = !(distance_value < filter_limit_max_ && distance_value > filter_limit_min_);
+      else
+        pass = !(distance_value > filter_limit_max_ || distance_value < filter_limit_min_);
+    }
+
+    if (pass)
+      indices[nr_p++] = cp;
+    else if (extract_removed_indices_)
+      (*removed_indices_)[nr_removed_p++] = cp;
+  }
+
+  indices.resize (nr_p);
+  removed_indices_->resize (nr_removed_p);
+}
+
 #define PCL_INSTANTIATE_PassThrough(T) template class PCL_EXPORTS pcl::PassThrough<T>;
 
 #endif    // PCL_FILTERS_IMPL_PASSTHROUGH_H_
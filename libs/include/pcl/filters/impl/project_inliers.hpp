@@ -58,6 +58,16 @@ pcl::ProjectInliers<PointT>::applyFilter (PointCloud &output)
   for (size_t i = 0; i < model_->values.size (); ++i)
     model_coefficients[i] = model_->values[i];
 
+  // All the plane models project the same way, and a plane doesn't need a model built over the input
+  if (model_coefficients.size () == 4 &&
+      (model_type_ == SACMODEL_PLANE || model_type_ == SACMODEL_PERPENDICULAR_PLANE ||
+       model_type_ == SACMODEL_NORMAL_PLANE || model_type_ == SACMODEL_NORMAL_PARALLEL_PLANE ||
+       model_type_ == SACMODEL_PARALLEL_PLANE))
+  {
+    projectOnPlane (Eigen::Vector4f (model_coefficients[0], model_coefficients[1], model_coefficients[2], model_coefficients[3]), output);
+    return;
+  }
+
   // Initialize the Sample Consensus model and set its parameters
   if (!initSACModel (model_type_))
   {
@@ -72,6 +82,64 @@ pcl::ProjectInliers<PointT>::applyFilter (PointCloud &output)
     sacmodel_->projectPoints (*indices_, model_coefficients, output, false);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::ProjectInliers<PointT>::projectOnPlane (const Eigen::Vector4f &model_coefficients, PointCloud &output)
+{
+  output.header = input_->header;
+  output.is_dense = input_->is_dense;
+
+  // Normalize the plane normal, the offset is kept as given (like projectPoints does)
+  const float norm = model_coefficients.head<3> ().norm ();
+  const float a = model_coefficients[0] / norm;
+  const float b = model_coefficients[1] / norm;
+  const float c = model_coefficients[2] / norm;
+  const float d = model_coefficients[3];
+
+  const int nr_indices = (int)indices_->size ();
+
+  // Every inlier moves along the normal by its distance to the plane
+  if (copy_all_data_)
+  {
+    if (&output != input_.get ())
+      output.points = input_->points;
+    output.width  = input_->width;
+    output.height = input_->height;
+
+    for (int i = 0; i < nr_indices; ++i)
+    {
+      PointT &p = output.points[(*indices_)[i]];
+      const float distance = a * p.x + b * p.y + c * p.z + d;
+      p.x -= a * distance;
+      p.y -= b * distance;
+      p.z -= c * distance;
+    }
+  }
+  else
+  {
+    // Project into a temporary, the inliers may be in any order if filtering in place
+    PointCloud projected;
+    PointCloud &target = (&output == input_.get ()) ? projected : output;
+    target.points.resize (nr_indices);
+
+    for (int i = 0; i < nr_indices; ++i)
+    {
+      const PointT &p = input_->points[(*indices_)[i]];
+      const float distance = a * p.x + b * p.y + c * p.z + d;
+      PointT &q = target.points[i];
+      q = p;
+      q.x = p.x - a * distance;
+      q.y = p.y - b * distance;
+      q.z = p.z - c * distance;
+    }
+
+    if (&target != &output)
+      output.points.swap (target.points);
+    output.width  = nr_indices;
+    output.height = 1;
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT> bool
 pcl::ProjectInliers<PointT>::initSACModel (int model_type)
@@ -41,6 +41,8 @@
 #include "pcl/filters/radius_outlier_removal.h"
 #include <pcl/kdtree/kdtree_flann.h>
 #include <pcl/kdtree/organized_data.h>
+#include <limits>
+#include <algorithm>
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT> void
@@ -53,53 +55,281 @@ pcl::RadiusOutlierRemoval<PointT>::applyFilter (PointCloud &output)
     output.points.clear ();
     return;
   }
-  // Initialize the spatial locator
-  if (!tree_)
-  {
-    if (input_->isOrganized ())
-      tree_.reset (new pcl::OrganizedDataIndex<PointT> ());
-    else
-      tree_.reset (new pcl::KdTreeFLANN<PointT> (false));
-  }
 
-  // Send the input dataset to the spatial locator
-  tree_->setInputCloud (input_);
+  // Decide which points have enough neighbors
+  inliers_.resize (indices_->size ());
+  if (input_->isOrganized () || !searchGrid ())
+    searchTree ();
 
-  // Allocate enough space to hold the results
-  std::vector<int> nn_indices (indices_->size ());
-  std::vector<float> nn_dists (indices_->size ());
-
-
-  output.points.resize (input_->points.size ());      // reserve enough space
+  // Keep the layout and mark the outliers, or build a new cloud by neglecting them
+  if (keep_organized_)
+  {
+    if (&output != input_.get ())
+      output = *input_;
+  }
+  else
+    output.points.resize (input_->points.size ());      // reserve enough space
   removed_indices_->resize (input_->points.size ());
   
   int nr_p = 0;
   int nr_removed_p = 0;
   
-  // Go over all the points and check which doesn't have enough neighbors
   for (size_t cp = 0; cp < indices_->size (); ++cp)
   {
-    int k = tree_->radiusSearch ((*indices_)[cp], search_radius_, nn_indices, nn_dists);
-    // Check if the number of neighbors is larger than the user imposed limit
-    if (k < min_pts_radius_)
+    if (!inliers_[cp])
     {
       if (extract_removed_indices_)
       {
         (*removed_indices_)[nr_removed_p] = cp;
         nr_removed_p++;
       }
+      if (keep_organized_)
+      {
+        PointT &pt = output.points[(*indices_)[cp]];
+        pt.x = pt.y = pt.z = user_filter_value_;
+      }
       continue;
     }
 
-    output.points[nr_p++] = input_->points[(*indices_)[cp]];
+    if (!keep_organized_)
+      output.points[nr_p++] = input_->points[(*indices_)[cp]];
   }
   removed_indices_->resize (nr_removed_p);
+
+  if (keep_organized_)
+  {
+    // Check what the user value is: if !finite, set is_dense to false
+    if (!pcl_isfinite (user_filter_value_))
+      output.is_dense = false;
+    return;
+  }
   output.points.resize (nr_p);
   output.width  = nr_p;
   output.height = 1;
   output.is_dense = true; // radiusSearch filters invalid points
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::RadiusOutlierRemoval<PointT>::applyFilterIndices (std::vector<int> &indices)
+{
+  if (search_radius_ == 0.0)
+  {
+    PCL_ERROR ("[pcl::%s::applyFilter] No radius defined!\n", getClassName ().c_str ());
+    indices.clear ();
+    return;
+  }
+
+  // Decide which points have enough neighbors
+  inliers_.resize (indices_->size ());
+  if (input_->isOrganized () || !searchGrid ())
+    searchTree ();
+
+  indices.resize (indices_->size ());
+  removed_indices_->resize (indices_->size ());
+
+  int nr_p = 0;
+  int nr_removed_p = 0;
+
+  for (size_t cp = 0; cp < indices_->size (); ++cp)
+  {
+    if (inliers_[cp])
+      indices[nr_p++] = (*indices_)[cp];
+    else if (extract_removed_indices_)
+      (*removed_indices_)[nr_removed_p++] = cp;
+  }
+
+  indices.resize (nr_p);
+  removed_indices_->resize (nr_removed_p);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::RadiusOutlierRemoval<PointT>::searchTree ()
+{
+  // Initialize the spatial locator
+  if (!tree_)
+  {
+    if (input_->isOrganized ())
+      tree_.reset (new pcl::OrganizedDataIndex<PointT> ());
+    else
+      tree_.reset (new pcl::KdTreeFLANN<PointT> (false));
+  }
+
+  // Send the input dataset to the spatial locator. Only the points in indices_ count as neighbors,
+  // except in organized clouds, which are searched in the image
+  const bool whole_cloud = fake_indices_ || input_->isOrganized ();
+  if (whole_cloud)
+    tree_->setInputCloud (input_);
+  else
+    tree_->setInputCloud (input_, indices_);
+
+  // Allocate enough space to hold the results
+  std::vector<int> nn_indices (indices_->size ());
+  std::vector<float> nn_dists (indices_->size ());
+
+  // Go over all the points and check which doesn't have enough neighbors
+  for (size_t cp = 0; cp < indices_->size (); ++cp)
+  {
+    int k = tree_->radiusSearch (whole_cloud ? (*indices_)[cp] : (int)cp, search_radius_, nn_indices, nn_dists);
+    // Check if the number of neighbors is larger than the user imposed limit
+    inliers_[cp] = (k >= min_pts_radius_);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> bool
+pcl::RadiusOutlierRemoval<PointT>::searchGrid ()
+{
+  // Every point passes, even the invalid ones, as with the tree
+  if (min_pts_radius_ <= 0)
+  {
+    inliers_.assign (indices_->size (), true);
+    return (true);
+  }
+
+  // Bounds of the valid points, only the points in indices_ count as neighbors
+  Eigen::Array3d min_p, max_p;
+  min_p.setConstant (std::numeric_limits<double>::max ());
+  max_p.setConstant (-std::numeric_limits<double>::max ());
+  for (size_t cp = 0; cp < indices_->size (); ++cp)
+  {
+    const PointT &p = input_->points[(*indices_)[cp]];
+    if (!pcl_isfinite (p.x) || !pcl_isfinite (p.y) || !pcl_isfinite (p.z))
+      continue;
+    const Eigen::Array3d pt (p.x, p.y, p.z);
+    min_p = min_p.min (pt);
+    max_p = max_p.max (pt);
+  }
+
+  // Invalid points never have neighbors
+  inliers_.assign (indices_->size (), false);
+  if ((min_p > max_p).any ())
+    return (true);
+
+  // Cells are a hair larger than the radius, so that rounding can't put two points
+  // closer than the radius more than one cell apart
+  inv_cell_size_ = 1.0 / (search_radius_ * (1.0 + 1e-5));
+  grid_min_ = min_p.matrix ();
+
+  double nr_cells = 1.0;
+  for (int d = 0; d < 3; ++d)
+  {
+    const double size = floor ((max_p[d] - min_p[d]) * inv_cell_size_) + 1.0;
+    nr_cells *= size;
+    if (nr_cells > static_cast<double> (std::numeric_limits<boost::int64_t>::max ()))
+    {
+      PCL_WARN ("[pcl::%s::applyFilter] Search radius is too small for the grid, using the tree instead.\n",
+                getClassName ().c_str ());
+      return (false);
+    }
+    grid_dims_[d] = static_cast<boost::uint64_t> (size);
+  }
+  const boost::uint64_t max_cell = grid_dims_[0] * grid_dims_[1] * grid_dims_[2] - 1;
+
+  // Bin the valid points by their position in indices_, and sort them by cell. Every
+  // point is both a query and a neighbor of the others.
+  cell_points_.clear ();
+  cell_points_.reserve (indices_->size ());
+  for (size_t cp = 0; cp < indices_->size (); ++cp)
+  {
+    VoxelPointIndex vpi;
+    if (!getCell (input_->points[(*indices_)[cp]], vpi.voxel))
+      continue;
+    vpi.index = static_cast<unsigned int> (cp);
+    cell_points_.push_back (vpi);
+  }
+  sortVoxelPointIndices (cell_points_, cell_buffer_, max_cell);
+
+  // Copy the coordinates in cell order and find where every cell starts
+  cell_xyz_.resize (cell_points_.size () * 3);
+  cells_.clear ();
+  cell_starts_.clear ();
+  for (size_t i = 0; i < cell_points_.size (); ++i)
+  {
+    const PointT &p = input_->points[(*indices_)[cell_points_[i].index]];
+    cell_xyz_[i * 3 + 0] = p.x;
+    cell_xyz_[i * 3 + 1] = p.y;
+    cell_xyz_[i * 3 + 2] = p.z;
+
+    if (i == 0 || cell_points_[i].voxel != cell_points_[i - 1].voxel)
+    {
+      cells_.push_back (cell_points_[i].voxel);
+      cell_starts_.push_back (i);
+    }
+  }
+  cell_starts_.push_back (cell_points_.size ());
+
+  // Count the neighbors, one occupied cell at a time
+  const int nr_cells_occupied = static_cast<int> (cells_.size ());
+  const VoxelPointIndex *points = &cell_points_[0];
+#pragma omp parallel for num_threads (threads_) schedule (dynamic, 64)
+  for (int c = 0; c < nr_cells_occupied; ++c)
+    searchCell (points + cell_starts_[c], points + cell_starts_[c + 1]);
+
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::RadiusOutlierRemoval<PointT>::searchCell (const VoxelPointIndex *first, const VoxelPointIndex *last)
+{
+  const boost::uint64_t cell = first->voxel;
+  const boost::int64_t nx = grid_dims_[0], ny = grid_dims_[1], nz = grid_dims_[2];
+  const boost::int64_t ix = cell % nx, iy = (cell / nx) % ny, iz = cell / (nx * ny);
+
+  // The 27 cells around the query cell, as up to 9 runs of consecutive cells along x.
+  // The run of the query cell itself goes first, it has most of the neighbors.
+  typedef std::vector<boost::uint64_t>::const_iterator CellIterator;
+  const CellIterator cells_begin = cells_.begin (), cells_end = cells_.end ();
+  size_t ranges[9][2];
+  int nr_ranges = 0;
+  for (int i = 0; i < 9; ++i)
+  {
+    const boost::int64_t y = iy + (i + 4) % 9 % 3 - 1;
+    const boost::int64_t z = iz + (i + 4) % 9 / 3 - 1;
+    if (y < 0 || y >= ny || z < 0 || z >= nz)
+      continue;
+
+    const boost::uint64_t row = (z * ny + y) * nx;
+    const boost::uint64_t lo = row + std::max<boost::int64_t> (ix - 1, 0);
+    const boost::uint64_t hi = row + std::min<boost::int64_t> (ix + 1, nx - 1);
+
+    const CellIterator begin = std::lower_bound (cells_begin, cells_end, lo);
+    const CellIterator end = std::upper_bound (begin, cells_end, hi);
+    if (begin == end)
+      continue;
+
+    ranges[nr_ranges][0] = cell_starts_[begin - cells_begin] * 3;
+    ranges[nr_ranges][1] = cell_starts_[end - cells_begin] * 3;
+    nr_ranges++;
+  }
+
+  // Same squared distance as the kd-tree, the point itself is counted too
+  const float sqr_radius = static_cast<float> (search_radius_ * search_radius_);
+  const float *xyz = &cell_xyz_[0];
+
+  for (const VoxelPointIndex *q = first; q != last; ++q)
+  {
+    const PointT &p = input_->points[(*indices_)[q->index]];
+    int k = 0;
+    for (int r = 0; r < nr_ranges && k < min_pts_radius_; ++r)
+    {
+      for (size_t j = ranges[r][0]; j < ranges[r][1]; j += 3)
+      {
+        const float dx = p.x - xyz[j], dy = p.y - xyz[j + 1], dz = p.z - xyz[j + 2];
+        float dist = 0.0f;
+        dist += dx * dx;
+        dist += dy * dy;
+        dist += dz * dz;
+        if (dist < sqr_radius && ++k >= min_pts_radius_)
+          break;
+      }
+    }
+    inliers_[q->index] = (k >= min_pts_radius_);
+  }
+}
+
 #define PCL_INSTANTIATE_RadiusOutlierRemoval(T) template class PCL_EXPORTS pcl::RadiusOutlierRemoval<T>;
 
 #endif    // PCL_FILTERS_IMPL_RADIUS_OUTLIER_REMOVAL_H_
@@ -43,106 +43,209 @@
 #include <pcl/kdtree/organized_data.h>
 
 //////////////////////////////////////////////////////////////////////////////////////////////
-template <typename PointT> void
-pcl::StatisticalOutlierRemoval<PointT>::applyFilter (PointCloud &output)
+template <typename PointT> double
+pcl::StatisticalOutlierRemoval<PointT>::computeMeanDistances (std::vector<float> &distances)
 {
-  if (std_mul_ == 0.0)
-  {
-    PCL_ERROR ("[pcl::%s::applyFilter] Standard deviation multiplier not set!\n", getClassName ().c_str ());
-    output.width = output.height = 0;
-    output.points.clear ();
-    return;
-  }
+  const int nr_points = (int)indices_->size ();
 
-  // Initialize the spatial locator
-  if (!tree_)
+  // Reuse the neighbors of an earlier stage if there are enough of them
+  const bool use_cache = neighbor_cache_ && neighbor_cache_->holds (input_, nr_points, mean_k_);
+  const bool organized = input_->isOrganized ();
+  const bool whole_cloud = fake_indices_ || organized;
+  if (!use_cache)
   {
-    if (input_->isOrganized ())
-      tree_.reset (new pcl::OrganizedDataIndex<PointT> ());
+    // Initialize the spatial locator, or replace it if the cloud was organized last time and isn't anymore
+    if (!tree_ || organized != (dynamic_cast<pcl::OrganizedDataIndex<PointT>*> (tree_.get ()) != NULL))
+    {
+      if (organized)
+        tree_.reset (new pcl::OrganizedDataIndex<PointT> ());
+      else
+        tree_.reset (new pcl::KdTreeFLANN<PointT> (false));
+    }
+
+    // Send the input dataset to the spatial locator. Only the points in indices_ count as
+    // neighbors, except in organized clouds, which are searched in the image
+    if (whole_cloud)
+      tree_->setInputCloud (input_);
     else
-      tree_.reset (new pcl::KdTreeFLANN<PointT> (false));
-  }
+      tree_->setInputCloud (input_, indices_);
 
-  // Send the input dataset to the spatial locator
-  tree_->setInputCloud (input_);
+    // Keep the neighbors for the next stages. Neighbors among a subset of the points are of no use to
+    // the stages searching the whole cloud, so they are not tied to it
+    if (neighbor_cache_)
+    {
+      neighbor_cache_->k = mean_k_;
+      if (whole_cloud)
+        neighbor_cache_->cloud = input_;
+      else
+        neighbor_cache_->cloud.reset ();
+      neighbor_cache_->indices.resize ((size_t)nr_points * mean_k_);
+      neighbor_cache_->sqr_distances.resize ((size_t)nr_points * mean_k_);
+    }
+  }
+  const int cache_k = neighbor_cache_ ? neighbor_cache_->k : 0;
 
-  // Allocate enough space to hold the results
-  std::vector<int> nn_indices (mean_k_);
-  std::vector<float> nn_dists (mean_k_);
+  // OrganizedDataIndex sets up its search window in every search, so it can't be shared by several threads
+  const unsigned int nr_threads = (!use_cache && organized) ? 1 : threads_;
 
-  std::vector<float> distances (indices_->size ());
-  // Go over all the points and calculate the mean or smallest distance
-  for (size_t cp = 0; cp < indices_->size (); ++cp)
+  distances.resize (nr_points);
+  // Go over all the points and calculate the mean or smallest distance. Every thread owns a contiguous range
+#pragma omp parallel num_threads (nr_threads)
   {
-    if (!pcl_isfinite (input_->points[(*indices_)[cp]].x) ||
-        !pcl_isfinite (input_->points[(*indices_)[cp]].y) ||
-        !pcl_isfinite (input_->points[(*indices_)[cp]].z))
-    {
-      distances[cp] = 0;
-      continue;
-    }
+    // Allocate enough space to hold the results
+    std::vector<int> nn_indices (mean_k_);
+    std::vector<float> nn_dists (mean_k_);
 
-    if (tree_->nearestKSearch ((*indices_)[cp], mean_k_, nn_indices, nn_dists) == 0)
+#pragma omp for schedule (static)
+    for (int cp = 0; cp < nr_points; ++cp)
     {
-      distances[cp] = 0;
-      PCL_WARN ("[pcl::%s::applyFilter] Searching for the closest %d neighbors failed.\n", getClassName ().c_str (), mean_k_);
-      continue;
-    }
+      const float *dists;
+      if (use_cache)
+        dists = &neighbor_cache_->sqr_distances[(size_t)cp * cache_k];
+      else
+      {
+        bool valid = pcl_isfinite (input_->points[(*indices_)[cp]].x) &&
+                     pcl_isfinite (input_->points[(*indices_)[cp]].y) &&
+                     pcl_isfinite (input_->points[(*indices_)[cp]].z);
+        if (valid && tree_->nearestKSearch (whole_cloud ? (*indices_)[cp] : cp, mean_k_, nn_indices, nn_dists) == 0)
+        {
+          PCL_WARN ("[pcl::%s::applyFilter] Searching for the closest %d neighbors failed.\n", getClassName ().c_str (), mean_k_);
+          valid = false;
+        }
+
+        if (!valid)
+        {
+          distances[cp] = 0;
+          if (neighbor_cache_)
+          {
+            std::fill_n (&neighbor_cache_->indices[(size_t)cp * cache_k], cache_k, -1);
+            std::fill_n (&neighbor_cache_->sqr_distances[(size_t)cp * cache_k], cache_k, 0.0f);
+          }
+          continue;
+        }
+
+        if (neighbor_cache_)
+        {
+          // A tree built on indices_ returns positions in indices_, the cache holds point indices
+          int *cache_indices = &neighbor_cache_->indices[(size_t)cp * cache_k];
+          for (int j = 0; j < mean_k_; ++j)
+            cache_indices[j] = whole_cloud ? nn_indices[j] : (*indices_)[nn_indices[j]];
+          std::copy (nn_dists.begin (), nn_dists.begin () + mean_k_, &neighbor_cache_->sqr_distances[(size_t)cp * cache_k]);
+        }
+        dists = &nn_dists[0];
+      }
 
-    // Minimum distance (if mean_k_ == 2) or mean distance
-    double dist_sum = 0;
-    for (int j = 1; j < mean_k_; ++j)
-      dist_sum += sqrt (nn_dists[j]);
-    distances[cp] = dist_sum / (mean_k_-1);
+      // Minimum distance (if mean_k_ == 2) or mean distance
+      double dist_sum = 0;
+      for (int j = 1; j < mean_k_; ++j)
+        dist_sum += sqrt (dists[j]);
+      distances[cp] = dist_sum / (mean_k_-1);
+    }
   }
 
   // Estimate the mean and the standard deviation of the distance vector
   double mean, stddev;
   getMeanStd (distances, mean, stddev);
-  double distance_threshold = mean + std_mul_ * stddev; // a distance that is bigger than this signals an outlier
+  return (mean + std_mul_ * stddev); // a distance that is bigger than this signals an outlier
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::StatisticalOutlierRemoval<PointT>::applyFilter (PointCloud &output)
+{
+  if (std_mul_ == 0.0)
+  {
+    PCL_ERROR ("[pcl::%s::applyFilter] Standard deviation multiplier not set!\n", getClassName ().c_str ());
+    output.width = output.height = 0;
+    output.points.clear ();
+    return;
+  }
+
+  std::vector<float> distances;
+  double distance_threshold = computeMeanDistances (distances);
 
-  output.points.resize (input_->points.size ());      // reserve enough space
+  // Keep the layout and mark the outliers, or build a new cloud by neglecting them
+  if (keep_organized_)
+  {
+    if (&output != input_.get ())
+      output = *input_;
+  }
+  else
+    output.points.resize (input_->points.size ());      // reserve enough space
   removed_indices_->resize (input_->points.size ());
   
-  // Build a new cloud by neglecting outliers
   int nr_p = 0;
   int nr_removed_p = 0;
   
   for (size_t cp = 0; cp < indices_->size (); ++cp)
   {
-    if (negative_)
+    const bool outlier = negative_ ? (distances[cp] <= distance_threshold) : (distances[cp] > distance_threshold);
+    if (outlier)
     {
-      if (distances[cp] <= distance_threshold)
+      if (extract_removed_indices_)
       {
-        if (extract_removed_indices_)
-        {
-          (*removed_indices_)[nr_removed_p] = cp;
-          nr_removed_p++;
-        }
-        continue;
+        (*removed_indices_)[nr_removed_p] = cp;
+        nr_removed_p++;
       }
-    }
-    else
-    {
-      if (distances[cp] > distance_threshold)
+      if (keep_organized_)
       {
-        if (extract_removed_indices_)
-        {
-          (*removed_indices_)[nr_removed_p] = cp;
-          nr_removed_p++;
-        }
-        continue;
+        PointT &pt = output.points[(*indices_)[cp]];
+        pt.x = pt.y = pt.z = user_filter_value_;
       }
+      continue;
     }
 
-    output.points[nr_p++] = input_->points[(*indices_)[cp]];
+    if (!keep_organized_)
+      output.points[nr_p++] = input_->points[(*indices_)[cp]];
+  }
+
+  if (keep_organized_)
+  {
+    // Check what the user value is: if !finite, set is_dense to false
+    if (!pcl_isfinite (user_filter_value_))
+      output.is_dense = false;
+  }
+  else
+  {
+    output.points.resize (nr_p);
+    output.width  = nr_p;
+    output.height = 1;
+    output.is_dense = true; // nearestKSearch filters invalid points
   }
 
-  output.points.resize (nr_p);
-  output.width  = nr_p;
-  output.height = 1;
-  output.is_dense = true; // nearestKSearch filters invalid points
+  removed_indices_->resize (nr_removed_p);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::StatisticalOutlierRemoval<PointT>::applyFilterIndices (std::vector<int> &indices)
+{
+  if (std_mul_ == 0.0)
+  {
+    PCL_ERROR ("[pcl::%s::applyFilter] Standard deviation multiplier not set!\n", getClassName ().c_str ());
+    indices.clear ();
+    return;
+  }
+
+  std::vector<float> distances;
+  double distance_threshold = computeMeanDistances (distances);
+
+  indices.resize (indices_->size ());
+  removed_indices_->resize (indices_->size ());
+
+  int nr_p = 0;
+  int nr_removed_p = 0;
+
+  for (size_t cp = 0; cp < indices_->size (); ++cp)
+  {
+    const bool outlier = negative_ ? (distances[cp] <= distance_threshold) : (distances[cp] > distance_threshold);
+    if (!outlier)
+      indices[nr_p++] = (*indices_)[cp];
+    else if (extract_removed_indices_)
+      (*removed_indices_)[nr_removed_p++] = cp;
+  }
 
+  indices.resize (nr_p);
   removed_indices_->resize (nr_removed_p);
 }
 
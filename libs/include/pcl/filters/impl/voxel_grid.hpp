@@ -131,6 +131,18 @@ pcl::VoxelGrid<PointT>::applyFilter (PointCloud &output)
     return;
   }
 
+  // The centroids are read from the input after the output is resized, filter in place through a copy
+  if (&output == input_.get ())
+  {
+    PointCloud output_temp;
+    applyFilter (output_temp);
+    output.points.swap (output_temp.points);
+    output.width    = output_temp.width;
+    output.height   = output_temp.height;
+    output.is_dense = output_temp.is_dense;
+    return;
+  }
+
   // Copy the header (and thus the frame_id) + allocate enough space for points
   output.height       = 1;                    // downsampling breaks the organized structure
   output.is_dense     = true;                 // we filter out invalid points
@@ -141,44 +153,67 @@ pcl::VoxelGrid<PointT>::applyFilter (PointCloud &output)
     getMinMax3D<PointT>(input_, filter_field_name_, filter_limit_min_, filter_limit_max_, min_p, max_p, filter_limit_negative_);
   else
     getMinMax3D<PointT>(*input_, min_p, max_p);
+  // The grid only spans the part of the crop box holding points, a large box would need a huge grid
+  if (use_crop_box_)
+  {
+    min_p = min_p.cwiseMax (crop_min_);
+    max_p = max_p.cwiseMin (crop_max_);
+  }
+
+  // Compute the minimum and maximum bounding box values, the same way as the voxels of the points
+  double min_b[3], max_b[3], nr_divisions[3];
+  for (int d = 0; d < 3; ++d)
+  {
+    min_b[d] = floor (min_p[d] * inverse_leaf_size_[d]);
+    max_b[d] = floor (max_p[d] * inverse_leaf_size_[d]);
+    nr_divisions[d] = max_b[d] - min_b[d] + 1;
+  }
 
-  // Compute the minimum and maximum bounding box values
-//  min_b_ = (min_p.array () * inverse_leaf_size_).template cast<int> ();
-//  max_b_ = (max_p.array () * inverse_leaf_size_).template cast<int> ();
-  min_b_[0] = (int)(floor (min_p[0] * inverse_leaf_size_[0]));
-  max_b_[0] = (int)(floor (max_p[0] * inverse_leaf_size_[0]));
-  min_b_[1] = (int)(floor (min_p[1] * inverse_leaf_size_[1]));
-  max_b_[1] = (int)(floor (max_p[1] * inverse_leaf_size_[1]));
-  min_b_[2] = (int)(floor (min_p[2] * inverse_leaf_size_[2]));
-  max_b_[2] = (int)(floor (max_p[2] * inverse_leaf_size_[2]));
+  // No points (in the crop box)
+  if (!(nr_divisions[0] >= 1 && nr_divisions[1] >= 1 && nr_divisions[2] >= 1))
+  {
+    output.width = 0;
+    output.points.clear ();
+    return;
+  }
+
+  // The voxel indices are 64 bit, but the bounds, the divisions and the leaf layout are int
+  const double max_cells = save_leaf_layout_ ? static_cast<double> (std::numeric_limits<int>::max ())
+                                             : static_cast<double> (std::numeric_limits<boost::uint64_t>::max ());
+  bool overflow = nr_divisions[0] * nr_divisions[1] * nr_divisions[2] > max_cells;
+  for (int d = 0; d < 3; ++d)
+    overflow = overflow || min_b[d] < std::numeric_limits<int>::min () || max_b[d] > std::numeric_limits<int>::max () ||
+               nr_divisions[d] > std::numeric_limits<int>::max ();
+  if (overflow)
+  {
+    PCL_ERROR ("[pcl::%s::applyFilter] The leaf size is too small for the extent of the input (or the crop box)!\n", getClassName ().c_str ());
+    output.width = 0;
+    output.points.clear ();
+    return;
+  }
+  for (int d = 0; d < 3; ++d)
+  {
+    min_b_[d] = (int)min_b[d];
+    max_b_[d] = (int)max_b[d];
+  }
 
   // Compute the number of divisions needed along all axis
   div_b_ = max_b_ - min_b_ + Eigen::Vector4i::Ones ();
   div_b_[3] = 0;
 
-  // Clear the leaves
-  leaves_.clear ();
-
   // Set up the division multiplier
   divb_mul_ = Eigen::Vector4i (1, div_b_[0], div_b_[0] * div_b_[1], 0);
 
-  int centroid_size = 4;
-  if (downsample_all_data_)
-    centroid_size = boost::mpl::size<FieldList>::value;
-
   // ---[ RGB special case
   std::vector<sensor_msgs::PointField> fields;
-  int rgba_index = -1;
-  rgba_index = pcl::getFieldIndex (*input_, "rgb", fields);
-  if (rgba_index == -1)
-    rgba_index = pcl::getFieldIndex (*input_, "rgba", fields);
-  if (rgba_index >= 0)
-  {
-    rgba_index = fields[rgba_index].offset;
-    centroid_size += 3;
-  }
+  rgba_offset_ = pcl::getFieldIndex (*input_, "rgb", fields);
+  if (rgba_offset_ == -1)
+    rgba_offset_ = pcl::getFieldIndex (*input_, "rgba", fields);
+  if (rgba_offset_ >= 0)
+    rgba_offset_ = fields[rgba_offset_].offset;
 
   // If we don't want to process the entire cloud, but rather filter points far away from the viewpoint first...
+  distance_offset_ = -1;
   if (!filter_field_name_.empty ())
   {
     // Get the distance field index
@@ -186,181 +221,308 @@ pcl::VoxelGrid<PointT>::applyFilter (PointCloud &output)
     int distance_idx = pcl::getFieldIndex (*input_, filter_field_name_, fields);
     if (distance_idx == -1)
       PCL_WARN ("[pcl::%s::applyFilter] Invalid filter field name. Index is %d.\n", getClassName ().c_str (), distance_idx);
+    else
+      distance_offset_ = fields[distance_idx].offset;
+  }
+
+  if (threads_ > 1 && indices_->size () > threads_)
+    applyFilterParallel (output);
+  else
+    applyFilterSerial (output);
+
+  output.width = output.points.size ();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> inline bool
+pcl::VoxelGrid<PointT>::getVoxelIndex (const PointT &point, boost::uint64_t &voxel) const
+{
+  if (use_crop_box_)
+  {
+    // Also rejects NaNs, any comparison with them is false
+    if (!(point.x >= crop_min_[0] && point.x <= crop_max_[0] &&
+          point.y >= crop_min_[1] && point.y <= crop_max_[1] &&
+          point.z >= crop_min_[2] && point.z <= crop_max_[2]))
+      return (false);
+  }
+  else if (!input_->is_dense)
+    // Check if the point is invalid
+    if (!pcl_isfinite (point.x) || !pcl_isfinite (point.y) || !pcl_isfinite (point.z))
+      return (false);
+
+  if (distance_offset_ >= 0)
+  {
+    // Get the distance value
+    float distance_value = 0;
+    memcpy (&distance_value, (const uint8_t*)&point + distance_offset_, sizeof (float));
 
-    // First pass: go over all points and insert them into the right leaf
-    for (size_t cp = 0; cp < input_->points.size (); ++cp)
+    if (filter_limit_negative_)
     {
-      if (!input_->is_dense)
-        // Check if the point is invalid
-        if (!pcl_isfinite (input_->points[cp].x) || 
-            !pcl_isfinite (input_->points[cp].y) || 
-            !pcl_isfinite (input_->points[cp].z))
-          continue;
+      // Use a threshold for cutting out points which inside the interval
+      if ((distance_value < filter_limit_max_) && (distance_value > filter_limit_min_))
+        return (false);
+    }
+    else
+    {
+      // Use a threshold for cutting out points which are too close/far away
+      if ((distance_value > filter_limit_max_) || (distance_value < filter_limit_min_))
+        return (false);
+    }
+  }
 
-      // Get the distance value
-      uint8_t* pt_data = (uint8_t*)&input_->points[cp];
-      float distance_value = 0;
-      memcpy (&distance_value, pt_data + fields[distance_idx].offset, sizeof (float));
+  int i = (int)(floor (point.x * inverse_leaf_size_[0])) - min_b_[0];
+  int j = (int)(floor (point.y * inverse_leaf_size_[1])) - min_b_[1];
+  int k = (int)(floor (point.z * inverse_leaf_size_[2])) - min_b_[2];
 
-      if (filter_limit_negative_)
-      {
-        // Use a threshold for cutting out points which inside the interval
-        if ((distance_value < filter_limit_max_) && (distance_value > filter_limit_min_))
-          continue;
-      }
-      else
-      {
-        // Use a threshold for cutting out points which are too close/far away
-        if ((distance_value > filter_limit_max_) || (distance_value < filter_limit_min_))
-          continue;
-      }
+  // Voxel indices are 64 bit, fine grids over large extents easily overflow an int
+  voxel = (boost::uint64_t)i + (boost::uint64_t)div_b_[0] * ((boost::uint64_t)j + (boost::uint64_t)div_b_[1] * k);
+  return (true);
+}
 
-      Eigen::Vector4i ijk = Eigen::Vector4i::Zero ();
-      ijk[0] = (int)(floor (input_->points[cp].x * inverse_leaf_size_[0]));
-      ijk[1] = (int)(floor (input_->points[cp].y * inverse_leaf_size_[1]));
-      ijk[2] = (int)(floor (input_->points[cp].z * inverse_leaf_size_[2]));
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::VoxelGrid<PointT>::computeCentroid (const VoxelPointIndex *first, const VoxelPointIndex *last, PointT &centroid) const
+{
+  const float nr_points = (float)(last - first);
 
-      // Compute the centroid leaf index
-      int idx = (ijk - min_b_).dot (divb_mul_);
-//      int idx = (((input_->points[cp].getArray4fMap () * inverse_leaf_size_).template cast<int> ()).matrix () - min_b_).dot (divb_mul_);
-      Leaf& leaf = leaves_[idx];
-      if (leaf.nr_points == 0)
-      {
-        leaf.centroid.resize (centroid_size);
-        leaf.centroid.setZero ();
-      }
+  // Do we need to process all the fields?
+  if (!downsample_all_data_)
+  {
+    Eigen::Array4f sum = Eigen::Array4f::Zero ();
+    for (const VoxelPointIndex *it = first; it != last; ++it)
+      sum += input_->points[it->index].getArray4fMap ();
+    sum /= nr_points;
+
+    centroid.x = sum[0];
+    centroid.y = sum[1];
+    centroid.z = sum[2];
+    return;
+  }
 
-      // Do we need to process all the fields?
-      if (!downsample_all_data_)
-      {
-        Eigen::Vector4f pt (input_->points[cp].x, input_->points[cp].y, input_->points[cp].z, 0);
-        leaf.centroid.template head<4> () += pt;
-      }
-      else
-      {
-        // Copy all the fields
-        Eigen::VectorXf centroid = Eigen::VectorXf::Zero (centroid_size);
-        // ---[ RGB special case
-        if (rgba_index >= 0)
-        {
-          // fill r/g/b data
-          pcl::RGB rgb;
-          memcpy (&rgb, ((char *)&(input_->points[cp])) + rgba_index, sizeof (RGB));
-          centroid[centroid_size-3] = rgb.r;
-          centroid[centroid_size-2] = rgb.g;
-          centroid[centroid_size-1] = rgb.b;
-        }
-        pcl::for_each_type <FieldList> (NdCopyPointEigenFunctor <PointT> (input_->points[cp], centroid));
-        leaf.centroid += centroid;
-      }
-      ++leaf.nr_points;
+  static const int nr_fields = boost::mpl::size<FieldList>::value;
+  float sum[nr_fields + 3];
+  std::fill (sum, sum + nr_fields + 3, 0.0f);
+  for (const VoxelPointIndex *it = first; it != last; ++it)
+  {
+    const PointT &pt = input_->points[it->index];
+    pcl::for_each_type <FieldList> (NdAddPointArrayFunctor <PointT> (pt, sum));
+    // ---[ RGB special case
+    if (rgba_offset_ >= 0)
+    {
+      // Fill r/g/b data, assuming that the order is BGRA
+      pcl::RGB rgb;
+      memcpy (&rgb, ((const char *)&pt) + rgba_offset_, sizeof (RGB));
+      sum[nr_fields + 0] += rgb.r;
+      sum[nr_fields + 1] += rgb.g;
+      sum[nr_fields + 2] += rgb.b;
     }
   }
-  // No distance filtering, process all data
-  else
+  const float inv_nr_points = 1.0f / nr_points;
+  for (int f = 0; f < nr_fields + 3; ++f)
+    sum[f] *= inv_nr_points;
+
+  pcl::for_each_type <FieldList> (pcl::NdCopyArrayPointFunctor <PointT> (sum, centroid));
+  // ---[ RGB special case
+  if (rgba_offset_ >= 0)
   {
-    // First pass: go over all points and insert them into the right leaf
-    for (size_t cp = 0; cp < input_->points.size (); ++cp)
-    {
-      if (!input_->is_dense)
-        // Check if the point is invalid
-        if (!pcl_isfinite (input_->points[cp].x) || 
-            !pcl_isfinite (input_->points[cp].y) || 
-            !pcl_isfinite (input_->points[cp].z))
-          continue;
+    // pack r/g/b into rgb
+    float r = sum[nr_fields + 0], g = sum[nr_fields + 1], b = sum[nr_fields + 2];
+    int rgb = ((int)r) << 16 | ((int)g) << 8 | ((int)b);
+    memcpy (((char *)&centroid) + rgba_offset_, &rgb, sizeof (float));
+  }
+}
 
-      Eigen::Vector4i ijk = Eigen::Vector4i::Zero ();
-      ijk[0] = (int)(floor (input_->points[cp].x * inverse_leaf_size_[0]));
-      ijk[1] = (int)(floor (input_->points[cp].y * inverse_leaf_size_[1]));
-      ijk[2] = (int)(floor (input_->points[cp].z * inverse_leaf_size_[2]));
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::VoxelGrid<PointT>::applyFilterSerial (PointCloud &output)
+{
+  // First pass: compute the voxel index of every valid point
+  voxel_indices_.clear ();
+  voxel_indices_.reserve (indices_->size ());
+  boost::uint64_t max_voxel = 0;
+  for (size_t cp = 0; cp < indices_->size (); ++cp)
+  {
+    VoxelPointIndex vp;
+    if (!getVoxelIndex (input_->points[(*indices_)[cp]], vp.voxel))
+      continue;
+    vp.index = (unsigned int)(*indices_)[cp];
+    voxel_indices_.push_back (vp);
+
+    if (vp.voxel > max_voxel)
+      max_voxel = vp.voxel;
+  }
 
-      // Compute the centroid leaf index
-      int idx = (ijk - min_b_).dot (divb_mul_);
-      //int idx = (((input_->points[cp].getArray4fMap () * inverse_leaf_size_).template cast<int> ()).matrix () - min_b_).dot (divb_mul_);
-      Leaf& leaf = leaves_[idx];
-      if (leaf.nr_points == 0)
-      {
-        leaf.centroid.resize (centroid_size);
-        leaf.centroid.setZero ();
-      }
+  // Group the points of each voxel together
+  sortVoxelPointIndices (voxel_indices_, voxel_indices_buffer_, max_voxel);
 
-      // Do we need to process all the fields?
-      if (!downsample_all_data_)
-      {
-        Eigen::Vector4f pt (input_->points[cp].x, input_->points[cp].y, input_->points[cp].z, 0);
-        leaf.centroid.template head<4> () += pt;
-      }
-      else
-      {
-        // Copy all the fields
-        Eigen::VectorXf centroid = Eigen::VectorXf::Zero (centroid_size);
-        // ---[ RGB special case
-        if (rgba_index >= 0)
-        {
-          // Fill r/g/b data, assuming that the order is BGRA
-          pcl::RGB rgb;
-          memcpy (&rgb, ((char *)&(input_->points[cp])) + rgba_index, sizeof (RGB));
-          centroid[centroid_size-3] = rgb.r;
-          centroid[centroid_size-2] = rgb.g;
-          centroid[centroid_size-1] = rgb.b;
-        }
-        pcl::for_each_type <FieldList> (NdCopyPointEigenFunctor <PointT> (input_->points[cp], centroid));
-        leaf.centroid += centroid;
-      }
-      ++leaf.nr_points;
-    }
-  }
+  // Count the occupied voxels
+  size_t nr_voxels = 0;
+  for (size_t cp = 0; cp < voxel_indices_.size (); ++cp)
+    if (cp == 0 || voxel_indices_[cp].voxel != voxel_indices_[cp - 1].voxel)
+      ++nr_voxels;
+  output.points.resize (nr_voxels);
 
-  // Second pass: go over all leaves and compute centroids
-  output.points.resize (leaves_.size ());
-  int cp = 0, i = 0;
   if (save_leaf_layout_)
   {
     try
     {
-      leaf_layout_.resize (div_b_[0]*div_b_[1]*div_b_[2], -1);
+      leaf_layout_.assign (div_b_[0]*div_b_[1]*div_b_[2], -1);
     }
     catch (std::bad_alloc&)
     {
       throw PCLException("VoxelGrid bin size is too low; impossible to allocate memory for layout", 
-        "voxel_grid.hpp", "applyFilter");	
+        "voxel_grid.hpp", "applyFilterSerial");	
     }
   }
-  
-  for (typename boost::unordered_map<size_t, Leaf>::const_iterator it = leaves_.begin (); it != leaves_.end (); ++it)
+
+  // Second pass: go over all the runs of equal voxels and compute centroids
+  const VoxelPointIndex *first = voxel_indices_.empty () ? NULL : &voxel_indices_[0];
+  const VoxelPointIndex *end = first + voxel_indices_.size ();
+  for (size_t i = 0; i < nr_voxels; ++i)
   {
+    const VoxelPointIndex *last = first + 1;
+    while (last != end && last->voxel == first->voxel)
+      ++last;
+
     // Save leaf layout information for fast access to cells relative to current position
     if (save_leaf_layout_)
-      leaf_layout_[it->first] = cp++;
+      leaf_layout_[first->voxel] = (int)i;
 
-    // Normalize the centroid
-    const Leaf& leaf = it->second;
+    computeCentroid (first, last, output.points[i]);
+    first = last;
+  }
+}
 
-    // Normalize the centroid
-    Eigen::VectorXf centroid = leaf.centroid / leaf.nr_points;
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::VoxelGrid<PointT>::applyFilterParallel (PointCloud &output)
+{
+  const int nr_points = (int)indices_->size ();
+  const int nr_chunks = threads_;
+
+  // Split the grid into slabs of consecutive voxels, a few per thread to balance uneven clouds
+  const int nr_slabs = threads_ * 4;
+  const boost::uint64_t nr_cells = (boost::uint64_t)div_b_[0] * div_b_[1] * div_b_[2];
+  const boost::uint64_t slab_size = std::max<boost::uint64_t> ((nr_cells + nr_slabs - 1) / nr_slabs, 1);
+
+  // slab_offsets_[c * nr_slabs + s] counts the points of input chunk c falling into slab s. The last
+  // nr_slabs + 1 entries hold the first point index and then the first output voxel of every slab.
+  slab_offsets_.assign (nr_chunks * nr_slabs + nr_slabs + 1, 0);
+  size_t *slab_begin = &slab_offsets_[nr_chunks * nr_slabs];
+
+  // First pass: compute the voxel index of every input point, invalid points get the largest index
+  voxel_indices_buffer_.resize (nr_points);
+  VoxelPointIndex *voxels = &voxel_indices_buffer_[0];
+#pragma omp parallel for num_threads (threads_)
+  for (int c = 0; c < nr_chunks; ++c)
+  {
+    size_t *counts = &slab_offsets_[c * nr_slabs];
+    for (int cp = nr_points / nr_chunks * c, end = (c == nr_chunks - 1) ? nr_points : cp + nr_points / nr_chunks; cp < end; ++cp)
+    {
+      voxels[cp].index = (*indices_)[cp];
+      if (getVoxelIndex (input_->points[(*indices_)[cp]], voxels[cp].voxel))
+        ++counts[voxels[cp].voxel / slab_size];
+      else
+        voxels[cp].voxel = std::numeric_limits<boost::uint64_t>::max ();
+    }
+  }
 
-    // Do we need to process all the fields?
-    if (!downsample_all_data_)
+  // Place the points of every chunk after the ones of the previous chunks, slab by slab, so the
+  // points of each slab stay in input order
+  size_t nr_valid = 0;
+  for (int s = 0; s < nr_slabs; ++s)
+  {
+    slab_begin[s] = nr_valid;
+    for (int c = 0; c < nr_chunks; ++c)
     {
-      output.points[i].x = centroid[0];
-      output.points[i].y = centroid[1];
-      output.points[i].z = centroid[2];
+      size_t count = slab_offsets_[c * nr_slabs + s];
+      slab_offsets_[c * nr_slabs + s] = nr_valid;
+      nr_valid += count;
     }
-    else
+  }
+  slab_begin[nr_slabs] = nr_valid;
+
+  voxel_indices_.resize (nr_valid);
+  if (nr_valid == 0)
+  {
+    output.points.clear ();
+    if (save_leaf_layout_)
+      leaf_layout_.assign (div_b_[0]*div_b_[1]*div_b_[2], -1);
+    return;
+  }
+  VoxelPointIndex *indices = &voxel_indices_[0];
+#pragma omp parallel for num_threads (threads_)
+  for (int c = 0; c < nr_chunks; ++c)
+  {
+    size_t *offsets = &slab_offsets_[c * nr_slabs];
+    for (int cp = nr_points / nr_chunks * c, end = (c == nr_chunks - 1) ? nr_points : cp + nr_points / nr_chunks; cp < end; ++cp)
+      if (voxels[cp].voxel != std::numeric_limits<boost::uint64_t>::max ())
+        indices[offsets[voxels[cp].voxel / slab_size]++] = voxels[cp];
+  }
+
+  // Group the points of each voxel together, every slab is sorted on its own. The point voxels aren't
+  // needed anymore, the buffer is reused as scratch space. Reuse the chunk counts for the voxel counts.
+  size_t *slab_voxels = &slab_offsets_[0];
+#pragma omp parallel for num_threads (threads_) schedule (dynamic)
+  for (int s = 0; s < nr_slabs; ++s)
+  {
+    const size_t begin = slab_begin[s], n = slab_begin[s + 1] - slab_begin[s];
+    slab_voxels[s] = 0;
+    if (n == 0)
+      continue;
+
+    const boost::uint64_t max_voxel = std::min (nr_cells, (s + 1) * slab_size) - 1;
+    if (sortVoxelPointIndices (indices + begin, voxels + begin, n, max_voxel) != indices + begin)
+      std::copy (voxels + begin, voxels + begin + n, indices + begin);
+
+    for (size_t cp = begin; cp < begin + n; ++cp)
+      if (cp == begin || indices[cp].voxel != indices[cp - 1].voxel)
+        ++slab_voxels[s];
+  }
+
+  // The first output voxel of every slab
+  size_t nr_voxels = 0;
+  for (int s = 0; s < nr_slabs; ++s)
+  {
+    size_t count = slab_voxels[s];
+    slab_voxels[s] = nr_voxels;
+    nr_voxels += count;
+  }
+  output.points.resize (nr_voxels);
+
+  if (save_leaf_layout_)
+  {
+    try
     {
-      pcl::for_each_type <FieldList> (pcl::NdCopyEigenPointFunctor <PointT> (centroid, output.points[i]));
-      // ---[ RGB special case
-      if (rgba_index >= 0)
-      {
-        // pack r/g/b into rgb
-        float r = centroid[centroid_size-3], g = centroid[centroid_size-2], b = centroid[centroid_size-1];
-        int rgb = ((int)r) << 16 | ((int)g) << 8 | ((int)b);
-        memcpy (((char *)&output.points[i]) + rgba_index, &rgb, sizeof (float));
-      }
+      leaf_layout_.assign (div_b_[0]*div_b_[1]*div_b_[2], -1);
+    }
+    catch (std::bad_alloc&)
+    {
+      throw PCLException("VoxelGrid bin size is too low; impossible to allocate memory for layout", 
+        "voxel_grid.hpp", "applyFilterParallel");	
+    }
+  }
+
+  // Second pass: compute the centroids, slab by slab
+#pragma omp parallel for num_threads (threads_) schedule (dynamic)
+  for (int s = 0; s < nr_slabs; ++s)
+  {
+    const VoxelPointIndex *first = indices + slab_begin[s];
+    const VoxelPointIndex *end = indices + slab_begin[s + 1];
+    for (size_t i = slab_voxels[s]; first != end; ++i)
+    {
+      const VoxelPointIndex *last = first + 1;
+      while (last != end && last->voxel == first->voxel)
+        ++last;
+
+      // Save leaf layout information for fast access to cells relative to current position
+      if (save_leaf_layout_)
+        leaf_layout_[first->voxel] = (int)i;
+
+      computeCentroid (first, last, output.points[i]);
+      first = last;
     }
-    i++;
   }
-  output.width = output.points.size ();
 }
 
 #define PCL_INSTANTIATE_VoxelGrid(T) template class PCL_EXPORTS pcl::VoxelGrid<T>;
@@ -0,0 +1,143 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_FILTERS_ORGANIZED_DOWNSAMPLE_H_
+#define PCL_FILTERS_ORGANIZED_DOWNSAMPLE_H_
+
+#include "pcl/filters/filter.h"
+#include "pcl/filters/voxel_grid.h"
+
+namespace pcl
+{
+  ////////////////////////////////////////////////////////////////////////////////////////////
+  /** \brief @b OrganizedDownsample decimates an organized point cloud by an integer step
+    * along both image axes, so the output is still organized and can be processed with
+    * pcl::OrganizedDataIndex, pcl::OrganizedNeighborSearch or
+    * pcl::IntegralImageNormalEstimation.
+    *
+    * Every output point stands for a step x step block of input points. By default it is
+    * the centroid of the valid points in the block, like pcl::VoxelGrid computes it.
+    * With setAverage (false) the center point of the block is copied as is, which is
+    * cheaper and doesn't blend foreground and background at depth discontinuities.
+    * Blocks without a valid point give an invalid (NaN) output point. Trailing rows and
+    * columns that don't fill a whole block are dropped.
+    *
+    * \note The input indices are ignored, the whole image is decimated.
+    * \ingroup filters
+    */
+  template <typename PointT>
+  class OrganizedDownsample : public Filter<PointT>
+  {
+    using Filter<PointT>::input_;
+    using Filter<PointT>::filter_name_;
+    using Filter<PointT>::getClassName;
+
+    typedef typename Filter<PointT>::PointCloud PointCloud;
+    typedef typename PointCloud::Ptr PointCloudPtr;
+    typedef typename PointCloud::ConstPtr PointCloudConstPtr;
+
+    public:
+      /** \brief Empty constructor. */
+      OrganizedDownsample () : step_ (2), average_ (true), downsample_all_data_ (true)
+      {
+        filter_name_ = "OrganizedDownsample";
+      }
+
+      /** \brief Set the decimation step, i.e. the size of the square block of input points
+        * that make one output point.
+        * \param step the decimation step (values below 1 are treated as 1)
+        */
+      inline void
+      setStep (int step) { step_ = step < 1 ? 1 : step; }
+
+      /** \brief Get the decimation step. */
+      inline int
+      getStep () { return (step_); }
+
+      /** \brief Set whether the output points are the centroids of the valid points in
+        * their block (true, default) or copies of the center points of the blocks.
+        */
+      inline void
+      setAverage (bool average) { average_ = average; }
+
+      /** \brief Get whether the output points are centroids. */
+      inline bool
+      getAverage () { return (average_); }
+
+      /** \brief Set to true if all fields need to be averaged and not just XYZ.
+        * \param downsample the new value (true/false)
+        */
+      inline void
+      setDownsampleAllData (bool downsample) { downsample_all_data_ = downsample; }
+
+      /** \brief Get the state of the internal downsampling parameter. */
+      inline bool
+      getDownsampleAllData () { return (downsample_all_data_); }
+
+    protected:
+      /** \brief The decimation step. */
+      int step_;
+
+      /** \brief Average the valid points of a block instead of copying the center point. */
+      bool average_;
+
+      /** \brief Set to true if all fields need to be averaged and not just XYZ. */
+      bool downsample_all_data_;
+
+      typedef typename pcl::traits::fieldList<PointT>::type FieldList;
+
+      /** \brief Downsample an organized point cloud.
+        * \param output the resultant point cloud message
+        */
+      void
+      applyFilter (PointCloud &output);
+
+      /** \brief Compute the centroid of the valid points in a block.
+        * \param row the first input row of the block
+        * \param col the first input column of the block
+        * \param rgba_offset offset of the rgb/rgba field in PointT, or -1
+        * \param centroid the resultant centroid, left untouched if the block has no valid point
+        * \return false if the block has no valid point
+        */
+      bool
+      computeCentroid (int row, int col, int rgba_offset, PointT &centroid) const;
+  };
+}
+
+#include "pcl/filters/impl/organized_downsample.hpp"
+
+#endif  //#ifndef PCL_FILTERS_ORGANIZED_DOWNSAMPLE_H_
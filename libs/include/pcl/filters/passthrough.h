@@ -52,6 +52,7 @@ namespace pcl
   class PassThrough : public Filter<PointT>
   {
     using Filter<PointT>::input_;
+    using Filter<PointT>::indices_;
     using Filter<PointT>::filter_name_;
     using Filter<PointT>::filter_field_name_;
     using Filter<PointT>::filter_limit_min_;
@@ -112,6 +113,12 @@ namespace pcl
       void
       applyFilter (PointCloud &output);
 
+      /** \brief Select the points of indices_ that pass, invalid points never do.
+        * \param indices the resultant point indices
+        */
+      void
+      applyFilterIndices (std::vector<int> &indices);
+
       typedef typename pcl::traits::fieldList<PointT>::type FieldList;
 
     private:
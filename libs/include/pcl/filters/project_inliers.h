@@ -140,6 +140,14 @@ namespace pcl
       applyFilter (PointCloud &output);
 
     private:
+      /** \brief Project the inliers on a plane directly, without a sample consensus model. Gives
+        * the same result as SampleConsensusModelPlane::projectPoints.
+        * \param model_coefficients the plane coefficients (a, b, c, d)
+        * \param output the resultant point cloud
+        */
+      void
+      projectOnPlane (const Eigen::Vector4f &model_coefficients, PointCloud &output);
+
       /** \brief A pointer to the vector of model coefficients. */
       ModelCoefficientsConstPtr model_;
 
@@ -41,12 +41,24 @@
 #include "pcl/filters/filter.h"
 #include "pcl/point_types.h"
 #include "pcl/kdtree/kdtree_flann.h"
+#include "pcl/filters/voxel_grid.h"
 
 namespace pcl
 {
   //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
   /** \brief @b RadiusOutlierRemoval is a simple filter that removes outliers if the number of neighbors in a certain
     * search radius is smaller than a given K.
+    *
+    * Unorganized clouds are binned into a uniform grid with a cell size of the search
+    * radius, so the neighbors of a point can only be in the 27 cells around it. The
+    * points are processed cell by cell, and counting stops as soon as \a
+    * min_pts_radius_ neighbors are found. Organized clouds still use
+    * pcl::OrganizedDataIndex.
+    *
+    * Only the points in the input indices count as neighbors, so filtering a cloud
+    * through indices gives the same result as filtering a copy of the indexed points.
+    * Organized clouds are the exception, their neighbors are searched in the image.
+    *
     * \note setFilterFieldName (), setFilterLimits (), and setFilterLimitNegative () are ignored.
     * \author Radu Bogdan Rusu
     * \ingroup filters
@@ -56,6 +68,7 @@ namespace pcl
   {
     using Filter<PointT>::input_;
     using Filter<PointT>::indices_;
+    using Filter<PointT>::fake_indices_;
     using Filter<PointT>::filter_name_;
     using Filter<PointT>::getClassName;
 
@@ -72,7 +85,8 @@ namespace pcl
     public:
       /** \brief Empty constructor. */
       RadiusOutlierRemoval (bool extract_removed_indices = false) :
-        Filter<PointT>::Filter (extract_removed_indices), search_radius_ (0.0), min_pts_radius_ (1), tree_ ()
+        Filter<PointT>::Filter (extract_removed_indices), search_radius_ (0.0), min_pts_radius_ (1), tree_ (),
+        threads_ (1), keep_organized_ (false), user_filter_value_ (std::numeric_limits<float>::quiet_NaN ())
       {
         filter_name_ = "RadiusOutlierRemoval";
       }
@@ -113,6 +127,53 @@ namespace pcl
         return (min_pts_radius_);
       }
 
+      /** \brief Set whether the outliers should be kept and set to the value given through
+        * \a setUserFilterValue (default: NaN), or removed from the PointCloud, thus breaking
+        * its organized structure. By default, points are removed. Points that aren't in the
+        * input indices are copied unchanged when the structure is kept.
+        * \param val set to true whether the outliers should be kept and set to a given user value
+        */
+      inline void
+      setKeepOrganized (bool val)
+      {
+        keep_organized_ = val;
+      }
+
+      inline bool
+      getKeepOrganized ()
+      {
+        return (keep_organized_);
+      }
+
+      /** \brief Provide a value that the x, y and z of the outliers should be set to instead of
+        * removing them. Used in conjunction with \a setKeepOrganized ().
+        * \param val the user given value that the outlier coordinates should be set to
+        */
+      inline void
+      setUserFilterValue (float val)
+      {
+        user_filter_value_ = val;
+      }
+
+      /** \brief Set the number of threads to use. The occupied grid cells are shared out
+        * between the threads.
+        * \param nr_threads the number of hardware threads to use (0 is treated as 1)
+        */
+      inline void
+      setNumberOfThreads (unsigned int nr_threads)
+      {
+        if (nr_threads == 0)
+          nr_threads = 1;
+        threads_ = nr_threads;
+      }
+
+      /** \brief Get the number of threads to use. */
+      inline unsigned int
+      getNumberOfThreads ()
+      {
+        return (threads_);
+      }
+
     protected:
       /** \brief The nearest neighbors search radius for each point. */
       double search_radius_;
@@ -125,11 +186,86 @@ namespace pcl
       /** \brief A pointer to the spatial search object. */
       KdTreePtr tree_;
 
+      /** \brief The number of threads the filter should use. */
+      unsigned int threads_;
+
+      /** \brief Keep the structure of the data organized, by setting the outliers to a user
+        * given value (NaN by default).
+        */
+      bool keep_organized_;
+
+      /** \brief User given value to be set to the coordinates of any outlier. */
+      float user_filter_value_;
+
+      /** \brief Per position in \a indices_, whether the point has enough neighbors. */
+      std::vector<char> inliers_;
+
+      /** \brief The valid points (positions in \a indices_) with their grid cell, sorted by cell. */
+      std::vector<VoxelPointIndex> cell_points_;
+
+      /** \brief Scratch space for sorting. */
+      std::vector<VoxelPointIndex> cell_buffer_;
+
+      /** \brief The xyz coordinates of \a cell_points_, in the same order. */
+      std::vector<float> cell_xyz_;
+
+      /** \brief The occupied cells, in increasing order. */
+      std::vector<boost::uint64_t> cells_;
+
+      /** \brief Where the points of every occupied cell start in \a cell_points_, plus the end. */
+      std::vector<size_t> cell_starts_;
+
+      /** \brief The number of cells along x, y and z. */
+      boost::uint64_t grid_dims_[3];
+
+      /** \brief The minimum corner of the grid. */
+      Eigen::Vector3d grid_min_;
+
+      /** \brief The inverse of the cell size. */
+      double inv_cell_size_;
+
       /** \brief Apply the filter
         * \param output the resultant point cloud message
         */
       void
       applyFilter (PointCloud &output);
+
+      /** \brief Select the points of indices_ that have enough neighbors.
+        * \param indices the resultant point indices
+        */
+      void
+      applyFilterIndices (std::vector<int> &indices);
+
+      /** \brief Count the neighbors of every query point with the spatial locator and fill \a inliers_. */
+      void
+      searchTree ();
+
+      /** \brief Count the neighbors of every query point in the grid and fill \a inliers_.
+        * \return false if the grid would need more than 2^63 cells, \a inliers_ is left untouched then
+        */
+      bool
+      searchGrid ();
+
+      /** \brief Get the grid cell of a point.
+        * \return false if the point has non finite coordinates
+        */
+      inline bool
+      getCell (const PointT &p, boost::uint64_t &cell) const
+      {
+        if (!pcl_isfinite (p.x) || !pcl_isfinite (p.y) || !pcl_isfinite (p.z))
+          return (false);
+        cell = (boost::uint64_t)((p.x - grid_min_[0]) * inv_cell_size_) +
+               (boost::uint64_t)((p.y - grid_min_[1]) * inv_cell_size_) * grid_dims_[0] +
+               (boost::uint64_t)((p.z - grid_min_[2]) * inv_cell_size_) * grid_dims_[0] * grid_dims_[1];
+        return (true);
+      }
+
+      /** \brief Count the neighbors of the queries in one occupied cell.
+        * \param first the first query of the cell
+        * \param last one past the last query of the cell
+        */
+      void
+      searchCell (const VoxelPointIndex *first, const VoxelPointIndex *last);
   };
 
   //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
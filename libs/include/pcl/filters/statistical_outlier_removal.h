@@ -53,6 +53,10 @@ namespace pcl
     *      Robotics and Autonomous Systems Journal (Special Issue on Semantic Knowledge), 2008.
     * </ul>
     *
+    * Only the points in the input indices count as neighbors, so filtering a cloud through
+    * indices gives the same result as filtering a copy of the indexed points. Organized
+    * clouds are the exception, their neighbors are searched in the image.
+    *
     * \note setFilterFieldName (), setFilterLimits (), and setFilterLimitNegative () are ignored.
     * \author Radu Bogdan Rusu
     * \ingroup filters
@@ -62,6 +66,7 @@ namespace pcl
   {
     using Filter<PointT>::input_;
     using Filter<PointT>::indices_;
+    using Filter<PointT>::fake_indices_;
     using Filter<PointT>::filter_name_;
     using Filter<PointT>::getClassName;
 
@@ -78,7 +83,9 @@ namespace pcl
     public:
       /** \brief Empty constructor. */
       StatisticalOutlierRemoval (bool extract_removed_indices = false) :
-        Filter<PointT>::Filter (extract_removed_indices), mean_k_ (2), std_mul_ (0.0), tree_ (), negative_ (false)
+        Filter<PointT>::Filter (extract_removed_indices), mean_k_ (2), std_mul_ (0.0), tree_ (), negative_ (false),
+        threads_ (1), neighbor_cache_ (), keep_organized_ (false),
+        user_filter_value_ (std::numeric_limits<float>::quiet_NaN ())
       {
         filter_name_ = "StatisticalOutlierRemoval";
       }
@@ -136,6 +143,71 @@ namespace pcl
         return (negative_);
       }
 
+      /** \brief Set whether the outliers should be kept and set to the value given through
+        * \a setUserFilterValue (default: NaN), or removed from the PointCloud, thus breaking
+        * its organized structure. By default, points are removed. Points that aren't in the
+        * input indices are copied unchanged when the structure is kept.
+        * \param val set to true whether the outliers should be kept and set to a given user value
+        */
+      inline void
+      setKeepOrganized (bool val)
+      {
+        keep_organized_ = val;
+      }
+
+      inline bool
+      getKeepOrganized ()
+      {
+        return (keep_organized_);
+      }
+
+      /** \brief Provide a value that the x, y and z of the outliers should be set to instead of
+        * removing them. Used in conjunction with \a setKeepOrganized ().
+        * \param val the user given value that the outlier coordinates should be set to
+        */
+      inline void
+      setUserFilterValue (float val)
+      {
+        user_filter_value_ = val;
+      }
+
+      /** \brief Set the number of threads to use. Every thread searches the neighbors of a
+        * contiguous range of the input indices. Organized clouds are searched by a single thread.
+        * \param nr_threads the number of hardware threads to use (0 is treated as 1)
+        */
+      inline void
+      setNumberOfThreads (unsigned int nr_threads)
+      {
+        if (nr_threads == 0)
+          nr_threads = 1;
+        threads_ = nr_threads;
+      }
+
+      /** \brief Get the number of threads to use. */
+      inline unsigned int
+      getNumberOfThreads ()
+      {
+        return (threads_);
+      }
+
+      /** \brief Share a neighbor list with other stages. If it holds at least \a mean_k_ neighbors
+        * of the input cloud for every input index, no tree is built and no search is done. Otherwise
+        * the neighbors are searched as usual and stored in it, for the next stages to use.
+        * \param neighbors the neighbor list, NULL to disable
+        */
+      inline void
+      setNeighborCache (const KNeighborList::Ptr &neighbors)
+      {
+        neighbor_cache_ = neighbors;
+      }
+
+      /** \brief Get the shared neighbor list. */
+      inline KNeighborList::Ptr
+      getNeighborCache ()
+      {
+        return (neighbor_cache_);
+      }
+
     protected:
       /** \brief The number of points to use for mean distance estimation. */
       int mean_k_;
@@ -150,11 +222,38 @@ namespace pcl
       /** \brief If true, the outliers will be returned instead of the inliers (default: false). */
       bool negative_;
 
+      /** \brief The number of threads the filter should use. */
+      unsigned int threads_;
+
+      /** \brief The neighbor list shared with other stages, if any. */
+      KNeighborList::Ptr neighbor_cache_;
+
+      /** \brief Keep the structure of the data organized, by setting the outliers to a user
+        * given value (NaN by default).
+        */
+      bool keep_organized_;
+
+      /** \brief User given value to be set to the coordinates of any outlier. */
+      float user_filter_value_;
+
       /** \brief Apply the filter
         * \param output the resultant point cloud message
         */
       void
       applyFilter (PointCloud &output);
+
+      /** \brief Select the points of indices_ that aren't outliers (or are, if negative).
+        * \param indices the resultant point indices
+        */
+      void
+      applyFilterIndices (std::vector<int> &indices);
+
+      /** \brief Compute the mean distance of every point in indices_ to its mean_k_ nearest neighbors.
+        * \param distances the resultant mean distances, per position in indices_
+        * \return the distance above which a point is an outlier
+        */
+      double
+      computeMeanDistances (std::vector<float> &distances);
   };
 
   /** \brief @b StatisticalOutlierRemoval uses point neighborhood statistics to filter outlier data. For more
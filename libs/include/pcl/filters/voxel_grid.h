@@ -40,7 +40,10 @@
 
 #include "pcl/filters/filter.h"
 #include <map>
+#include <limits>
+#include <algorithm>
 #include <boost/unordered_map.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/mpl/size.hpp>
 #include <boost/fusion/sequence/intrinsic/at_key.hpp>
 
@@ -119,6 +122,116 @@ namespace pcl
       int f_idx_;
   };
 
+  /** \brief Helper functor structure for adding the fields of a PointT to a float array. */
+  template <typename PointT>
+  struct NdAddPointArrayFunctor
+  {
+    typedef typename traits::POD<PointT>::type Pod;
+
+    NdAddPointArrayFunctor (const PointT &p1, float *p2)
+      : p1_ (reinterpret_cast<const Pod&>(p1)), p2_ (p2), f_idx_ (0) { }
+
+    template<typename Key> inline void operator() ()
+    {
+      typedef typename pcl::traits::datatype<PointT, Key>::type T;
+      const uint8_t* data_ptr = reinterpret_cast<const uint8_t*>(&p1_) + pcl::traits::offset<PointT, Key>::value;
+      p2_[f_idx_++] += *reinterpret_cast<const T*>(data_ptr);
+    }
+
+    private:
+      const Pod &p1_;
+      float *p2_;
+      int f_idx_;
+  };
+
+  /** \brief Helper functor structure for copying data between a float array and a PointT. */
+  template <typename PointT>
+  struct NdCopyArrayPointFunctor
+  {
+    typedef typename traits::POD<PointT>::type Pod;
+
+    NdCopyArrayPointFunctor (const float *p1, PointT &p2)
+      : p1_ (p1), p2_ (reinterpret_cast<Pod&>(p2)), f_idx_ (0) { }
+
+    template<typename Key> inline void operator() ()
+    {
+      typedef typename pcl::traits::datatype<PointT, Key>::type T;
+      uint8_t* data_ptr = reinterpret_cast<uint8_t*>(&p2_) + pcl::traits::offset<PointT, Key>::value;
+      *reinterpret_cast<T*>(data_ptr) = p1_[f_idx_++];
+    }
+
+    private:
+      const float *p1_;
+      Pod &p2_;
+      int f_idx_;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////////////////
+  /** \brief A point index tagged with the index of the voxel it falls in. */
+  struct VoxelPointIndex
+  {
+    boost::uint64_t voxel;
+    unsigned int index;
+  };
+
+  /** \brief Stable LSD radix sort of point indices by voxel, 8 bits per pass. Digits above
+    * \a max_voxel and digits shared by all the voxels are skipped, so a typical grid takes 3-4 passes.
+    * \param indices the point indices to sort
+    * \param buffer scratch space for \a n point indices
+    * \param n the number of point indices
+    * \param max_voxel the largest voxel index in \a indices
+    * \return \a indices or \a buffer, whichever holds the sorted point indices
+    */
+  inline VoxelPointIndex*
+  sortVoxelPointIndices (VoxelPointIndex *indices, VoxelPointIndex *buffer, size_t n, boost::uint64_t max_voxel)
+  {
+    VoxelPointIndex *src = indices, *dst = buffer;
+    if (n < 2)
+      return (src);
+
+    for (int shift = 0; shift < 64 && (max_voxel >> shift) != 0; shift += 8)
+    {
+      size_t offsets[256] = { 0 };
+      for (size_t i = 0; i < n; ++i)
+        ++offsets[(src[i].voxel >> shift) & 0xff];
+
+      // All the voxels share this digit, nothing to reorder
+      if (offsets[(src[0].voxel >> shift) & 0xff] == n)
+        continue;
+
+      size_t sum = 0;
+      for (int b = 0; b < 256; ++b)
+      {
+        size_t count = offsets[b];
+        offsets[b] = sum;
+        sum += count;
+      }
+
+      for (size_t i = 0; i < n; ++i)
+        dst[offsets[(src[i].voxel >> shift) & 0xff]++] = src[i];
+
+      std::swap (src, dst);
+    }
+    return (src);
+  }
+
+  /** \brief Stable LSD radix sort of point indices by voxel.
+    * \param indices the point indices to sort
+    * \param buffer scratch space, resized to the size of \a indices
+    * \param max_voxel the largest voxel index in \a indices
+    */
+  inline void
+  sortVoxelPointIndices (std::vector<VoxelPointIndex> &indices, std::vector<VoxelPointIndex> &buffer,
+                         boost::uint64_t max_voxel)
+  {
+    if (indices.size () < 2)
+      return;
+    buffer.resize (indices.size ());
+
+    if (sortVoxelPointIndices (&indices[0], &buffer[0], indices.size (), max_voxel) != &indices[0])
+      indices.swap (buffer);
+  }
+
   /** \brief @b VoxelGrid assembles a local 3D grid over a given PointCloud, and downsamples + filters the data.
     *
     * The @b VoxelGrid class creates a *3D voxel grid* (think about a voxel
@@ -128,6 +241,20 @@ namespace pcl
     * a bit slower than approximating them with the center of the voxel, but it
     * represents the underlying surface more accurately.
     *
+    * The points are grouped by sorting their voxel indices instead of hashing them
+    * into per-voxel leaves. The index buffers are kept between calls, so filtering a
+    * stream of similarly sized clouds runs without allocations, and the output is
+    * ordered by voxel index.
+    *
+    * With \ref setNumberOfThreads, the grid is split into slabs of consecutive voxels
+    * which are sorted and reduced in parallel using OpenMP. The points of every
+    * voxel are still summed in input order, so the result doesn't depend on the
+    * number of threads.
+    *
+    * Only the points in the input indices are downsampled, so a chain of filters
+    * returning indices (see Filter::filter (std::vector<int>&)) can end with a
+    * VoxelGrid without ever copying the points in between.
+    *
     * \author Radu Bogdan Rusu, Bastian Steder
     * \ingroup filters
     */
@@ -149,8 +276,11 @@ namespace pcl
 
     public:
       /** \brief Empty constructor. */
-      VoxelGrid () : downsample_all_data_ (true), save_leaf_layout_ (false)
+      VoxelGrid () : downsample_all_data_ (true), save_leaf_layout_ (false), threads_ (1),
+                     rgba_offset_ (-1), distance_offset_ (-1), use_crop_box_ (false)
       {
+        crop_min_.setZero ();
+        crop_max_.setZero ();
         leaf_size_.setZero ();
         min_b_.setZero ();
         max_b_.setZero ();
@@ -160,9 +290,23 @@ namespace pcl
       /** \brief Destructor. */
       virtual ~VoxelGrid ()
       {
-        leaves_.clear();
       }
 
+      /** \brief Set the number of threads to use.
+        * \param nr_threads the number of hardware threads to use (0 is treated as 1)
+        */
+      inline void 
+      setNumberOfThreads (unsigned int nr_threads)
+      { 
+        if (nr_threads == 0)
+          nr_threads = 1;
+        threads_ = nr_threads; 
+      }
+
+      /** \brief Get the number of threads to use. */
+      inline unsigned int 
+      getNumberOfThreads () { return (threads_); }
+
       /** \brief Set the voxel grid leaf size.
         * \param leaf_size the voxel grid leaf size
         */
@@ -219,6 +363,38 @@ namespace pcl
       inline bool 
       getSaveLeafLayout () { return (save_leaf_layout_); }
 
+      /** \brief Only downsample the points inside an axis aligned box (bounds included), in the
+        * same pass. The grid spans the part of the box holding points, and the box test also rejects
+        * non-finite points. This replaces PassThrough filters on x, y and z followed
+        * by a VoxelGrid, without copying the cloud in between.
+        * \param min_pt the minimum corner of the box, must be finite
+        * \param max_pt the maximum corner of the box, must be finite
+        */
+      inline void
+      setCropBox (const Eigen::Vector4f &min_pt, const Eigen::Vector4f &max_pt)
+      {
+        crop_min_ = min_pt;
+        crop_max_ = max_pt;
+        use_crop_box_ = true;
+      }
+
+      /** \brief Get the crop box.
+        * \param min_pt the minimum corner of the box
+        * \param max_pt the maximum corner of the box
+        * \return false if no crop box is set
+        */
+      inline bool
+      getCropBox (Eigen::Vector4f &min_pt, Eigen::Vector4f &max_pt)
+      {
+        min_pt = crop_min_;
+        max_pt = crop_max_;
+        return (use_crop_box_);
+      }
+
+      /** \brief Downsample all the points again, without a crop box. */
+      inline void
+      resetCropBox () { use_crop_box_ = false; }
+
       /** \brief Get the minimum coordinates of the bounding box (after
         * filtering is performed). 
         */
@@ -310,17 +486,29 @@ namespace pcl
       }
 
     protected:
-      /** \brief Simple structure to hold an nD centroid and the number of points in a leaf. 
-        */
-      struct Leaf
-      {
-        Leaf () : nr_points(0) {}
-        Eigen::VectorXf centroid;    // @todo we do not support FLOAT64 just yet due to memory issues. Need to fix this.
-        int nr_points;
-      };
+      /** \brief The valid input points with their voxel index, sorted by voxel. */
+      std::vector<VoxelPointIndex> voxel_indices_;
 
-      /** \brief The 3D grid leaves. */
-      boost::unordered_map<size_t, Leaf> leaves_;
+      /** \brief Scratch space for sorting \a voxel_indices_. */
+      std::vector<VoxelPointIndex> voxel_indices_buffer_;
+
+      /** \brief Per thread and per slab counts of the parallel filter. */
+      std::vector<size_t> slab_offsets_;
+
+      /** \brief The number of threads the filter should use. */
+      unsigned int threads_;
+
+      /** \brief Offset of the rgb/rgba field in PointT, or -1. */
+      int rgba_offset_;
+
+      /** \brief Offset of the distance field in PointT, or -1 if no distance filtering is done. */
+      int distance_offset_;
+
+      /** \brief The crop box corners, used if \a use_crop_box_ is set. */
+      Eigen::Vector4f crop_min_, crop_max_;
+
+      /** \brief Set to true if only the points inside the crop box are downsampled. */
+      bool use_crop_box_;
 
       /** \brief The size of a leaf. */
       Eigen::Vector4f leaf_size_;
@@ -347,6 +535,30 @@ namespace pcl
         */
       void 
       applyFilter (PointCloud &output);
+
+      /** \brief Get the voxel index of a point.
+        * \param point the input point
+        * \param voxel the resultant voxel index
+        * \return false if the point is invalid or filtered out by the crop box or the distance limits
+        */
+      inline bool
+      getVoxelIndex (const PointT &point, boost::uint64_t &voxel) const;
+
+      /** \brief Compute the centroid of a run of point indices of the same voxel.
+        * \param first the first point index of the voxel
+        * \param last one past the last point index of the voxel
+        * \param centroid the resultant centroid
+        */
+      void
+      computeCentroid (const VoxelPointIndex *first, const VoxelPointIndex *last, PointT &centroid) const;
+
+      /** \brief Sort and reduce the valid points on a single thread. */
+      void
+      applyFilterSerial (PointCloud &output);
+
+      /** \brief Sort and reduce the valid points in parallel, one slab of consecutive voxels at a time. */
+      void
+      applyFilterParallel (PointCloud &output);
   };
 
   /** \brief @b VoxelGrid assembles a local 3D grid over a given PointCloud, and downsamples + filters the data.
@@ -95,6 +95,18 @@ namespace pcl
        * @brief rewinds to the first PCD file in the list.
        */
       virtual void rewind ();
+      /**
+       * @brief decodes the next PCD files on worker threads into a ring buffer, so that slow loads do not stall the playback.
+       * @param frames number of frames decoded ahead of the playback. 0 (default) loads each file inside the trigger.
+       * @param threads number of decoding threads.
+       */
+      void setReadAhead (unsigned int frames, unsigned int threads = 1);
+      /**
+       * @brief keeps the most recently decoded frames in memory, so that looping playback (repeat = true) or rewind() does not load them again.
+       * Only used together with setReadAhead ().
+       * @param frames maximum number of cached frames. 0 (default) disables the cache.
+       */
+      void setCacheSize (unsigned int frames);
     private:
       virtual void publish (const sensor_msgs::PointCloud2& blob) const = 0;
 
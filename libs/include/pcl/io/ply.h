@@ -66,7 +66,7 @@ namespace pcl
 #  error
 #endif
       ///@return endianess of the host machine
-      Format getEndianess()
+      inline Format getEndianess()
       {
         #ifdef PCL_LITTLE_ENDIAN
         return LITTLE_ENDIAN_FORMAT;
@@ -103,7 +103,7 @@ namespace pcl
         ALL               = 0xFFFFFFF
       };
       ///@return a property type from its type name
-      int getTypeFromTypeName(const std::string& type_name) 
+      inline int getTypeFromTypeName(const std::string& type_name) 
       {
         if(!strcmp(type_name.c_str(), "char"))
           return sensor_msgs::PointField::INT8;
@@ -126,7 +126,7 @@ namespace pcl
         return -2;
       };
       
-      size_t getMaximumCapacity(int size_type)
+      inline size_t getMaximumCapacity(int size_type)
       {
         switch(size_type)
         {
@@ -154,6 +154,7 @@ namespace pcl
         {
           offset_ = pcl::getFieldSize(data_type_);
         }
+        virtual ~property() {}
       };
 
       struct list_property : public property
@@ -330,6 +331,19 @@ namespace pcl
             return last_element_->push_property(name, size_type, data_type);
           }
 
+          /** remove all the elements and their properties so the parser can be reused */
+          inline void clear()
+          {
+            for(std::vector<element*>::iterator elements_it = elements_.begin(); elements_it != elements_.end(); ++elements_it)
+            {
+              for(element::iterator properties_it = (*elements_it)->properties_.begin(); properties_it != (*elements_it)->properties_.end(); ++properties_it)
+                delete *properties_it;
+              delete *elements_it;
+            }
+            elements_.clear();
+            last_element_ = 0;
+          }
+
           size_t offset_before(const std::string& element_name)
           {
             size_t offset = 0;
@@ -395,7 +409,7 @@ namespace pcl
       };
       
       /** write out a pcl::io::ply::camera structure to an ostream */
-      void write(const pcl::io::ply::camera& c, std::ostream& out, bool binary)
+      inline void write(const pcl::io::ply::camera& c, std::ostream& out, bool binary)
       {
         if(!binary)
         {
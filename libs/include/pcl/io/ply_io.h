@@ -108,48 +108,98 @@ namespace pcl
       }
 
       /** \brief Read a point cloud data from any PLY file, and convert it to the given template format.
+        *
+        * The vertex properties are mapped straight onto the point layout (x/y/z,
+        * nx/ny/nz to normal_x/normal_y/normal_z and red/green/blue/alpha to rgb/rgba)
+        * instead of going through pcl::fromROSMsg. Binary files stored in the host
+        * byte order are copied from the mapped file without any intermediate buffer.
+        *
         * \param file_name the name of the file containing the actual PointCloud data
         * \param cloud the resultant PointCloud message read from disk
         */
       template<typename PointT> inline int
         read (const std::string &file_name, pcl::PointCloud<PointT> &cloud)
       {
+        std::vector<sensor_msgs::PointField> fields;
+        pcl::getFields (cloud, fields);
+
         sensor_msgs::PointCloud2 blob;
         int ply_version;
-        int res = read (file_name, blob, cloud.sensor_origin_, cloud.sensor_orientation_,
-                        ply_version);
+        bool binary_data;
+        int data_idx;
+        int res = readHeader (file_name, blob, cloud.sensor_origin_, cloud.sensor_orientation_,
+                              ply_version, binary_data, data_idx);
 
         // Exit in case of error
         if (res < 0)
           return res;
-        pcl::fromROSMsg (blob, cloud);
+
+        cloud.points.resize (blob.width * blob.height);
+        cloud.width = blob.width;
+        cloud.height = blob.height;
+        if (cloud.points.empty ())
+          return 0;
+
+        if (binary_data && !swap_bytes_)
+        {
+          cloud.is_dense = false;
+          return (readBinaryVertices (file_name, data_idx, blob, fields, sizeof (PointT),
+                                      reinterpret_cast<unsigned char*> (&cloud.points[0]),
+                                      cloud.sensor_origin_, cloud.sensor_orientation_));
+        }
+
+        res = read (file_name, blob, cloud.sensor_origin_, cloud.sensor_orientation_, ply_version);
+        if (res < 0)
+          return res;
+        cloud.is_dense = blob.is_dense;
+        copyVertexFields (&blob.data[0], cloud.points.size (), blob.point_step, blob.fields,
+                          fields, sizeof (PointT), reinterpret_cast<unsigned char*> (&cloud.points[0]));
         return 0;
       }
       
     private:
       pcl::io::ply::parser parser_;
       bool swap_bytes_;
-      /** \brief Copy one single value of type T (uchar, char, uint, int, float, double, ...) from a string
-        *
-        * Uses atoi/atof to do the conversion.
-        * Checks if the st is "nan" and converts it accordingly.
-        *
-        * \param st the string containing the value to convert and copy
-        * \param cloud the cloud to copy it to
-        * \param point_index the index of the point
-        * \param property_name the index of the dimension/field
-        * \param list_count the current fields count
+
+      /** \brief Get the byte offset of an element in the binary data section.
+        * Returns -1 if the element is missing or follows an element with list properties.
+        * \param element_name the name of the element
         */
-      template <typename Type> inline void
-      copyStringValue (const std::string &string_value, void* data, size_t offset = 0)
-      {
-        //char value = (char)atoi (st.at (d + c).c_str ());
-        static char* char_ptr;
-        char_ptr = (char*) data;
-        Type value;
-        value = pcl_atoa<Type>(string_value.c_str ());
-        memcpy (char_ptr+offset, &value, sizeof (Type));
-      }
+      int
+      binaryElementOffset (const std::string &element_name);
+
+      /** \brief Copy the vertices of a binary PLY file straight into a point array.
+        * \param file_name the name of the file to map
+        * \param data_idx the offset of the binary data section, as returned by readHeader
+        * \param header the vertex layout, as returned by readHeader
+        * \param fields the fields of the destination point type
+        * \param point_size the size of the destination point type
+        * \param points the destination point array (header.width * header.height points)
+        * \param origin the sensor acquisition origin
+        * \param orientation the sensor acquisition orientation
+        */
+      int
+      readBinaryVertices (const std::string &file_name, int data_idx,
+                          const sensor_msgs::PointCloud2 &header,
+                          const std::vector<sensor_msgs::PointField> &fields, size_t point_size,
+                          unsigned char *points,
+                          Eigen::Vector4f &origin, Eigen::Quaternionf &orientation);
+
+      /** \brief Copy packed PLY vertex records into an array of points, matching the
+        * PLY property names against the point field names.
+        * \param src the first vertex record
+        * \param nr_points the number of records to copy
+        * \param src_step the size of one vertex record
+        * \param src_fields the vertex properties
+        * \param dst_fields the fields of the destination point type
+        * \param dst_step the size of the destination point type
+        * \param dst the destination point array
+        */
+      static void
+      copyVertexFields (const unsigned char *src, size_t nr_points, size_t src_step,
+                        const std::vector<sensor_msgs::PointField> &src_fields,
+                        const std::vector<sensor_msgs::PointField> &dst_fields, size_t dst_step,
+                        unsigned char *dst);
   };
 
   /** \brief Point Cloud Data (PLY) file format writer.
@@ -0,0 +1,338 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_KDTREE_DESCRIPTOR_STORE_H_
+#define PCL_KDTREE_DESCRIPTOR_STORE_H_
+
+#include <vector>
+#include <Eigen/Core>
+#include "pcl/kdtree/kdtree.h"
+#include "pcl/common/norms.h"
+#include <pcl/console/print.h>
+
+namespace pcl
+{
+  ////////////////////////////////////////////////////////////////////////////////////////////
+  /** \brief @b DescriptorStore is an exact brute force search for feature descriptors (PFH, FPFH, VFH, SHOT...).
+    * The descriptors are vectorized once through the point representation into one contiguous, aligned matrix
+    * whose rows are padded with zeros to a multiple of 8 floats, and every query is compared against all the
+    * rows. The distance kernels keep 8 independent sums so that the compiler turns them into SIMD code, and the
+    * rows are visited in cache sized blocks shared by several queries. In the 33 to 1344 dimensions of the
+    * descriptors a kd-tree barely prunes anything, so for up to tens of thousands of descriptors this is both
+    * faster and exact.
+    *
+    * Distances are computed with one of the following norms (see pcl/common/norms.h):
+    *  - L2_SQR: the squared euclidean distance (the default, as returned by KdTreeFLANN)
+    *  - L1: the sum of the absolute differences
+    *  - CS: the chi-squared distance, sum ((a - b)^2 / (a + b))
+    *  - HIK: the histogram intersection, returned as the distance 1 - sum (min (a, b)) / min (sum (a), sum (b))
+    *
+    * The store is a KdTree and replaces KdTreeFLANN wherever descriptors are matched, e.g. through
+    * SampleConsensusInitialAlignment::setFeatureSearchMethod. Searching doesn't modify the store, so it can be
+    * queried from several threads, and the batch nearestKSearch parallelizes over the queries by itself.
+    * \ingroup kdtree
+    */
+  template <typename PointT>
+  class DescriptorStore : public KdTree<PointT>
+  {
+    using KdTree<PointT>::input_;
+    using KdTree<PointT>::indices_;
+    using KdTree<PointT>::sorted_;
+    using KdTree<PointT>::point_representation_;
+
+    typedef typename KdTree<PointT>::PointCloud PointCloud;
+    typedef typename KdTree<PointT>::PointCloudConstPtr PointCloudConstPtr;
+
+    typedef boost::shared_ptr <std::vector<int> > IndicesPtr;
+    typedef boost::shared_ptr <const std::vector<int> > IndicesConstPtr;
+
+    public:
+      // Boost shared pointers
+      typedef boost::shared_ptr<DescriptorStore<PointT> > Ptr;
+      typedef boost::shared_ptr<const DescriptorStore<PointT> > ConstPtr;
+
+      /** \brief Empty constructor for DescriptorStore.
+        * \param sorted whether radius search results are sorted by distance
+        */
+      DescriptorStore (bool sorted = true) : KdTree<PointT> (sorted), norm_type_ (L2_SQR), threads_ (1), 
+                                             dim_ (0), stride_ (0)
+      {
+      }
+
+      /** \brief Provide a pointer to the input dataset and copy its descriptors into the store. Descriptors with
+        * non finite values are left out.
+        * \param cloud the const boost shared pointer to a PointCloud message
+        * \param indices the point indices subset that is to be used from \a cloud - if NULL the whole cloud is used
+        */
+      void 
+      setInputCloud (const PointCloudConstPtr &cloud, const IndicesConstPtr &indices = IndicesConstPtr ());
+
+      /** \brief Set the norm used to compare descriptors: L2_SQR (default), L1, CS or HIK.
+        * \param norm_type the norm type
+        */
+      void
+      setNormType (NormType norm_type);
+
+      /** \brief Get the norm used to compare descriptors. */
+      inline NormType
+      getNormType () const { return (norm_type_); }
+
+      /** \brief Set the number of threads used by the batch nearestKSearch.
+        * \param nr_threads the number of hardware threads to use (0 sets the value back to 1)
+        */
+      inline void
+      setNumberOfThreads (unsigned int nr_threads) { threads_ = (nr_threads == 0) ? 1 : nr_threads; }
+
+      /** \brief Get the number of threads used by the batch nearestKSearch. */
+      inline unsigned int
+      getNumberOfThreads () const { return (threads_); }
+
+      /** \brief Get the number of descriptors in the store. */
+      inline size_t
+      size () const { return (index_mapping_.size ()); }
+
+      /** \brief Get the number of dimensions of the stored descriptors. */
+      inline int
+      getDimension () const { return (dim_); }
+
+      /** \brief Search for the k nearest descriptors of the given query.
+        * \param point the given query point
+        * \param k the number of neighbors to search for
+        * \param k_indices the resultant indices of the neighboring points (resized to \a k if smaller)
+        * \param k_distances the resultant distances to the neighboring points (resized to \a k if smaller)
+        * \return number of neighbors found
+        */
+      int 
+      nearestKSearch (const PointT &point, int k, std::vector<int> &k_indices, std::vector<float> &k_distances);
+
+      /** \brief Search for the k nearest descriptors of the given query.
+        * \param cloud the point cloud data
+        * \param index the index in \a cloud representing the query point
+        * \param k the number of neighbors to search for
+        * \param k_indices the resultant indices of the neighboring points (resized to \a k if smaller)
+        * \param k_distances the resultant distances to the neighboring points (resized to \a k if smaller)
+        * \return number of neighbors found
+        */
+      inline int 
+      nearestKSearch (const PointCloud &cloud, int index, int k, 
+                      std::vector<int> &k_indices, std::vector<float> &k_distances)
+      {
+        if (index >= (int)cloud.points.size ())
+          return (0);
+        return (nearestKSearch (cloud.points[index], k, k_indices, k_distances));
+      }
+
+      /** \brief Search for the k nearest descriptors of the given query (zero-copy).
+        * \param index the index representing the query point in the dataset given by \a setInputCloud
+        *        if indices were given in setInputCloud, index will be the position in the indices vector
+        * \param k the number of neighbors to search for
+        * \param k_indices the resultant indices of the neighboring points (resized to \a k if smaller)
+        * \param k_distances the resultant distances to the neighboring points (resized to \a k if smaller)
+        * \return number of neighbors found
+        */
+      inline int 
+      nearestKSearch (int index, int k, std::vector<int> &k_indices, std::vector<float> &k_distances)
+      {
+        if (indices_ == NULL)
+        {
+          if (index >= (int)input_->points.size ())
+            return (0);
+          return (nearestKSearch (input_->points[index], k, k_indices, k_distances));
+        }
+        if (index >= (int)indices_->size ())
+          return (0);
+        return (nearestKSearch (input_->points[(*indices_)[index]], k, k_indices, k_distances));
+      }
+
+      /** \brief Search for the k nearest descriptors of every point in \a queries, in parallel.
+        * \param queries the query descriptors
+        * \param k the number of neighbors to search for
+        * \param neighbors the resultant neighbors, k per query, sorted by distance. The distances are the ones of
+        * the norm type. Rows of invalid queries hold -1 indices, as do the slots left when the store holds fewer
+        * than \a k descriptors.
+        */
+      void
+      nearestKSearch (const PointCloud &queries, int k, KNeighborList &neighbors) const;
+
+      /** \brief Search for all the descriptors within a given distance of the query.
+        * \param point the given query point
+        * \param radius the maximum distance. For L2_SQR it is compared against the euclidean distance, as in
+        * KdTreeFLANN, for the other norms against the norm itself.
+        * \param k_indices the resultant indices of the neighboring points
+        * \param k_distances the resultant distances to the neighboring points
+        * \param max_nn if given, only the closest \a max_nn neighbors are returned
+        * \return number of neighbors found in radius
+        */
+      int 
+      radiusSearch (const PointT &point, double radius, std::vector<int> &k_indices,
+                    std::vector<float> &k_distances, int max_nn = INT_MAX) const;
+
+      /** \brief Search for all the descriptors within a given distance of the query.
+        * \param cloud the point cloud data
+        * \param index the index in \a cloud representing the query point
+        * \param radius the maximum distance (see above)
+        * \param k_indices the resultant indices of the neighboring points
+        * \param k_distances the resultant distances to the neighboring points
+        * \param max_nn if given, only the closest \a max_nn neighbors are returned
+        * \return number of neighbors found in radius
+        */
+      inline int 
+      radiusSearch (const PointCloud &cloud, int index, double radius, 
+                    std::vector<int> &k_indices, std::vector<float> &k_distances, 
+                    int max_nn = INT_MAX) const
+      {
+        if (index >= (int)cloud.points.size ())
+          return (0);
+        return (radiusSearch (cloud.points[index], radius, k_indices, k_distances, max_nn));
+      }
+
+      /** \brief Search for all the descriptors within a given distance of the query (zero-copy).
+        * \param index the index representing the query point in the dataset given by \a setInputCloud
+        *        if indices were given in setInputCloud, index will be the position in the indices vector
+        * \param radius the maximum distance (see above)
+        * \param k_indices the resultant indices of the neighboring points
+        * \param k_distances the resultant distances to the neighboring points
+        * \param max_nn if given, only the closest \a max_nn neighbors are returned
+        * \return number of neighbors found in radius
+        */
+      inline int 
+      radiusSearch (int index, double radius, std::vector<int> &k_indices,
+                    std::vector<float> &k_distances, int max_nn = INT_MAX) const
+      {
+        if (indices_ == NULL)
+        {
+          if (index >= (int)input_->points.size ())
+            return (0);
+          return (radiusSearch (input_->points[index], radius, k_indices, k_distances, max_nn));
+        }
+        if (index >= (int)indices_->size ())
+          return (0);
+        return (radiusSearch (input_->points[(*indices_)[index]], radius, k_indices, k_distances, max_nn));
+      }
+
+    protected:
+      /** \brief Distance kernels over rows padded to a multiple of 8 floats. \a sum_a and \a sum_b are the sums of
+        * the two rows, only used by the histogram intersection.
+        */
+      struct L1Kernel
+      {
+        static inline float
+        distance (const float *a, const float *b, int n, float, float);
+      };
+
+      struct L2SqrKernel
+      {
+        static inline float
+        distance (const float *a, const float *b, int n, float, float);
+      };
+
+      struct ChiSquaredKernel
+      {
+        static inline float
+        distance (const float *a, const float *b, int n, float, float);
+      };
+
+      struct IntersectionKernel
+      {
+        static inline float
+        distance (const float *a, const float *b, int n, float sum_a, float sum_b);
+      };
+
+      /** \brief Vectorize a descriptor into a zero padded row.
+        * \param point the descriptor
+        * \param row the output row of stride_ floats
+        * \param sum the sum of the row
+        * \return false if the descriptor has non finite values
+        */
+      bool
+      vectorize (const PointT &point, float *row, float &sum) const;
+
+      /** \brief Find the k nearest rows of a set of vectorized queries with the current norm.
+        * \param queries the query rows
+        * \param query_sums the sums of the query rows
+        * \param nr_queries the number of queries
+        * \param k the number of neighbors to search for, at most size ()
+        * \param rows the resultant row indices, k per query
+        * \param distances the resultant distances, k per query
+        */
+      void
+      search (const float *queries, const float *query_sums, int nr_queries, int k, int *rows, float *distances) const;
+
+      /** \brief The blocked search loop of \a search, for one kernel. */
+      template <typename Kernel> void
+      searchRows (const float *queries, const float *query_sums, int nr_queries, int k, 
+                  int *rows, float *distances) const;
+
+      /** \brief Compute the distances of a vectorized query to all the rows with the current norm. */
+      void
+      computeDistances (const float *query, float query_sum, std::vector<float> &distances) const;
+
+      /** \brief The loop of \a computeDistances, for one kernel. */
+      template <typename Kernel> void
+      computeRowDistances (const float *query, float query_sum, std::vector<float> &distances) const;
+
+    private:
+      /** \brief Class getName method. */
+      virtual std::string 
+      getName () const { return ("DescriptorStore"); }
+
+      /** \brief The norm used to compare descriptors. */
+      NormType norm_type_;
+
+      /** \brief The number of threads used by the batch search. */
+      unsigned int threads_;
+
+      /** \brief The number of dimensions of the descriptors. */
+      int dim_;
+
+      /** \brief The number of floats per row, dim_ rounded up to a multiple of 8. */
+      int stride_;
+
+      /** \brief The descriptors, one row of stride_ floats each. */
+      std::vector<float, Eigen::aligned_allocator<float> > data_;
+
+      /** \brief The sum of every row. */
+      std::vector<float> sums_;
+
+      /** \brief The index in input_ of every row. */
+      std::vector<int> index_mapping_;
+  };
+}
+
+#include "pcl/kdtree/impl/descriptor_store.hpp"
+
+#endif  //#ifndef PCL_KDTREE_DESCRIPTOR_STORE_H_
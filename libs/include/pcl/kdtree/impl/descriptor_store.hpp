@@ -0,0 +1,425 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_KDTREE_IMPL_DESCRIPTOR_STORE_H_
+#define PCL_KDTREE_IMPL_DESCRIPTOR_STORE_H_
+
+#include <algorithm>
+#include "pcl/kdtree/descriptor_store.h"
+
+namespace pcl
+{
+  /** \brief Rows are visited in blocks of about this many bytes, which stay in cache for all the queries. */
+  const size_t DESCRIPTOR_STORE_BLOCK_BYTES = 64 * 1024;
+
+  /** \brief The number of queries compared to a row while it is in the registers / L1 cache. */
+  const int DESCRIPTOR_STORE_QUERY_TILE = 4;
+
+  /** \brief The number of queries a thread takes at a time in the batch search. */
+  const int DESCRIPTOR_STORE_QUERY_CHUNK = 32;
+
+  /** \brief Add up the 8 partial sums of a distance kernel. */
+  inline float
+  sumDescriptorLanes (const float *acc)
+  {
+    return (((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7])));
+  }
+
+  /** \brief Insert a neighbor into a list of at most k neighbors sorted by distance.
+    * \param row the neighbor
+    * \param distance the distance to the neighbor
+    * \param k the maximum number of neighbors
+    * \param count the current number of neighbors, updated
+    * \param rows the neighbors
+    * \param distances the distances to the neighbors
+    */
+  inline void
+  insertDescriptorNeighbor (int row, float distance, int k, int &count, int *rows, float *distances)
+  {
+    int i;
+    if (count < k)
+      i = count++;
+    else if (distance < distances[k - 1])
+      i = k - 1;
+    else
+      return;
+
+    for (; i > 0 && distances[i - 1] > distance; --i)
+    {
+      distances[i] = distances[i - 1];
+      rows[i] = rows[i - 1];
+    }
+    distances[i] = distance;
+    rows[i] = row;
+  }
+
+  /** \brief Orders neighbors by distance, then by index. */
+  inline bool
+  compareDescriptorNeighbors (const std::pair<float, int> &a, const std::pair<float, int> &b)
+  {
+    return (a.first < b.first || (a.first == b.first && a.second < b.second));
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// The kernels keep one partial sum per lane of a 8 float register and use no data dependent branch, which
+// lets the compiler vectorize them without reordering a single sum.
+template <typename PointT> inline float
+pcl::DescriptorStore<PointT>::L1Kernel::distance (const float *a, const float *b, int n, float, float)
+{
+  float acc[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  for (int i = 0; i < n; i += 8)
+    for (int j = 0; j < 8; ++j)
+      acc[j] += fabsf (a[i + j] - b[i + j]);
+  return (sumDescriptorLanes (acc));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> inline float
+pcl::DescriptorStore<PointT>::L2SqrKernel::distance (const float *a, const float *b, int n, float, float)
+{
+  float acc[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  for (int i = 0; i < n; i += 8)
+    for (int j = 0; j < 8; ++j)
+    {
+      float d = a[i + j] - b[i + j];
+      acc[j] += d * d;
+    }
+  return (sumDescriptorLanes (acc));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> inline float
+pcl::DescriptorStore<PointT>::ChiSquaredKernel::distance (const float *a, const float *b, int n, float, float)
+{
+  float acc[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  for (int i = 0; i < n; i += 8)
+    for (int j = 0; j < 8; ++j)
+    {
+      // a bin empty in both histograms (and the padding) has a + b == 0 and adds 0 / 1
+      float d = a[i + j] - b[i + j];
+      float s = a[i + j] + b[i + j];
+      acc[j] += d * d / (s > 0.0f ? s : 1.0f);
+    }
+  return (sumDescriptorLanes (acc));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> inline float
+pcl::DescriptorStore<PointT>::IntersectionKernel::distance (const float *a, const float *b, int n, 
+                                                            float sum_a, float sum_b)
+{
+  float acc[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  for (int i = 0; i < n; i += 8)
+    for (int j = 0; j < 8; ++j)
+      acc[j] += a[i + j] < b[i + j] ? a[i + j] : b[i + j];
+
+  float norm = (std::min) (sum_a, sum_b);
+  if (norm <= 0.0f)
+    return (1.0f);
+  return (1.0f - sumDescriptorLanes (acc) / norm);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::DescriptorStore<PointT>::setInputCloud (const PointCloudConstPtr &cloud, const IndicesConstPtr &indices)
+{
+  input_   = cloud;
+  indices_ = indices;
+
+  data_.clear ();
+  sums_.clear ();
+  index_mapping_.clear ();
+  dim_ = point_representation_->getNumberOfDimensions ();
+  stride_ = (dim_ + 7) / 8 * 8;
+
+  if (!input_ || dim_ <= 0)
+    return;
+
+  int nr_points = (indices_ != NULL) ? (int)indices_->size () : (int)input_->points.size ();
+  data_.resize ((size_t)nr_points * stride_);
+  sums_.reserve (nr_points);
+  index_mapping_.reserve (nr_points);
+
+  for (int i = 0; i < nr_points; ++i)
+  {
+    int idx = (indices_ != NULL) ? (*indices_)[i] : i;
+    float sum;
+    // an invalid descriptor is overwritten by the next one
+    if (!vectorize (input_->points[idx], &data_[index_mapping_.size () * stride_], sum))
+      continue;
+    sums_.push_back (sum);
+    index_mapping_.push_back (idx);
+  }
+  data_.resize (index_mapping_.size () * stride_);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::DescriptorStore<PointT>::setNormType (NormType norm_type)
+{
+  if (norm_type != L1 && norm_type != L2_SQR && norm_type != CS && norm_type != HIK)
+  {
+    PCL_ERROR ("[pcl::%s::setNormType] Only the L1, L2_SQR, CS and HIK norms are supported!\n", getName ().c_str ());
+    return;
+  }
+  norm_type_ = norm_type;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> bool
+pcl::DescriptorStore<PointT>::vectorize (const PointT &point, float *row, float &sum) const
+{
+  point_representation_->vectorize (point, row);
+
+  sum = 0.0f;
+  for (int i = 0; i < dim_; ++i)
+  {
+    if (!pcl_isfinite (row[i]))
+      return (false);
+    sum += row[i];
+  }
+  for (int i = dim_; i < stride_; ++i)
+    row[i] = 0.0f;
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> template <typename Kernel> void
+pcl::DescriptorStore<PointT>::searchRows (const float *queries, const float *query_sums, int nr_queries, int k, 
+                                          int *rows, float *distances) const
+{
+  const int nr_rows = (int)index_mapping_.size ();
+  const int block = (std::max) (1, (int)(DESCRIPTOR_STORE_BLOCK_BYTES / (stride_ * sizeof (float))));
+
+  std::vector<int> counts (nr_queries, 0);
+  for (int begin = 0; begin < nr_rows; begin += block)
+  {
+    const int end = (std::min) (begin + block, nr_rows);
+    for (int tile = 0; tile < nr_queries; tile += DESCRIPTOR_STORE_QUERY_TILE)
+    {
+      const int tile_end = (std::min) (tile + DESCRIPTOR_STORE_QUERY_TILE, nr_queries);
+      for (int r = begin; r < end; ++r)
+      {
+        const float *row = &data_[(size_t)r * stride_];
+        for (int q = tile; q < tile_end; ++q)
+        {
+          float d = Kernel::distance (queries + (size_t)q * stride_, row, stride_, query_sums[q], sums_[r]);
+          insertDescriptorNeighbor (r, d, k, counts[q], rows + (size_t)q * k, distances + (size_t)q * k);
+        }
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::DescriptorStore<PointT>::search (const float *queries, const float *query_sums, int nr_queries, int k, 
+                                      int *rows, float *distances) const
+{
+  switch (norm_type_)
+  {
+    case L1:
+      searchRows<L1Kernel> (queries, query_sums, nr_queries, k, rows, distances);
+      break;
+    case CS:
+      searchRows<ChiSquaredKernel> (queries, query_sums, nr_queries, k, rows, distances);
+      break;
+    case HIK:
+      searchRows<IntersectionKernel> (queries, query_sums, nr_queries, k, rows, distances);
+      break;
+    default:
+      searchRows<L2SqrKernel> (queries, query_sums, nr_queries, k, rows, distances);
+      break;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> template <typename Kernel> void
+pcl::DescriptorStore<PointT>::computeRowDistances (const float *query, float query_sum, 
+                                                   std::vector<float> &distances) const
+{
+  distances.resize (index_mapping_.size ());
+  for (size_t r = 0; r < index_mapping_.size (); ++r)
+    distances[r] = Kernel::distance (query, &data_[r * stride_], stride_, query_sum, sums_[r]);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::DescriptorStore<PointT>::computeDistances (const float *query, float query_sum, 
+                                                std::vector<float> &distances) const
+{
+  switch (norm_type_)
+  {
+    case L1:
+      computeRowDistances<L1Kernel> (query, query_sum, distances);
+      break;
+    case CS:
+      computeRowDistances<ChiSquaredKernel> (query, query_sum, distances);
+      break;
+    case HIK:
+      computeRowDistances<IntersectionKernel> (query, query_sum, distances);
+      break;
+    default:
+      computeRowDistances<L2SqrKernel> (query, query_sum, distances);
+      break;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> int
+pcl::DescriptorStore<PointT>::nearestKSearch (const PointT &point, int k, 
+                                              std::vector<int> &k_indices, std::vector<float> &k_distances)
+{
+  k = (std::min) (k, (int)index_mapping_.size ());
+  if (k <= 0)
+    return (0);
+
+  std::vector<float> query (stride_);
+  float query_sum;
+  if (!vectorize (point, &query[0], query_sum))
+    return (0);
+
+  if (k_indices.size () < (size_t)k)
+    k_indices.resize (k);
+  if (k_distances.size () < (size_t)k)
+    k_distances.resize (k);
+
+  search (&query[0], &query_sum, 1, k, &k_indices[0], &k_distances[0]);
+  for (int i = 0; i < k; ++i)
+    k_indices[i] = index_mapping_[k_indices[i]];
+  return (k);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::DescriptorStore<PointT>::nearestKSearch (const PointCloud &queries, int k, KNeighborList &neighbors) const
+{
+  const int nr_queries = (int)queries.points.size ();
+  k = (std::max) (k, 0);
+  neighbors.k = k;
+  neighbors.indices.assign ((size_t)nr_queries * k, -1);
+  neighbors.sqr_distances.assign ((size_t)nr_queries * k, 0.0f);
+
+  const int nr_found = (std::min) (k, (int)index_mapping_.size ());
+  if (nr_found == 0)
+    return;
+
+  const int nr_chunks = (nr_queries + DESCRIPTOR_STORE_QUERY_CHUNK - 1) / DESCRIPTOR_STORE_QUERY_CHUNK;
+#pragma omp parallel num_threads (threads_)
+  {
+    // Per thread buffers for a chunk of vectorized queries and their neighbors
+    std::vector<float, Eigen::aligned_allocator<float> > chunk ((size_t)DESCRIPTOR_STORE_QUERY_CHUNK * stride_);
+    std::vector<float> chunk_sums (DESCRIPTOR_STORE_QUERY_CHUNK);
+    std::vector<int> chunk_queries (DESCRIPTOR_STORE_QUERY_CHUNK);
+    std::vector<int> rows ((size_t)DESCRIPTOR_STORE_QUERY_CHUNK * nr_found);
+    std::vector<float> distances ((size_t)DESCRIPTOR_STORE_QUERY_CHUNK * nr_found);
+
+#pragma omp for schedule (dynamic, 1)
+    for (int c = 0; c < nr_chunks; ++c)
+    {
+      const int begin = c * DESCRIPTOR_STORE_QUERY_CHUNK;
+      const int end = (std::min) (begin + DESCRIPTOR_STORE_QUERY_CHUNK, nr_queries);
+
+      // Invalid queries keep their row of -1
+      int n = 0;
+      for (int q = begin; q < end; ++q)
+        if (vectorize (queries.points[q], &chunk[(size_t)n * stride_], chunk_sums[n]))
+          chunk_queries[n++] = q;
+      if (n == 0)
+        continue;
+
+      search (&chunk[0], &chunk_sums[0], n, nr_found, &rows[0], &distances[0]);
+
+      for (int i = 0; i < n; ++i)
+      {
+        const size_t out = (size_t)chunk_queries[i] * k;
+        for (int j = 0; j < nr_found; ++j)
+        {
+          neighbors.indices[out + j] = index_mapping_[rows[(size_t)i * nr_found + j]];
+          neighbors.sqr_distances[out + j] = distances[(size_t)i * nr_found + j];
+        }
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> int
+pcl::DescriptorStore<PointT>::radiusSearch (const PointT &point, double radius, std::vector<int> &k_indices,
+                                            std::vector<float> &k_distances, int max_nn) const
+{
+  k_indices.clear ();
+  k_distances.clear ();
+  if (index_mapping_.empty ())
+    return (0);
+
+  std::vector<float> query (stride_);
+  float query_sum;
+  if (!vectorize (point, &query[0], query_sum))
+    return (0);
+
+  std::vector<float> distances;
+  computeDistances (&query[0], query_sum, distances);
+
+  const float max_distance = (float)(norm_type_ == L2_SQR ? radius * radius : radius);
+  std::vector<std::pair<float, int> > found;
+  for (size_t r = 0; r < distances.size (); ++r)
+    if (distances[r] <= max_distance)
+      found.push_back (std::make_pair (distances[r], index_mapping_[r]));
+
+  if (max_nn > 0 && found.size () > (size_t)max_nn)
+  {
+    std::partial_sort (found.begin (), found.begin () + max_nn, found.end (), compareDescriptorNeighbors);
+    found.resize (max_nn);
+  }
+  else if (sorted_)
+    std::sort (found.begin (), found.end (), compareDescriptorNeighbors);
+
+  k_indices.resize (found.size ());
+  k_distances.resize (found.size ());
+  for (size_t i = 0; i < found.size (); ++i)
+  {
+    k_distances[i] = found[i].first;
+    k_indices[i] = found[i].second;
+  }
+  return ((int)found.size ());
+}
+
+#define PCL_INSTANTIATE_DescriptorStore(T) template class PCL_EXPORTS pcl::DescriptorStore<T>;
+
+#endif  //#ifndef PCL_KDTREE_IMPL_DESCRIPTOR_STORE_H_
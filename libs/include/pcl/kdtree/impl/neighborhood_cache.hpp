@@ -0,0 +1,151 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+
+#ifndef PCL_KDTREE_IMPL_NEIGHBORHOOD_CACHE_H_
+#define PCL_KDTREE_IMPL_NEIGHBORHOOD_CACHE_H_
+
+#include <algorithm>
+#include "pcl/kdtree/neighborhood_cache.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void
+pcl::NeighborhoodCache<PointT>::computeNeighborhoods (const PointCloudConstPtr &cloud, const IndicesConstPtr &indices,
+                                                      double radius)
+{
+  // The copies made so far keep the previous neighborhoods
+  boost::shared_ptr<Data> data (new Data);
+  data->cloud = cloud;
+  data->radius = radius;
+  data->queries_are_surface = (tree_->getInputCloud () == cloud);
+  data->begin.resize (cloud->points.size (), -1);
+  data->count.resize (cloud->points.size (), -1);
+
+  const int nr_queries = indices ? (int) indices->size () : (int) cloud->points.size ();
+  std::vector<std::vector<std::pair<float, int> > > neighborhoods (nr_queries);
+
+#pragma omp parallel num_threads (threads_)
+  {
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
+
+#pragma omp for schedule (dynamic, 64)
+    for (int q = 0; q < nr_queries; ++q)
+    {
+      int index = indices ? (*indices)[q] : q;
+      // Vectors the locator can reuse aren't resized, only the first k entries are valid
+      int k = tree_->radiusSearch (*cloud, index, radius, nn_indices, nn_dists);
+
+      std::vector<std::pair<float, int> > &neighborhood = neighborhoods[q];
+      neighborhood.resize (std::max (k, 0));
+      for (int i = 0; i < k; ++i)
+        neighborhood[i] = std::make_pair (nn_dists[i], nn_indices[i]);
+      std::sort (neighborhood.begin (), neighborhood.end ());
+    }
+  }
+
+  size_t nr_neighbors = 0;
+  for (int q = 0; q < nr_queries; ++q)
+    nr_neighbors += neighborhoods[q].size ();
+  data->indices.reserve (nr_neighbors);
+  data->sqr_distances.reserve (nr_neighbors);
+
+  for (int q = 0; q < nr_queries; ++q)
+  {
+    int index = indices ? (*indices)[q] : q;
+    data->begin[index] = (int) data->indices.size ();
+    data->count[index] = (int) neighborhoods[q].size ();
+    for (size_t i = 0; i < neighborhoods[q].size (); ++i)
+    {
+      data->sqr_distances.push_back (neighborhoods[q][i].first);
+      data->indices.push_back (neighborhoods[q][i].second);
+    }
+  }
+
+  data_ = data;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> bool
+pcl::NeighborhoodCache<PointT>::getNeighborhood (const PointCloud &cloud, int index, double radius,
+                                                 std::vector<int> &k_indices, std::vector<float> &k_sqr_distances,
+                                                 int max_nn, int &nr_neighbors) const
+{
+  const Data &data = *data_;
+  if (&cloud != data.cloud.get () || radius > data.radius || index < 0 || index >= (int) data.count.size () ||
+      data.count[index] < 0)
+    return (false);
+
+  // The locator keeps the neighbors strictly closer than the radius, in single precision
+  const float sqr_radius = (float) (radius * radius);
+  const float *distances = data.count[index] > 0 ? &data.sqr_distances[data.begin[index]] : NULL;
+  nr_neighbors = (int) (std::lower_bound (distances, distances + data.count[index], sqr_radius) - distances);
+  if (max_nn > 0)
+    nr_neighbors = std::min (nr_neighbors, max_nn);
+
+  k_indices.assign (data.indices.begin () + data.begin[index], data.indices.begin () + data.begin[index] + nr_neighbors);
+  k_sqr_distances.assign (distances, distances + nr_neighbors);
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> int
+pcl::NeighborhoodCache<PointT>::radiusSearch (const PointCloud &cloud, int index, double radius,
+                                              std::vector<int> &k_indices, std::vector<float> &k_sqr_distances,
+                                              int max_nn) const
+{
+  int nr_neighbors;
+  if (getNeighborhood (cloud, index, radius, k_indices, k_sqr_distances, max_nn, nr_neighbors))
+    return (nr_neighbors);
+  return (tree_->radiusSearch (cloud, index, radius, k_indices, k_sqr_distances, max_nn));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> int
+pcl::NeighborhoodCache<PointT>::radiusSearch (int index, double radius, std::vector<int> &k_indices,
+                                              std::vector<float> &k_sqr_distances, int max_nn) const
+{
+  int nr_neighbors;
+  if (data_->queries_are_surface && 
+      getNeighborhood (*data_->cloud, index, radius, k_indices, k_sqr_distances, max_nn, nr_neighbors))
+    return (nr_neighbors);
+  return (tree_->radiusSearch (index, radius, k_indices, k_sqr_distances, max_nn));
+}
+
+#define PCL_INSTANTIATE_NeighborhoodCache(T) template class PCL_EXPORTS pcl::NeighborhoodCache<T>;
+
+#endif  //#ifndef PCL_KDTREE_IMPL_NEIGHBORHOOD_CACHE_H_
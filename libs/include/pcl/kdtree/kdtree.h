@@ -39,12 +39,73 @@
 #define PCL_KDTREE_KDTREE_H_
 
 #include <limits.h>
+#include <boost/weak_ptr.hpp>
 #include "pcl/pcl_macros.h"
 #include "pcl/point_cloud.h"
 #include "pcl/point_representation.h"
 
 namespace pcl
 {
+  /** \brief The k nearest neighbors of a set of points, stored flat: the neighbors of the i-th point are at
+    * [i * k, (i + 1) * k), sorted by distance, starting with the point itself. Rows of points whose search
+    * failed (e.g. NaN points) hold -1 indices and 0 distances.
+    *
+    * Computed once, the list can be shared by all the stages working on the same cloud with up to k
+    * neighbors, instead of searching the tree again in every stage. A stage only reuses the list for the
+    * cloud it was filled for; call clear () when the points of that cloud are changed in place.
+    * \ingroup kdtree
+    */
+  struct KNeighborList
+  {
+    KNeighborList () : k (0) {}
+
+    /** \brief The number of neighbors of every point. */
+    int k;
+
+    /** \brief The cloud the neighbors were searched in. It can be set to another cloud holding the same
+      * points in the same order (e.g. the cloud with normals built from it), so that the stages working on
+      * that cloud reuse the list too. Empty if the list doesn't belong to any cloud.
+      */
+    boost::weak_ptr<const void> cloud;
+
+    /** \brief The neighbor indices, k per point. Row i belongs to the i-th query index of the stage that
+      * filled the list, and every entry is an index into the points of the whole cloud (not a position in
+      * the query indices). Rows of points without neighbors are filled with -1.
+      */
+    std::vector<int> indices;
+
+    /** \brief The squared distances to the neighbors. */
+    std::vector<float> sqr_distances;
+
+    /** \brief Get the number of points the list holds neighbors for. */
+    inline size_t
+    size () const { return (k > 0 ? indices.size () / k : 0); }
+
+    /** \brief Check whether the list holds at least \a min_k neighbors of \a nr_points points of the given cloud.
+      * \param source the cloud the neighbors are needed for
+      * \param nr_points the number of query points
+      * \param min_k the number of neighbors needed per point
+      */
+    inline bool
+    holds (const boost::shared_ptr<const void> &source, size_t nr_points, int min_k) const
+    {
+      return (k >= min_k && size () == nr_points && source && cloud.lock () == source);
+    }
+
+    /** \brief Empty the list, so that the next stage searches the neighbors again. */
+    inline void
+    clear ()
+    {
+      k = 0;
+      cloud.reset ();
+      indices.clear ();
+      sqr_distances.clear ();
+    }
+
+    typedef boost::shared_ptr<KNeighborList> Ptr;
+    typedef boost::shared_ptr<const KNeighborList> ConstPtr;
+  };
+
   /** \brief @b KdTree represents the base spatial locator class for nearest neighbor estimation. All types of spatial
     * locators should inherit from KdTree.
     * \author Radu Bogdan Rusu, Bastian Steder, Michael Dixon
@@ -0,0 +1,223 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+
+#ifndef PCL_KDTREE_NEIGHBORHOOD_CACHE_H_
+#define PCL_KDTREE_NEIGHBORHOOD_CACHE_H_
+
+#include <vector>
+#include "pcl/kdtree/kdtree.h"
+
+namespace pcl
+{
+  ////////////////////////////////////////////////////////////////////////////////////////////
+  /** \brief @b NeighborhoodCache answers radius searches from neighborhoods computed once. The neighbors of the
+    * query points are searched with a wrapped locator at the largest radius and sorted by distance, so the
+    * neighborhood at any smaller radius is a prefix of the cached one.
+    *
+    * The cache is meant for estimating the same feature at several scales (see MultiscaleFeaturePersistence): it
+    * replaces the search method of the feature estimator, which then runs one search instead of one per scale.
+    * Searches that the cache can't answer (other query points or clouds, larger radii, nearest k searches) go to
+    * the wrapped locator. Copies share the cached neighborhoods and searching doesn't modify them, so one copy per
+    * thread can be searched concurrently.
+    *
+    * \note setInputCloud () doesn't reach the wrapped locator, whose input cloud must be set beforehand.
+    * \ingroup kdtree
+    */
+  template <typename PointT>
+  class NeighborhoodCache : public KdTree<PointT>
+  {
+    using KdTree<PointT>::input_;
+    using KdTree<PointT>::indices_;
+
+    typedef typename KdTree<PointT>::PointCloud PointCloud;
+    typedef typename KdTree<PointT>::PointCloudConstPtr PointCloudConstPtr;
+
+    typedef boost::shared_ptr <std::vector<int> > IndicesPtr;
+    typedef boost::shared_ptr <const std::vector<int> > IndicesConstPtr;
+
+    public:
+      // Boost shared pointers
+      typedef boost::shared_ptr<NeighborhoodCache<PointT> > Ptr;
+      typedef boost::shared_ptr<const NeighborhoodCache<PointT> > ConstPtr;
+
+      typedef typename KdTree<PointT>::Ptr KdTreePtr;
+
+      /** \brief Constructor for NeighborhoodCache.
+        * \param tree the locator that computes the neighborhoods, with its input cloud already set
+        */
+      NeighborhoodCache (const KdTreePtr &tree) : tree_ (tree), data_ (new Data), threads_ (1) {}
+
+      /** \brief Search the neighborhoods of the given query points with the wrapped locator.
+        * \param cloud the cloud of the query points
+        * \param indices the indices of the query points in \a cloud - if NULL all the points are queried
+        * \param radius the largest radius that the cache answers
+        */
+      void
+      computeNeighborhoods (const PointCloudConstPtr &cloud, const IndicesConstPtr &indices, double radius);
+
+      /** \brief Get the largest radius that the cache answers. */
+      inline double
+      getRadius () const { return (data_->radius); }
+
+      /** \brief Get the wrapped locator. */
+      inline KdTreePtr
+      getSearchMethod () const { return (tree_); }
+
+      /** \brief Set the number of threads used by computeNeighborhoods.
+        * \param nr_threads the number of hardware threads to use (0 sets the value back to 1)
+        */
+      inline void
+      setNumberOfThreads (unsigned int nr_threads) { threads_ = (nr_threads == 0) ? 1 : nr_threads; }
+
+      /** \brief Get the number of threads used by computeNeighborhoods. */
+      inline unsigned int
+      getNumberOfThreads () const { return (threads_); }
+
+      /** \brief Provide a pointer to the input dataset. Only remembers the cloud, see the class note.
+        * \param cloud the const boost shared pointer to a PointCloud message
+        * \param indices the point indices subset that is to be used from \a cloud
+        */
+      inline void
+      setInputCloud (const PointCloudConstPtr &cloud, const IndicesConstPtr &indices = IndicesConstPtr ())
+      {
+        input_   = cloud;
+        indices_ = indices;
+      }
+
+      /** \brief Search for the k-nearest neighbors of a given point, with the wrapped locator. */
+      inline int 
+      nearestKSearch (const PointCloud &cloud, int index, int k, std::vector<int> &k_indices, std::vector<float> &k_sqr_distances)
+      {
+        return (tree_->nearestKSearch (cloud, index, k, k_indices, k_sqr_distances));
+      }
+
+      /** \brief Search for the k-nearest neighbors of a given point, with the wrapped locator. */
+      inline int 
+      nearestKSearch (const PointT &p_q, int k, std::vector<int> &k_indices, std::vector<float> &k_sqr_distances)
+      {
+        return (tree_->nearestKSearch (p_q, k, k_indices, k_sqr_distances));
+      }
+
+      /** \brief Search for the k-nearest neighbors of a given point, with the wrapped locator. */
+      inline int 
+      nearestKSearch (int index, int k, std::vector<int> &k_indices, std::vector<float> &k_sqr_distances)
+      {
+        return (tree_->nearestKSearch (index, k, k_indices, k_sqr_distances));
+      }
+
+      /** \brief Search for all the neighbors of a point of \a cloud within a radius, from the cache if it holds
+        * the point and the radius isn't larger than the cached one.
+        * \param cloud the point cloud data
+        * \param index the index in \a cloud of the query point
+        * \param radius the radius of the sphere bounding all of p_q's neighbors
+        * \param k_indices the resultant indices of the neighboring points, sorted by distance
+        * \param k_sqr_distances the resultant squared distances to the neighboring points
+        * \param max_nn if given, bounds the maximum returned neighbors to this value
+        * \return number of neighbors found in radius
+        */
+      int 
+      radiusSearch (const PointCloud &cloud, int index, double radius, std::vector<int> &k_indices,
+                    std::vector<float> &k_sqr_distances, int max_nn = INT_MAX) const;
+
+      /** \brief Search for all the neighbors of a query point within a radius, with the wrapped locator. */
+      inline int 
+      radiusSearch (const PointT &p_q, double radius, std::vector<int> &k_indices,
+                    std::vector<float> &k_sqr_distances, int max_nn = INT_MAX) const
+      {
+        return (tree_->radiusSearch (p_q, radius, k_indices, k_sqr_distances, max_nn));
+      }
+
+      /** \brief Search for all the neighbors of a point of the locator's cloud within a radius, from the cache if
+        * the query points are that cloud.
+        * \param index the index in the locator's cloud of the query point
+        * \param radius the radius of the sphere bounding all of p_q's neighbors
+        * \param k_indices the resultant indices of the neighboring points, sorted by distance
+        * \param k_sqr_distances the resultant squared distances to the neighboring points
+        * \param max_nn if given, bounds the maximum returned neighbors to this value
+        * \return number of neighbors found in radius
+        */
+      int 
+      radiusSearch (int index, double radius, std::vector<int> &k_indices,
+                    std::vector<float> &k_sqr_distances, int max_nn = INT_MAX) const;
+
+    private:
+      /** \brief The cached neighborhoods, shared by the copies of the cache. */
+      struct Data
+      {
+        Data () : radius (0), queries_are_surface (false) {}
+
+        /** \brief The cloud of the query points. */
+        PointCloudConstPtr cloud;
+
+        /** \brief The radius of the neighborhoods. */
+        double radius;
+
+        /** \brief Whether the query points are the locator's cloud. */
+        bool queries_are_surface;
+
+        /** \brief The first neighbor and the number of neighbors of every point of the cloud, -1 if not cached. */
+        std::vector<int> begin, count;
+
+        /** \brief The neighbors of all the query points, sorted by distance. */
+        std::vector<int> indices;
+        std::vector<float> sqr_distances;
+      };
+
+      /** \brief Get a cached neighborhood.
+        * \return false if the cache doesn't hold it
+        */
+      bool
+      getNeighborhood (const PointCloud &cloud, int index, double radius, std::vector<int> &k_indices,
+                       std::vector<float> &k_sqr_distances, int max_nn, int &nr_neighbors) const;
+
+      /** \brief Class getName method. */
+      virtual std::string 
+      getName () const { return ("NeighborhoodCache"); }
+
+      /** \brief The wrapped locator. */
+      KdTreePtr tree_;
+
+      /** \brief The cached neighborhoods. */
+      boost::shared_ptr<const Data> data_;
+
+      /** \brief The number of threads used by computeNeighborhoods. */
+      unsigned int threads_;
+  };
+}
+
+#endif  //#ifndef PCL_KDTREE_NEIGHBORHOOD_CACHE_H_
@@ -293,6 +293,33 @@ namespace pcl
       }
   };
 
+  //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+  /** \brief The SHOT descriptor is a vector whose length depends on the estimator: 352 for the shape only
+    * descriptor (the default), 1344 for SHOT with color. Descriptors of another length are mapped to NaN.
+    */
+  template <>
+  class DefaultPointRepresentation <SHOT> : public PointRepresentation <SHOT>
+  {
+    public:
+      DefaultPointRepresentation (int nr_dimensions = 352)
+      {
+        nr_dimensions_ = nr_dimensions;
+      }
+
+      virtual void
+        copyToFloatArray (const SHOT &p, float * out) const
+      {
+        if ((int)p.descriptor.size () != nr_dimensions_)
+        {
+          for (int i = 0; i < nr_dimensions_; ++i)
+            out[i] = std::numeric_limits<float>::quiet_NaN ();
+          return;
+        }
+        for (int i = 0; i < nr_dimensions_; ++i)
+          out[i] = p.descriptor[i];
+      }
+  };
+
 
   //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
   /** \brief @b CustomPointRepresentation extends PointRepresentation to allow for sub-part selection on the point.
@@ -78,7 +78,7 @@ namespace pcl
     typedef typename FeatureCloud::Ptr FeatureCloudPtr;
     typedef typename FeatureCloud::ConstPtr FeatureCloudConstPtr;
 
-    typedef typename KdTreeFLANN<FeatureT>::Ptr FeatureKdTreePtr; 
+    typedef typename KdTree<FeatureT>::Ptr FeatureKdTreePtr; 
 
     public:
       /** \brief Constructor. */
@@ -110,6 +110,22 @@ namespace pcl
       inline FeatureCloudConstPtr const 
       getTargetFeatures () { return (target_features_); }
 
+      /** \brief Provide a pointer to the search object used to find the target features most similar to the
+        * source ones, e.g. a DescriptorStore instead of the default KdTreeFLANN.
+        * \param tree a pointer to the feature search object
+        */
+      inline void
+      setFeatureSearchMethod (const FeatureKdTreePtr &tree)
+      {
+        feature_tree_ = tree;
+        if (target_features_)
+          feature_tree_->setInputCloud (target_features_);
+      }
+
+      /** \brief Get a pointer to the search object used to compare feature descriptors. */
+      inline FeatureKdTreePtr
+      getFeatureSearchMethod () { return (feature_tree_); }
+
       /** \brief Set the minimum distances between samples
         * \param min_sample_distance the minimum distances between samples
         */
@@ -198,7 +214,7 @@ namespace pcl
       /** \brief The number of neighbors to use when selecting a random feature correspondence. */
       int k_correspondences_;
      
-      /** \brief The KdTree used to compare feature descriptors. */
+      /** \brief The search object used to compare feature descriptors. */
       FeatureKdTreePtr feature_tree_;               
 
   };
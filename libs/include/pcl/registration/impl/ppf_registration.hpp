@@ -0,0 +1,250 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+
+#ifndef PCL_REGISTRATION_IMPL_PPF_REGISTRATION_H_
+#define PCL_REGISTRATION_IMPL_PPF_REGISTRATION_H_
+
+#include "pcl/features/pfh.h"
+#include "pcl/common/transforms.h"
+
+namespace pcl
+{
+  namespace registration
+  {
+    /** \brief Orders poses by decreasing number of votes. */
+    template <typename PoseWithVotes>
+    struct MoreVotes
+    {
+      inline bool
+      operator () (const PoseWithVotes &a, const PoseWithVotes &b) const { return (a.votes > b.votes); }
+    };
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointSource, typename PointTarget> void
+pcl::PPFRegistration<PointSource, PointTarget>::computeTransformation (PointCloudSource &output)
+{
+  clustered_poses_.clear ();
+  if (!search_method_ || search_method_->getNumberOfModelPoints () == 0)
+  {
+    PCL_ERROR ("[pcl::%s::computeTransformation] No model library given!\n", getClassName ().c_str ());
+    return;
+  }
+  const size_t nr_model_points = search_method_->getNumberOfModelPoints ();
+  if (input_->points.size () != nr_model_points)
+  {
+    PCL_ERROR ("[pcl::%s::computeTransformation] The model library was built for %lu points, the source cloud has %lu!\n",
+               getClassName ().c_str (), (unsigned long) nr_model_points, (unsigned long) input_->points.size ());
+    return;
+  }
+
+  // The reference frames of the model points
+  std::vector<Eigen::Affine3f, Eigen::aligned_allocator<Eigen::Affine3f> > model_transforms (nr_model_points);
+  for (size_t i = 0; i < nr_model_points; ++i)
+    model_transforms[i] = pcl::computePPFReferenceTransform (input_->points[i].getVector3fMap (),
+                                                             input_->points[i].getNormalVector3fMap ());
+
+  const float angle_step = search_method_->getAngleDiscretizationStep ();
+  const int nr_angle_bins = static_cast<int> (ceilf (2.0f * static_cast<float> (M_PI) / angle_step));
+  const double max_distance = search_method_->getModelDiameter ();
+  const int nr_references = static_cast<int> ((target_->points.size () + scene_reference_point_sampling_rate_ - 1) /
+                                              scene_reference_point_sampling_rate_);
+
+  // The best pose of every scene reference point, 0 votes if it found none
+  PoseWithVotesList poses (nr_references);
+
+#pragma omp parallel num_threads (threads_)
+  {
+    // The (model point, rotation angle) accumulator of the thread, and the cells to reset after every reference point
+    std::vector<unsigned int> accumulator (nr_model_points * nr_angle_bins, 0);
+    std::vector<size_t> touched;
+    std::vector<int> nn_indices;
+    std::vector<float> nn_distances;
+
+#pragma omp for schedule (dynamic, 16)
+    for (int r = 0; r < nr_references; ++r)
+    {
+      poses[r].votes = 0;
+      const int scene_reference_index = r * scene_reference_point_sampling_rate_;
+      const PointTarget &scene_reference = target_->points[scene_reference_index];
+      if (!pcl_isfinite (scene_reference.x) || !pcl_isfinite (scene_reference.normal_x))
+        continue;
+
+      Eigen::Affine3f transform_sg = pcl::computePPFReferenceTransform (scene_reference.getVector3fMap (),
+                                                                        scene_reference.getNormalVector3fMap ());
+      // The search doesn't shrink vectors it can reuse, only the first nr_neighbors entries are valid
+      int nr_neighbors = tree_->radiusSearch (scene_reference_index, max_distance, nn_indices, nn_distances);
+
+      touched.clear ();
+      for (int k = 0; k < nr_neighbors; ++k)
+      {
+        const PointTarget &scene_point = target_->points[nn_indices[k]];
+        if (nn_indices[k] == scene_reference_index || !(nn_distances[k] > 0.0f) || !pcl_isfinite (scene_point.normal_x))
+          continue;
+
+        float f1, f2, f3, f4;
+        if (!pcl::computePairFeatures (scene_reference.getVector4fMap (), scene_reference.getNormalVector4fMap (),
+                                       scene_point.getVector4fMap (), scene_point.getNormalVector4fMap (),
+                                       f1, f2, f3, f4))
+          continue;
+
+        const PPFHashMapSearch::Entry *entries;
+        int nr_entries = search_method_->nearestNeighborSearch (f1, f2, f3, f4, entries);
+        if (nr_entries == 0)
+          continue;
+
+        float alpha_s = pcl::computePPFAlpha (transform_sg, scene_point.getVector3fMap ());
+        for (int e = 0; e < nr_entries; ++e)
+        {
+          // The rotation around X that brings the model pair onto the scene pair, in [0, 2 pi)
+          float alpha = entries[e].alpha - alpha_s;
+          if (alpha < 0.0f)
+            alpha += 2.0f * static_cast<float> (M_PI);
+          int bin = static_cast<int> (alpha / angle_step);
+          if (bin >= nr_angle_bins)
+            bin = nr_angle_bins - 1;
+
+          size_t cell = entries[e].model_reference * nr_angle_bins + bin;
+          if (accumulator[cell]++ == 0)
+            touched.push_back (cell);
+        }
+      }
+
+      // The cell with the most votes, the first one on ties
+      size_t best_cell = 0;
+      unsigned int best_votes = 0;
+      for (size_t t = 0; t < touched.size (); ++t)
+      {
+        size_t cell = touched[t];
+        if (accumulator[cell] > best_votes || (accumulator[cell] == best_votes && cell < best_cell))
+        {
+          best_cell = cell;
+          best_votes = accumulator[cell];
+        }
+        accumulator[cell] = 0;
+      }
+      if (best_votes == 0)
+        continue;
+
+      const size_t model_reference = best_cell / nr_angle_bins;
+      const float alpha = (static_cast<float> (best_cell % nr_angle_bins) + 0.5f) * angle_step;
+      poses[r].pose = transform_sg.inverse () * Eigen::AngleAxisf (alpha, Eigen::Vector3f::UnitX ()) *
+                      model_transforms[model_reference];
+      poses[r].votes = best_votes;
+    }
+  }
+
+  // Drop the reference points that found nothing
+  PoseWithVotesList voted_poses;
+  voted_poses.reserve (poses.size ());
+  for (size_t r = 0; r < poses.size (); ++r)
+    if (poses[r].votes > 0)
+      voted_poses.push_back (poses[r]);
+  if (voted_poses.empty ())
+  {
+    PCL_ERROR ("[pcl::%s::computeTransformation] No pose of the model found in the scene!\n", getClassName ().c_str ());
+    return;
+  }
+
+  clusterPoses (voted_poses, clustered_poses_);
+
+  final_transformation_ = transformation_ = clustered_poses_[0].pose.matrix ();
+  converged_ = true;
+  pcl::transformPointCloudWithNormals (output, output, final_transformation_);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointSource, typename PointTarget> void
+pcl::PPFRegistration<PointSource, PointTarget>::clusterPoses (PoseWithVotesList &poses, PoseWithVotesList &result)
+{
+  std::stable_sort (poses.begin (), poses.end (), pcl::registration::MoreVotes<PoseWithVotes> ());
+
+  // Every cluster is represented by its first pose, the one with the most votes
+  std::vector<std::vector<size_t> > clusters;
+  for (size_t i = 0; i < poses.size (); ++i)
+  {
+    size_t c = 0;
+    while (c < clusters.size () && !posesWithinErrorBounds (poses[clusters[c][0]].pose, poses[i].pose))
+      ++c;
+    if (c == clusters.size ())
+      clusters.push_back (std::vector<size_t> ());
+    clusters[c].push_back (i);
+  }
+
+  result.resize (clusters.size ());
+  for (size_t c = 0; c < clusters.size (); ++c)
+  {
+    Eigen::Vector3f translation = Eigen::Vector3f::Zero ();
+    Eigen::Vector4f rotation = Eigen::Vector4f::Zero ();
+    Eigen::Quaternionf first (poses[clusters[c][0]].pose.linear ());
+    unsigned int votes = 0;
+    for (size_t i = 0; i < clusters[c].size (); ++i)
+    {
+      const PoseWithVotes &p = poses[clusters[c][i]];
+      Eigen::Quaternionf q (p.pose.linear ());
+      // q and -q are the same rotation, average on the side of the first one
+      if (q.coeffs ().dot (first.coeffs ()) < 0.0f)
+        q.coeffs () *= -1.0f;
+      translation += p.pose.translation ();
+      rotation += q.coeffs ();
+      votes += p.votes;
+    }
+    translation /= static_cast<float> (clusters[c].size ());
+    Eigen::Quaternionf q (rotation);
+    q.normalize ();
+
+    result[c].pose = Eigen::Translation3f (translation) * q;
+    result[c].votes = votes;
+  }
+  std::stable_sort (result.begin (), result.end (), pcl::registration::MoreVotes<PoseWithVotes> ());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointSource, typename PointTarget> bool
+pcl::PPFRegistration<PointSource, PointTarget>::posesWithinErrorBounds (const Eigen::Affine3f &pose1,
+                                                                        const Eigen::Affine3f &pose2)
+{
+  if ((pose1.translation () - pose2.translation ()).norm () > clustering_position_diff_threshold_)
+    return (false);
+
+  Eigen::AngleAxisf rotation_diff (pose1.linear ().transpose () * pose2.linear ());
+  return (fabsf (rotation_diff.angle ()) <= clustering_rotation_diff_threshold_);
+}
+
+#endif // PCL_REGISTRATION_IMPL_PPF_REGISTRATION_H_
@@ -0,0 +1,200 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+
+#ifndef PCL_REGISTRATION_PPF_REGISTRATION_H_
+#define PCL_REGISTRATION_PPF_REGISTRATION_H_
+
+#include "pcl/registration/registration.h"
+#include "pcl/features/ppf.h"
+
+namespace pcl
+{
+  /** \brief @b PPFRegistration finds the poses of a model in a scene with the point pair feature voting scheme of
+    * "Model Globally, Match Locally: Efficient and Robust 3D Object Recognition", B. Drost, M. Ulrich, N. Navab and
+    * S. Ilic, CVPR 2010.
+    *
+    * The source (input) cloud is the model and the target cloud is the scene, both with normals. The model library
+    * is a PPFHashMapSearch built from the PPFEstimation features of the whole source cloud, or loaded from disk.
+    * Every scene reference point pairs up with its neighbors closer than the model diameter, looks up the similar
+    * model pairs and votes for a model point and a rotation around its normal. The best vote of every reference
+    * point is a pose; the poses are clustered and the cluster with the most votes is the final transformation.
+    *
+    * The reference points vote in parallel (setNumberOfThreads), each thread in its own accumulator. The result
+    * doesn't depend on the number of threads.
+    * \ingroup registration
+    */
+  template <typename PointSource, typename PointTarget>
+  class PPFRegistration : public Registration<PointSource, PointTarget>
+  {
+    public:
+      using Registration<PointSource, PointTarget>::reg_name_;
+      using Registration<PointSource, PointTarget>::getClassName;
+      using Registration<PointSource, PointTarget>::input_;
+      using Registration<PointSource, PointTarget>::target_;
+      using Registration<PointSource, PointTarget>::tree_;
+      using Registration<PointSource, PointTarget>::final_transformation_;
+      using Registration<PointSource, PointTarget>::transformation_;
+      using Registration<PointSource, PointTarget>::converged_;
+
+      typedef typename Registration<PointSource, PointTarget>::PointCloudSource PointCloudSource;
+      typedef typename Registration<PointSource, PointTarget>::PointCloudTarget PointCloudTarget;
+
+      /** \brief A pose of the model in the scene and the number of votes for it. */
+      struct PoseWithVotes
+      {
+        Eigen::Affine3f pose;
+        unsigned int votes;
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+      };
+      typedef std::vector<PoseWithVotes, Eigen::aligned_allocator<PoseWithVotes> > PoseWithVotesList;
+
+      /** \brief Empty constructor. */
+      PPFRegistration () : search_method_ (), scene_reference_point_sampling_rate_ (5),
+                           clustering_position_diff_threshold_ (0.01f),
+                           clustering_rotation_diff_threshold_ (20.0f / 180.0f * (float)M_PI),
+                           threads_ (1)
+      {
+        reg_name_ = "PPFRegistration";
+      }
+
+      /** \brief Provide a pointer to the model library, built from the features of the source cloud.
+        * \param search_method the model library
+        */
+      inline void
+      setSearchMethod (const PPFHashMapSearch::ConstPtr &search_method) { search_method_ = search_method; }
+
+      /** \brief Get a pointer to the model library. */
+      inline PPFHashMapSearch::ConstPtr
+      getSearchMethod () { return (search_method_); }
+
+      /** \brief Set the sampling rate of the scene reference points: every n-th scene point votes.
+        * \param scene_reference_point_sampling_rate the sampling rate (default 5)
+        */
+      inline void
+      setSceneReferencePointSamplingRate (unsigned int scene_reference_point_sampling_rate)
+      {
+        scene_reference_point_sampling_rate_ = scene_reference_point_sampling_rate == 0 ? 1 : scene_reference_point_sampling_rate;
+      }
+
+      /** \brief Get the sampling rate of the scene reference points. */
+      inline unsigned int
+      getSceneReferencePointSamplingRate () { return (scene_reference_point_sampling_rate_); }
+
+      /** \brief Set the largest distance between the translations of two poses of the same cluster.
+        * \param clustering_position_diff_threshold the distance (default 0.01)
+        */
+      inline void
+      setPositionClusteringThreshold (float clustering_position_diff_threshold)
+      {
+        clustering_position_diff_threshold_ = clustering_position_diff_threshold;
+      }
+
+      /** \brief Get the largest distance between the translations of two poses of the same cluster. */
+      inline float
+      getPositionClusteringThreshold () { return (clustering_position_diff_threshold_); }
+
+      /** \brief Set the largest angle between the rotations of two poses of the same cluster.
+        * \param clustering_rotation_diff_threshold the angle in radians (default 20 degrees)
+        */
+      inline void
+      setRotationClusteringThreshold (float clustering_rotation_diff_threshold)
+      {
+        clustering_rotation_diff_threshold_ = clustering_rotation_diff_threshold;
+      }
+
+      /** \brief Get the largest angle between the rotations of two poses of the same cluster. */
+      inline float
+      getRotationClusteringThreshold () { return (clustering_rotation_diff_threshold_); }
+
+      /** \brief Set the number of threads the scene reference points vote in.
+        * \param nr_threads the number of threads (0 is 1)
+        */
+      inline void
+      setNumberOfThreads (unsigned int nr_threads) { threads_ = nr_threads == 0 ? 1 : nr_threads; }
+
+      /** \brief Get the number of threads the scene reference points vote in. */
+      inline unsigned int
+      getNumberOfThreads () { return (threads_); }
+
+      /** \brief Get the clustered poses of the last alignment, the one with the most votes first. Every instance of
+        * the model in the scene gets a cluster.
+        */
+      inline const PoseWithVotesList&
+      getResultingPoses () const { return (clustered_poses_); }
+
+    protected:
+      /** \brief Vote for the poses of the model and cluster them.
+        * \param output the source cloud transformed by the best pose
+        */
+      void
+      computeTransformation (PointCloudSource &output);
+
+      /** \brief Group the poses closer than the clustering thresholds, greedily starting from the one with the most
+        * votes, and average every group into one pose.
+        * \param poses the poses found by the scene reference points
+        * \param result the clustered poses, the one with the most votes first
+        */
+      void
+      clusterPoses (PoseWithVotesList &poses, PoseWithVotesList &result);
+
+      /** \brief Check if two poses are closer than the clustering thresholds. */
+      bool
+      posesWithinErrorBounds (const Eigen::Affine3f &pose1, const Eigen::Affine3f &pose2);
+
+    private:
+      /** \brief The model library. */
+      PPFHashMapSearch::ConstPtr search_method_;
+
+      /** \brief Every n-th scene point is a reference point. */
+      unsigned int scene_reference_point_sampling_rate_;
+
+      /** \brief The pose clustering thresholds. */
+      float clustering_position_diff_threshold_, clustering_rotation_diff_threshold_;
+
+      /** \brief The number of threads to vote in. */
+      unsigned int threads_;
+
+      /** \brief The clustered poses of the last alignment. */
+      PoseWithVotesList clustered_poses_;
+  };
+}
+
+#include "pcl/registration/impl/ppf_registration.hpp"
+
+#endif  //#ifndef PCL_REGISTRATION_PPF_REGISTRATION_H_
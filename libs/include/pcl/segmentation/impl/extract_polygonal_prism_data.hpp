@@ -41,6 +41,7 @@
 #include "pcl/segmentation/extract_polygonal_prism_data.h"
 #include "pcl/common/centroid.h"
 #include "pcl/common/eigen.h"
+#include "pcl/filters/convex_region.h"
 
 //////////////////////////////////////////////////////////////////////////
 template <typename PointT> bool
@@ -164,50 +165,33 @@ pcl::ExtractPolygonalPrismData<PointT>::segment (pcl::PointIndices &output)
     return;
   }
 
-  // Compute the plane coefficients
+  // Compute the plane coefficients, with the normal flipped towards the viewpoint
   Eigen::Vector4f model_coefficients;
-  EIGEN_ALIGN16 Eigen::Matrix3f covariance_matrix;
-  Eigen::Vector4f xyz_centroid;
-
-  // Estimate the XYZ centroid
-  compute3DCentroid (*planar_hull_, xyz_centroid);
-
-  // Compute the 3x3 covariance matrix
-  computeCovarianceMatrix (*planar_hull_, xyz_centroid, covariance_matrix);
+  ConvexRegion<PointT>::computeHullPlane (*planar_hull_, Eigen::Vector3f (vpx_, vpy_, vpz_), model_coefficients);
 
-  // Compute the model coefficients
-  EIGEN_ALIGN16 Eigen::Vector3f eigen_values;
-  EIGEN_ALIGN16 Eigen::Matrix3f eigen_vectors;
-  eigen33 (covariance_matrix, eigen_vectors, eigen_values);
-
-  model_coefficients[0] = eigen_vectors (0, 0);
-  model_coefficients[1] = eigen_vectors (1, 0);
-  model_coefficients[2] = eigen_vectors (2, 0);
-  model_coefficients[3] = 0;
+  output.indices.resize (indices_->size ());
+  int l = 0;
 
-  // Hessian form (D = nc . p_plane (centroid here) + p)
-  model_coefficients[3] = -1 * model_coefficients.dot (xyz_centroid);
+  // A prism over a convex hull is an intersection of half-spaces, which can be tested
+  // a block of points at a time without projecting them
+  ConvexRegion<PointT> region;
+  if (region.setPrism (*planar_hull_, model_coefficients, (float)height_limit_min_, (float)height_limit_max_))
+  {
+    const int nr_indices = (int)indices_->size ();
+    uint8_t mask[PREDICATE_BLOCK_SIZE];
+    for (int block = 0; block < nr_indices; block += PREDICATE_BLOCK_SIZE)
+    {
+      const int n = std::min<int> (PREDICATE_BLOCK_SIZE, nr_indices - block);
+      region (*input_, &(*indices_)[block], n, mask);
+      for (int i = 0; i < n; ++i)
+        if (mask[i])
+          output.indices[l++] = (*indices_)[block + i];
+    }
+    output.indices.resize (l);
 
-  // Need to flip the plane normal towards the viewpoint
-  Eigen::Vector4f vp (vpx_, vpy_, vpz_, 0);
-  // See if we need to flip any plane normals
-  vp -= planar_hull_->points[0].getVector4fMap ();
-  vp[3] = 0;
-  // Dot product between the (viewpoint - point) and the plane normal
-  float cos_theta = vp.dot (model_coefficients);
-  // Flip the plane normal
-  if (cos_theta < 0)
-  {                                                                
-    model_coefficients *= -1;
-    model_coefficients[3] = 0;
-    // Hessian form (D = nc . p_plane (centroid here) + p)
-    model_coefficients[3] = -1 * (model_coefficients.dot (planar_hull_->points[0].getVector4fMap ()));
+    deinitCompute ();
+    return;
   }
-    
-  // Project all points
-  PointCloud projected_points;
-  SampleConsensusModelPlane<PointT> sacmodel (input_);
-  sacmodel.projectPoints (*indices_, model_coefficients, projected_points, false);
 
   // Create a X-Y projected representation for within bounds polygonal checking
   int k0, k1, k2;
@@ -216,7 +200,7 @@ pcl::ExtractPolygonalPrismData<PointT>::segment (pcl::PointIndices &output)
   k0 = (fabs (model_coefficients[k0]) > fabs (model_coefficients[2])) ? k0 : 2;
   k1 = (k0 + 1) % 3;
   k2 = (k0 + 2) % 3;
-  // Project the convex hull
+  // Project the hull
   pcl::PointCloud<PointT> polygon;
   polygon.points.resize (planar_hull_->points.size ());
   for (size_t i = 0; i < planar_hull_->points.size (); ++i)
@@ -230,19 +214,20 @@ pcl::ExtractPolygonalPrismData<PointT>::segment (pcl::PointIndices &output)
   PointT pt_xy;
   pt_xy.z = 0;
 
-  output.indices.resize (indices_->size ());
-  int l = 0;
-  for (size_t i = 0; i < projected_points.points.size (); ++i)
+  for (size_t i = 0; i < indices_->size (); ++i)
   {
+    const PointT &point = input_->points[(*indices_)[i]];
+
     // Check the distance to the user imposed limits from the table planar model
-    double distance = pointToPlaneDistanceSigned (input_->points[(*indices_)[i]], model_coefficients);
+    float distance = model_coefficients[0] * point.x + model_coefficients[1] * point.y +
+                     model_coefficients[2] * point.z + model_coefficients[3];
     if (distance < height_limit_min_ || distance > height_limit_max_)
       continue;
 
-    // Check what points are inside the hull
-    Eigen::Vector4f pt (projected_points.points[i].x,
-                         projected_points.points[i].y,
-                         projected_points.points[i].z, 0);
+    // Check whether the projection of the point on the plane is inside the hull
+    Eigen::Vector4f pt (point.x - distance * model_coefficients[0],
+                        point.y - distance * model_coefficients[1],
+                        point.z - distance * model_coefficients[2], 0);
     pt_xy.x = pt[k1];
     pt_xy.y = pt[k2];
 
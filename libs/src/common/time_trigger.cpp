@@ -110,6 +110,9 @@ void pcl::TimeTrigger::thread_function ()
   {
     time = getTime ();
     unique_lock<mutex> lock (condition_mutex_);
+    // quit_ may have been set after the loop check, don't wait for a notification that already happened
+    if (quit_)
+      break;
     if (!running_)
     {
       condition_.wait (lock); // wait util start is called or destructor is called
@@ -39,6 +39,22 @@
 #include "pcl/features/impl/ppf.hpp"
 #include <pcl/point_types.h>
 #include <pcl/impl/instantiate.hpp>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+# include <io.h>
+# include <windows.h>
+# define pcl_open                    _open
+# define pcl_close(fd)               _close(fd)
+#else
+# include <sys/mman.h>
+# include <unistd.h>
+# define pcl_open                    open
+# define pcl_close(fd)               close(fd)
+#endif
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 bool
@@ -63,5 +79,322 @@ pcl::computePPFPairFeature (const Eigen::Vector4f &p1, const Eigen::Vector4f &n1
   return (true);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+Eigen::Affine3f
+pcl::computePPFReferenceTransform (const Eigen::Vector3f &point, const Eigen::Vector3f &normal)
+{
+  // Rotate the normal onto the X axis around normal x X
+  Eigen::Vector3f axis = normal.cross (Eigen::Vector3f::UnitX ());
+  float s = axis.norm (), c = normal.dot (Eigen::Vector3f::UnitX ());
+  Eigen::Matrix3f rotation;
+  if (s > 1e-6f)
+    rotation = Eigen::AngleAxisf (atan2f (s, c), axis / s).toRotationMatrix ();
+  // The normal is (anti)parallel to X, any axis perpendicular to it will do
+  else if (c > 0.0f)
+    rotation = Eigen::Matrix3f::Identity ();
+  else
+    rotation = Eigen::AngleAxisf (static_cast<float> (M_PI), Eigen::Vector3f::UnitZ ()).toRotationMatrix ();
+
+  Eigen::Affine3f transform;
+  transform.linear () = rotation;
+  transform.translation () = rotation * (-point);
+  return (transform);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+  const char ppf_model_magic[8] = {'P', 'C', 'L', 'P', 'P', 'F', 'M', '1'};
+  const pcl::uint32_t ppf_model_version = 1;
+
+  /** \brief A model pair and its key while the library is built. */
+  struct KeyedEntry
+  {
+    pcl::uint64_t key;
+    pcl::PPFHashMapSearch::Entry entry;
+
+    inline bool
+    operator < (const KeyedEntry &other) const
+    {
+      if (key != other.key)
+        return (key < other.key);
+      return (entry.model_reference < other.entry.model_reference);
+    }
+  };
+
+  /** \brief The first slot to probe for a key in a table of the given size (a power of 2). */
+  inline size_t
+  hashKey (pcl::uint64_t key, size_t nr_slots)
+  {
+    pcl::uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 32;
+    return (static_cast<size_t> (h) & (nr_slots - 1));
+  }
+
+  /** \brief Deletes a library allocated with new []. */
+  struct ArrayDeleter
+  {
+    void operator () (char *p) const { delete [] p; }
+  };
+
+  /** \brief Unmaps a library mapped by loadModel. */
+  struct UnmapDeleter
+  {
+    size_t size;
+    void operator () (char *p) const
+    {
+#ifdef _WIN32
+      UnmapViewOfFile (p);
+#else
+      munmap (p, size);
+#endif
+    }
+  };
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+pcl::PPFHashMapSearch::PPFHashMapSearch (float angle_discretization_step, float distance_discretization_step)
+  : angle_discretization_step_ (angle_discretization_step),
+    distance_discretization_step_ (distance_discretization_step),
+    data_size_ (0), header_ (NULL), slots_ (NULL), entries_ (NULL)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+bool
+pcl::PPFHashMapSearch::computeKey (float f1, float f2, float f3, float f4, pcl::uint64_t &key) const
+{
+  const float angle_step = getAngleDiscretizationStep (), distance_step = getDistanceDiscretizationStep ();
+  // f1 is an angle in [-pi, pi], f2 and f3 are cosines
+  float a1 = (f1 + static_cast<float> (M_PI)) / angle_step,
+        a2 = acosf (std::max (-1.0f, std::min (1.0f, f2))) / angle_step,
+        a3 = acosf (std::max (-1.0f, std::min (1.0f, f3))) / angle_step,
+        d = f4 / distance_step;
+  if (!(a1 >= 0.0f && a1 < 65536.0f && a2 < 65536.0f && a3 < 65536.0f && d >= 0.0f && d < 65536.0f))
+    return (false);
+
+  key = static_cast<pcl::uint64_t> (a1) | static_cast<pcl::uint64_t> (a2) << 16 |
+        static_cast<pcl::uint64_t> (a3) << 32 | static_cast<pcl::uint64_t> (d) << 48;
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void
+pcl::PPFHashMapSearch::setInputFeatureCloud (const PointCloud<PPFSignature>::ConstPtr &feature_cloud)
+{
+  data_.reset ();
+  data_size_ = 0;
+  header_ = NULL; slots_ = NULL; entries_ = NULL;
+
+  size_t nr_points = static_cast<size_t> (sqrt (static_cast<double> (feature_cloud->points.size ())) + 0.5);
+  if (nr_points < 2 || nr_points * nr_points != feature_cloud->points.size ())
+  {
+    PCL_ERROR ("[pcl::PPFHashMapSearch::setInputFeatureCloud] Expected the features of all the pairs of at least 2 model points, got %lu features.\n",
+               (unsigned long) feature_cloud->points.size ());
+    return;
+  }
+
+  // Quantize every pair; (i, i) and the pairs that failed have no distance
+  std::vector<KeyedEntry> keyed;
+  keyed.reserve (feature_cloud->points.size () - nr_points);
+  float max_distance = 0.0f;
+  for (size_t i = 0; i < nr_points; ++i)
+  {
+    for (size_t j = 0; j < nr_points; ++j)
+    {
+      const PPFSignature &p = feature_cloud->points[i * nr_points + j];
+      KeyedEntry k;
+      if (i == j || !(p.f4 > 0.0f) || !computeKey (p.f1, p.f2, p.f3, p.f4, k.key))
+        continue;
+      k.entry.model_reference = static_cast<pcl::uint32_t> (i);
+      k.entry.alpha = p.alpha_m;
+      keyed.push_back (k);
+      max_distance = std::max (max_distance, p.f4);
+    }
+  }
+  std::sort (keyed.begin (), keyed.end ());
+
+  size_t nr_keys = 0;
+  for (size_t i = 0; i < keyed.size (); ++i)
+    if (i == 0 || keyed[i].key != keyed[i - 1].key)
+      ++nr_keys;
+
+  // Keep the table at most half full so the probe sequences stay short
+  size_t nr_slots = 2;
+  while (nr_slots < 2 * nr_keys)
+    nr_slots <<= 1;
+
+  size_t size = sizeof (Header) + nr_slots * sizeof (Slot) + keyed.size () * sizeof (Entry);
+  boost::shared_ptr<char> data (new char[size], ArrayDeleter ());
+  memset (data.get (), 0, size);
+
+  Header *header = reinterpret_cast<Header*> (data.get ());
+  memcpy (header->magic, ppf_model_magic, sizeof (header->magic));
+  header->version = ppf_model_version;
+  header->nr_model_points = static_cast<pcl::uint32_t> (nr_points);
+  header->angle_discretization_step = angle_discretization_step_;
+  header->distance_discretization_step = distance_discretization_step_;
+  header->max_distance = max_distance;
+  header->nr_slots = static_cast<pcl::uint32_t> (nr_slots);
+  header->nr_entries = keyed.size ();
+
+  Slot *slots = reinterpret_cast<Slot*> (data.get () + sizeof (Header));
+  Entry *entries = reinterpret_cast<Entry*> (data.get () + sizeof (Header) + nr_slots * sizeof (Slot));
+  for (size_t i = 0; i < keyed.size (); ++i)
+  {
+    entries[i] = keyed[i].entry;
+    if (i > 0 && keyed[i].key == keyed[i - 1].key)
+      continue;
+
+    size_t end = i + 1;
+    while (end < keyed.size () && keyed[end].key == keyed[i].key)
+      ++end;
+
+    size_t slot = hashKey (keyed[i].key, nr_slots);
+    while (slots[slot].count != 0)
+      slot = (slot + 1) & (nr_slots - 1);
+    slots[slot].key = keyed[i].key;
+    slots[slot].begin = static_cast<pcl::uint32_t> (i);
+    slots[slot].count = static_cast<pcl::uint32_t> (end - i);
+  }
+
+  setData (data, size);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+int
+pcl::PPFHashMapSearch::nearestNeighborSearch (float f1, float f2, float f3, float f4, const Entry *&entries) const
+{
+  entries = NULL;
+  pcl::uint64_t key;
+  if (!header_ || !computeKey (f1, f2, f3, f4, key))
+    return (0);
+
+  const size_t mask = header_->nr_slots - 1;
+  for (size_t slot = hashKey (key, header_->nr_slots); slots_[slot].count != 0; slot = (slot + 1) & mask)
+  {
+    if (slots_[slot].key == key)
+    {
+      entries = entries_ + slots_[slot].begin;
+      return (static_cast<int> (slots_[slot].count));
+    }
+  }
+  return (0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+bool
+pcl::PPFHashMapSearch::setData (const boost::shared_ptr<char> &data, size_t size)
+{
+  const Header *header = reinterpret_cast<const Header*> (data.get ());
+  if (size < sizeof (Header) || memcmp (header->magic, ppf_model_magic, sizeof (header->magic)) != 0 ||
+      header->version != ppf_model_version)
+    return (false);
+  if (header->nr_slots < 2 || (header->nr_slots & (header->nr_slots - 1)) != 0 ||
+      size != sizeof (Header) + header->nr_slots * sizeof (Slot) + header->nr_entries * sizeof (Entry))
+    return (false);
+
+  data_ = data;
+  data_size_ = size;
+  header_ = header;
+  slots_ = reinterpret_cast<const Slot*> (data.get () + sizeof (Header));
+  entries_ = reinterpret_cast<const Entry*> (data.get () + sizeof (Header) + header->nr_slots * sizeof (Slot));
+  angle_discretization_step_ = header->angle_discretization_step;
+  distance_discretization_step_ = header->distance_discretization_step;
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+int
+pcl::PPFHashMapSearch::saveModel (const std::string &file_name) const
+{
+  if (!header_)
+  {
+    PCL_ERROR ("[pcl::PPFHashMapSearch::saveModel] No model to save!\n");
+    return (-1);
+  }
+
+  std::ofstream fs (file_name.c_str (), std::ios::out | std::ios::binary);
+  fs.write (data_.get (), data_size_);
+  fs.close ();
+  if (!fs)
+  {
+    PCL_ERROR ("[pcl::PPFHashMapSearch::saveModel] Error writing to %s!\n", file_name.c_str ());
+    return (-1);
+  }
+  return (0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+int
+pcl::PPFHashMapSearch::loadModel (const std::string &file_name, bool memory_map)
+{
+  boost::shared_ptr<char> data;
+  size_t size = 0;
+  if (memory_map)
+  {
+    int fd = pcl_open (file_name.c_str (), O_RDONLY);
+    if (fd == -1)
+    {
+      PCL_ERROR ("[pcl::PPFHashMapSearch::loadModel] Could not open %s!\n", file_name.c_str ());
+      return (-1);
+    }
+    struct stat st;
+    if (fstat (fd, &st) == -1 || st.st_size == 0)
+    {
+      pcl_close (fd);
+      PCL_ERROR ("[pcl::PPFHashMapSearch::loadModel] %s is empty!\n", file_name.c_str ());
+      return (-1);
+    }
+    size = static_cast<size_t> (st.st_size);
+
+    UnmapDeleter deleter;
+    deleter.size = size;
+#ifdef _WIN32
+    HANDLE fm = CreateFileMapping ((HANDLE) _get_osfhandle (fd), NULL, PAGE_READONLY, 0, 0, NULL);
+    char *map = fm ? static_cast<char*> (MapViewOfFile (fm, FILE_MAP_READ, 0, 0, size)) : NULL;
+    if (fm)
+      CloseHandle (fm);
+    pcl_close (fd);
+    if (map == NULL)
+#else
+    char *map = static_cast<char*> (mmap (0, size, PROT_READ, MAP_SHARED, fd, 0));
+    pcl_close (fd);
+    if (map == MAP_FAILED)
+#endif
+    {
+      PCL_ERROR ("[pcl::PPFHashMapSearch::loadModel] Error during mmap ()!\n");
+      return (-1);
+    }
+    data.reset (map, deleter);
+  }
+  else
+  {
+    std::ifstream fs (file_name.c_str (), std::ios::in | std::ios::binary);
+    if (!fs.is_open ())
+    {
+      PCL_ERROR ("[pcl::PPFHashMapSearch::loadModel] Could not open %s!\n", file_name.c_str ());
+      return (-1);
+    }
+    fs.seekg (0, std::ios::end);
+    size = static_cast<size_t> (fs.tellg ());
+    fs.seekg (0, std::ios::beg);
+    data.reset (new char[size], ArrayDeleter ());
+    fs.read (data.get (), size);
+    if (!fs)
+    {
+      PCL_ERROR ("[pcl::PPFHashMapSearch::loadModel] Error reading %s!\n", file_name.c_str ());
+      return (-1);
+    }
+  }
+
+  if (!setData (data, size))
+  {
+    PCL_ERROR ("[pcl::PPFHashMapSearch::loadModel] %s is not a point pair feature model!\n", file_name.c_str ());
+    return (-1);
+  }
+  return (0);
+}
+
 // Instantiations of specific point types
 PCL_INSTANTIATE_PRODUCT(PPFEstimation, (PCL_XYZ_POINT_TYPES)(PCL_NORMAL_POINT_TYPES)((pcl::PPFSignature)));
@@ -41,14 +41,38 @@
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
 #include <pcl/io/pcd_io.h>
+#include <boost/thread.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <list>
+#include <map>
 
 //////////////////////// GrabberImplementation //////////////////////
 struct pcl::PCDGrabberBase::PCDGrabberImpl
 {
+  typedef boost::shared_ptr<const sensor_msgs::PointCloud2> BlobConstPtr;
+
+  /** \brief a ring buffer entry, holding the frame of one playback position */
+  struct Slot
+  {
+    Slot () : sequence (0), ready (false) {}
+    size_t sequence;
+    bool ready;
+    BlobConstPtr cloud;
+  };
+
   PCDGrabberImpl (pcl::PCDGrabberBase& grabber, const std::string& pcd_path, float frames_per_second, bool repeat);
   PCDGrabberImpl (pcl::PCDGrabberBase& grabber, const std::vector<std::string>& pcd_files, float frames_per_second, bool repeat);
+  ~PCDGrabberImpl ();
   void trigger ();
   void readAhead ();
+  void startWorkers (unsigned int frames, unsigned int threads);
+  void stopWorkers ();
+  void worker ();
+  bool hasSequence (size_t sequence) const;
+  BlobConstPtr load (size_t file_index) const;
+  BlobConstPtr findCached (size_t file_index);
+  void insertCached (size_t file_index, const BlobConstPtr& cloud);
+  void restart ();
   pcl::PCDGrabberBase& grabber_;
   float frames_per_second_;
   bool repeat_;
@@ -59,6 +83,21 @@ struct pcl::PCDGrabberBase::PCDGrabberImpl
 
   sensor_msgs::PointCloud2 next_cloud_;
   bool valid_;
+
+  // read-ahead mode: playback position n is decoded into ring_[n % ring_.size ()]
+  std::vector<Slot> ring_;
+  boost::scoped_ptr<boost::thread_group> workers_;
+  boost::mutex mutex_;
+  boost::condition_variable condition_;
+  size_t next_publish_;
+  size_t next_decode_;
+  unsigned int generation_;
+  bool quit_;
+
+  // LRU cache of decoded frames, by file index
+  size_t cache_size_;
+  std::list<size_t> cache_order_;
+  std::map<size_t, std::pair<BlobConstPtr, std::list<size_t>::iterator> > cache_;
 };
 
 pcl::PCDGrabberBase::PCDGrabberImpl::PCDGrabberImpl (pcl::PCDGrabberBase& grabber, const std::string& pcd_path, float frames_per_second, bool repeat)
@@ -68,6 +107,11 @@ pcl::PCDGrabberBase::PCDGrabberImpl::PCDGrabberImpl (pcl::PCDGrabberBase& grabbe
 , running_ (false)
 , time_trigger_ (1.0 / (double) std::max(frames_per_second, 0.001f), boost::bind (&PCDGrabberImpl::trigger, this))
 , valid_ (false)
+, next_publish_ (0)
+, next_decode_ (0)
+, generation_ (0)
+, quit_ (false)
+, cache_size_ (0)
 {
   pcd_files_.push_back (pcd_path);
   pcd_iterator_ = pcd_files_.begin ();
@@ -80,11 +124,21 @@ pcl::PCDGrabberBase::PCDGrabberImpl::PCDGrabberImpl (pcl::PCDGrabberBase& grabbe
 , running_ (false)
 , time_trigger_ (1.0 / (double) std::max(frames_per_second, 0.001f), boost::bind (&PCDGrabberImpl::trigger, this))
 , valid_ (false)
+, next_publish_ (0)
+, next_decode_ (0)
+, generation_ (0)
+, quit_ (false)
+, cache_size_ (0)
 {
   pcd_files_ = pcd_files;
   pcd_iterator_ = pcd_files_.begin ();
 }
 
+pcl::PCDGrabberBase::PCDGrabberImpl::~PCDGrabberImpl ()
+{
+  stopWorkers ();
+}
+
 void pcl::PCDGrabberBase::PCDGrabberImpl::readAhead ()
 {
   if (pcd_iterator_ != pcd_files_.end ())
@@ -104,11 +158,174 @@ void pcl::PCDGrabberBase::PCDGrabberImpl::readAhead ()
 
 void pcl::PCDGrabberBase::PCDGrabberImpl::trigger ()
 {
-  if (valid_)
-    grabber_.publish (next_cloud_);
+  boost::unique_lock<boost::mutex> lock (mutex_);
+  if (ring_.empty ())
+  {
+    // publish outside the lock, the callbacks may rewind the grabber
+    lock.unlock ();
+    if (valid_)
+      grabber_.publish (next_cloud_);
+    lock.lock ();
+
+    // use remaining time, if there is time left!
+    readAhead ();
+    return;
+  }
+
+  // wait for the workers only if they fell behind. rewind () and setReadAhead () may reset the
+  // playback position or the ring meanwhile, so the slot is looked up again after every wakeup
+  BlobConstPtr cloud;
+  for (;;)
+  {
+    if (quit_ || ring_.empty () || !hasSequence (next_publish_))
+      return;
+
+    Slot& slot = ring_[next_publish_ % ring_.size ()];
+    if (slot.ready && slot.sequence == next_publish_)
+    {
+      cloud = slot.cloud;
+      slot.cloud.reset ();
+      slot.ready = false;
+      ++next_publish_;
+      condition_.notify_all ();
+      break;
+    }
+    condition_.wait (lock);
+  }
+  lock.unlock ();
+
+  // publish outside the lock, the workers keep decoding meanwhile
+  if (cloud)
+    grabber_.publish (*cloud);
+}
+
+bool pcl::PCDGrabberBase::PCDGrabberImpl::hasSequence (size_t sequence) const
+{
+  return (!pcd_files_.empty () && (repeat_ || sequence < pcd_files_.size ()));
+}
+
+pcl::PCDGrabberBase::PCDGrabberImpl::BlobConstPtr
+pcl::PCDGrabberBase::PCDGrabberImpl::load (size_t file_index) const
+{
+  boost::shared_ptr<sensor_msgs::PointCloud2> cloud (new sensor_msgs::PointCloud2);
+  PCDReader reader;
+  int pcd_version;
+  Eigen::Vector4f origin;
+  Eigen::Quaternionf orientation;
+  if (reader.read (pcd_files_[file_index], *cloud, origin, orientation, pcd_version) != 0)
+    return (BlobConstPtr ());
+  return (cloud);
+}
+
+pcl::PCDGrabberBase::PCDGrabberImpl::BlobConstPtr
+pcl::PCDGrabberBase::PCDGrabberImpl::findCached (size_t file_index)
+{
+  std::map<size_t, std::pair<BlobConstPtr, std::list<size_t>::iterator> >::iterator it = cache_.find (file_index);
+  if (it == cache_.end ())
+    return (BlobConstPtr ());
+
+  // move to the most recently used end
+  cache_order_.splice (cache_order_.end (), cache_order_, it->second.second);
+  return (it->second.first);
+}
+
+void pcl::PCDGrabberBase::PCDGrabberImpl::insertCached (size_t file_index, const BlobConstPtr& cloud)
+{
+  if (cache_size_ == 0 || !cloud || cache_.count (file_index))
+    return;
 
-  // use remaining time, if there is time left!
-  readAhead ();
+  while (cache_.size () >= cache_size_)
+  {
+    cache_.erase (cache_order_.front ());
+    cache_order_.pop_front ();
+  }
+  cache_order_.push_back (file_index);
+  cache_[file_index] = std::make_pair (cloud, --cache_order_.end ());
+}
+
+void pcl::PCDGrabberBase::PCDGrabberImpl::worker ()
+{
+  boost::unique_lock<boost::mutex> lock (mutex_);
+  while (!quit_)
+  {
+    // the ring is full or we reached the end of the list
+    if (next_decode_ >= next_publish_ + ring_.size () || !hasSequence (next_decode_))
+    {
+      condition_.wait (lock);
+      continue;
+    }
+
+    const size_t sequence = next_decode_++;
+    const unsigned int generation = generation_;
+    const size_t file_index = sequence % pcd_files_.size ();
+
+    BlobConstPtr cloud = findCached (file_index);
+    if (!cloud)
+    {
+      lock.unlock ();
+      cloud = load (file_index);
+      lock.lock ();
+    }
+
+    // rewind () was called while decoding
+    if (generation != generation_)
+      continue;
+
+    insertCached (file_index, cloud);
+
+    Slot& slot = ring_[sequence % ring_.size ()];
+    slot.sequence = sequence;
+    slot.cloud = cloud;
+    slot.ready = true;
+    condition_.notify_all ();
+  }
+}
+
+void pcl::PCDGrabberBase::PCDGrabberImpl::startWorkers (unsigned int frames, unsigned int threads)
+{
+  stopWorkers ();
+  if (frames == 0)
+    return;
+
+  boost::unique_lock<boost::mutex> lock (mutex_);
+  quit_ = false;
+  ring_.assign (frames, Slot ());
+  // continue from where the synchronous playback stopped
+  next_publish_ = next_decode_ = pcd_iterator_ - pcd_files_.begin ();
+  lock.unlock ();
+
+  // a new group for every start, the joined threads of the previous one are gone with it
+  workers_.reset (new boost::thread_group);
+  for (unsigned int i = 0; i < std::max (threads, 1u); ++i)
+    workers_->create_thread (boost::bind (&PCDGrabberImpl::worker, this));
+}
+
+void pcl::PCDGrabberBase::PCDGrabberImpl::stopWorkers ()
+{
+  boost::unique_lock<boost::mutex> lock (mutex_);
+  if (ring_.empty ())
+    return;
+  quit_ = true;
+  condition_.notify_all ();
+  lock.unlock ();
+
+  workers_->join_all ();
+  workers_.reset ();
+
+  lock.lock ();
+  ring_.clear ();
+  ++generation_;
+}
+
+void pcl::PCDGrabberBase::PCDGrabberImpl::restart ()
+{
+  boost::unique_lock<boost::mutex> lock (mutex_);
+  pcd_iterator_ = pcd_files_.begin ();
+  ++generation_;
+  next_publish_ = next_decode_ = 0;
+  for (size_t i = 0; i < ring_.size (); ++i)
+    ring_[i] = Slot ();
+  condition_.notify_all ();
 }
 
 //////////////////////// GrabberBase //////////////////////
@@ -162,7 +379,23 @@ std::string pcl::PCDGrabberBase::getName () const
 
 void pcl::PCDGrabberBase::rewind ()
 {
-  impl_->pcd_iterator_ = impl_->pcd_files_.begin ();
+  impl_->restart ();
+}
+
+void pcl::PCDGrabberBase::setReadAhead (unsigned int frames, unsigned int threads)
+{
+  impl_->startWorkers (frames, threads);
+}
+
+void pcl::PCDGrabberBase::setCacheSize (unsigned int frames)
+{
+  boost::unique_lock<boost::mutex> lock (impl_->mutex_);
+  impl_->cache_size_ = frames;
+  while (impl_->cache_.size () > impl_->cache_size_)
+  {
+    impl_->cache_.erase (impl_->cache_order_.front ());
+    impl_->cache_order_.pop_front ();
+  }
 }
 
 #endif
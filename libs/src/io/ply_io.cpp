@@ -56,6 +56,8 @@ pcl::PLYReader::readHeader (const std::string &file_name, sensor_msgs::PointClou
   // Default values
   data_idx = 0;
   binary_data = false;
+  swap_bytes_ = false;
+  parser_.clear ();
   cloud.width = cloud.height = cloud.point_step = cloud.row_step = 0;
   cloud.data.clear ();
 
@@ -201,21 +203,22 @@ pcl::PLYReader::readHeader (const std::string &file_name, sensor_msgs::PointClou
   pcl::io::ply::element* vertex = NULL;
   pcl::io::ply::element* camera = NULL;
   // this is the most painful part in a PLY file: 
-  // you need to peek up the list property size, for now we don't deal with them
+  // you need to peek up the list property size, for now we only skip them
+  // in elements we don't read (e.g. faces)
   for(pcl::io::ply::parser::iterator elements_it = parser_.begin();
       elements_it != parser_.end();
       ++elements_it)
   {
-    if((*elements_it)->has_list_properties ())
-    {
-      PCL_ERROR ("[pcl::PLYReader::readHeader] list properties are not handled\n");
-      return (-1);
-    }
     if("vertex" == (*elements_it)->name_)
       vertex = *elements_it;
     if("camera" == (*elements_it)->name_)
       camera = *elements_it;
   }
+  if((vertex && vertex->has_list_properties ()) || (camera && camera->has_list_properties ()))
+  {
+    PCL_ERROR ("[pcl::PLYReader::readHeader] list properties are not handled for vertex and camera elements\n");
+    return (-1);
+  }
   // Ensure we have some elements named vertex
   if(!vertex)
   {
@@ -223,18 +226,19 @@ pcl::PLYReader::readHeader (const std::string &file_name, sensor_msgs::PointClou
     return -1;
   }
   cloud.point_step = vertex->offset_;
-  cloud.data.resize (vertex->count_ * vertex->offset_);
   cloud.width = vertex->count_;
   cloud.row_step = cloud.point_step * cloud.width;
   cloud.height = 1;
   cloud.fields.resize (vertex->properties_.size());
   size_t counter = 0;
+  size_t offset = 0;
   for(pcl::io::ply::element::const_iterator properties_it = vertex->properties_.begin();
       properties_it != vertex->properties_.end();
       ++properties_it, counter++)
   {
     cloud.fields.at(counter).name = (*properties_it)->name_;
-    cloud.fields.at(counter).offset = counter * (*properties_it)->offset_;
+    cloud.fields.at(counter).offset = offset;
+    offset += (*properties_it)->offset_;
     cloud.fields.at(counter).datatype = (*properties_it)->data_type_;
     if(!vertex->is_list_property(properties_it))
       cloud.fields.at(counter).count = 1;
@@ -253,6 +257,185 @@ pcl::PLYReader::readHeader (const std::string &file_name, sensor_msgs::PointClou
 
 /////////////////////////////////////////////////////////////////////////////////////////
 
+namespace
+{
+  /** \brief Find the start of the next \a count non empty lines.
+    * \param pos the current position in the data section
+    * \param records the resultant record starts
+    * \param count the number of records to look for
+    * \return the position after the last record found
+    */
+  const char*
+  findRecords (const char *pos, const char *end, std::vector<const char*> &records, size_t count)
+  {
+    records.clear ();
+    records.reserve (count);
+    while (records.size () < count && pos < end)
+    {
+      const char *eol = static_cast<const char*> (memchr (pos, '\n', end - pos));
+      if (!eol)
+        eol = end;
+
+      // Ignore empty lines
+      const char *c = pos;
+      while (c < eol && isspace (*c))
+        ++c;
+      if (c < eol)
+        records.push_back (pos);
+
+      pos = (eol < end) ? eol + 1 : end;
+    }
+    return (pos);
+  }
+
+  /** \brief Parse one ASCII record of scalar properties into \a data.
+    * The record must be followed by a '\n' or a '\0'.
+    * \return false if the record has less values than properties
+    */
+  bool
+  parseRecord (const char *pos, const pcl::io::ply::element &element, unsigned char *data)
+  {
+    size_t offset = 0;
+    for (pcl::io::ply::element::const_iterator properties_it = element.properties_.begin ();
+         properties_it != element.properties_.end ();
+         ++properties_it)
+    {
+      // Stay on the current line, strtod/strtol would happily skip the newline
+      while (*pos == ' ' || *pos == '\t' || *pos == '\r')
+        ++pos;
+      if (*pos == '\n' || *pos == '\0')
+        return (false);
+
+      char *next = NULL;
+      unsigned char *dst = data + offset;
+      switch ((*properties_it)->data_type_)
+      {
+        case sensor_msgs::PointField::INT8:
+          *reinterpret_cast<char*> (dst) = static_cast<char> (strtol (pos, &next, 10));
+          break;
+        case sensor_msgs::PointField::UINT8:
+          *dst = static_cast<unsigned char> (strtoul (pos, &next, 10));
+          break;
+        case sensor_msgs::PointField::INT16:
+        {
+          short value = static_cast<short> (strtol (pos, &next, 10));
+          memcpy (dst, &value, sizeof (short));
+          break;
+        }
+        case sensor_msgs::PointField::UINT16:
+        {
+          unsigned short value = static_cast<unsigned short> (strtoul (pos, &next, 10));
+          memcpy (dst, &value, sizeof (unsigned short));
+          break;
+        }
+        case sensor_msgs::PointField::INT32:
+        {
+          int value = static_cast<int> (strtol (pos, &next, 10));
+          memcpy (dst, &value, sizeof (int));
+          break;
+        }
+        case sensor_msgs::PointField::UINT32:
+        {
+          unsigned int value = static_cast<unsigned int> (strtoul (pos, &next, 10));
+          memcpy (dst, &value, sizeof (unsigned int));
+          break;
+        }
+        case sensor_msgs::PointField::FLOAT32:
+        {
+          float value = static_cast<float> (strtod (pos, &next));
+          memcpy (dst, &value, sizeof (float));
+          break;
+        }
+        case sensor_msgs::PointField::FLOAT64:
+        {
+          double value = strtod (pos, &next);
+          memcpy (dst, &value, sizeof (double));
+          break;
+        }
+        default:
+          return (false);
+      }
+      if (next == pos)
+        return (false);
+      pos = next;
+      offset += (*properties_it)->offset_;
+    }
+    return (true);
+  }
+
+  /** \brief One field copied from a PLY vertex record into a point. */
+  struct FieldCopy
+  {
+    size_t src_offset;
+    size_t dst_offset;
+    size_t size;
+    int src_type;
+    int dst_type;
+
+    inline bool
+    operator< (const FieldCopy &other) const
+    {
+      return (dst_offset < other.dst_offset);
+    }
+  };
+
+  /** \brief PLY property names used for the PCL field names that differ. */
+  const char* ply_field_aliases[][2] = {
+    { "normal_x", "nx" }, { "normal_y", "ny" }, { "normal_z", "nz" },
+    { "intensity", "scalar_intensity" }
+  };
+
+  /** \brief PLY property names of the color channels, in rgba byte order. */
+  const char* ply_color_names[][2] = {
+    { "blue", "diffuse_blue" }, { "green", "diffuse_green" },
+    { "red", "diffuse_red" }, { "alpha", "diffuse_alpha" }
+  };
+
+  int
+  findField (const std::vector<sensor_msgs::PointField> &fields, const std::string &name)
+  {
+    for (size_t d = 0; d < fields.size (); ++d)
+      if (fields[d].name == name)
+        return (static_cast<int> (d));
+    return (-1);
+  }
+
+  inline double
+  readValue (const unsigned char *src, int type)
+  {
+    switch (type)
+    {
+      case sensor_msgs::PointField::INT8:    { char value;           memcpy (&value, src, sizeof (value)); return (value); }
+      case sensor_msgs::PointField::UINT8:   { unsigned char value;  memcpy (&value, src, sizeof (value)); return (value); }
+      case sensor_msgs::PointField::INT16:   { short value;          memcpy (&value, src, sizeof (value)); return (value); }
+      case sensor_msgs::PointField::UINT16:  { unsigned short value; memcpy (&value, src, sizeof (value)); return (value); }
+      case sensor_msgs::PointField::INT32:   { int value;            memcpy (&value, src, sizeof (value)); return (value); }
+      case sensor_msgs::PointField::UINT32:  { unsigned int value;   memcpy (&value, src, sizeof (value)); return (value); }
+      case sensor_msgs::PointField::FLOAT32: { float value;          memcpy (&value, src, sizeof (value)); return (value); }
+      case sensor_msgs::PointField::FLOAT64: { double value;         memcpy (&value, src, sizeof (value)); return (value); }
+    }
+    return (0);
+  }
+
+  inline void
+  writeValue (unsigned char *dst, int type, double value)
+  {
+    switch (type)
+    {
+      case sensor_msgs::PointField::INT8:    { char v           = static_cast<char> (value);           memcpy (dst, &v, sizeof (v)); break; }
+      case sensor_msgs::PointField::UINT8:   { unsigned char v  = static_cast<unsigned char> (value);  memcpy (dst, &v, sizeof (v)); break; }
+      case sensor_msgs::PointField::INT16:   { short v          = static_cast<short> (value);          memcpy (dst, &v, sizeof (v)); break; }
+      case sensor_msgs::PointField::UINT16:  { unsigned short v = static_cast<unsigned short> (value); memcpy (dst, &v, sizeof (v)); break; }
+      case sensor_msgs::PointField::INT32:   { int v            = static_cast<int> (value);            memcpy (dst, &v, sizeof (v)); break; }
+      case sensor_msgs::PointField::UINT32:  { unsigned int v   = static_cast<unsigned int> (value);   memcpy (dst, &v, sizeof (v)); break; }
+      case sensor_msgs::PointField::FLOAT32: { float v          = static_cast<float> (value);          memcpy (dst, &v, sizeof (v)); break; }
+      case sensor_msgs::PointField::FLOAT64: { memcpy (dst, &value, sizeof (value)); break; }
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
 int
 pcl::PLYReader::read (const std::string &file_name, sensor_msgs::PointCloud2 &cloud,
                       Eigen::Vector4f &origin, Eigen::Quaternionf &orientation, int &ply_version)
@@ -265,143 +448,73 @@ pcl::PLYReader::read (const std::string &file_name, sensor_msgs::PointCloud2 &cl
   if (res < 0)
     return (res);
   
-  int line_count = 0;
   assert(parser_["vertex"] != NULL);
-  // Get the number of points the cloud should have
-  int nr_points = cloud.width * cloud.height;
+  cloud.data.resize (cloud.row_step * cloud.height);
 
   // if ascii
   if (!binary_data)
   {
-    // Re-open the file (readHeader closes it)
+    // Re-open the file (readHeader closes it) and load the whole data section,
+    // the records are then tokenized in place
     std::ifstream fs;
-    fs.open (file_name.c_str ());
+    fs.open (file_name.c_str (), std::ios::binary);
     if (!fs.is_open () || fs.fail ())
     {
       PCL_ERROR ("[pcl::PLYReader::read] Could not open file %s.", file_name.c_str ());
       return (-1);
     }
-    
+    fs.seekg (0, std::ios_base::end);
+    std::streamoff data_size = static_cast<std::streamoff> (fs.tellg ()) - data_idx;
     fs.seekg (data_idx, std::ios_base::beg);
-    std::string line;
-    std::vector<std::string> st;
-    std::map<std::string, void*> associated_data;
-    associated_data["vertex"] = &cloud.data[0];
+
+    // Terminate the buffer so the last record always ends with a '\0'
+    std::vector<char> buffer (static_cast<size_t> (std::max<std::streamoff> (data_size, 0)) + 1, '\0');
+    fs.read (&buffer[0], buffer.size () - 1);
+    fs.close ();
+
+    const char *pos = &buffer[0];
+    const char *end = pos + buffer.size () - 1;
+    std::vector<const char*> records;
     pcl::io::ply::camera sensor;
-    associated_data["camera"] = &sensor;
-    // Read the rest of the file
-    try
+
+    for(pcl::io::ply::parser::iterator elements_it = parser_.begin();
+        elements_it != parser_.end();
+        ++elements_it)
     {
-      while (!fs.eof ())
+      const pcl::io::ply::element &element = **elements_it;
+      pos = findRecords (pos, end, records, element.count_);
+      if (records.size () != element.count_)
       {
-        for(pcl::io::ply::parser::iterator elements_it = parser_.begin();
-            elements_it != parser_.end();
-            ++elements_it)
-        {
-          for(size_t counter = 0 ; counter < (*elements_it)->count_; counter++)
-          {
-            getline (fs, line);
-            // Ignore empty lines
-            if (line == "")
-              continue;
-              
-            // Tokenize the line
-            boost::trim (line);
-            boost::split (st, line, boost::is_any_of (std::string ("\t\r ")), boost::token_compress_on);
-        
-            size_t prop_counter = 0;
-            size_t offset_before = 0;
-            for(pcl::io::ply::element::iterator properties_it = (*elements_it)->properties_.begin();
-                properties_it != (*elements_it)->properties_.end();
-                ++properties_it, prop_counter++)
-            {
-              if((*elements_it)->is_list_property(properties_it))
-              {
-                size_t list_length = atoi ((st.at(0)).c_str ());
-                pcl::io::ply::list_property* lp = (pcl::io::ply::list_property*) (*properties_it);
-                lp->set_size((st.at(0)).c_str ());
-                for(size_t i = 0; i < list_length; i++)
-                {
-                  switch (lp->data_type_)
-                  {
-                  case sensor_msgs::PointField::INT8:
-                    copyStringValue<pcl::traits::asType<sensor_msgs::PointField::INT8>::type> (st.at(prop_counter+i), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before + i * pcl::getFieldSize(lp->data_type_));
-                    break;
-                  case sensor_msgs::PointField::UINT8:
-                    copyStringValue<pcl::traits::asType<sensor_msgs::PointField::UINT8>::type> (st.at(prop_counter+i), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before + i * pcl::getFieldSize(lp->data_type_));
-                    break;
-                  case sensor_msgs::PointField::INT16:
-                    copyStringValue<pcl::traits::asType<sensor_msgs::PointField::INT16>::type> (st.at(prop_counter+i), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before + i * pcl::getFieldSize(lp->data_type_));
-                    break;
-                  case sensor_msgs::PointField::UINT16:
-                    copyStringValue<pcl::traits::asType<sensor_msgs::PointField::UINT16>::type> (st.at(prop_counter+i), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before + i * pcl::getFieldSize(lp->data_type_));
-                    break;
-                  case sensor_msgs::PointField::INT32:
-                    copyStringValue<pcl::traits::asType<sensor_msgs::PointField::INT32>::type> (st.at(prop_counter+i), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before + i * pcl::getFieldSize(lp->data_type_));
-                    break;
-                  case sensor_msgs::PointField::UINT32:
-                    copyStringValue<pcl::traits::asType<sensor_msgs::PointField::UINT32>::type> (st.at(prop_counter+i), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before + i * pcl::getFieldSize(lp->data_type_));
-                    break;
-                  case sensor_msgs::PointField::FLOAT32:
-                    copyStringValue<pcl::traits::asType<sensor_msgs::PointField::FLOAT32>::type> (st.at(prop_counter+i), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before + i * pcl::getFieldSize(lp->data_type_));
-                    break;
-                  case sensor_msgs::PointField::FLOAT64:
-                    copyStringValue<pcl::traits::asType<sensor_msgs::PointField::FLOAT64>::type> (st.at(prop_counter+i), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before + i * pcl::getFieldSize(lp->data_type_));
-                    break;
-                  default:
-                    PCL_WARN ("[pcl::PCDReader::read] Incorrect data type specified for list element (%d)!\n",lp->data_type_);
-                    break;
-                  }
-                }
-              }
-              else
-              {
-                switch ((*properties_it)->data_type_)
-                {
-                case sensor_msgs::PointField::INT8:
-                  copyStringValue<pcl::traits::asType<sensor_msgs::PointField::INT8>::type> (st.at(prop_counter), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before);
-                  break;
-                case sensor_msgs::PointField::UINT8:
-                  copyStringValue<pcl::traits::asType<sensor_msgs::PointField::UINT8>::type> (st.at(prop_counter), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before);
-                  break;
-                case sensor_msgs::PointField::INT16:
-                  copyStringValue<pcl::traits::asType<sensor_msgs::PointField::INT16>::type> (st.at(prop_counter), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before);
-                  break;
-                case sensor_msgs::PointField::UINT16:
-                  copyStringValue<pcl::traits::asType<sensor_msgs::PointField::UINT16>::type> (st.at(prop_counter), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before);
-                  break;
-                case sensor_msgs::PointField::INT32:
-                  copyStringValue<pcl::traits::asType<sensor_msgs::PointField::INT32>::type> (st.at(prop_counter), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before);
-                  break;
-                case sensor_msgs::PointField::UINT32:
-                  copyStringValue<pcl::traits::asType<sensor_msgs::PointField::UINT32>::type> (st.at(prop_counter), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before);
-                  break;
-                case sensor_msgs::PointField::FLOAT32:
-                  copyStringValue<pcl::traits::asType<sensor_msgs::PointField::FLOAT32>::type> (st.at(prop_counter), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before);
-                  break;
-                case sensor_msgs::PointField::FLOAT64:
-                  copyStringValue<pcl::traits::asType<sensor_msgs::PointField::FLOAT64>::type> (st.at(prop_counter), associated_data[(*elements_it)->name_], counter * (*elements_it)->offset_ + offset_before);
-                  break;
-                default:
-                  PCL_WARN ("[pcl::PCDReader::read] Incorrect data type specified (%d)!\n",(*properties_it)->data_type_);
-                  break;
-                }
-              }
-              offset_before+= (*properties_it)->offset_;
-            }
-          }
-        }
-        line_count++;
+        PCL_ERROR ("[pcl::PLYReader::read] Number of %s records read (%d) is different than expected (%d)\n",
+                   element.name_.c_str (), (int)records.size (), (int)element.count_);
+        return (-1);
+      }
+
+      unsigned char *data = NULL;
+      if ("vertex" == element.name_)
+        data = &cloud.data[0];
+      else if ("camera" == element.name_)
+        data = reinterpret_cast<unsigned char*> (&sensor);
+      // Other elements (faces, edges, ...) are skipped
+      if (!data)
+        continue;
+
+      // The records are independent from each other, parse them in chunks
+      const int nr_records = static_cast<int> (records.size ());
+      const size_t record_size = element.offset_;
+      int nr_invalid = 0;
+#pragma omp parallel for schedule (static, 4096) reduction (+:nr_invalid)
+      for (int i = 0; i < nr_records; ++i)
+        if (!parseRecord (records[i], element, data + i * record_size))
+          ++nr_invalid;
+
+      if (nr_invalid > 0)
+      {
+        PCL_ERROR ("[pcl::PLYReader::read] %d %s records have missing values\n", nr_invalid, element.name_.c_str ());
+        return (-1);
       }
-    }
-    catch (const char *exception)
-    {
-      PCL_ERROR ("[pcl::PLYReader::read] %s", exception);
-      return (-1);
     }
 
-  // Close file
-    fs.close ();
     if(parser_["camera"])
     {
       sensor.ext_to_eigen(origin, orientation);
@@ -413,39 +526,203 @@ pcl::PLYReader::read (const std::string &file_name, sensor_msgs::PointCloud2 &cl
   {
     // Set the is_dense mode to false -- otherwise we would have to iterate over all points and check them 1 by 1
     cloud.is_dense = false;
+    int vertex_idx = binaryElementOffset ("vertex");
+    if (vertex_idx < 0)
+    {
+      PCL_ERROR ("[pcl::PLYReader::read] Could not locate the vertex data in %s.\n", file_name.c_str ());
+      return (-1);
+    }
+    int camera_idx = binaryElementOffset ("camera");
+
     // Open for reading
     boost::iostreams::mapped_file_source mapped_file_;
-    mapped_file_.open (file_name, cloud.data.size () + data_idx + sizeof(pcl::io::ply::camera), 0);
+    mapped_file_.open (file_name);
     if (!mapped_file_.is_open())
       return (-1);
+    if (mapped_file_.size () < data_idx + vertex_idx + cloud.data.size ())
+    {
+      PCL_ERROR ("[pcl::PLYReader::read] File %s is truncated.\n", file_name.c_str ());
+      mapped_file_.close ();
+      return (-1);
+    }
     
     const char *map = mapped_file_.data();
 
     // Copy the data
-    memcpy (&cloud.data[0], &map[0] + data_idx, cloud.data.size ());
+    memcpy (&cloud.data[0], &map[0] + data_idx + vertex_idx, cloud.data.size ());
 
     // Copy the sensor data if available
-    if(parser_["camera"] != NULL)
+    if(camera_idx >= 0 && mapped_file_.size () >= data_idx + camera_idx + sizeof(pcl::io::ply::camera))
     {
       pcl::io::ply::camera sensor;
-      memcpy (&sensor, &map[0] + data_idx + cloud.data.size (), sizeof(pcl::io::ply::camera));
+      memcpy (&sensor, &map[0] + data_idx + camera_idx, sizeof(pcl::io::ply::camera));
       sensor.ext_to_eigen(origin, orientation);
     }
     // Unmap the pages of memory
     mapped_file_.close();
   }
 
-  // if ( (line_count != nr_points) && (!binary_data) )
-  // {
-  //   PCL_ERROR ("[pcl::PLYReader::read] Number of points read (%d) is different than expected (%d)", line_count, nr_points);
-  //   return (-1);
-  // }
-  
   return 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
 
+int
+pcl::PLYReader::binaryElementOffset (const std::string &element_name)
+{
+  size_t offset = 0;
+  for(pcl::io::ply::parser::iterator elements_it = parser_.begin();
+      elements_it != parser_.end();
+      ++elements_it)
+  {
+    if ((*elements_it)->name_ == element_name)
+      return (static_cast<int> (offset));
+    // The size of list elements can't be known without walking them
+    if ((*elements_it)->has_list_properties ())
+      return (-1);
+    offset += (*elements_it)->offset_ * (*elements_it)->count_;
+  }
+  return (-1);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+int
+pcl::PLYReader::readBinaryVertices (const std::string &file_name, int data_idx,
+                                    const sensor_msgs::PointCloud2 &header,
+                                    const std::vector<sensor_msgs::PointField> &fields, size_t point_size,
+                                    unsigned char *points,
+                                    Eigen::Vector4f &origin, Eigen::Quaternionf &orientation)
+{
+  int vertex_idx = binaryElementOffset ("vertex");
+  if (vertex_idx < 0)
+  {
+    PCL_ERROR ("[pcl::PLYReader::readBinaryVertices] Could not locate the vertex data in %s.\n", file_name.c_str ());
+    return (-1);
+  }
+  int camera_idx = binaryElementOffset ("camera");
+
+  boost::iostreams::mapped_file_source mapped_file;
+  mapped_file.open (file_name);
+  if (!mapped_file.is_open ())
+    return (-1);
+
+  const size_t nr_points = header.width * header.height;
+  if (mapped_file.size () < data_idx + vertex_idx + nr_points * header.point_step)
+  {
+    PCL_ERROR ("[pcl::PLYReader::readBinaryVertices] File %s is truncated.\n", file_name.c_str ());
+    mapped_file.close ();
+    return (-1);
+  }
+
+  const unsigned char *map = reinterpret_cast<const unsigned char*> (mapped_file.data ());
+  copyVertexFields (map + data_idx + vertex_idx, nr_points, header.point_step, header.fields,
+                    fields, point_size, points);
+
+  if (camera_idx >= 0 && mapped_file.size () >= data_idx + camera_idx + sizeof (pcl::io::ply::camera))
+  {
+    pcl::io::ply::camera sensor;
+    memcpy (&sensor, map + data_idx + camera_idx, sizeof (pcl::io::ply::camera));
+    sensor.ext_to_eigen (origin, orientation);
+  }
+  mapped_file.close ();
+  return (0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void
+pcl::PLYReader::copyVertexFields (const unsigned char *src, size_t nr_points, size_t src_step,
+                                  const std::vector<sensor_msgs::PointField> &src_fields,
+                                  const std::vector<sensor_msgs::PointField> &dst_fields, size_t dst_step,
+                                  unsigned char *dst)
+{
+  // Resolve the field names once, the per point loop only runs the copy plan
+  std::vector<FieldCopy> copies;
+  for (size_t d = 0; d < dst_fields.size (); ++d)
+  {
+    const sensor_msgs::PointField &dst_field = dst_fields[d];
+
+    // Colors are stored per channel in PLY but packed in rgb/rgba
+    if (dst_field.name == "rgb" || dst_field.name == "rgba")
+    {
+      const int nr_channels = (dst_field.name == "rgba") ? 4 : 3;
+      for (int c = 0; c < nr_channels; ++c)
+      {
+        int s = findField (src_fields, ply_color_names[c][0]);
+        if (s < 0)
+          s = findField (src_fields, ply_color_names[c][1]);
+        if (s < 0)
+          continue;
+        FieldCopy copy;
+        copy.src_offset = src_fields[s].offset;
+        copy.dst_offset = dst_field.offset + c;
+        copy.size = 1;
+        copy.src_type = src_fields[s].datatype;
+        copy.dst_type = sensor_msgs::PointField::UINT8;
+        copies.push_back (copy);
+      }
+      continue;
+    }
+
+    int s = findField (src_fields, dst_field.name);
+    for (size_t a = 0; s < 0 && a < sizeof (ply_field_aliases) / sizeof (ply_field_aliases[0]); ++a)
+      if (dst_field.name == ply_field_aliases[a][0])
+        s = findField (src_fields, ply_field_aliases[a][1]);
+    if (s < 0)
+      continue;
+
+    const sensor_msgs::PointField &src_field = src_fields[s];
+    const size_t count = std::max<size_t> (dst_field.count, 1);
+    if (count != std::max<size_t> (src_field.count, 1) || (count > 1 && src_field.datatype != dst_field.datatype))
+      continue;
+
+    FieldCopy copy;
+    copy.src_offset = src_field.offset;
+    copy.dst_offset = dst_field.offset;
+    copy.size = pcl::getFieldSize (dst_field.datatype) * count;
+    copy.src_type = src_field.datatype;
+    copy.dst_type = dst_field.datatype;
+    copies.push_back (copy);
+  }
+  if (copies.empty ())
+    return;
+
+  // Merge the fields that are contiguous on both sides (e.g. x y z) into a single copy
+  std::sort (copies.begin (), copies.end ());
+  std::vector<FieldCopy> plan (1, copies[0]);
+  for (size_t c = 1; c < copies.size (); ++c)
+  {
+    FieldCopy &last = plan.back ();
+    const FieldCopy &copy = copies[c];
+    if (last.src_type == last.dst_type && copy.src_type == copy.dst_type &&
+        last.src_offset + last.size == copy.src_offset && last.dst_offset + last.size == copy.dst_offset)
+      last.size += copy.size;
+    else
+      plan.push_back (copy);
+  }
+
+  const FieldCopy *first = &plan[0];
+  const int nr_copies = static_cast<int> (plan.size ());
+  const int nr = static_cast<int> (nr_points);
+#pragma omp parallel for schedule (static, 4096)
+  for (int i = 0; i < nr; ++i)
+  {
+    const unsigned char *record = src + i * src_step;
+    unsigned char *point = dst + i * dst_step;
+    for (int c = 0; c < nr_copies; ++c)
+    {
+      const FieldCopy &copy = first[c];
+      if (copy.src_type == copy.dst_type)
+        memcpy (point + copy.dst_offset, record + copy.src_offset, copy.size);
+      else
+        writeValue (point + copy.dst_offset, copy.dst_type, readValue (record + copy.src_offset, copy.src_type));
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
 void pcl::PLYWriter::setMaskFromFieldsList(const std::string& fields_list)
 {
   // Find coordinates mandatory
@@ -0,0 +1,470 @@
+#pragma once
+
+#include <deque>
+#include <streambuf>
+
+#include <pcl/compression/octree_pointcloud_compression.h>
+#include <boost/thread.hpp>
+
+namespace ofxPCL
+{
+
+//
+// bounded blocking queue between pipeline stages
+//
+// push() blocks while the queue is full and pop() while it's empty. after
+// close() pushes are dropped and pop() returns false once the queue drained.
+//
+template <typename T>
+class BlockingQueue
+{
+public:
+
+	BlockingQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+	bool push(const T &value)
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		while (!closed && queue.size() >= capacity) condition.wait(lock);
+		if (closed) return false;
+
+		queue.push_back(value);
+		condition.notify_all();
+		return true;
+	}
+
+	bool pop(T &value)
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		while (!closed && queue.empty()) condition.wait(lock);
+		if (queue.empty()) return false;
+
+		value = queue.front();
+		queue.pop_front();
+		condition.notify_all();
+		return true;
+	}
+
+	void close()
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		closed = true;
+		condition.notify_all();
+	}
+
+protected:
+
+	size_t capacity;
+	bool closed;
+	deque<T> queue;
+	boost::mutex mutex;
+	boost::condition_variable condition;
+};
+
+//
+// in-memory byte ring buffer
+//
+// a fixed size FIFO usable as std::streambuf by one writer and one reader
+// thread, e.g. to connect a CompressionEncoder to a CompressionDecoder or to
+// feed a decoder from a socket:
+//
+//   RingBuffer ring;
+//   ostream out(&ring);
+//   istream in(&ring);
+//
+// writes block while the buffer is full, reads block while it's empty until
+// close() is called, after which the reader sees the end of the stream.
+//
+class RingBuffer : public std::streambuf
+{
+public:
+
+	RingBuffer(size_t capacity = 1 << 20) : buffer(capacity), head(0), size(0), closed(false) {}
+
+	// blocks until everything is written, returns less only if closed
+	size_t write(const char *data, size_t n)
+	{
+		size_t written = 0;
+
+		boost::mutex::scoped_lock lock(mutex);
+		while (written < n)
+		{
+			while (!closed && size == buffer.size()) condition.wait(lock);
+			if (closed) break;
+
+			const size_t tail = (head + size) % buffer.size();
+			const size_t chunk = std::min(n - written, std::min(buffer.size() - size, buffer.size() - tail));
+			memcpy(&buffer[tail], data + written, chunk);
+			size += chunk;
+			written += chunk;
+			condition.notify_all();
+		}
+		return written;
+	}
+
+	// blocks until some data is available, returns 0 at the end of the stream
+	size_t read(char *data, size_t n)
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		while (!closed && size == 0) condition.wait(lock);
+
+		size_t count = 0;
+		while (count < n && size > 0)
+		{
+			const size_t chunk = std::min(n - count, std::min(size, buffer.size() - head));
+			memcpy(data + count, &buffer[head], chunk);
+			head = (head + chunk) % buffer.size();
+			size -= chunk;
+			count += chunk;
+		}
+		condition.notify_all();
+		return count;
+	}
+
+	void close()
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		closed = true;
+		condition.notify_all();
+	}
+
+	bool isClosed()
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		return closed;
+	}
+
+	size_t getSize()
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		return size;
+	}
+
+protected:
+
+	vector<char> buffer;
+	size_t head, size;
+	bool closed;
+	boost::mutex mutex;
+	boost::condition_variable condition;
+
+	// reader side, only touched by the reading thread
+	char get_buffer[4096];
+
+	std::streamsize xsputn(const char *s, std::streamsize n)
+	{
+		return write(s, n);
+	}
+
+	int_type overflow(int_type c)
+	{
+		if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+
+		const char ch = traits_type::to_char_type(c);
+		return write(&ch, 1) == 1 ? c : traits_type::eof();
+	}
+
+	int_type underflow()
+	{
+		if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+		const size_t n = read(get_buffer, sizeof(get_buffer));
+		if (n == 0) return traits_type::eof();
+
+		setg(get_buffer, get_buffer, get_buffer + n);
+		return traits_type::to_int_type(*gptr());
+	}
+};
+
+//
+// pipelined octree compression
+//
+// PointCloudCompression split in two stages running on their own threads:
+// the octree stage (octree build, serialization, point detail and color
+// coding) and the entropy coding stage. while frame N is range coded, frame
+// N + 1 is already being serialized. the stream is the same as the one
+// written by PointCloudCompression::encodePointCloud, so either side can be
+// replaced by the plain single threaded class.
+//
+template <typename PointT>
+class CompressionEncoder
+{
+public:
+
+	typedef pcl::octree::PointCloudCompression<PointT> Codec;
+	typedef typename Codec::FrameData Frame;
+	typedef typename pcl::PointCloud<PointT>::ConstPtr CloudConstPtr;
+
+	CompressionEncoder(ostream &stream, pcl::octree::compression_Profiles_e profile = pcl::octree::MED_RES_ONLINE_COMPRESSION_WITH_COLOR, size_t queue_size = 2)
+		: stream(stream), codec(profile), clouds(queue_size), frames(queue_size), free_frames(queue_size + 2), pending(0)
+	{
+		// one frame in each stage plus the queued ones, recycled so steady state doesn't allocate
+		for (size_t i = 0; i < queue_size + 2; i++)
+		{
+			pool.push_back(new Frame);
+			free_frames.push(pool.back());
+		}
+
+		octree_thread = boost::thread(&CompressionEncoder::octreeStage, this);
+		entropy_thread = boost::thread(&CompressionEncoder::entropyStage, this);
+	}
+
+	~CompressionEncoder()
+	{
+		close();
+		for (size_t i = 0; i < pool.size(); i++) delete pool[i];
+	}
+
+	// RANGE_CODING (default, readable by any PointCloudCompression) or the
+	// faster RANS_CODING. decoders detect it, call before encoding.
+	void setEntropyCoding(pcl::octree::entropy_Coders_e coding)
+	{
+		codec.setEntropyCoding(coding);
+	}
+
+	// queues a cloud, blocks while the pipeline is full.
+	// the cloud must not be modified until it's encoded.
+	void encode(const CloudConstPtr &cloud)
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			pending++;
+		}
+
+		if (!clouds.push(cloud)) finished();
+	}
+
+	template <typename T>
+	void encode(const T &cloud)
+	{
+		encode(CloudConstPtr(cloud));
+	}
+
+	// waits until all the queued clouds are written to the stream
+	void flush()
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		while (pending > 0) condition.wait(lock);
+	}
+
+	// writes the remaining clouds and stops the threads
+	void close()
+	{
+		clouds.close();
+		if (octree_thread.joinable()) octree_thread.join();
+		if (entropy_thread.joinable()) entropy_thread.join();
+	}
+
+protected:
+
+	ostream &stream;
+	Codec codec;
+
+	BlockingQueue<CloudConstPtr> clouds;
+	BlockingQueue<Frame*> frames;
+	BlockingQueue<Frame*> free_frames;
+	vector<Frame*> pool;
+
+	size_t pending;
+	boost::mutex mutex;
+	boost::condition_variable condition;
+
+	boost::thread octree_thread;
+	boost::thread entropy_thread;
+
+	void finished()
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		pending--;
+		condition.notify_all();
+	}
+
+	void octreeStage()
+	{
+		CloudConstPtr cloud;
+		Frame *frame;
+
+		while (clouds.pop(cloud) && free_frames.pop(frame))
+		{
+			codec.encodeFrame(cloud, *frame);
+			cloud.reset();
+
+			if (!frames.push(frame)) break;
+		}
+		frames.close();
+	}
+
+	void entropyStage()
+	{
+		Frame *frame;
+
+		while (frames.pop(frame))
+		{
+			codec.writeFrame(*frame, stream);
+			free_frames.push(frame);
+			finished();
+		}
+	}
+};
+
+template <typename PointT>
+class CompressionDecoder
+{
+public:
+
+	typedef pcl::octree::PointCloudCompression<PointT> Codec;
+	typedef typename Codec::FrameData Frame;
+	typedef typename pcl::PointCloud<PointT>::Ptr CloudPtr;
+
+	CompressionDecoder(istream &stream, size_t queue_size = 2)
+		: stream(stream), codec(pcl::octree::MANUAL_CONFIGURATION), clouds(queue_size), frames(queue_size), free_frames(queue_size + 2)
+	{
+		for (size_t i = 0; i < queue_size + 2; i++)
+		{
+			pool.push_back(new Frame);
+			free_frames.push(pool.back());
+		}
+
+		entropy_thread = boost::thread(&CompressionDecoder::entropyStage, this);
+		octree_thread = boost::thread(&CompressionDecoder::octreeStage, this);
+	}
+
+	~CompressionDecoder()
+	{
+		close();
+		for (size_t i = 0; i < pool.size(); i++) delete pool[i];
+	}
+
+	// next cloud of the stream, blocks until it's decoded.
+	// returns false at the end of the stream.
+	template <typename T>
+	bool decode(T &cloud)
+	{
+		CloudPtr result;
+		if (!clouds.pop(result)) return false;
+
+		cloud = result;
+		return true;
+	}
+
+	// stops the threads. a thread blocked reading the stream returns only when
+	// the stream ends, e.g. when the RingBuffer feeding it is closed.
+	void close()
+	{
+		clouds.close();
+		frames.close();
+		free_frames.close();
+		if (entropy_thread.joinable()) entropy_thread.join();
+		if (octree_thread.joinable()) octree_thread.join();
+	}
+
+protected:
+
+	istream &stream;
+	Codec codec;
+
+	BlockingQueue<CloudPtr> clouds;
+	BlockingQueue<Frame*> frames;
+	BlockingQueue<Frame*> free_frames;
+	vector<Frame*> pool;
+
+	boost::thread entropy_thread;
+	boost::thread octree_thread;
+
+	void entropyStage()
+	{
+		Frame *frame;
+
+		while (free_frames.pop(frame))
+		{
+			if (!codec.readFrame(stream, *frame)) break;
+			if (!frames.push(frame)) break;
+		}
+		frames.close();
+	}
+
+	void octreeStage()
+	{
+		Frame *frame;
+
+		while (frames.pop(frame))
+		{
+			CloudPtr cloud(new typename CloudPtr::element_type);
+			codec.decodeFrame(*frame, cloud);
+			free_frames.push(frame);
+
+			if (!clouds.push(cloud)) break;
+		}
+		clouds.close();
+	}
+};
+
+//
+// compression benchmark
+//
+// encodes and decodes the frames (e.g. a recording read with SequenceReader)
+// with each entropy coder and logs the time spent in the octree and the
+// entropy coding stages and the compressed size.
+//
+template <typename T>
+void benchmarkCompression(const vector<T> &frames, pcl::octree::compression_Profiles_e profile = pcl::octree::MED_RES_ONLINE_COMPRESSION_WITH_COLOR)
+{
+	typedef typename T::value_type::PointType PointT;
+	typedef pcl::octree::PointCloudCompression<PointT> Codec;
+	typedef typename Codec::FrameData Frame;
+	typedef boost::posix_time::microsec_clock Clock;
+
+	const pcl::octree::entropy_Coders_e codings[] = { pcl::octree::RANGE_CODING, pcl::octree::RANS_CODING };
+	const char *names[] = { "range coder", "rANS coder" };
+
+	for (int c = 0; c < 2; c++)
+	{
+		Codec encoder(profile), decoder(profile);
+		encoder.setEntropyCoding(codings[c]);
+
+		Frame frame;
+		stringstream stream;
+		size_t num_points = 0, num_decoded = 0;
+		double octree_encode = 0, entropy_encode = 0, entropy_decode = 0, octree_decode = 0;
+
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			typename pcl::PointCloud<PointT>::ConstPtr cloud = frames[i];
+
+			boost::posix_time::ptime t0 = Clock::local_time();
+			encoder.encodeFrame(cloud, frame);
+			boost::posix_time::ptime t1 = Clock::local_time();
+			encoder.writeFrame(frame, stream);
+			boost::posix_time::ptime t2 = Clock::local_time();
+
+			octree_encode += (t1 - t0).total_microseconds() / 1000.0;
+			entropy_encode += (t2 - t1).total_microseconds() / 1000.0;
+			num_points += cloud->points.size();
+		}
+
+		const size_t size = stream.str().size();
+
+		typename pcl::PointCloud<PointT>::Ptr cloud(new pcl::PointCloud<PointT>);
+		for (;;)
+		{
+			boost::posix_time::ptime t0 = Clock::local_time();
+			if (!decoder.readFrame(stream, frame)) break;
+			boost::posix_time::ptime t1 = Clock::local_time();
+			decoder.decodeFrame(frame, cloud);
+			boost::posix_time::ptime t2 = Clock::local_time();
+
+			entropy_decode += (t1 - t0).total_microseconds() / 1000.0;
+			octree_decode += (t2 - t1).total_microseconds() / 1000.0;
+			num_decoded += cloud->points.size();
+		}
+
+		ofLogNotice(string(names[c]) + ": " + ofToString((int)frames.size()) + " frames, "
+			+ ofToString((int)num_points) + " points, " + ofToString((int)size) + " bytes ("
+			+ ofToString(num_points ? size * 8.0 / num_points : 0.0, 2) + " bits/point)");
+		ofLogNotice("  encode: octree " + ofToString(octree_encode, 1) + " ms, entropy " + ofToString(entropy_encode, 1) + " ms");
+		ofLogNotice("  decode: entropy " + ofToString(entropy_decode, 1) + " ms, octree " + ofToString(octree_decode, 1) + " ms, "
+			+ ofToString((int)num_decoded) + " points");
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <fstream>
+
+namespace ofxPCL
+{
+
+//
+// streaming PLY writer
+//
+// writes binary little endian PLY files (the host is assumed to be little
+// endian) through a fixed size buffer, so big meshes never need a second
+// in-memory copy. the element counts are part of the header and must be
+// known when the file is opened.
+//
+class PlyWriter
+{
+public:
+
+	PlyWriter() : num_vertices(0), num_faces(0), written_vertices(0), written_faces(0), has_normals(false), has_colors(false) {}
+	~PlyWriter() { close(); }
+
+	bool open(string path, size_t num_vertices, size_t num_faces, bool has_normals = false, bool has_colors = false, size_t buffer_size = 1 << 20)
+	{
+		close();
+
+		path = ofToDataPath(path);
+		fs.open(path.c_str(), ios::out | ios::binary);
+		if (!fs.is_open())
+		{
+			ofLogError("Couldn't write file: " + path);
+			return false;
+		}
+
+		this->path = path;
+		this->num_vertices = num_vertices;
+		this->num_faces = num_faces;
+		this->has_normals = has_normals;
+		this->has_colors = has_colors;
+		written_vertices = 0;
+		written_faces = 0;
+
+		buffer.clear();
+		buffer.reserve(buffer_size);
+
+		fs << "ply\n";
+		fs << "format binary_little_endian 1.0\n";
+		fs << "comment ofxPCL generated\n";
+		fs << "element vertex " << num_vertices << "\n";
+		fs << "property float x\nproperty float y\nproperty float z\n";
+		if (has_normals) fs << "property float nx\nproperty float ny\nproperty float nz\n";
+		if (has_colors) fs << "property uchar red\nproperty uchar green\nproperty uchar blue\nproperty uchar alpha\n";
+		fs << "element face " << num_faces << "\n";
+		fs << "property list uchar int vertex_indices\n";
+		fs << "end_header\n";
+
+		return true;
+	}
+
+	bool isOpen() const { return fs.is_open(); }
+
+	void addVertex(const ofVec3f &v)
+	{
+		assert(!has_normals && !has_colors);
+		putVertex(v);
+	}
+
+	void addVertex(const ofVec3f &v, const ofVec3f &n)
+	{
+		assert(has_normals && !has_colors);
+		putVertex(v);
+		putNormal(n);
+	}
+
+	void addVertex(const ofVec3f &v, const ofFloatColor &c)
+	{
+		assert(!has_normals && has_colors);
+		putVertex(v);
+		putColor(c);
+	}
+
+	void addVertex(const ofVec3f &v, const ofVec3f &n, const ofFloatColor &c)
+	{
+		assert(has_normals && has_colors);
+		putVertex(v);
+		putNormal(n);
+		putColor(c);
+	}
+
+	void addTriangle(int a, int b, int c)
+	{
+		// faces have to follow all the vertices
+		assert(written_vertices == num_vertices);
+
+		const unsigned char n = 3;
+		const int indices[3] = { a, b, c };
+		put(&n, 1);
+		put(indices, sizeof(indices));
+		written_faces++;
+	}
+
+	// false if any write failed (e.g. the disk is full)
+	bool close()
+	{
+		if (!fs.is_open()) return true;
+
+		flush();
+		fs.flush();
+		bool ok = fs.good();
+		fs.close();
+		ok = ok && !fs.fail();
+
+		if (!ok)
+			ofLogError("Couldn't write file: " + path);
+
+		if (written_vertices != num_vertices || written_faces != num_faces)
+			ofLogError("PlyWriter: wrote " + ofToString((int)written_vertices) + "/" + ofToString((int)num_vertices) + " vertices and " + ofToString((int)written_faces) + "/" + ofToString((int)num_faces) + " faces");
+
+		return ok;
+	}
+
+protected:
+
+	ofstream fs;
+	string path;
+	vector<char> buffer;
+
+	size_t num_vertices, num_faces;
+	size_t written_vertices, written_faces;
+	bool has_normals, has_colors;
+
+	inline void put(const void *data, size_t size)
+	{
+		if (buffer.size() + size > buffer.capacity()) flush();
+
+		const char *p = (const char*)data;
+		buffer.insert(buffer.end(), p, p + size);
+	}
+
+	inline void putVertex(const ofVec3f &v)
+	{
+		const float xyz[3] = { v.x, v.y, v.z };
+		put(xyz, sizeof(xyz));
+		written_vertices++;
+	}
+
+	inline void putNormal(const ofVec3f &n)
+	{
+		const float xyz[3] = { n.x, n.y, n.z };
+		put(xyz, sizeof(xyz));
+	}
+
+	inline void putColor(const ofFloatColor &c)
+	{
+		const unsigned char rgba[4] = {
+			(unsigned char)(ofClamp(c.r, 0, 1) * 255),
+			(unsigned char)(ofClamp(c.g, 0, 1) * 255),
+			(unsigned char)(ofClamp(c.b, 0, 1) * 255),
+			(unsigned char)(ofClamp(c.a, 0, 1) * 255)
+		};
+		put(rgba, sizeof(rgba));
+	}
+
+	void flush()
+	{
+		if (buffer.empty()) return;
+
+		fs.write(&buffer[0], buffer.size());
+		buffer.clear();
+	}
+};
+
+//
+// save ofMesh (e.g. the result of triangulate) as binary PLY
+//
+inline bool savePLY(string path, const ofMesh &mesh)
+{
+	ofMesh &m = const_cast<ofMesh&>(mesh);
+
+	const vector<ofVec3f> &vertices = m.getVertices();
+	const vector<ofVec3f> &normals = m.getNormals();
+	const vector<ofFloatColor> &colors = m.getColors();
+	const vector<ofIndexType> &indices = m.getIndices();
+
+	const size_t num_vertices = vertices.size();
+	const bool has_normals = normals.size() == num_vertices && num_vertices > 0;
+	const bool has_colors = colors.size() == num_vertices && num_vertices > 0;
+
+	PlyWriter writer;
+	if (!writer.open(path, num_vertices, indices.size() / 3, has_normals, has_colors))
+		return false;
+
+	for (size_t i = 0; i < num_vertices; i++)
+	{
+		if (has_normals && has_colors) writer.addVertex(vertices[i], normals[i], colors[i]);
+		else if (has_normals) writer.addVertex(vertices[i], normals[i]);
+		else if (has_colors) writer.addVertex(vertices[i], colors[i]);
+		else writer.addVertex(vertices[i]);
+	}
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		writer.addTriangle(indices[i], indices[i + 1], indices[i + 2]);
+	}
+
+	return writer.close();
+}
+
+}
@@ -0,0 +1,381 @@
+#pragma once
+
+#include <fstream>
+
+#include <pcl/common/io.h>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace ofxPCL
+{
+
+//
+// point cloud sequence
+//
+// a recorded session stored in a single file:
+//
+//   header   | magic, version, point layout (fields), frame count, index offset
+//   frames   | raw points of each frame, 16 byte aligned
+//   index    | offset, timestamp, width and height of every frame
+//
+// the index is written last, so frames can be appended while recording.
+// all the values are stored in host byte order.
+//
+namespace sequence
+{
+
+const char MAGIC[8] = { 'O', 'F', 'X', 'P', 'C', 'L', 'S', 'Q' };
+const pcl::uint32_t VERSION = 1;
+const size_t ALIGNMENT = 16;
+
+struct Header
+{
+	char magic[8];
+	pcl::uint32_t version;
+	pcl::uint32_t point_step;
+	pcl::uint32_t num_fields;
+	pcl::uint32_t num_frames;
+	pcl::uint64_t index_offset;
+};
+
+struct Field
+{
+	char name[32];
+	pcl::uint32_t offset;
+	pcl::uint32_t datatype;
+	pcl::uint32_t count;
+};
+
+struct Frame
+{
+	pcl::uint64_t offset;
+	pcl::uint64_t timestamp;
+	pcl::uint32_t width;
+	pcl::uint32_t height;
+};
+
+template <typename PointT>
+inline vector<Field> getFields()
+{
+	vector<sensor_msgs::PointField> fields;
+	pcl::getFields(pcl::PointCloud<PointT>(), fields);
+
+	vector<Field> result(fields.size());
+	for (size_t i = 0; i < fields.size(); i++)
+	{
+		Field &f = result[i];
+		memset(&f, 0, sizeof(Field));
+		strncpy(f.name, fields[i].name.c_str(), sizeof(f.name) - 1);
+		f.offset = fields[i].offset;
+		f.datatype = fields[i].datatype;
+		f.count = fields[i].count;
+	}
+	return result;
+}
+
+}
+
+//
+// sequence writer
+//
+class SequenceWriter
+{
+public:
+
+	SequenceWriter() {}
+	~SequenceWriter() { close(); }
+
+	template <typename PointT>
+	bool open(string path)
+	{
+		close();
+
+		path = ofToDataPath(path);
+		fs.open(path.c_str(), ios::out | ios::binary | ios::trunc);
+		if (!fs.is_open())
+		{
+			ofLogError("Couldn't write file: " + path);
+			return false;
+		}
+
+		fields = sequence::getFields<PointT>();
+		frames.clear();
+
+		memcpy(header.magic, sequence::MAGIC, sizeof(header.magic));
+		header.version = sequence::VERSION;
+		header.point_step = sizeof(PointT);
+		header.num_fields = fields.size();
+		header.num_frames = 0;
+		header.index_offset = 0;
+
+		fs.write((const char*)&header, sizeof(header));
+		if (!fields.empty()) fs.write((const char*)&fields[0], sizeof(sequence::Field) * fields.size());
+		position = sizeof(header) + sizeof(sequence::Field) * fields.size();
+
+		return fs.good();
+	}
+
+	bool isOpen() const { return fs.is_open(); }
+
+	// timestamp in microseconds, uses the cloud header stamp by default
+	template <typename T>
+	void addFrame(const T &cloud)
+	{
+		addFrame(cloud, cloud->header.stamp);
+	}
+
+	template <typename T>
+	void addFrame(const T &cloud, pcl::uint64_t timestamp)
+	{
+		assert(fs.is_open());
+		assert(sizeof(typename T::value_type::PointType) == header.point_step);
+
+		pad();
+
+		sequence::Frame frame;
+		frame.offset = position;
+		frame.timestamp = timestamp;
+		frame.width = cloud->width;
+		frame.height = cloud->height;
+
+		// unorganized clouds built by hand don't always keep width in sync
+		if ((size_t)frame.width * frame.height != cloud->points.size())
+		{
+			frame.width = cloud->points.size();
+			frame.height = 1;
+		}
+
+		const size_t size = cloud->points.size() * header.point_step;
+		if (size > 0) fs.write((const char*)&cloud->points[0], size);
+		position += size;
+
+		frames.push_back(frame);
+	}
+
+	size_t getNumFrames() const { return frames.size(); }
+
+	void close()
+	{
+		if (!fs.is_open()) return;
+
+		pad();
+
+		header.num_frames = frames.size();
+		header.index_offset = position;
+		if (!frames.empty()) fs.write((const char*)&frames[0], sizeof(sequence::Frame) * frames.size());
+
+		// patch the header now that the index is known
+		fs.seekp(0);
+		fs.write((const char*)&header, sizeof(header));
+		fs.close();
+
+		frames.clear();
+	}
+
+protected:
+
+	ofstream fs;
+	sequence::Header header;
+	vector<sequence::Field> fields;
+	vector<sequence::Frame> frames;
+	pcl::uint64_t position;
+
+	void pad()
+	{
+		static const char zeros[sequence::ALIGNMENT] = { 0 };
+
+		const size_t n = (sequence::ALIGNMENT - position % sequence::ALIGNMENT) % sequence::ALIGNMENT;
+		fs.write(zeros, n);
+		position += n;
+	}
+};
+
+//
+// sequence reader
+//
+// the file is memory mapped, so seeking to any frame is O(1) and frames can
+// be accessed in place with getPoints() without copying.
+//
+class SequenceReader
+{
+public:
+
+	SequenceReader() : frames(NULL), position(0) {}
+	~SequenceReader() { close(); }
+
+	bool open(string path)
+	{
+		close();
+
+		path = ofToDataPath(path);
+		try
+		{
+			file.open(path);
+		}
+		catch (const std::exception &e)
+		{
+			ofLogError("Couldn't read file: " + path + " (" + e.what() + ")");
+			return false;
+		}
+		if (!file.is_open()) return false;
+
+		if (file.size() < sizeof(sequence::Header))
+		{
+			ofLogError("Not a sequence file: " + path);
+			close();
+			return false;
+		}
+
+		memcpy(&header, file.data(), sizeof(header));
+		if (memcmp(header.magic, sequence::MAGIC, sizeof(header.magic)) != 0 || header.version != sequence::VERSION)
+		{
+			ofLogError("Not a sequence file or unsupported version: " + path);
+			close();
+			return false;
+		}
+
+		const pcl::uint64_t fields_end = sizeof(header) + sizeof(sequence::Field) * (pcl::uint64_t)header.num_fields;
+		if (file.size() < fields_end || header.index_offset < fields_end || header.index_offset > file.size()
+			|| (file.size() - header.index_offset) / sizeof(sequence::Frame) < header.num_frames)
+		{
+			ofLogError("Truncated sequence file (recording not closed?): " + path);
+			close();
+			return false;
+		}
+
+		// the points of every frame lie between the fields and the index
+		const sequence::Frame *index = (const sequence::Frame*)(file.data() + header.index_offset);
+		for (pcl::uint32_t i = 0; i < header.num_frames; i++)
+		{
+			const sequence::Frame &frame = index[i];
+			if (header.point_step == 0 || frame.offset < fields_end || frame.offset > header.index_offset
+				|| (pcl::uint64_t)frame.width * frame.height > (header.index_offset - frame.offset) / header.point_step)
+			{
+				ofLogError("Corrupt sequence file (frame " + ofToString((int)i) + " out of bounds): " + path);
+				close();
+				return false;
+			}
+		}
+
+		const sequence::Field *f = (const sequence::Field*)(file.data() + sizeof(header));
+		fields.assign(f, f + header.num_fields);
+		frames = index;
+		position = 0;
+
+		return true;
+	}
+
+	bool isOpen() const { return file.is_open(); }
+
+	void close()
+	{
+		if (file.is_open()) file.close();
+		fields.clear();
+		frames = NULL;
+		position = 0;
+	}
+
+	size_t getNumFrames() const { return frames ? header.num_frames : 0; }
+
+	pcl::uint64_t getTimestamp(size_t frame) const { return frames[frame].timestamp; }
+	size_t getNumPoints(size_t frame) const { return (size_t)frames[frame].width * frames[frame].height; }
+
+	// true if the file was recorded with the given point type
+	template <typename PointT>
+	bool isPointType() const
+	{
+		if (sizeof(PointT) != header.point_step) return false;
+
+		vector<sequence::Field> f = sequence::getFields<PointT>();
+		if (f.size() != fields.size()) return false;
+
+		for (size_t i = 0; i < f.size(); i++)
+		{
+			if (strcmp(f[i].name, fields[i].name) != 0
+				|| f[i].offset != fields[i].offset
+				|| f[i].datatype != fields[i].datatype)
+				return false;
+		}
+		return true;
+	}
+
+	// points of a frame, in place in the mapped file
+	template <typename PointT>
+	const PointT* getPoints(size_t frame) const
+	{
+		assert(frame < getNumFrames());
+		assert(isPointType<PointT>());
+		return (const PointT*)(file.data() + frames[frame].offset);
+	}
+
+	template <typename T>
+	bool read(size_t frame, T &cloud) const
+	{
+		typedef typename T::value_type::PointType PointT;
+
+		if (frame >= getNumFrames()) return false;
+		if (!isPointType<PointT>())
+		{
+			ofLogError("Sequence point type mismatch");
+			return false;
+		}
+
+		if (!cloud) cloud = T(new typename T::value_type);
+
+		const sequence::Frame &f = frames[frame];
+		const PointT *points = getPoints<PointT>(frame);
+		cloud->points.assign(points, points + getNumPoints(frame));
+		cloud->width = f.width;
+		cloud->height = f.height;
+		cloud->header.stamp = f.timestamp;
+		cloud->is_dense = false;
+
+		return true;
+	}
+
+	//
+	// playback
+	//
+	void seek(size_t frame) { position = frame; }
+	size_t getPosition() const { return position; }
+
+	// the frame with the latest timestamp <= the given one
+	size_t findFrame(pcl::uint64_t timestamp) const
+	{
+		size_t lo = 0, hi = getNumFrames();
+		while (lo < hi)
+		{
+			size_t mid = lo + (hi - lo) / 2;
+			if (frames[mid].timestamp <= timestamp) lo = mid + 1;
+			else hi = mid;
+		}
+		return lo > 0 ? lo - 1 : 0;
+	}
+
+	// reads the current frame and moves forward
+	template <typename T>
+	bool next(T &cloud)
+	{
+		if (!read(position, cloud)) return false;
+		position++;
+		return true;
+	}
+
+	// moves backward and reads that frame, for reverse playback
+	template <typename T>
+	bool previous(T &cloud)
+	{
+		if (position == 0 || !read(position - 1, cloud)) return false;
+		position--;
+		return true;
+	}
+
+protected:
+
+	boost::iostreams::mapped_file_source file;
+	sequence::Header header;
+	vector<sequence::Field> fields;
+	const sequence::Frame *frames;
+	size_t position;
+};
+
+}
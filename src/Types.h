@@ -21,4 +21,10 @@ typedef pcl::PointCloud<PointNormalType>::Ptr PointNormalPointCloud;
 typedef pcl::PointXYZRGBNormal ColorNormalPointType;
 typedef pcl::PointCloud<ColorNormalPointType>::Ptr ColorNormalPointCloud;
 
+typedef pcl::FPFHSignature33 FPFHType;
+typedef pcl::PointCloud<FPFHType>::Ptr FPFHPointCloud;
+
+typedef pcl::VFHSignature308 VFHType;
+typedef pcl::PointCloud<VFHType>::Ptr VFHPointCloud;
+
 }
\ No newline at end of file
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <list>
+#include <boost/unordered_map.hpp>
+
+#include <pcl/common/io.h>
+
+namespace ofxPCL
+{
+
+//
+// persistent voxel map
+//
+// fuses many frames into one voxel grid, e.g. a static scene seen from a
+// moving sensor. every voxel keeps the running centroid, color and hit count
+// of all the points that fell into it, so the history never has to be
+// voxelized again.
+//
+// memory is bounded by evicting the least recently seen voxels (setMaxVoxels)
+// and the voxels that weren't seen for a number of frames (setMaxAge).
+//
+// getPointCloud() keeps one point per voxel in a cloud owned by the map and
+// only rewrites the voxels changed since the previous call. evicted voxels are
+// replaced by the last point, so the point order isn't stable. only xyz and
+// rgb/rgba are written, the other fields are left default constructed.
+//
+template <typename PointT>
+class VoxelMap
+{
+public:
+
+	typedef pcl::PointCloud<PointT> CloudType;
+	typedef typename CloudType::Ptr CloudPtr;
+
+	// max_voxels 0 is unbounded
+	VoxelMap(ofVec3f resolution = ofVec3f(1, 1, 1), size_t max_voxels = 0)
+		: cloud(new CloudType), max_voxels(max_voxels), max_age(0), min_hits(1), frame(0)
+	{
+		std::vector<sensor_msgs::PointField> fields;
+		rgb_offset = pcl::getFieldIndex(CloudType(), "rgb", fields);
+		if (rgb_offset == -1) rgb_offset = pcl::getFieldIndex(CloudType(), "rgba", fields);
+		if (rgb_offset >= 0) rgb_offset = fields[rgb_offset].offset;
+
+		setResolution(resolution);
+	}
+
+	// clears the map
+	void setResolution(ofVec3f resolution)
+	{
+		clear();
+		this->resolution = resolution;
+		inv_resolution = ofVec3f(1.0f / resolution.x, 1.0f / resolution.y, 1.0f / resolution.z);
+	}
+
+	ofVec3f getResolution() const { return resolution; }
+
+	// 0 is unbounded
+	void setMaxVoxels(size_t n)
+	{
+		max_voxels = n;
+		evict();
+	}
+
+	size_t getMaxVoxels() const { return max_voxels; }
+
+	// number of frames a voxel is kept without being seen, 0 keeps it forever
+	void setMaxAge(unsigned int frames)
+	{
+		max_age = frames;
+		evict();
+	}
+
+	unsigned int getMaxAge() const { return max_age; }
+
+	// voxels hit fewer times aren't exported, to keep out sensor noise
+	void setMinHits(unsigned int hits)
+	{
+		if (hits == 0) hits = 1;
+		if (hits == min_hits) return;
+		min_hits = hits;
+
+		// export everything again with the new threshold
+		cloud->points.clear();
+		slot_keys.clear();
+		dirty.clear();
+		for (typename VoxelTable::iterator it = voxels.begin(); it != voxels.end(); ++it)
+		{
+			it->second.slot = -1;
+			it->second.dirty = true;
+			dirty.push_back(it->first);
+		}
+	}
+
+	unsigned int getMinHits() const { return min_hits; }
+
+	void clear()
+	{
+		voxels.clear();
+		lru.clear();
+		dirty.clear();
+		slot_keys.clear();
+		cloud->points.clear();
+		cloud->width = 0;
+		cloud->height = 1;
+		frame = 0;
+	}
+
+	size_t size() const { return voxels.size(); }
+	bool empty() const { return voxels.empty(); }
+
+	// number of frames added since the last clear
+	unsigned int getFrame() const { return frame; }
+
+	template <typename T>
+	void add(const T &cloud)
+	{
+		add(cloud, ofMatrix4x4());
+	}
+
+	// pose is applied to every point while binning, like transform()
+	template <typename T>
+	void add(const T &cloud, const ofMatrix4x4 &pose)
+	{
+		Eigen::Matrix4f mat;
+		memcpy(&mat, pose.getPtr(), sizeof(float) * 16);
+		const Eigen::Matrix3f rotation = mat.topLeftCorner<3, 3>();
+		const Eigen::Vector3f translation = mat.block<3, 1>(0, 3);
+
+		frame++;
+
+		// neighboring points mostly fall into the same voxel, skip the lookup
+		Key last_key = 0;
+		Voxel *last = NULL;
+
+		for (size_t i = 0; i < cloud->points.size(); i++)
+		{
+			const typename T::value_type::PointType &p = cloud->points[i];
+			if (!pcl_isfinite(p.x) || !pcl_isfinite(p.y) || !pcl_isfinite(p.z)) continue;
+
+			const Eigen::Vector3f q = rotation * Eigen::Vector3f(p.x, p.y, p.z) + translation;
+
+			Key key;
+			if (!getKey(q[0], q[1], q[2], key)) continue;
+
+			if (last == NULL || key != last_key)
+			{
+				last = &touch(key);
+				last_key = key;
+			}
+
+			Voxel &v = *last;
+			v.x += q[0];
+			v.y += q[1];
+			v.z += q[2];
+			v.hits++;
+
+			if (rgb_offset >= 0)
+			{
+				pcl::RGB rgb;
+				memcpy(&rgb, (const char*)&p + rgb_offset, sizeof(pcl::RGB));
+				v.r += rgb.r;
+				v.g += rgb.g;
+				v.b += rgb.b;
+			}
+		}
+
+		evict();
+	}
+
+	// times points fell into the voxel containing p, 0 if it isn't in the map
+	unsigned int getHits(ofVec3f p) const
+	{
+		Key key;
+		if (!getKey(p.x, p.y, p.z, key)) return 0;
+
+		typename VoxelTable::const_iterator it = voxels.find(key);
+		return it == voxels.end() ? 0 : it->second.hits;
+	}
+
+	// one point per voxel (hit at least min hits times). the cloud is owned
+	// by the map and updated by the next call, don't modify it.
+	CloudPtr getPointCloud()
+	{
+		for (size_t i = 0; i < dirty.size(); i++)
+		{
+			typename VoxelTable::iterator it = voxels.find(dirty[i]);
+			if (it == voxels.end()) continue; // evicted
+
+			Voxel &v = it->second;
+			v.dirty = false;
+			if (v.hits < min_hits) continue;
+
+			if (v.slot < 0)
+			{
+				v.slot = cloud->points.size();
+				cloud->points.push_back(PointT());
+				slot_keys.push_back(it->first);
+			}
+
+			PointT &p = cloud->points[v.slot];
+			p.x = v.x / v.hits;
+			p.y = v.y / v.hits;
+			p.z = v.z / v.hits;
+
+			if (rgb_offset >= 0)
+			{
+				int rgb = ((int)(v.r / v.hits)) << 16 | ((int)(v.g / v.hits)) << 8 | ((int)(v.b / v.hits));
+				memcpy((char*)&p + rgb_offset, &rgb, sizeof(float));
+			}
+		}
+		dirty.clear();
+
+		cloud->width = cloud->points.size();
+		cloud->height = 1;
+		cloud->is_dense = true;
+		return cloud;
+	}
+
+protected:
+
+	// voxel coordinates packed into 21 bits each
+	typedef pcl::uint64_t Key;
+	static const int KEY_BITS = 21;
+
+	struct Voxel
+	{
+		Voxel() : x(0), y(0), z(0), r(0), g(0), b(0), hits(0), frame(0), slot(-1), dirty(false) {}
+
+		double x, y, z;
+		double r, g, b;
+		unsigned int hits;
+		unsigned int frame;  // last frame the voxel was seen in
+		int slot;            // index in the exported cloud, -1 if not exported
+		bool dirty;
+		typename std::list<Key>::iterator lru;
+	};
+
+	typedef boost::unordered_map<Key, Voxel> VoxelTable;
+
+	VoxelTable voxels;
+	std::list<Key> lru;          // most recently seen first
+	std::vector<Key> dirty;      // changed since the last export
+	std::vector<Key> slot_keys;  // voxel of every exported point
+
+	CloudPtr cloud;
+
+	ofVec3f resolution, inv_resolution;
+	size_t max_voxels;
+	unsigned int max_age;
+	unsigned int min_hits;
+	unsigned int frame;
+	int rgb_offset;
+
+	inline bool getKey(float x, float y, float z, Key &key) const
+	{
+		const double range = 1 << (KEY_BITS - 1);
+		const double i = floor(x * inv_resolution.x);
+		const double j = floor(y * inv_resolution.y);
+		const double k = floor(z * inv_resolution.z);
+		if (fabs(i) >= range || fabs(j) >= range || fabs(k) >= range) return false;
+
+		key = (Key)(i + range) | (Key)(j + range) << KEY_BITS | (Key)(k + range) << (2 * KEY_BITS);
+		return true;
+	}
+
+	// the voxel, created if needed, marked as seen in the current frame
+	Voxel& touch(Key key)
+	{
+		Voxel &v = voxels[key];
+		if (v.frame == 0) // new voxel, frames start at 1
+		{
+			lru.push_front(key);
+			v.lru = lru.begin();
+		}
+		else if (v.frame != frame)
+		{
+			lru.splice(lru.begin(), lru, v.lru);
+		}
+		v.frame = frame;
+
+		if (!v.dirty)
+		{
+			v.dirty = true;
+			dirty.push_back(key);
+		}
+		return v;
+	}
+
+	void evict()
+	{
+		// the list is ordered by the last frame seen, so stale voxels are at the back
+		while (!lru.empty())
+		{
+			typename VoxelTable::iterator it = voxels.find(lru.back());
+			const bool full = max_voxels > 0 && voxels.size() > max_voxels;
+			const bool stale = max_age > 0 && frame - it->second.frame >= max_age;
+			if (!full && !stale) break;
+
+			remove(it);
+		}
+	}
+
+	void remove(typename VoxelTable::iterator it)
+	{
+		Voxel &v = it->second;
+		if (v.slot >= 0)
+		{
+			// move the last point into the hole
+			const size_t last = slot_keys.size() - 1;
+			if ((size_t)v.slot != last)
+			{
+				cloud->points[v.slot] = cloud->points[last];
+				slot_keys[v.slot] = slot_keys[last];
+				voxels.find(slot_keys[v.slot])->second.slot = v.slot;
+			}
+			cloud->points.pop_back();
+			slot_keys.pop_back();
+		}
+
+		lru.erase(v.lru);
+		voxels.erase(it);
+	}
+};
+
+}
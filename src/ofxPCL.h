@@ -5,15 +5,26 @@
 #include "Types.h"
 #include "Utility.h"
 #include "Tree.h"
+#include "Ply.h"
+#include "Sequence.h"
+#include "Compression.h"
+#include "VoxelMap.h"
 
 // file io
 #include <pcl/io/pcd_io.h>
+#include <pcl/io/ply_io.h>
 
 // transform
 #include <pcl/common/transforms.h>
 
 // thresold
 #include <pcl/filters/passthrough.h>
+#include <pcl/filters/field_predicate.h>
+
+// crop / project
+#include <pcl/filters/convex_region.h>
+#include <pcl/filters/project_inliers.h>
+#include <pcl/segmentation/extract_polygonal_prism_data.h>
 
 // outlier removal
 #include <pcl/filters/statistical_outlier_removal.h>
@@ -24,15 +35,18 @@
 
 // downsample
 #include <pcl/filters/voxel_grid.h>
+#include <pcl/filters/organized_downsample.h>
 
 // segmentation
 #include <pcl/ModelCoefficients.h>
 #include <pcl/segmentation/sac_segmentation.h>
 #include <pcl/sample_consensus/method_types.h>
 #include <pcl/filters/extract_indices.h>
+#include <pcl/segmentation/extract_clusters.h>
 
 // triangulate
 #include <pcl/features/normal_3d.h>
+#include <pcl/features/normal_3d_omp.h>
 #include <pcl/surface/gp3.h>
 #include <pcl/surface/grid_projection.h>
 #include <pcl/Vertices.h>
@@ -41,6 +55,11 @@
 #include <pcl/surface/mls.h>
 #include <pcl/io/pcd_io.h>
 
+// features
+#include <pcl/features/fpfh.h>
+#include <pcl/features/vfh.h>
+#include <pcl/features/cvfh.h>
+
 namespace ofxPCL
 {
 
@@ -68,6 +87,18 @@ inline void savePointCloud(string path, T cloud)
 	pcl::io::savePCDFileBinary(path.c_str(), *cloud);
 }
 
+template <typename T>
+inline T loadPLY(string path)
+{
+	T cloud(new typename T::value_type);
+	path = ofToDataPath(path);
+
+	if (pcl::io::loadPLYFile<typename T::value_type::PointType>(path, *cloud) < 0)
+		ofLogError("Couldn't read file: " + path);
+
+	return cloud;
+}
+
 //
 // transform
 //
@@ -81,21 +112,212 @@ void transform(T cloud, ofMatrix4x4 matrix)
 	pcl::transformPointCloud(*cloud, *cloud, mat);
 }
 
+//
+// index pipelines
+//
+// threshold, outlier removal and downsample also take a pcl::PointIndices::Ptr
+// after the cloud. these variants leave the cloud alone and only look at the
+// points in indices (all of them if it's null), the selection variants write
+// the passing points back to indices. the points are copied once, by the last
+// stage:
+//
+//	pcl::PointIndices::Ptr indices;
+//	threshold(cloud, indices, "z", 0, 2);
+//	statisticalOutlierRemoval(cloud, indices);
+//	downsample(cloud, indices, ofVec3f(0.01, 0.01, 0.01)); // or extract(cloud, indices)
+//
+template <typename Filter, typename T>
+inline void filterIndices(Filter &filter, T cloud, pcl::PointIndices::Ptr &indices)
+{
+	filter.setInputCloud(cloud);
+	if (indices)
+		filter.setIndices(pcl::IndicesPtr(indices, &indices->indices)); // shares, doesn't copy
+	else
+		indices.reset(new pcl::PointIndices);
+
+	std::vector<int> result;
+	filter.filter(result);
+	indices->indices.swap(result);
+}
+
+// replaces the cloud by the points in indices
+template <typename T>
+inline void extract(T cloud, const pcl::PointIndices::Ptr &indices)
+{
+	if (!indices) return;
+
+	typename T::value_type extracted;
+	pcl::copyPointCloud(*cloud, indices->indices, extracted);
+	cloud->points.swap(extracted.points);
+	cloud->width = extracted.width;
+	cloud->height = extracted.height;
+	cloud->is_dense = extracted.is_dense;
+}
+
 //
 // threshold
 //
+// the field is given as a tag, e.g. threshold<pcl::fields::z>(cloud, 0, 1),
+// and compiles down to a plain member load per point
+//
+// with keep_organized the removed points are set to NaN instead, so the
+// width x height layout of sensor clouds survives
+template <typename Field, typename T>
+inline void threshold(T cloud, float min, float max, bool keep_organized = false)
+{
+	if (cloud->points.empty()) return;
+
+	typedef typename T::value_type::PointType PointT;
+	typedef pcl::PredicateAnd<pcl::FiniteXYZ<PointT>, pcl::FieldRange<PointT, Field> > Predicate;
+
+	pcl::PredicateFilter<PointT, Predicate> pass(Predicate(pcl::FiniteXYZ<PointT>(), pcl::FieldRange<PointT, Field>(min, max)));
+	pass.setInputCloud(cloud);
+	pass.setKeepOrganized(keep_organized);
+	pass.filter(*cloud);
+}
+
 template <typename T>
-inline void threshold(T cloud, const char *dimension, float min, float max)
+inline void threshold(T cloud, const char *dimension, float min, float max, bool keep_organized = false)
 {
 	if (cloud->points.empty()) return;
 
+	if (strcmp(dimension, "x") == 0) return threshold<pcl::fields::x>(cloud, min, max, keep_organized);
+	if (strcmp(dimension, "y") == 0) return threshold<pcl::fields::y>(cloud, min, max, keep_organized);
+	if (strcmp(dimension, "z") == 0) return threshold<pcl::fields::z>(cloud, min, max, keep_organized);
+
 	pcl::PassThrough<typename T::value_type::PointType> pass;
 	pass.setInputCloud(cloud);
 	pass.setFilterFieldName(dimension);
 	pass.setFilterLimits(min, max);
+	pass.setKeepOrganized(keep_organized);
 	pass.filter(*cloud);
 }
 
+template <typename Field, typename T>
+inline void threshold(T cloud, pcl::PointIndices::Ptr &indices, float min, float max)
+{
+	typedef typename T::value_type::PointType PointT;
+	typedef pcl::PredicateAnd<pcl::FiniteXYZ<PointT>, pcl::FieldRange<PointT, Field> > Predicate;
+
+	pcl::PredicateFilter<PointT, Predicate> pass(Predicate(pcl::FiniteXYZ<PointT>(), pcl::FieldRange<PointT, Field>(min, max)));
+	filterIndices(pass, cloud, indices);
+}
+
+template <typename T>
+inline void threshold(T cloud, pcl::PointIndices::Ptr &indices, const char *dimension, float min, float max)
+{
+	if (strcmp(dimension, "x") == 0) return threshold<pcl::fields::x>(cloud, indices, min, max);
+	if (strcmp(dimension, "y") == 0) return threshold<pcl::fields::y>(cloud, indices, min, max);
+	if (strcmp(dimension, "z") == 0) return threshold<pcl::fields::z>(cloud, indices, min, max);
+
+	pcl::PassThrough<typename T::value_type::PointType> pass;
+	pass.setFilterFieldName(dimension);
+	pass.setFilterLimits(min, max);
+	filterIndices(pass, cloud, indices);
+}
+
+//
+// crop
+//
+// keeps the points inside a pcl::ConvexRegion: a band along a plane, an
+// oriented box or a prism over a convex polygon. the points are tested a
+// block at a time, branch free, and copied once.
+//
+template <typename T>
+inline void crop(T cloud, const pcl::ConvexRegion<typename T::value_type::PointType> &region, bool keep_organized = false)
+{
+	if (cloud->points.empty()) return;
+
+	typedef typename T::value_type::PointType PointT;
+	pcl::PredicateFilter<PointT, pcl::ConvexRegion<PointT> > pass(region);
+	pass.setInputCloud(cloud);
+	pass.setKeepOrganized(keep_organized);
+	pass.filter(*cloud);
+}
+
+template <typename T>
+inline void crop(T cloud, pcl::PointIndices::Ptr &indices, const pcl::ConvexRegion<typename T::value_type::PointType> &region)
+{
+	typedef typename T::value_type::PointType PointT;
+	pcl::PredicateFilter<PointT, pcl::ConvexRegion<PointT> > pass(region);
+	filterIndices(pass, cloud, indices);
+}
+
+// plane is (a, b, c, d), keeps the points at a signed distance in [min, max]
+template <typename T>
+inline void cropPlane(T cloud, ofVec4f plane, float min, float max, bool keep_organized = false)
+{
+	pcl::ConvexRegion<typename T::value_type::PointType> region;
+	region.addSlab(Eigen::Vector4f(plane.x, plane.y, plane.z, plane.w), min, max);
+	crop(cloud, region, keep_organized);
+}
+
+// min and max are the corners of the box in its own frame, pose moves the
+// box into the cloud (rotation and translation only)
+template <typename T>
+inline void cropBox(T cloud, ofMatrix4x4 pose, ofVec3f min, ofVec3f max, bool keep_organized = false)
+{
+	Eigen::Matrix4f mat;
+	memcpy(&mat, pose.getPtr(), sizeof(float) * 16);
+
+	pcl::ConvexRegion<typename T::value_type::PointType> region;
+	region.setOrientedBox(Eigen::Affine3f(mat), Eigen::Vector3f(min.x, min.y, min.z), Eigen::Vector3f(max.x, max.y, max.z));
+	crop(cloud, region, keep_organized);
+}
+
+// keeps the points above the polygon hull (e.g. a table top from
+// pcl::ConvexHull) at a height in [height_min, height_max], up being the
+// side of the viewpoint. concave hulls take the slower point in polygon test.
+template <typename T>
+inline void cropPrism(T cloud, pcl::PointIndices::Ptr &indices, const T &hull, float height_min, float height_max, ofVec3f viewpoint = ofVec3f(0, 0, 0))
+{
+	typedef typename T::value_type::PointType PointT;
+
+	pcl::ConvexRegion<PointT> region;
+	if (region.setPrism(*hull, height_min, height_max, Eigen::Vector3f(viewpoint.x, viewpoint.y, viewpoint.z)))
+		return crop(cloud, indices, region);
+
+	pcl::ExtractPolygonalPrismData<PointT> prism;
+	prism.setInputCloud(cloud);
+	if (indices) prism.setIndices(pcl::IndicesPtr(indices, &indices->indices));
+	prism.setInputPlanarHull(hull);
+	prism.setHeightLimits(height_min, height_max);
+	prism.setViewPoint(viewpoint.x, viewpoint.y, viewpoint.z);
+
+	pcl::PointIndices::Ptr result(new pcl::PointIndices);
+	prism.segment(*result);
+	indices = result;
+}
+
+template <typename T>
+inline void cropPrism(T cloud, const T &hull, float height_min, float height_max, ofVec3f viewpoint = ofVec3f(0, 0, 0))
+{
+	pcl::PointIndices::Ptr indices;
+	cropPrism(cloud, indices, hull, height_min, height_max, viewpoint);
+	extract(cloud, indices);
+}
+
+// moves every point along the normal of the plane (a, b, c, d) onto it
+template <typename T>
+inline void projectOnPlane(T cloud, ofVec4f plane)
+{
+	if (cloud->points.empty()) return;
+
+	pcl::ModelCoefficients::Ptr coefficients(new pcl::ModelCoefficients);
+	coefficients->values.resize(4);
+	coefficients->values[0] = plane.x;
+	coefficients->values[1] = plane.y;
+	coefficients->values[2] = plane.z;
+	coefficients->values[3] = plane.w;
+
+	pcl::ProjectInliers<typename T::value_type::PointType> proj;
+	proj.setInputCloud(cloud);
+	proj.setModelType(pcl::SACMODEL_PLANE);
+	proj.setModelCoefficients(coefficients);
+	proj.setCopyAllData(true);
+	proj.filter(*cloud);
+}
+
 //
 // downsample
 //
@@ -110,11 +332,51 @@ inline void downsample(T cloud, ofVec3f resolution = ofVec3f(1, 1, 1))
 	sor.filter(*cloud);
 }
 
+// downsamples the points in indices, the cloud is replaced by the result
+template <typename T>
+inline void downsample(T cloud, const pcl::PointIndices::Ptr &indices, ofVec3f resolution = ofVec3f(1, 1, 1))
+{
+	if (!indices) return downsample(cloud, resolution);
+
+	pcl::VoxelGrid<typename T::value_type::PointType> sor;
+	sor.setInputCloud(cloud);
+	sor.setIndices(pcl::IndicesPtr(indices, &indices->indices));
+	sor.setLeafSize(resolution.x, resolution.y, resolution.z);
+	sor.filter(*cloud);
+}
+
+// threshold() on x, y and z, NaN removal and downsample() in a single pass
+template <typename T>
+inline void cropDownsample(T cloud, ofVec3f min, ofVec3f max, ofVec3f resolution = ofVec3f(1, 1, 1))
+{
+	if (cloud->points.empty()) return;
+
+	pcl::VoxelGrid<typename T::value_type::PointType> sor;
+	sor.setInputCloud(cloud);
+	sor.setLeafSize(resolution.x, resolution.y, resolution.z);
+	sor.setCropBox(Eigen::Vector4f(min.x, min.y, min.z, 0), Eigen::Vector4f(max.x, max.y, max.z, 0));
+	sor.filter(*cloud);
+}
+
+// keeps the cloud organized: every step x step block of the image becomes one
+// point, the centroid of its valid points (average) or its center point
+template <typename T>
+inline void organizedDownsample(T cloud, int step = 2, bool average = true)
+{
+	if (cloud->points.empty()) return;
+
+	pcl::OrganizedDownsample<typename T::value_type::PointType> sor;
+	sor.setInputCloud(cloud);
+	sor.setStep(step);
+	sor.setAverage(average);
+	sor.filter(*cloud);
+}
+
 //
 // outlier removal
 //
 template <typename T>
-inline void statisticalOutlierRemoval(T cloud, int nr_k = 50, double std_mul = 1.0)
+inline void statisticalOutlierRemoval(T cloud, int nr_k = 50, double std_mul = 1.0, int num_threads = 1, bool keep_organized = false)
 {
 	if (cloud->points.empty()) return;
 
@@ -122,11 +384,13 @@ inline void statisticalOutlierRemoval(T cloud, int nr_k = 50, double std_mul = 1
 	sor.setInputCloud(cloud);
 	sor.setMeanK(nr_k);
 	sor.setStddevMulThresh(std_mul);
+	sor.setNumberOfThreads(num_threads);
+	sor.setKeepOrganized(keep_organized);
 	sor.filter(*cloud);
 }
 
 template <typename T>
-inline void radiusOutlierRemoval(T cloud, double radius, int num_min_points)
+inline void radiusOutlierRemoval(T cloud, double radius, int num_min_points, int num_threads = 1, bool keep_organized = false)
 {
 	if (cloud->points.empty()) return;
 
@@ -134,9 +398,31 @@ inline void radiusOutlierRemoval(T cloud, double radius, int num_min_points)
 	outrem.setInputCloud(cloud);
 	outrem.setRadiusSearch(radius);
 	outrem.setMinNeighborsInRadius(num_min_points);
+	outrem.setNumberOfThreads(num_threads);
+	outrem.setKeepOrganized(keep_organized);
 	outrem.filter(*cloud);
 }
 
+template <typename T>
+inline void statisticalOutlierRemoval(T cloud, pcl::PointIndices::Ptr &indices, int nr_k = 50, double std_mul = 1.0, int num_threads = 1)
+{
+	pcl::StatisticalOutlierRemoval<typename T::value_type::PointType> sor;
+	sor.setMeanK(nr_k);
+	sor.setStddevMulThresh(std_mul);
+	sor.setNumberOfThreads(num_threads);
+	filterIndices(sor, cloud, indices);
+}
+
+template <typename T>
+inline void radiusOutlierRemoval(T cloud, pcl::PointIndices::Ptr &indices, double radius, int num_min_points, int num_threads = 1)
+{
+	pcl::RadiusOutlierRemoval<typename T::value_type::PointType> outrem;
+	outrem.setRadiusSearch(radius);
+	outrem.setMinNeighborsInRadius(num_min_points);
+	outrem.setNumberOfThreads(num_threads);
+	filterIndices(outrem, cloud, indices);
+}
+
 //
 // segmentation
 //
@@ -193,11 +479,43 @@ inline vector<T> segmentation(T cloud, const pcl::SacModel model_type = pcl::SAC
 	return result;
 }
 
+//
+// euclidean clusters
+//
+// point indices of every group of points closer than tolerance to each
+// other, biggest first. for vfh() and cvfh() compute them on the cloud with
+// normals, so that the indices match.
+//
+template <typename T>
+inline vector<pcl::PointIndices> euclideanClusters(const T &cloud, float tolerance, int min_points = 1, int max_points = std::numeric_limits<int>::max())
+{
+	vector<pcl::PointIndices> clusters;
+	if (cloud->points.empty()) return clusters;
+
+	KdTree<typename T::value_type::PointType> kdtree(cloud);
+
+	pcl::EuclideanClusterExtraction<typename T::value_type::PointType> ec;
+	ec.setInputCloud(cloud);
+	ec.setSearchMethod(kdtree.kdtree);
+	ec.setClusterTolerance(tolerance);
+	ec.setMinClusterSize(min_points);
+	ec.setMaxClusterSize(max_points);
+	ec.extract(clusters);
+	return clusters;
+}
+
 //
 // normal estimation
 //
+// normalEstimation() and fpfh() can share a pcl::KNeighborList, so that the
+// neighbors of every point are searched once for both:
+//
+//	pcl::KNeighborList::Ptr neighbors(new pcl::KNeighborList);
+//	normalEstimation(cloud, cloud_with_normals, 20, neighbors);
+//	FPFHPointCloud features = fpfh(cloud_with_normals, 20, 4, neighbors);
+//
 template <typename T1, typename T2>
-inline void normalEstimation(const T1 &cloud, T2 &output_cloud_with_normals)
+inline void normalEstimation(const T1 &cloud, T2 &output_cloud_with_normals, int k = 20, const pcl::KNeighborList::Ptr &neighbors = pcl::KNeighborList::Ptr())
 {
 	if (cloud->points.empty()) return;
 
@@ -208,13 +526,123 @@ inline void normalEstimation(const T1 &cloud, T2 &output_cloud_with_normals)
 
 	n.setInputCloud(cloud);
 	n.setSearchMethod(kdtree.kdtree);
-	n.setKSearch(20);
+	n.setKSearch(k);
+	n.setNeighborCache(neighbors);
+	n.compute(*normals);
+
+	output_cloud_with_normals = T2(new typename T2::value_type);
+	pcl::concatenateFields(*cloud, *normals, *output_cloud_with_normals);
+
+	// the cloud with normals holds the same points, so fpfh() can use the neighbors too
+	if (neighbors && neighbors->holds(cloud, cloud->points.size(), k))
+		neighbors->cloud = output_cloud_with_normals;
+}
+
+//
+// approximate normal estimation
+//
+// coarse normals for large clouds, e.g. static scans. no neighbors are
+// searched: the point moments are summed once per voxel of leaf_size, and a
+// point gets the normal of the 3x3x3 voxels around its own.
+//
+template <typename T1, typename T2>
+inline void approximateNormalEstimation(const T1 &cloud, T2 &output_cloud_with_normals, float leaf_size, int num_threads = 1)
+{
+	if (cloud->points.empty()) return;
+
+	pcl::NormalEstimationOMP<typename T1::value_type::PointType, NormalType> n(num_threads);
+	NormalPointCloud normals(new typename NormalPointCloud::value_type);
+
+	n.setInputCloud(cloud);
+	n.setApproximationLeafSize(leaf_size);
 	n.compute(*normals);
 
 	output_cloud_with_normals = T2(new typename T2::value_type);
 	pcl::concatenateFields(*cloud, *normals, *output_cloud_with_normals);
 }
 
+//
+// fpfh
+//
+// FPFH descriptor of every point of a cloud with normals, in the same order.
+// points without neighbors get NaN descriptors.
+//
+template <typename T>
+inline FPFHPointCloud fpfh(const T &cloud_with_normals, int k = 20, int num_threads = 1, const pcl::KNeighborList::Ptr &neighbors = pcl::KNeighborList::Ptr())
+{
+	typedef typename T::value_type::PointType P;
+
+	FPFHPointCloud features(new typename FPFHPointCloud::value_type);
+	if (cloud_with_normals->points.empty()) return features;
+
+	pcl::FPFHEstimation<P, P, FPFHType> fpfh;
+	fpfh.setInputCloud(cloud_with_normals);
+	fpfh.setInputNormals(cloud_with_normals);
+	fpfh.setKSearch(k);
+	fpfh.setNumberOfThreads(num_threads);
+	fpfh.setNeighborCache(neighbors);
+	fpfh.compute(*features);
+	return features;
+}
+
+//
+// vfh / cvfh
+//
+// global descriptors of all the clusters of a frame at once, e.g. for object
+// classification:
+//
+//	vector<pcl::PointIndices> clusters = euclideanClusters(cloud_with_normals, 0.02, 100);
+//	VFHPointCloud descriptors = vfh(cloud_with_normals, clusters, 4);
+//
+// the clusters are processed in parallel. vfh() gives one descriptor per
+// cluster, in the same order, cvfh() one cloud of descriptors per cluster
+// (one per stable region of the cluster).
+//
+template <typename T>
+inline VFHPointCloud vfh(const T &cloud_with_normals, const vector<pcl::PointIndices> &clusters, int num_threads = 1, ofVec3f viewpoint = ofVec3f(0, 0, 0))
+{
+	typedef typename T::value_type::PointType P;
+
+	VFHPointCloud descriptors(new typename VFHPointCloud::value_type);
+	if (cloud_with_normals->points.empty()) return descriptors;
+
+	pcl::VFHEstimation<P, P, VFHType> vfh;
+	vfh.setInputCloud(cloud_with_normals);
+	vfh.setInputNormals(cloud_with_normals);
+	vfh.setViewPoint(viewpoint.x, viewpoint.y, viewpoint.z);
+	vfh.setNumberOfThreads(num_threads);
+	vfh.computeClusters(clusters, *descriptors);
+	return descriptors;
+}
+
+template <typename T>
+inline vector<VFHPointCloud> cvfh(const T &cloud_with_normals, const vector<pcl::PointIndices> &clusters, int num_threads = 1, ofVec3f viewpoint = ofVec3f(0, 0, 0))
+{
+	typedef typename T::value_type::PointType P;
+
+	vector<VFHPointCloud> descriptors(clusters.size());
+	for (size_t i = 0; i < clusters.size(); i++)
+		descriptors[i] = VFHPointCloud(new typename VFHPointCloud::value_type);
+	if (cloud_with_normals->points.empty()) return descriptors;
+
+	// cvfh works on the whole input, so every cluster is copied out and gets
+	// its own estimator
+	if (num_threads < 1) num_threads = 1;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+	for (int i = 0; i < (int)clusters.size(); i++)
+	{
+		typename T::value_type::Ptr cluster(new typename T::value_type);
+		pcl::copyPointCloud(*cloud_with_normals, clusters[i].indices, *cluster);
+
+		pcl::CVFHEstimation<P, P, VFHType> cvfh;
+		cvfh.setInputCloud(cluster);
+		cvfh.setInputNormals(cluster);
+		cvfh.setViewPoint(viewpoint.x, viewpoint.y, viewpoint.z);
+		cvfh.compute(*descriptors[i]);
+	}
+	return descriptors;
+}
+
 //
 // MLS
 //